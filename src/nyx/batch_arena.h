@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// @brief Bump allocator handing out aligned spans of a single contiguous block. Spans are never freed individually - reset() makes
+/// the whole block available again and grows it only if a bigger one is requested, so consecutive ROI batches and file pairs
+/// keep reusing the same memory instead of going to the heap for every ROI.
+class BatchArena
+{
+public:
+	static constexpr size_t ALIGNMENT = 64;	// cache line
+
+	static size_t aligned (size_t n) { return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+	/// @brief Invalidates all the spans handed out so far and makes sure the block can hold 'capacity' bytes of spans
+	void reset (size_t capacity)
+	{
+		capacity = aligned (capacity);
+		if (capacity > cap)
+		{
+			block.reset();	// give the old block back before allocating a bigger one
+			block.reset (new uint8_t [capacity + ALIGNMENT]);	// not value-initialized on purpose
+			uintptr_t a = reinterpret_cast<uintptr_t> (block.get());
+			base = block.get() + (aligned(a) - a);
+			cap = capacity;
+		}
+		used = 0;
+	}
+
+	/// @brief Returns an aligned span of 'n' bytes or nullptr if the block is exhausted
+	void* allocate (size_t n)
+	{
+		n = aligned (n);
+		if (used + n > cap)
+			return nullptr;
+		void* p = base + used;
+		used += n;
+		return p;
+	}
+
+	/// @brief Gives the block back to the heap
+	void release()
+	{
+		block.reset();
+		base = nullptr;
+		cap = used = 0;
+	}
+
+	size_t capacity() const { return cap; }
+	size_t bytes_used() const { return used; }
+
+private:
+	std::unique_ptr<uint8_t[]> block;
+	uint8_t* base = nullptr;
+	size_t cap = 0,
+		used = 0;
+};
@@ -211,4 +211,26 @@ namespace Nyxus
 		else { throw (std::runtime_error("Tile Loader ERROR: The file can not be opened.")); }
 	}
 
+	// Helper function to determine if a Tiff file can be read in 16-bit buffers without a loss
+	bool check_16bit_unsigned(const std::string& filePath)
+	{
+		if (fs::path(filePath).extension() == ".zarr")
+			return false;
+
+		TIFF* tiff_ = TIFFOpen(filePath.c_str(), "r");
+		if (tiff_ == nullptr)
+			return false;
+
+		uint16_t bitsPerSample = 0, sampleFormat = 1;
+		TIFFGetField(tiff_, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+		TIFFGetField(tiff_, TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+		TIFFClose(tiff_);
+
+		// Loaders treat unknown sample formats as unsigned
+		if (sampleFormat < 1 || sampleFormat > 3)
+			sampleFormat = 1;
+
+		return sampleFormat == 1 && (bitsPerSample == 8 || bitsPerSample == 16);
+	}
+
 } // namespace Nyxus
\ No newline at end of file
@@ -49,4 +49,8 @@ namespace Nyxus
 	/// @brief checks if the Tiff file is tiled or not
 	/// @param filePath File name with complete path
 	bool check_tile_status(const std::string& filePath);
+
+	/// @brief checks if the Tiff file holds unsigned samples of at most 16 bits
+	/// @param filePath File name with complete path
+	bool check_16bit_unsigned(const std::string& filePath);
 } // namespace Nyxus
\ No newline at end of file
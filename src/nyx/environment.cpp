@@ -17,7 +17,6 @@
 #include <iterator>
 #include "environment.h"
 #include "featureset.h"
-#include "features/glcm.h"
 #include "helpers/helpers.h"
 #include "helpers/system_resource.h"
 #include "version.h"
@@ -112,7 +111,7 @@ namespace Nyxus
 			}
 
 			AvailableFeatures af;
-			bool fnameExists = theFeatureSet.findFeatureByString(s_uppr, af);
+			bool fnameExists = theFeatureSet().findFeatureByString(s_uppr, af);
 			if (!fnameExists)
 			{
 				retval = false;
@@ -124,7 +123,7 @@ namespace Nyxus
 
 		// Show help on available features if necessary
 		if (!retval)
-		   theEnvironment.show_featureset_help();
+		   theEnvironment().show_featureset_help();
 
 		return retval;
 	}
@@ -144,6 +143,11 @@ size_t Environment::get_ram_limit()
 	return ram_limit;
 }
 
+void Environment::set_ram_limit (size_t bytes)
+{
+	ram_limit = bytes;
+}
+
 int Environment::get_pixel_distance()
 {
 	return n_pixel_distance;
@@ -172,7 +176,12 @@ void Environment::show_cmdline_help()
 		<< " [" << EMBPIXSZ << " <eps>]\n"
 		<< " [" << LOADERTHREADS << " <lt>]\n"
 		<< " [" << PXLSCANTHREADS << " <st>]\n"
+		<< " [" << PREFETCHDEPTH << " <pd>]\n"
+		<< " [" << PYRAMIDLEVEL << " <pl>]\n"
+		<< " [" << ROIWHITELIST << " <wl>]\n"
 		<< " [" << REDUCETHREADS << " <rt>]\n"
+		<< " [" << REDUCEORDER << " <ro>]\n"
+		<< " [" << PIPELINE << " <pp>]\n"
 		<< " [" << PXLDIST << " <pxd>]\n"
 		<< " [" << COARSEGRAYDEPTH << " <custom number of grayscale levels (default: 256)>]\n"
 		<< " [" << GLCMANGLES << " one or more comma separated rotation angles from set {0, 45, 90, and 135}, default is " << GLCMANGLES << "0,45,90,135 \n"
@@ -190,9 +199,15 @@ void Environment::show_cmdline_help()
 		<< "\t<od> - output directory \n"
 		<< "\t<res> - number of pixels per centimeter, an integer or floating point number \n"
 		<< "\t<eps> - [default = 0] \n"
-		<< "\t<lt> - number of image loader threads [default = 1] \n"
-		<< "\t<st> - number of pixel scanner threads within a TIFF tile [default = 1] \n"
+		<< "\t<lt> - number of threads decoding image tiles ahead of pixel scanning [default = 1] \n"
+		<< "\t<st> - number of threads scanning image tiles in phase 1 [default = 1] \n"
+		<< "\t<pd> - number of tiles decoded ahead by a background thread, 0 to disable prefetching [default = 0] \n"
+		<< "\t<pl> - resolution level of pyramidal OME-TIFF and OME-Zarr images to process, e.g. for a quick low-resolution pre-screening. \n"
+		<< "\t\tPositions and sizes are in pixels of that level [default = 0, the full resolution] \n"
+		<< "\t<wl> - comma separated labels of ROIs to process, e.g. ROIs selected by a pre-screening. Ignored in the single-ROI mode [default: all the ROIs] \n"
 		<< "\t<rt> - number of feature reduction threads [default = 1] \n"
+		<< "\t<ro> - 'feature' to calculate a feature group over all the ROIs of a batch at a time or 'roi' to calculate all the features of a ROI at a time [default = 'feature'] \n"
+		<< "\t<pp> - 'true' to scan the next file pair and save the previous one's results while a file pair is being processed, within the RAM limit [default = 'false'] \n"
 		<< "\t<pxd> - number of pixels as neighbor features radius [default = 5] \n"
 		<< "\t<verbo> - levels of verbosity 0 (silence), 2 (timing), 4 (roi diagnostics), 8 (granular diagnostics) [default = 0] \n";
 }
@@ -212,7 +227,12 @@ void Environment::show_summary(const std::string &head, const std::string &tail)
 			  << "\toutput type\t" << rawOutpType << "\n"
 			  << "\t# of image loader threads\t" << n_loader_threads << "\n"
 			  << "\t# of pixel scanner threads\t" << n_pixel_scan_threads << "\n"
+			  << "\ttile prefetch depth\t" << n_prefetch_depth << "\n"
+			  << "\tpyramid level\t" << pyramid_level << "\n"
+			  << "\t# of whitelisted ROIs\t" << roiWhitelist.size() << "\n"
 			  << "\t# of post-processing threads\t" << n_reduce_threads << "\n"
+			  << "\treduction order\t" << (roi_major_reduce ? "roi" : "feature") << "\n"
+			  << "\tpipelined file pairs\t" << (pipelined ? "yes" : "no") << "\n"
 			  << "\tpixel distance\t" << n_pixel_distance << "\n"
 			  << "\tverbosity level\t" << verbosity_level << "\n";
 
@@ -244,17 +264,10 @@ void Environment::show_summary(const std::string &head, const std::string &tail)
 			std::cout << ", ";
 		std::cout << ang;
 	}
-	std::cout << "\tshould match GLCMFeature angles\t{";
-	for (auto ang : GLCMFeature::angles)
-	{
-		if (ang != GLCMFeature::angles[0])
-			std::cout << ", ";
-		std::cout << ang;
-	}
-	std::cout << "}\n";
+	std::cout << "\n";
 
 	// Oversized ROI limit
-	std::cout << "\tbatch and oversized ROI lower limit " << theEnvironment.get_ram_limit() << " bytes\n";
+	std::cout << "\tbatch and oversized ROI lower limit " << theEnvironment().get_ram_limit() << " bytes\n";
 
 	std::cout << tail;
 }
@@ -329,25 +342,25 @@ bool Environment::find_int_argument(std::vector<std::string>::iterator &i, const
 
 void Environment::process_feature_list()
 {
-	theFeatureSet.enableAll(false); // First, disable all
+	theFeatureSet().enableAll(false); // First, disable all
 	for (auto &s : desiredFeatures) // Second, iterate uppercased feature names
 	{
 		// Check if features are requested via a group nickname
 		if (s == FEA_NICK_ALL)
 		{
-			theFeatureSet.enableAll();
+			theFeatureSet().enableAll();
 			break; // No need to bother of others
 		}
 		if (s == FEA_NICK_ALL_BUT_GABOR)
 		{
-			theFeatureSet.enableAll();
+			theFeatureSet().enableAll();
 			auto F = {GABOR};
-			theFeatureSet.disableFeatures(F);
+			theFeatureSet().disableFeatures(F);
 			break; // No need to bother of others
 		}
 		if (s == FEA_NICK_ALL_BUT_GLCM)
 		{
-			theFeatureSet.enableAll();
+			theFeatureSet().enableAll();
 			auto F = {
 				GLCM_ANGULAR2NDMOMENT,
 				GLCM_CONTRAST,
@@ -362,7 +375,7 @@ void Environment::process_feature_list()
 				GLCM_DIFFERENCEENTROPY,
 				GLCM_INFOMEAS1,
 				GLCM_INFOMEAS2};
-			theFeatureSet.disableFeatures(F);
+			theFeatureSet().disableFeatures(F);
 			break; // No need to bother of others
 		}
 
@@ -392,7 +405,7 @@ void Environment::process_feature_list()
 				INTERQUARTILE_RANGE,
 				ROBUST_MEAN_ABSOLUTE_DEVIATION,
 				MASS_DISPLACEMENT};
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 		if (s == FEA_NICK_ALL_MORPHOLOGY)
@@ -425,7 +438,7 @@ void Environment::process_feature_list()
 				EDGE_MAX_INTENSITY,
 				EDGE_MIN_INTENSITY,
 				CIRCULARITY};
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 		if (s == FEA_NICK_BASIC_MORPHOLOGY)
@@ -439,7 +452,7 @@ void Environment::process_feature_list()
 				BBOX_XMIN,
 				BBOX_HEIGHT,
 				BBOX_WIDTH};
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 		if (s == FEA_NICK_ALL_GLCM)
@@ -461,7 +474,7 @@ void Environment::process_feature_list()
 				GLCM_SUMENTROPY,
 				GLCM_SUMVARIANCE,
 				GLCM_VARIANCE };
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 		if (s == FEA_NICK_ALL_GLRLM)
@@ -483,7 +496,7 @@ void Environment::process_feature_list()
 				GLRLM_SRHGLE,
 				GLRLM_LRLGLE,
 				GLRLM_LRHGLE};
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 		if (s == FEA_NICK_ALL_GLSZM)
@@ -505,7 +518,7 @@ void Environment::process_feature_list()
 				GLSZM_SAHGLE,
 				GLSZM_LALGLE,
 				GLSZM_LAHGLE};
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 		if (s == FEA_NICK_ALL_GLDM)
@@ -525,7 +538,7 @@ void Environment::process_feature_list()
 				GLDM_SDHGLE,
 				GLDM_LDLGLE,
 				GLDM_LDHGLE};
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 		if (s == FEA_NICK_ALL_NGTDM)
@@ -536,13 +549,13 @@ void Environment::process_feature_list()
 				NGTDM_BUSYNESS,
 				NGTDM_COMPLEXITY,
 				NGTDM_STRENGTH};
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			continue;
 		}
 
 		if (s == FEA_NICK_ALL_EASY)
 		{
-			theFeatureSet.enableAll();
+			theFeatureSet().enableAll();
 			auto F = {
 				//=== Gabor
 				GABOR,
@@ -643,7 +656,7 @@ void Environment::process_feature_list()
 				WEIGHTED_HU_M7
 			};
 
-			theFeatureSet.disableFeatures(F);
+			theFeatureSet().disableFeatures(F);
 
 			break; // No need to bother of others
 		}
@@ -660,17 +673,17 @@ void Environment::process_feature_list()
 				ANG_BW_NEIGHBORS_MEAN,
 				ANG_BW_NEIGHBORS_STDDEV,
 				ANG_BW_NEIGHBORS_MODE };
-			theFeatureSet.enableFeatures(F);
+			theFeatureSet().enableFeatures(F);
 			break; // No need to bother of others
 		}
 		// Process features individually
 		AvailableFeatures af;
-		if (!theFeatureSet.findFeatureByString(s, af))
+		if (!theFeatureSet().findFeatureByString(s, af))
 		{
 			throw std::invalid_argument("Error: '" + s + "' is not a valid feature name. \n");
 		}
 
-		theFeatureSet.enableFeature(af);
+		theFeatureSet().enableFeature(af);
 	}
 }
 
@@ -705,7 +718,12 @@ int Environment::parse_cmdline(int argc, char **argv)
 				find_string_argument(i, EMBPIXSZ, embedded_pixel_size) ||
 				find_string_argument(i, LOADERTHREADS, loader_threads) ||
 				find_string_argument(i, PXLSCANTHREADS, pixel_scan_threads) ||
+				find_string_argument(i, PREFETCHDEPTH, prefetch_depth) ||
+				find_string_argument(i, PYRAMIDLEVEL, raw_pyramid_level) ||
+				find_string_argument(i, ROIWHITELIST, rawRoiWhitelist) ||
 				find_string_argument(i, REDUCETHREADS, reduce_threads) ||
+				find_string_argument(i, REDUCEORDER, raw_reduce_order) ||
+				find_string_argument(i, PIPELINE, raw_pipeline) ||
 				find_string_argument(i, GLCMANGLES, rawGlcmAngles) ||
 				find_string_argument(i, PXLDIST, pixel_distance) ||
 				find_string_argument(i, COARSEGRAYDEPTH, raw_coarse_grayscale_depth) ||
@@ -809,6 +827,39 @@ int Environment::parse_cmdline(int argc, char **argv)
 		}
 	}
 
+	if (!prefetch_depth.empty())
+	{
+		// string -> integer
+		if (sscanf(prefetch_depth.c_str(), "%d", &n_prefetch_depth) != 1 || n_prefetch_depth < 0)
+		{
+			std::cout << "Error: " << PREFETCHDEPTH << "=" << prefetch_depth << ": expecting a non-negative integer constant\n";
+			return 1;
+		}
+	}
+
+	if (!raw_pyramid_level.empty())
+	{
+		// string -> integer
+		if (sscanf(raw_pyramid_level.c_str(), "%d", &pyramid_level) != 1 || pyramid_level < 0)
+		{
+			std::cout << "Error: " << PYRAMIDLEVEL << "=" << raw_pyramid_level << ": expecting a non-negative integer constant\n";
+			return 1;
+		}
+	}
+
+	//==== Parse the ROI whitelist
+	if (!rawRoiWhitelist.empty())
+	{
+		if (!Nyxus::parse_delimited_string_list_to_ints (rawRoiWhitelist, roiWhitelist))
+		{
+			std::cout << "Error parsing a list of integers " << rawRoiWhitelist << "\n";
+			return 1;
+		}
+
+		// Sorted for binary search
+		std::sort (roiWhitelist.begin(), roiWhitelist.end());
+	}
+
 	if (!reduce_threads.empty())
 	{
 		// string -> integer
@@ -819,6 +870,28 @@ int Environment::parse_cmdline(int argc, char **argv)
 		}
 	}
 
+	if (!raw_reduce_order.empty())
+	{
+		auto rawReduceOrderUC = Nyxus::toupper(raw_reduce_order);
+		if (rawReduceOrderUC != "FEATURE" && rawReduceOrderUC != "ROI")
+		{
+			std::cout << "Error: valid values of " << REDUCEORDER << " are feature or roi\n";
+			return 1;
+		}
+		roi_major_reduce = rawReduceOrderUC == "ROI";
+	}
+
+	if (!raw_pipeline.empty())
+	{
+		auto rawPipelineUC = Nyxus::toupper(raw_pipeline);
+		if (rawPipelineUC != "TRUE" && rawPipelineUC != "FALSE")
+		{
+			std::cout << "Error: valid values of " << PIPELINE << " are true or false\n";
+			return 1;
+		}
+		pipelined = rawPipelineUC == "TRUE";
+	}
+
 	if (!pixel_distance.empty())
 	{
 		// string -> integer
@@ -858,9 +931,6 @@ int Environment::parse_cmdline(int argc, char **argv)
 			std::cout << "Error parsing a list of integers " << rawGlcmAngles << "\n";
 			return 1;
 		}
-
-		// The angle list parsed well, let's tell it to GLCMFeature 
-		GLCMFeature::angles = glcmAngles;
 	}
 
 
@@ -957,7 +1027,7 @@ int Environment::parse_cmdline(int argc, char **argv)
 			EROSIONS_2_VANISH_COMPLEMENT, 
 			GABOR
 		};
-		theFeatureSet.disableFeatures (F);
+		theFeatureSet().disableFeatures (F);
 	}
 
 	//==== Parse resolution
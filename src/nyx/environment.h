@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -20,7 +21,12 @@
 #define EMBPIXSZ "--embeddedpixelsize"			// Environment :: embedded_pixel_size
 #define LOADERTHREADS "--loaderThreads"			// Environment :: n_loader_threads
 #define PXLSCANTHREADS "--pxlscanThreads"		// Environment :: n_pixel_scan_threads
+#define PREFETCHDEPTH "--prefetchDepth"			// Environment :: n_prefetch_depth
+#define PYRAMIDLEVEL "--pyramidLevel"			// Environment :: pyramid_level	-- Example: --pyramidLevel=2
+#define ROIWHITELIST "--roiWhitelist"			// Environment :: roiWhitelist	-- Example: --roiWhitelist=12,15,107
 #define REDUCETHREADS "--reduceThreads"			// Environment :: n_reduce_threads
+#define REDUCEORDER "--reduceOrder"				// Environment :: roi_major_reduce <= valid values "feature" or "roi"
+#define PIPELINE "--pipeline"					// Environment :: pipelined <= valid values "true" or "false"
 #define GLCMANGLES "--glcmAngles"					// Environment :: rotAngles
 #define VERBOSITY "--verbosity"					// Environment :: verbosity_level	-- Example: --verbosity=3
 #define ONLINESTATSTHRESH "--onlineStatsThresh" // Environment :: onlineStatsThreshold	-- Example: --onlineStatsThresh=150
@@ -86,14 +92,37 @@ public:
 	std::string pixel_scan_threads = "";
 	int n_pixel_scan_threads = 1;
 
+	std::string prefetch_depth = "";
+	int n_prefetch_depth = 0;	// number of tiles decoded ahead by a background thread, 0 means no prefetching
+
+	std::string raw_pyramid_level = "";
+	int pyramid_level = 0;	// resolution level of pyramidal images to process, 0 means the full resolution
+
+	std::string rawRoiWhitelist = "";
+	std::vector<int> roiWhitelist;	// sorted labels of ROIs to process, empty means all the ROIs
+
+	/// @brief Tells if ROI 'label' is to be processed. Without a whitelist, all the ROIs are
+	bool roi_whitelisted (int label) const
+	{
+		return roiWhitelist.empty() || std::binary_search (roiWhitelist.begin(), roiWhitelist.end(), label);
+	}
+
 	std::string reduce_threads = "";
 	int n_reduce_threads = 4;
 
+	std::string raw_reduce_order = "";
+	bool roi_major_reduce = false;	// calculate all the features of a ROI in one go instead of a feature group over all the ROIs at a time
+
+	std::string raw_pipeline = "";
+	bool pipelined = false;	// scan the next file pair and save the previous one's results while a file pair is being processed
+
 	std::string pixel_distance = "";
 	int n_pixel_distance = 5;
 
 	std::string rawGlcmAngles = "";
 	std::vector<int> glcmAngles = {0, 45, 90, 135};
+	int glcmOffset = 1,		// GLCMFeature::offset()
+		glcmNLevels = 8;	// GLCMFeature::n_levels()
 
 	std::string verbosity = "";	// 'verbosity_level' is inherited from BasicEnvironment
 
@@ -111,6 +140,7 @@ public:
 	int get_pixel_distance();
 	void set_pixel_distance(int pixelDistance);
 	size_t get_ram_limit();
+	void set_ram_limit (size_t bytes);
 	void process_feature_list();
 
 	/// @brief Slash-terminated application-wide temp directory path
@@ -161,10 +191,14 @@ private:
 
 namespace Nyxus
 {
-	extern Environment theEnvironment;
+	/// @brief Parameters of the current context's extraction
+	Environment& theEnvironment();
+
+	/// @brief Directory of the current context's temporary files (see ContextTempDir)
+	std::string theTempDirPath();
 }
 
-#define VERBOSLVL1(stmt) if(Nyxus::theEnvironment.get_verbosity_level()>=1){stmt;}
-#define VERBOSLVL2(stmt) if(Nyxus::theEnvironment.get_verbosity_level()>=2){stmt;}
-#define VERBOSLVL3(stmt) if(Nyxus::theEnvironment.get_verbosity_level()>=3){stmt;}
-#define VERBOSLVL4(stmt) if(Nyxus::theEnvironment.get_verbosity_level()>=4){stmt;}	
+#define VERBOSLVL1(stmt) if(Nyxus::theEnvironment().get_verbosity_level()>=1){stmt;}
+#define VERBOSLVL2(stmt) if(Nyxus::theEnvironment().get_verbosity_level()>=2){stmt;}
+#define VERBOSLVL3(stmt) if(Nyxus::theEnvironment().get_verbosity_level()>=3){stmt;}
+#define VERBOSLVL4(stmt) if(Nyxus::theEnvironment().get_verbosity_level()>=4){stmt;}	
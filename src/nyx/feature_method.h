@@ -19,8 +19,10 @@ public:
 	//=== Trivial ROI
 	// Calculate the feature for one ROI using cached data and probably caching data
 	virtual void calculate (LR& r) = 0;
-	// Calculate the feature for a vector of ROIs 
-	virtual void parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)  {}
+	// Calculate the feature for trivial ROIs (*ptrLabels)[start] ... (*ptrLabels)[end-1]. Is called concurrently for disjoint ranges of a batch's ROIs, so mustn't change the instance's state
+	virtual void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData) = 0;
+	// Tells if parallel_process() can be called for subsets of a batch's ROIs. If not, it's called once for all of them
+	virtual bool roi_granular() { return true; }
 
 	//=== Oversized ROI
 	virtual void osized_scan_whole_image (LR& r, ImageLoader& imloader);
@@ -28,9 +30,13 @@ public:
 	virtual void osized_add_online_pixel (size_t x, size_t y, uint32_t intensity) = 0;	// Called each time the ROI pixel is being scanned in the raster order
 	virtual void osized_reduce() final {};	// Get rid of this method in all derived
 	virtual void osized_calculate (LR& r, ImageLoader& imloader) = 0;	// Called once right after having scanned the ROI in the raster order. Put your reduction or summarization of data gathered in osized_add_online_pixel()
+	// Tells if osized_calculate() needs nothing but the pixels fed to osized_add_online_pixel(), e.g. not the ROI's pixel cloud
+	virtual bool osized_online_only() { return false; }
+	// Merges the online state of another instance of the feature method fed a disjoint part of the ROI's pixels
+	virtual void osized_merge_online (const FeatureMethod& other) {}
 
 	// Put method-dependent set of calculation results in the standard feature results list further savable as CSV-file
-	virtual void save_value(std::vector<std::vector<double>>& feature_vals) = 0;
+	virtual void save_value(FeatureValues& feature_vals) = 0;
 
 	// Feature-specific cache clean-up 
 	virtual void cleanup_instance() {}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <string>
 #include "feature_mgr.h"
 #include "featureset.h"
@@ -46,6 +47,62 @@ FeatureMethod* FeatureManager::get_feature_method(int idx)
 	return user_requested_features[idx];
 }
 
+std::vector<int> FeatureManager::get_requested_dependencies (int idx)
+{
+	std::vector<int> D;
+	for (auto fcode : user_requested_features[idx]->dependencies)
+		for (int k = 0; k < user_requested_features.size(); k++)
+			if (user_requested_features[k]->provides(fcode))
+			{
+				if (std::find(D.begin(), D.end(), k) == D.end())
+					D.push_back(k);
+				break;
+			}
+	return D;
+}
+
+FeatureMethod* FeatureManager::get_provider (Nyxus::AvailableFeatures fcode)
+{
+	for (auto fm : full_featureset)
+		if (fm->provides(fcode))
+			return fm;
+	return nullptr;
+}
+
+std::vector<Nyxus::AvailableFeatures> FeatureManager::get_calculated_features (const std::vector<Nyxus::AvailableFeatures>& F)
+{
+	std::vector<Nyxus::AvailableFeatures> calculated = F;
+	std::vector<bool> known (Nyxus::AvailableFeatures::_COUNT_, false), 
+		visited (full_featureset.size(), false);
+	for (auto fcode : F)
+		known[fcode] = true;
+
+	// 'calculated' grows while being iterated, so providers of dependencies get visited too
+	for (size_t i = 0; i < calculated.size(); i++)
+		for (size_t k = 0; k < full_featureset.size(); k++)
+		{
+			auto fm = full_featureset[k];
+			if (visited[k] || ! fm->provides(calculated[i]))
+				continue;
+			visited[k] = true;
+
+			for (auto fcode : fm->provided_features)
+				if (! known[fcode])
+				{
+					known[fcode] = true;
+					calculated.push_back (fcode);
+				}
+			for (auto fcode : fm->dependencies)
+				if (! known[fcode])
+				{
+					known[fcode] = true;
+					calculated.push_back (fcode);
+				}
+		}
+
+	return calculated;
+}
+
 void FeatureManager::apply_user_selection()
 {
 	build_user_requested_set();	// The result is 'user_requested_features'
@@ -72,12 +129,12 @@ bool FeatureManager::check_11_correspondence()
 			if (nProviders > 1)	// error - ambiguous provider
 			{
 				success = false;
-				std::cout << "Error: ambiguous provider of feature " << theFeatureSet.findFeatureNameByCode((AvailableFeatures)i_fcode) << " (code " << i_fcode << ").  (Feature is provided by multiple feature methods.) \n";
+				std::cout << "Error: ambiguous provider of feature " << theFeatureSet().findFeatureNameByCode((AvailableFeatures)i_fcode) << " (code " << i_fcode << ").  (Feature is provided by multiple feature methods.) \n";
 			}
 			else	// error - no providers
 			{
 				success = false;
-				std::cout << "Error: feature " << theFeatureSet.findFeatureNameByCode((AvailableFeatures)i_fcode) << " (code " << i_fcode << ") is not provided by any feature method \n";
+				std::cout << "Error: feature " << theFeatureSet().findFeatureNameByCode((AvailableFeatures)i_fcode) << " (code " << i_fcode << ") is not provided by any feature method \n";
 			}
 	}
 
@@ -94,7 +151,8 @@ bool FeatureManager::gather_dependencies()
 	for (const auto fm : full_featureset)
 	{
 		std::vector<Nyxus::AvailableFeatures> extendedDependencies;
-		int n_deps = get_num_fmethods_dependencies (fm, extendedDependencies);
+		std::vector<FeatureMethod*> path;
+		int n_deps = get_num_fmethods_dependencies (fm, extendedDependencies, path);
 
 		// Any cycle (negative number of depends) ?
 		if (n_deps < 0)
@@ -110,7 +168,7 @@ bool FeatureManager::gather_dependencies()
 
 			// Show the user method's extended dependencies 
 			for (auto fcode : extendedDependencies)
-				std::cout << "\t" << theFeatureSet.findFeatureNameByCode(fcode) << "\n";
+				std::cout << "\t" << theFeatureSet().findFeatureNameByCode(fcode) << "\n";
 		)
 
 		// Bind 'fm' to feature methods implementing fm's extended dependency set
@@ -120,7 +178,7 @@ bool FeatureManager::gather_dependencies()
 	return success;
 }
 
-int FeatureManager::get_num_fmethods_dependencies (FeatureMethod * fm, std::vector<Nyxus::AvailableFeatures> & parent_dependencies)
+int FeatureManager::get_num_fmethods_dependencies (FeatureMethod * fm, std::vector<Nyxus::AvailableFeatures> & parent_dependencies, std::vector<FeatureMethod*> & path)
 {
 	// Sanity check
 	if (fm == nullptr)
@@ -129,15 +187,16 @@ int FeatureManager::get_num_fmethods_dependencies (FeatureMethod * fm, std::vect
 		return 0;
 	}
 
+	// Check if 'fm' depends on itself via the chain of dependencies 'path'. If so, there's no need to count the number of dependencies. Instead, return -1. 
+	// (A feature reachable via several chains, e.g. PERIMETER required both directly and via CONVEX_HULL_AREA, isn't a cycle.)
+	if (std::find(path.begin(), path.end(), fm) != path.end())
+		return -1;
+	path.push_back (fm);
+
 	int n_deps = 0;
 
 	for (auto fcode : fm->dependencies)
 	{
-		// Check if dependency 'fcode' is cyclic. If so, there's no need to count the number of dependencies. Instead, return -1.
-		bool cyclic = std::find(parent_dependencies.begin(), parent_dependencies.end(), fcode) != parent_dependencies.end();
-		if (cyclic)
-			return -1;
-
 		// Account for the dependency itself (without children)
 		n_deps++;
 
@@ -166,10 +225,14 @@ int FeatureManager::get_num_fmethods_dependencies (FeatureMethod * fm, std::vect
 		// Analyze the child
 		int n_child_deps = get_num_fmethods_dependencies(
 			providerFM,
-			parent_dependencies); 
+			parent_dependencies, 
+			path); 
+		if (n_child_deps < 0)
+			return -1;
 		n_deps += n_child_deps;
 	}
 
+	path.pop_back();
 	return n_deps;
 }
 
@@ -190,7 +253,7 @@ void FeatureManager::build_user_requested_set()
 
 		// --iterate provided FCodes
 		for (auto fcode : fm->provided_features)
-			if (theFeatureSet.isEnabled(fcode))
+			if (theFeatureSet().isEnabled(fcode))
 			{
 				fmRequested = true;
 				break;
@@ -204,13 +267,15 @@ void FeatureManager::build_user_requested_set()
 			if (std::find(requestedWithDeps.begin(), requestedWithDeps.end(), oneD) == requestedWithDeps.end())
 				requestedWithDeps.push_back(oneD);
 
-			// iterate dependency FCodes and add corresponding FMs to the execute list
-			for (auto dfc : fm->dependencies)
+			// iterate extended dependency FCodes and add corresponding FMs to the execute list
+			for (auto dfc : xdeps[i])
 			{
 				// find the provider
 				for (int k = 0; k < full_featureset.size(); k++)
 				{
 					auto provFM = full_featureset[k];
+					if (! provFM->provides(dfc))
+						continue;
 					auto& provDeps = xdeps[k];
 					oneD = { provFM, provDeps.size() };
 					if (std::find(requestedWithDeps.begin(), requestedWithDeps.end(), oneD) == requestedWithDeps.end())
@@ -229,8 +294,8 @@ void FeatureManager::build_user_requested_set()
 				std::cout << std::get<0>(oneD)->feature_info << " " << std::get<1>(oneD) << " deps \n";
 		)
 
-	// Sort by independence
-	std::sort(requestedWithDeps.begin(), requestedWithDeps.end(),
+	// Sort by independence. A feature method has more extended dependencies than any of the ones it depends on, so this is a topological order
+	std::stable_sort(requestedWithDeps.begin(), requestedWithDeps.end(),
 		[](const std::tuple<FeatureMethod*, int>& a, const std::tuple<FeatureMethod*, int>& b)
 		{
 			return std::get<1>(a) < std::get<1>(b);
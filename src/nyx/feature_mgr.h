@@ -24,6 +24,15 @@ public:
 	// Returns the pointer to a feature method instance
 	FeatureMethod* get_feature_method (int idx);
 
+	// After compiling, returns indices of the requested feature methods providing features that the idx-th one directly depends on
+	std::vector<int> get_requested_dependencies (int idx);
+
+	// Returns the feature method providing feature 'fcode' or nullptr
+	FeatureMethod* get_provider (Nyxus::AvailableFeatures fcode);
+
+	// Returns codes 'F' followed by the other features calculated along with them: features provided by the same feature methods and, recursively, their dependencies
+	std::vector<Nyxus::AvailableFeatures> get_calculated_features (const std::vector<Nyxus::AvailableFeatures>& F);
+
 private:
 	// This test checks if there exists a feature code in Nyxus::AvailableFeatures implemented by multiple feature methods
 	bool check_11_correspondence();
@@ -31,7 +40,7 @@ private:
 	// This test checks for cyclic feature dependencies and populates 'xdeps' 
 	bool gather_dependencies();
 
-	int get_num_fmethods_dependencies(FeatureMethod* fm, std::vector<Nyxus::AvailableFeatures> & parent_dependencies);
+	int get_num_fmethods_dependencies(FeatureMethod* fm, std::vector<Nyxus::AvailableFeatures> & parent_dependencies, std::vector<FeatureMethod*> & path);
 
 	// Builds the requested set by copying items of 'featureset' requested via the command line into 'user_requested_features' along with their depended feature methods
 	void build_user_requested_set();
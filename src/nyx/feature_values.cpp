@@ -0,0 +1,57 @@
+#include "feature_values.h"
+#include "features/gabor.h"
+#include "features/glcm.h"
+#include "features/radial_distribution.h"
+#include "features/zernike.h"
+
+namespace Nyxus
+{
+	// Number of values calculated for a feature code
+	static uint32_t num_values (int code)
+	{
+		if (code >= GLCM_ANGULAR2NDMOMENT && code <= GLCM_VARIANCE)
+			return (uint32_t) std::max (GLCMFeature::angles().size(), size_t(1));	// 1 value per angle
+		if (code >= GLRLM_SRE && code <= GLRLM_LRHGLE)
+			return 4;	// angles 0, 45, 90, and 135
+		switch (code)
+		{
+		case GABOR:
+			return GaborFeature::num_features;
+		case ZERNIKE2D:
+			return ZernikeFeature::NUM_FEATURE_VALS;
+		case FRAC_AT_D:
+			return RadialDistributionFeature::num_features_FracAtD;
+		case MEAN_FRAC:
+			return RadialDistributionFeature::num_features_MeanFrac;
+		case RADIAL_CV:
+			return RadialDistributionFeature::num_features_RadialCV;
+		default:
+			return 1;
+		}
+	}
+}
+
+void FeatureValueLayout::build_full()
+{
+	std::vector<Nyxus::AvailableFeatures> F;
+	for (int i = 0; i < Nyxus::AvailableFeatures::_COUNT_; i++)
+		F.push_back ((Nyxus::AvailableFeatures) i);
+	build (F);
+}
+
+void FeatureValueLayout::build (const std::vector<Nyxus::AvailableFeatures>& F)
+{
+	offsets.assign (Nyxus::AvailableFeatures::_COUNT_, ABSENT);
+	widths.resize (Nyxus::AvailableFeatures::_COUNT_);
+	for (int i = 0; i < Nyxus::AvailableFeatures::_COUNT_; i++)
+		widths[i] = Nyxus::num_values (i);
+
+	rowWidth = 0;
+	for (auto code : F)
+	{
+		if (offsets[code] != ABSENT)
+			continue;
+		offsets[code] = (uint32_t) rowWidth;
+		rowWidth += widths[code];
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "featureset.h"
+#include "features/pixel.h"
+
+/// @brief Column layout of ROI feature value rows. Each laid out feature code owns a fixed-width span of the row: 1 value for
+/// a regular feature and e.g. 1 value per angle for GLCM and GLRLM features or 1 value per coefficient for Zernike ones.
+class FeatureValueLayout
+{
+public:
+	static constexpr uint32_t ABSENT = UINT32_MAX;
+
+	/// @brief Lays out every feature code
+	void build_full();
+
+	/// @brief Lays out codes 'F' in the specified order
+	void build (const std::vector<Nyxus::AvailableFeatures>& F);
+
+	/// @brief Offset of the code's values in the row or ABSENT if the code isn't laid out
+	uint32_t offset (int code) const { return offsets[code]; }
+
+	/// @brief Number of values of a feature code
+	uint32_t width (int code) const { return widths[code]; }
+
+	/// @brief Number of values in a row
+	size_t row_width() const { return rowWidth; }
+
+	bool built() const { return ! offsets.empty(); }
+
+private:
+	std::vector<uint32_t> offsets,
+		widths;
+	size_t rowWidth = 0;
+};
+
+namespace Nyxus
+{
+	FeatureValueLayout& theFeatureValueLayout();
+}
+
+/// @brief Fixed-width span of a row of feature values holding values of one feature code
+class FeatureCell
+{
+public:
+	FeatureCell (StatsReal* p, size_t n) : vals(p), n(n) {}
+
+	StatsReal& operator[] (size_t i) { return vals[i]; }
+	const StatsReal& operator[] (size_t i) const { return vals[i]; }
+	size_t size() const { return n; }
+	StatsReal* begin() { return vals; }
+	StatsReal* end() { return vals + n; }
+	const StatsReal* begin() const { return vals; }
+	const StatsReal* end() const { return vals + n; }
+
+	/// @brief Copies values of range [first, last) zeroing the rest of the span. Values beyond the span's width are dropped
+	template <class It>
+	void assign (It first, It last)
+	{
+		size_t i = 0;
+		for (; first != last && i < n; ++first)
+			vals[i++] = *first;
+		std::fill (vals + i, vals + n, 0.0);
+	}
+
+	/// @brief Sets 'count' first values to 'x' zeroing the rest of the span
+	void assign (size_t count, StatsReal x)
+	{
+		count = std::min (count, n);
+		std::fill (vals, vals + count, x);
+		std::fill (vals + count, vals + n, 0.0);
+	}
+
+	FeatureCell& operator= (const std::vector<StatsReal>& v)
+	{
+		assign (v.begin(), v.end());
+		return *this;
+	}
+
+	std::vector<StatsReal> to_vector() const { return std::vector<StatsReal> (begin(), end()); }
+
+private:
+	StatsReal* vals;
+	size_t n;
+};
+
+/// @brief Row of feature values of a ROI laid out by Nyxus::theFeatureValueLayout. Values of feature codes that aren't laid out
+/// - normally the ones that aren't calculated - are kept aside in separately allocated cells created on demand.
+class FeatureValues
+{
+public:
+	/// @brief Lays the row out by the current layout and zeroes all the values
+	void initialize()
+	{
+		if (! Nyxus::theFeatureValueLayout().built())
+			Nyxus::theFeatureValueLayout().build_full();
+		row.assign (Nyxus::theFeatureValueLayout().row_width(), 0.0);
+		extra.clear();
+	}
+
+	bool empty() const { return row.empty(); }
+
+	FeatureCell operator[] (int code)
+	{
+		uint32_t w = Nyxus::theFeatureValueLayout().width (code),
+			ofs = Nyxus::theFeatureValueLayout().offset (code);
+		if (ofs != FeatureValueLayout::ABSENT)
+			return FeatureCell (row.data() + ofs, w);
+
+		for (auto& x : extra)
+			if (x.first == code)
+				return FeatureCell (x.second.data(), w);
+		extra.push_back ({ code, std::vector<StatsReal>(w, 0.0) });
+		return FeatureCell (extra.back().second.data(), w);
+	}
+
+private:
+	std::vector<StatsReal> row;
+	std::vector<std::pair<int, std::vector<StatsReal>>> extra;
+};
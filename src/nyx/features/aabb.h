@@ -11,9 +11,10 @@ class AABB
 {
 public:
 	AABB() {}
-	AABB(const std::vector<Pixel2> & cloud) 
+	template <class Cloud>
+	AABB(const Cloud & cloud) 
 	{
-		for (auto& px : cloud)
+		for (const auto& px : cloud)
 		{
 			update_x(px.x);
 			update_y(px.y);
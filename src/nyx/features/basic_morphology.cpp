@@ -3,6 +3,7 @@
 #include "histogram.h"
 #include "basic_morphology.h"
 #include "pixel.h"
+#include "../helpers/timing.h"
 
 BasicMorphologyFeatures::BasicMorphologyFeatures(): FeatureMethod("BasicMorphologyFeatures")
 {
@@ -30,28 +31,41 @@ void BasicMorphologyFeatures::calculate(LR& r)
 
 	// --AREA
 	val_AREA_PIXELS_COUNT = n;
-	if (theEnvironment.xyRes > 0.0)
-			val_AREA_UM2  = n * std::pow(theEnvironment.pixelSizeUm, 2);
+	if (theEnvironment().xyRes > 0.0)
+			val_AREA_UM2  = n * std::pow(theEnvironment().pixelSizeUm, 2);
+
+	// Cached pixels' coordinates are relative to (x0, y0)
+	StatsInt x0 = r.raw_pixels.get_x0(),
+		y0 = r.raw_pixels.get_y0();
 
 	// --CENTROID_XY
 	double cen_x = 0.0,
 		cen_y = 0.0;
-	for (auto& px : r.raw_pixels)
+	r.raw_pixels.visit ([&] (const auto* X, const auto* Y, const PixIntens* I, size_t np)
 	{
-		cen_x += px.x;
-		cen_y += px.y;
-	}
+		for (size_t i = 0; i < np; i++)
+		{
+			cen_x += x0 + X[i];
+			cen_y += y0 + Y[i];
+		}
+	});
 
 	val_CENTROID_X = cen_x;
 	val_CENTROID_Y = cen_y;
 	
 	// --COMPACTNESS
 	Moments2 mom2;
-	for (auto& px : r.raw_pixels)
+	int cx = cen_x,	// Pixel2::sqdist() flavor taking integer coordinates
+		cy = cen_y;
+	r.raw_pixels.visit ([&] (const auto* X, const auto* Y, const PixIntens* I, size_t np)
 	{
-		double dst = std::sqrt(px.sqdist(cen_x, cen_y));
-		mom2.add(dst);
-	}
+		for (size_t i = 0; i < np; i++)
+		{
+			double dx = double(cx) - double(x0 + X[i]),
+				dy = double(cy) - double(y0 + Y[i]);
+			mom2.add (std::sqrt(dx * dx + dy * dy));
+		}
+	});
 	val_COMPACTNESS = mom2.std() / n;
 
 	//==== Basic morphology :: Bounding box
@@ -61,25 +75,24 @@ void BasicMorphologyFeatures::calculate(LR& r)
 	val_BBOX_HEIGHT = r.aabb.get_height();
 
 	//==== Basic morphology :: Centroids
-	val_CENTROID_X = val_CENTROID_Y = 0;
-	for (auto& px : r.raw_pixels)
-	{
-		val_CENTROID_X += px.x;
-		val_CENTROID_Y += px.y;
-	}
+	val_CENTROID_X = cen_x;
+	val_CENTROID_Y = cen_y;
 	val_CENTROID_X /= n;
 	val_CENTROID_Y /= n;
 
 	//==== Basic morphology :: Weighted centroids
 	double x_mass = 0, y_mass = 0, mass = 0;
 
-	for (auto& px : r.raw_pixels)
+	r.raw_pixels.visit ([&] (const auto* X, const auto* Y, const PixIntens* I, size_t np)
 	{
-		// the "+1" is only for compatability with matlab code (where index starts from 1) 
-		x_mass = x_mass + (px.x + 1) * px.inten;
-		y_mass = y_mass + (px.y + 1) * px.inten;
-		mass += px.inten;
-	}
+		for (size_t i = 0; i < np; i++)
+		{
+			// the "+1" is only for compatability with matlab code (where index starts from 1) 
+			x_mass = x_mass + (x0 + X[i] + 1) * I[i];
+			y_mass = y_mass + (y0 + Y[i] + 1) * I[i];
+			mass += I[i];
+		}
+	});
 
 	if (mass > 0)
 	{
@@ -113,16 +126,15 @@ void BasicMorphologyFeatures::osized_calculate(LR& r, ImageLoader& imloader)
 
 	// --AREA
 	val_AREA_PIXELS_COUNT = n;
-	if (theEnvironment.xyRes > 0.0)
-		val_AREA_UM2 = n * std::pow(theEnvironment.pixelSizeUm, 2);
+	if (theEnvironment().xyRes > 0.0)
+		val_AREA_UM2 = n * std::pow(theEnvironment().pixelSizeUm, 2);
 
 	// --CENTROID_XY
 	double cen_x = 0.0,
 		cen_y = 0.0;
 	
-	for (size_t i = 0; i < r.osized_pixel_cloud.get_size(); i++)	// for (auto& px : r.raw_pixels)
+	for (const Pixel2& px : r.osized_pixel_cloud)	// for (auto& px : r.raw_pixels)
 	{
-		auto px = r.osized_pixel_cloud.get_at(i);
 		cen_x += px.x;
 		cen_y += px.y;
 	}
@@ -132,9 +144,8 @@ void BasicMorphologyFeatures::osized_calculate(LR& r, ImageLoader& imloader)
 
 	// --COMPACTNESS
 	Moments2 mom2;
-	for (size_t i = 0; i < r.osized_pixel_cloud.get_size(); i++)	// for (auto& px : r.raw_pixels)
+	for (const Pixel2& px : r.osized_pixel_cloud)	// for (auto& px : r.raw_pixels)
 	{
-		auto px = r.osized_pixel_cloud.get_at(i);
 		double dst = std::sqrt(px.sqdist(cen_x, cen_y));
 		mom2.add(dst);
 	}
@@ -148,9 +159,8 @@ void BasicMorphologyFeatures::osized_calculate(LR& r, ImageLoader& imloader)
 
 	//==== Basic morphology :: Centroids
 	val_CENTROID_X = val_CENTROID_Y = 0;
-	for (size_t i = 0; i < r.osized_pixel_cloud.get_size(); i++)	// for (auto& px : r.raw_pixels)
+	for (const Pixel2& px : r.osized_pixel_cloud)	// for (auto& px : r.raw_pixels)
 	{
-		auto px = r.osized_pixel_cloud.get_at(i);
 		val_CENTROID_X += px.x;
 		val_CENTROID_Y += px.y;
 	}
@@ -160,9 +170,8 @@ void BasicMorphologyFeatures::osized_calculate(LR& r, ImageLoader& imloader)
 	//==== Basic morphology :: Weighted centroids
 	double x_mass = 0, y_mass = 0, mass = 0;
 
-	for (size_t i = 0; i < r.osized_pixel_cloud.get_size(); i++)	// for (auto& px : r.raw_pixels)
+	for (const Pixel2& px : r.osized_pixel_cloud)	// for (auto& px : r.raw_pixels)
 	{
-		auto px = r.osized_pixel_cloud.get_at(i);
 		// the "+1" is only for compatability with matlab code (where index starts from 1) 
 		x_mass = x_mass + (px.x + 1) * px.inten;
 		y_mass = y_mass + (px.y + 1) * px.inten;
@@ -193,7 +202,7 @@ void BasicMorphologyFeatures::osized_calculate(LR& r, ImageLoader& imloader)
 	val_ASPECT_RATIO = r.aabb.get_width() / r.aabb.get_height();
 }
 
-void BasicMorphologyFeatures::save_value(std::vector<std::vector<double>>& fvals)
+void BasicMorphologyFeatures::save_value(FeatureValues& fvals)
 {
 	fvals[AREA_PIXELS_COUNT][0] = val_AREA_PIXELS_COUNT;
 	fvals[AREA_UM2][0] = val_AREA_UM2;
@@ -211,15 +220,13 @@ void BasicMorphologyFeatures::save_value(std::vector<std::vector<double>>& fvals
 	fvals[WEIGHTED_CENTROID_Y][0] = val_WEIGHTED_CENTROID_Y;
 }
 
-void BasicMorphologyFeatures::parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)
+void BasicMorphologyFeatures::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
-	size_t jobSize = roi_labels.size(),
-		workPerThread = jobSize / n_threads;
-
-	runParallel(BasicMorphologyFeatures::parallel_process_1_batch, n_threads, workPerThread, jobSize, &roi_labels, &roiData);
+	STOPWATCH("Morphology/Basic/E/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
 }
 
-void BasicMorphologyFeatures::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void BasicMorphologyFeatures::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	// Calculate the feature for each batch ROI item 
 	for (auto i = firstitem; i < lastitem; i++)
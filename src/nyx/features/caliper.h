@@ -13,9 +13,9 @@ public:
 	void calculate (LR& r);
 	void osized_add_online_pixel (size_t x, size_t y, uint32_t intensity) {};		// No online mode for this feature
 	void osized_calculate (LR& r, ImageLoader& imloader);
-	void save_value (std::vector<std::vector<double>>& feature_vals);
-	static void parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
-	void parallel_process (std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads);
+	void save_value (FeatureValues& feature_vals);
+	static void parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 	// Compatibility with manual reduce
 	static bool required(const FeatureSet& fs) {
@@ -46,9 +46,9 @@ public:
 	void calculate(LR& r);
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity) {};		// No online mode for this feature
 	void osized_calculate(LR& r, ImageLoader& imloader);
-	void save_value(std::vector<std::vector<double>>& feature_vals);
-	static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
-	void parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads);
+	void save_value(FeatureValues& feature_vals);
+	static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 	// Compatibility with manual reduce
 	static bool required(const FeatureSet& fs) {
@@ -96,9 +96,9 @@ public:
 	void calculate(LR& r);
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity) {};		
 	void osized_calculate(LR& r, ImageLoader& imloader);
-	void save_value(std::vector<std::vector<double>>& feature_vals);
-	static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
-	void parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads);
+	void save_value(FeatureValues& feature_vals);
+	static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 	// Compatibility with manual reduce
 	static bool required(const FeatureSet& fs) {
@@ -1,6 +1,7 @@
 #include "caliper.h"
 #include "../parallel.h"
 #include "rotation.h"
+#include "../helpers/timing.h"
 
 CaliperFeretFeature::CaliperFeretFeature() : FeatureMethod("CaliperFeretFeature")
 {
@@ -16,6 +17,8 @@ CaliperFeretFeature::CaliperFeretFeature() : FeatureMethod("CaliperFeretFeature"
 			STAT_FERET_DIAM_MEDIAN,
 			STAT_FERET_DIAM_STDDEV,
 			STAT_FERET_DIAM_MODE});
+
+	add_dependencies ({ CONVEX_HULL_AREA });	// uses the convex hull
 }
 
 void CaliperFeretFeature::calculate(LR& r)
@@ -60,7 +63,7 @@ void CaliperFeretFeature::calculate(LR& r)
 	}
 }
 
-void CaliperFeretFeature::save_value(std::vector<std::vector<double>>& fvals)
+void CaliperFeretFeature::save_value(FeatureValues& fvals)
 {
 	fvals[MIN_FERET_DIAMETER][0] = minFeretDiameter;
 	fvals[MAX_FERET_DIAMETER][0] = maxFeretDiameter;
@@ -250,15 +253,13 @@ void CaliperFeretFeature::osized_calculate(LR& r, ImageLoader&)
 	}
 }
 
-void CaliperFeretFeature::parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)
+void CaliperFeretFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
-	size_t jobSize = roi_labels.size(),
-		workPerThread = jobSize / n_threads;
-
-	runParallel(CaliperFeretFeature::parallel_process_1_batch, n_threads, workPerThread, jobSize, &roi_labels, &roiData);
+	STOPWATCH("Morphology/Feret/F/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
 }
 
-void CaliperFeretFeature::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void CaliperFeretFeature::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	// Calculate the feature for each batch ROI item 
 	for (auto i = firstitem; i < lastitem; i++)
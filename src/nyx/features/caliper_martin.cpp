@@ -1,6 +1,7 @@
 #include "caliper.h"
 #include "../parallel.h"
 #include "rotation.h"
+#include "../helpers/timing.h"
 
 CaliperMartinFeature::CaliperMartinFeature() : FeatureMethod("CaliperMartinFeature")
 {
@@ -12,6 +13,8 @@ CaliperMartinFeature::CaliperMartinFeature() : FeatureMethod("CaliperMartinFeatu
 			STAT_MARTIN_DIAM_MEDIAN,
 			STAT_MARTIN_DIAM_STDDEV,
 			STAT_MARTIN_DIAM_MODE });
+
+	add_dependencies ({ CONVEX_HULL_AREA });	// uses the convex hull
 }
 
 void CaliperMartinFeature::calculate(LR& r)
@@ -32,7 +35,7 @@ void CaliperMartinFeature::calculate(LR& r)
 	_mode = (double)s.mode;
 }
 
-void CaliperMartinFeature::save_value(std::vector<std::vector<double>>& fvals)
+void CaliperMartinFeature::save_value(FeatureValues& fvals)
 {
 	fvals[STAT_MARTIN_DIAM_MIN][0] = _min;
 	fvals[STAT_MARTIN_DIAM_MAX][0] = _max;
@@ -195,15 +198,13 @@ void CaliperMartinFeature::osized_calculate(LR& r, ImageLoader&)
 	_mode = (double)s.mode;
 }
 
-void CaliperMartinFeature::parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)
+void CaliperMartinFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
-	size_t jobSize = roi_labels.size(),
-		workPerThread = jobSize / n_threads;
-
-	runParallel(CaliperMartinFeature::parallel_process_1_batch, n_threads, workPerThread, jobSize, &roi_labels, &roiData);
+	STOPWATCH("Morphology/Martin/M/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
 }
 
-void CaliperMartinFeature::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void CaliperMartinFeature::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	// Calculate the feature for each batch ROI item 
 	for (auto i = firstitem; i < lastitem; i++)
@@ -1,6 +1,7 @@
 #include "caliper.h"
 #include "../parallel.h"
 #include "rotation.h"
+#include "../helpers/timing.h"
 
 CaliperNassensteinFeature::CaliperNassensteinFeature() : FeatureMethod("CaliperNassensteinFeature")
 {
@@ -11,6 +12,8 @@ CaliperNassensteinFeature::CaliperNassensteinFeature() : FeatureMethod("CaliperN
 			STAT_NASSENSTEIN_DIAM_MEDIAN,
 			STAT_NASSENSTEIN_DIAM_STDDEV,
 			STAT_NASSENSTEIN_DIAM_MODE });
+
+	add_dependencies ({ CONVEX_HULL_AREA });	// uses the convex hull
 }
 
 void CaliperNassensteinFeature::calculate (LR& r)
@@ -31,7 +34,7 @@ void CaliperNassensteinFeature::calculate (LR& r)
 	_mode = (double)s.mode;
 }
 
-void CaliperNassensteinFeature::save_value (std::vector<std::vector<double>>& fvals)
+void CaliperNassensteinFeature::save_value (FeatureValues& fvals)
 {
 	fvals[STAT_NASSENSTEIN_DIAM_MIN][0] = _min;
 	fvals[STAT_NASSENSTEIN_DIAM_MAX][0] = _max;
@@ -194,15 +197,13 @@ void CaliperNassensteinFeature::osized_calculate (LR& r, ImageLoader&)
 	_mode = (double)s.mode;
 }
 
-void CaliperNassensteinFeature::parallel_process (std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)
+void CaliperNassensteinFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
-	size_t jobSize = roi_labels.size(),
-		workPerThread = jobSize / n_threads;
-
-	runParallel(CaliperNassensteinFeature::parallel_process_1_batch, n_threads, workPerThread, jobSize, &roi_labels, &roiData);
+	STOPWATCH("Morphology/Nassenstein/N/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
 }
 
-void CaliperNassensteinFeature::parallel_process_1_batch (size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void CaliperNassensteinFeature::parallel_process_1_batch (size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	// Calculate the feature for each batch ROI item 
 	for (auto i = firstitem; i < lastitem; i++)
@@ -7,10 +7,11 @@
 #include "histogram.h"
 #include "image_matrix.h"
 #include "rotation.h"
+#include "../helpers/timing.h"
 
 void ChordsFeature::calculate (LR & r)
 {
-	const std::vector<Pixel2>& raw_pixels = r.raw_pixels;
+	std::vector<Pixel2> raw_pixels = r.raw_pixels.to_pixels();
 	const AABB& bb = r.aabb;
 	double cenx = (bb.get_xmin() + bb.get_xmax()) / 2.0,
 		ceny = (bb.get_ymin() + bb.get_ymax()) / 2.0;
@@ -98,7 +99,13 @@ void ChordsFeature::calculate (LR & r)
 	allchords_max_angle = ACang[idxmax];
 }
 
-void ChordsFeature::process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void ChordsFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Chords/Ch/#4aaaea", "\t=");
+	process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void ChordsFeature::process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
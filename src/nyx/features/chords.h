@@ -53,7 +53,7 @@ public:
 	/// @param end Last ROI label index
 	/// @param ptrLabels Vector of ROI labels
 	/// @param ptrLabelData Map of numeric ROI labels to ROI data
-	static void reduce (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	static void reduce (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 private:
 	double
@@ -87,8 +87,9 @@ public:
 	// Non-trivial 
 	void osized_add_online_pixel (size_t x, size_t y, uint32_t intensity) {}
 	void osized_calculate (LR& r, ImageLoader& imloader);
-	void save_value (std::vector<std::vector<double>>& feature_vals);
-	static void process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	void save_value (FeatureValues& feature_vals);
+	static void process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 	// Support of "manual" phase 2 
 	static bool required(const FeatureSet& fs)
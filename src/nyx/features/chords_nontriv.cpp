@@ -81,7 +81,7 @@ void ChordsFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	}
 }
 
-void ChordsFeature::save_value (std::vector<std::vector<double>>& feature_vals)
+void ChordsFeature::save_value (FeatureValues& feature_vals)
 {
 	feature_vals[MAXCHORDS_MAX][0] = maxchords_max;
 	feature_vals[MAXCHORDS_MAX_ANG][0] = maxchords_max_angle;
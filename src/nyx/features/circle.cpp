@@ -1,10 +1,11 @@
 #include <algorithm>
 #include "circle.h"
+#include "../helpers/timing.h"
 
 EnclosingInscribingCircumscribingCircleFeature::EnclosingInscribingCircumscribingCircleFeature() : FeatureMethod("EnclosingInscribingCircumscribingCircleFeature")
 {
     provide_features({ DIAMETER_MIN_ENCLOSING_CIRCLE, DIAMETER_INSCRIBING_CIRCLE, DIAMETER_CIRCUMSCRIBING_CIRCLE });
-    add_dependencies({ PERIMETER, CONVEX_HULL_AREA, NUM_NEIGHBORS });
+    add_dependencies({ PERIMETER, CONVEX_HULL_AREA, NUM_NEIGHBORS, CENTROID_X });
 }
 
 void EnclosingInscribingCircumscribingCircleFeature::calculate(LR& r)
@@ -13,7 +14,7 @@ void EnclosingInscribingCircumscribingCircleFeature::calculate(LR& r)
     std::tie(d_inscr, d_circum) = calculate_inscribing_circumscribing_circle (r.contour, r.fvals[CENTROID_X][0], r.fvals[CENTROID_Y][0]);
 }
 
-void EnclosingInscribingCircumscribingCircleFeature::save_value(std::vector<std::vector<double>>& fvals)
+void EnclosingInscribingCircumscribingCircleFeature::save_value(FeatureValues& fvals)
 {
     fvals[DIAMETER_MIN_ENCLOSING_CIRCLE][0] = d_minEnclo;
     fvals[DIAMETER_INSCRIBING_CIRCLE][0] = d_inscr;
@@ -242,7 +243,13 @@ std::tuple <double, double> EnclosingInscribingCircumscribingCircleFeature::calc
     return { diameter_inscribing_circle, diameter_circumscribing_circle };
 }
 
-void EnclosingInscribingCircumscribingCircleFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void EnclosingInscribingCircumscribingCircleFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/HexPolygEncloInsCircleGeodetLenThickness/HP/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void EnclosingInscribingCircumscribingCircleFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
     for (auto i = start; i < end; i++)
     {
@@ -16,6 +16,7 @@
 #include "../parallel.h"
 
 #include "../environment.h"		// regular or whole slide mode
+#include "../helpers/timing.h"
 
 ContourFeature::ContourFeature() : FeatureMethod("ContourFeature")
 {
@@ -194,7 +195,7 @@ void ContourFeature::buildWholeSlideContour(LR& r)
 
 void ContourFeature::calculate(LR& r)
 {
-	if (Nyxus::theEnvironment.singleROI)
+	if (Nyxus::theEnvironment().singleROI)
 		buildWholeSlideContour(r);
 	else
 		buildRegularContour(r);
@@ -219,7 +220,7 @@ void ContourFeature::osized_add_online_pixel(size_t x, size_t y, uint32_t intens
 void ContourFeature::osized_calculate(LR& r, ImageLoader& imloader)
 {}
 
-void ContourFeature::save_value(std::vector<std::vector<double>>& fvals)
+void ContourFeature::save_value(FeatureValues& fvals)
 {
 	fvals[PERIMETER][0] = fval_PERIMETER;
 	fvals[EQUIVALENT_DIAMETER][0] = fval_EQUIVALENT_DIAMETER;
@@ -230,15 +231,13 @@ void ContourFeature::save_value(std::vector<std::vector<double>>& fvals)
 	fvals[EDGE_INTEGRATEDINTENSITY][0] = fval_EDGE_INTEGRATEDINTENSITY;
 }
 
-void ContourFeature::parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)
-{	
-	size_t jobSize = roi_labels.size(),
-		workPerThread = jobSize / n_threads;
-
-	runParallel (ContourFeature::parallel_process_1_batch, n_threads, workPerThread, jobSize, &roi_labels, &roiData);
+void ContourFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Contour/C/#4aaaea", "\t=");
+	Nyxus::parallelReduceContour (start, end, ptrLabels, ptrLabelData);
 }
 
-void ContourFeature::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void ContourFeature::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {}
 
 void ContourFeature::cleanup_instance()
@@ -265,16 +264,13 @@ namespace Nyxus
 		if (r.roi_disabled)
 			return;
 
-		//==== Calculate ROI's image matrix
-		r.aux_image_matrix.calculate_from_pixelcloud (r.raw_pixels, r.aabb);
-
 		//==== Contour, ROI perimeter, equivalent circle diameter
 		ContourFeature f;
 		f.calculate(r);	// Consumes LR::aux_image_matrix, leaves contour pixels in LR::contour
 		f.save_value(r.fvals);
 	}
 
-	void parallelReduceContour (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+	void parallelReduceContour (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 	{
 		for (auto i = start; i < end; i++)
 		{
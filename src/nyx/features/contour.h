@@ -11,9 +11,9 @@ public:
 	void calculate(LR& r);
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity);
 	void osized_calculate(LR& r, ImageLoader& imloader);
-	void save_value(std::vector<std::vector<double>>& feature_vals);
-	void parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads);
-	static void parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	void save_value(FeatureValues& feature_vals);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	static void parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 	void cleanup_instance();
 
 	#if 0
@@ -26,7 +26,7 @@ public:
 
 	static bool required(const FeatureSet& fs) 
 	{
-		return theFeatureSet.anyEnabled({
+		return theFeatureSet().anyEnabled({
 			PERIMETER,
 			EQUIVALENT_DIAMETER,
 			EDGE_INTEGRATEDINTENSITY,
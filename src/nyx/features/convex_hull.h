@@ -12,11 +12,12 @@ public:
 
 	// Trivial ROI
 	void calculate(LR& r);	 // Consumes LR::raw_pixels, populates LR::conv_hull_pixels, calculates 3 features
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 	// Non-trivial ROI
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity) {}
 	void osized_calculate (LR& r, ImageLoader& imloader);	// Consumes LR::raw_pixels, populates LR::conv_hull_pixels, calculates the 3 features
-	void save_value (std::vector<std::vector<double>>& feature_vals);
+	void save_value (FeatureValues& feature_vals);
 	void cleanup_instance();
 
 	// Part of the legacy reduce(), will be gone
@@ -24,6 +25,8 @@ public:
 
 private:
 	void build_convex_hull(const std::vector<Pixel2>& contour, std::vector<Pixel2>& convhull);
+	void build_convex_hull(const PixelCache& roi_cloud, std::vector<Pixel2>& convhull);
+	void build_convex_hull_of_sorted(const std::vector<Pixel2>& cloud, std::vector<Pixel2>& convhull);
 	static bool compare_locations(const Pixel2& lhs, const Pixel2& rhs);
 	bool right_turn(const Pixel2& P1, const Pixel2& P2, const Pixel2& P3);
 	double polygon_area(const std::vector<Pixel2>& vertices);
@@ -1,15 +1,18 @@
 #define _USE_MATH_DEFINES	// For M_PI, etc.
+#include <algorithm>
 #include <cmath>
 #include "../feature_method.h"
 #include "image_matrix_nontriv.h"
 #include "convex_hull.h"
+#include "../helpers/timing.h"
 
 ConvexHullFeature::ConvexHullFeature() : FeatureMethod("ConvexHullFeature")
 {
 	provide_features ({CONVEX_HULL_AREA, SOLIDITY, CIRCULARITY});
+	add_dependencies ({PERIMETER});	// circularity
 }
 
-void ConvexHullFeature::save_value(std::vector<std::vector<double>>& fvals)
+void ConvexHullFeature::save_value(FeatureValues& fvals)
 {
 	fvals [CONVEX_HULL_AREA][0] = area;
 	fvals[SOLIDITY][0] = solidity; 
@@ -43,15 +46,66 @@ void ConvexHullFeature::build_convex_hull (const std::vector<Pixel2>& roi_cloud,
 	if (roi_cloud.size() < 2)
 		return;
 
-	std::vector<Pixel2>& upperCH = convhull;
-	std::vector<Pixel2> lowerCH;
-
-	size_t n = roi_cloud.size();
-
 	// Sorting points
 	std::vector<Pixel2> cloud = roi_cloud;	// Safely copy the ROI for fear of changing the original pixels order
 	std::sort (cloud.begin(), cloud.end(), compare_locations);
 
+	build_convex_hull_of_sorted (cloud, convhull);
+}
+
+void ConvexHullFeature::build_convex_hull (const PixelCache& roi_cloud, std::vector<Pixel2>& convhull)
+{
+	convhull.clear();
+
+	// Skip calculation if the ROI is too small
+	if (roi_cloud.size() < 2)
+		return;
+
+	// Hull vertices are among the topmost and bottommost pixels of ROI's columns, so only those need to be sorted. Column 
+	// extremes come out in the order of compare_locations()
+	std::vector<Pixel2> cloud;
+	roi_cloud.visit ([&] (const auto* X, const auto* Y, const PixIntens* I, size_t np)
+	{
+		auto xmin = *std::min_element (X, X + np),
+			xmax = *std::max_element (X, X + np);
+		size_t w = xmax - xmin + 1;
+		constexpr size_t NONE = SIZE_MAX;
+		std::vector<size_t> top (w, NONE), bottom (w, NONE);
+		for (size_t i = 0; i < np; i++)
+		{
+			size_t c = X[i] - xmin;
+			if (top[c] == NONE || Y[i] < Y[top[c]])
+				top[c] = i;
+			if (bottom[c] == NONE || Y[i] > Y[bottom[c]])
+				bottom[c] = i;
+		}
+
+		StatsInt x0 = roi_cloud.get_x0(),
+			y0 = roi_cloud.get_y0();
+		for (size_t c = 0; c < w; c++)
+		{
+			if (top[c] == NONE)
+				continue;
+			size_t i = top[c];
+			cloud.push_back (Pixel2(x0 + X[i], y0 + Y[i], I[i]));
+			if (bottom[c] != i)
+			{
+				i = bottom[c];
+				cloud.push_back (Pixel2(x0 + X[i], y0 + Y[i], I[i]));
+			}
+		}
+	});
+
+	build_convex_hull_of_sorted (cloud, convhull);
+}
+
+void ConvexHullFeature::build_convex_hull_of_sorted (const std::vector<Pixel2>& cloud, std::vector<Pixel2>& convhull)
+{
+	std::vector<Pixel2>& upperCH = convhull;
+	std::vector<Pixel2> lowerCH;
+
+	size_t n = cloud.size();
+
 	// Computing upper convex hull
 	upperCH.push_back (cloud[0]);
 	upperCH.push_back (cloud[1]);
@@ -164,7 +218,7 @@ void ConvexHullFeature::osized_calculate (LR& r, ImageLoader& imloader)
 
 namespace Nyxus
 {
-	void parallelReduceConvHull (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+	void parallelReduceConvHull (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 	{
 		for (auto i = start; i < end; i++)
 		{
@@ -181,3 +235,8 @@ namespace Nyxus
 	}
 }
 
+void ConvexHullFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Hull/H/#4aaaea", "\t=");
+	Nyxus::parallelReduceConvHull (start, end, ptrLabels, ptrLabelData);
+}
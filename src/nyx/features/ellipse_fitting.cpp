@@ -1,6 +1,7 @@
 #define _USE_MATH_DEFINES	
 #include <cmath>
 #include "ellipse_fitting.h"
+#include "../helpers/timing.h"
 
 // Inspired by https://www.mathworks.com/matlabcentral/mlc-downloads/downloads/submissions/19028/versions/1/previews/regiondata.m/index.html
 
@@ -13,6 +14,8 @@ EllipseFittingFeature::EllipseFittingFeature() : FeatureMethod("EllipseFittingFe
 		ELONGATION,
 		ORIENTATION, 
 		ROUNDNESS });
+
+	add_dependencies ({ AREA_PIXELS_COUNT, CENTROID_X });
 }
 
 //EllipseFittingFeature::EllipseFittingFeature(const std::vector<Pixel2>& roi_pixels, double centroid_x, double centroid_y, double area)
@@ -28,14 +31,19 @@ void EllipseFittingFeature::calculate (LR& r)
 		ySquaredTmp = 0, 
 		xySquaredTmp = 0;
 
-	for (const auto& pix : r.raw_pixels)
+	StatsInt x0 = r.raw_pixels.get_x0(),
+		y0 = r.raw_pixels.get_y0();
+	r.raw_pixels.visit ([&] (const auto* X, const auto* Y, const PixIntens* I, size_t np)
 	{
-		auto diffX = centroid_x - pix.x,
-			diffY = centroid_y - pix.y;
-		xSquaredTmp += diffX * diffX;
-		ySquaredTmp += diffY * diffY;
-		xySquaredTmp += diffX * diffY;
-	}
+		for (size_t i = 0; i < np; i++)
+		{
+			auto diffX = centroid_x - (x0 + X[i]),
+				diffY = centroid_y - (y0 + Y[i]);
+			xSquaredTmp += diffX * diffX;
+			ySquaredTmp += diffY * diffY;
+			xySquaredTmp += diffX * diffY;
+		}
+	});
 
 	double n = (double) r.raw_pixels.size();
 	double uxx = xSquaredTmp / n + 1. / 12.;
@@ -104,7 +112,13 @@ double EllipseFittingFeature::get_roundness()
 	return roundness;
 }
 
-void EllipseFittingFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void EllipseFittingFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Ellipticity/E/#4aaaea", "\t=");
+	reduce (start, end, ptrLabels, ptrLabelData);
+}
+
+void EllipseFittingFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -123,7 +137,7 @@ void EllipseFittingFeature::reduce (size_t start, size_t end, std::vector<int>*
 void EllipseFittingFeature::osized_calculate (LR& r, ImageLoader& imloader)
 {}
 
-void EllipseFittingFeature::save_value (std::vector<std::vector<double>>& fvals)
+void EllipseFittingFeature::save_value (FeatureValues& fvals)
 {
 	fvals[MAJOR_AXIS_LENGTH][0] = get_major_axis_length();
 	fvals[MINOR_AXIS_LENGTH][0] = get_minor_axis_length();
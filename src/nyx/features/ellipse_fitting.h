@@ -20,7 +20,7 @@ public:
 	void osized_calculate(LR& r, ImageLoader& imloader);	
 
 	// Result saver
-	void save_value(std::vector<std::vector<double>>& feature_vals);
+	void save_value(FeatureValues& feature_vals);
 
 
 
@@ -49,7 +49,8 @@ public:
 	double get_roundness();
 
 	static bool required (const FeatureSet& fs) { return fs.anyEnabled ({ MAJOR_AXIS_LENGTH, MINOR_AXIS_LENGTH, ECCENTRICITY, ORIENTATION, ROUNDNESS }); }
-	static void reduce (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	static void reduce (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 private:
 
@@ -1,10 +1,11 @@
 #include <algorithm>
 #include "erosion.h"
+#include "../helpers/timing.h"
 
 ErosionPixelsFeature::ErosionPixelsFeature() : FeatureMethod("ErosionPixelsFeature")
 {
 	provide_features({ EROSIONS_2_VANISH, EROSIONS_2_VANISH_COMPLEMENT });
-	add_dependencies({ PERIMETER });
+	add_dependencies({ PERIMETER, MIN });
 }
 
 void ErosionPixelsFeature::calculate(LR& r)
@@ -114,7 +115,7 @@ void ErosionPixelsFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	//
 
 	//-- auto& I = r.aux_image_matrix;
-	ReadImageMatrix_nontriv I(r.aabb);
+	ReadImageMatrix_nontriv I(r.aabb, r.label);
 
 	//[rows, columns, numberOfColorChannels] = size(grayImage);
 	int rows = r.aabb.get_height(),
@@ -201,12 +202,18 @@ void ErosionPixelsFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	}
 }
 
-void ErosionPixelsFeature::save_value(std::vector<std::vector<double>>& fvals)
+void ErosionPixelsFeature::save_value(FeatureValues& fvals)
 {
 	fvals[EROSIONS_2_VANISH][0] = numErosions;
 }
 
-void ErosionPixelsFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void ErosionPixelsFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Erosion/Er/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void ErosionPixelsFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
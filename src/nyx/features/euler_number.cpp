@@ -1,5 +1,6 @@
 #include <iostream>
 #include "euler_number.h"
+#include "../helpers/timing.h"
 
 EulerNumberFeature::EulerNumberFeature() : FeatureMethod("EulerNumberFeature")
 {
@@ -15,7 +16,6 @@ void EulerNumberFeature::calculate (LR& r)
 		return;
 	}
 
-	const std::vector<Pixel2>& cloud = r.raw_pixels;
 	const AABB& aabb = r.aabb;
 
 	StatsInt min_x = aabb.get_xmin(), 
@@ -28,13 +28,18 @@ void EulerNumberFeature::calculate (LR& r)
 		nx = max_x - min_x + 1,
 		n = nx * ny;
 	std::vector<unsigned char> I(n, 0);
-	for (auto& p : cloud)
+	StatsInt dx = r.raw_pixels.get_x0() - min_x,
+		dy = r.raw_pixels.get_y0() - min_y;
+	r.raw_pixels.visit ([&] (const auto* X, const auto* Y, const PixIntens*, size_t np)
 	{
-		int col = p.x - min_x,
-			row = p.y - min_y, 
-			idx = row * nx + col;
-		I[idx] = 1;
-	}
+		for (size_t i = 0; i < np; i++)
+		{
+			int col = X[i] + dx,
+				row = Y[i] + dy, 
+				idx = row * nx + col;
+			I[idx] = 1;
+		}
+	});
 
 	euler_number = calculate_euler (I, ny, nx, mode);
 }
@@ -95,12 +100,18 @@ long EulerNumberFeature::calculate_euler (std::vector<unsigned char> & arr, int
 		return ((C1 - C3 - (2 * Cd)) / 4);
 }
 
-void EulerNumberFeature::save_value(std::vector<std::vector<double>>& fvals)
+void EulerNumberFeature::save_value(FeatureValues& fvals)
 {
 	fvals[EULER_NUMBER][0] = euler_number;
 }
 
-void EulerNumberFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void EulerNumberFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Euler/Eu/#4aaaea", "\t=");
+	reduce (start, end, ptrLabels, ptrLabelData);
+}
+
+void EulerNumberFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -150,9 +161,8 @@ void EulerNumberFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	//		idx = row * nx + col;
 	//	I[idx] = 1;
 	//}
-	for (auto i = 0; i < cloud.get_size(); i++)
+	for (const auto& p : cloud)
 	{
-		const auto& p = cloud.get_at(i);
 		int col = p.x - min_x,
 			row = p.y - min_y,
 			idx = row * width + col;
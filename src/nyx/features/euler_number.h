@@ -22,9 +22,10 @@ public:
 	void osized_calculate (LR& r, ImageLoader& imloader);
 
 	// Result saver
-	void save_value (std::vector<std::vector<double>>& feature_vals);
+	void save_value (FeatureValues& feature_vals);
 
-	static void reduce (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	static void reduce (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 	static bool required (const FeatureSet& fs) { return fs.isEnabled(EULER_NUMBER); }
 
 private:
@@ -1,4 +1,5 @@
 #include "extrema.h"
+#include "../helpers/timing.h"
 
 ExtremaFeature::ExtremaFeature() : FeatureMethod("ExtremaFeature") 
 {
@@ -99,10 +100,8 @@ void ExtremaFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	int RightMost_Top = -1;
 	int RightMost_Bottom = -1;
 
-	for (size_t i = 0; i < r.osized_pixel_cloud.get_size(); i++)
+	for (const Pixel2& p : r.osized_pixel_cloud)
 	{
-		Pixel2 p = r.osized_pixel_cloud.get_at(i);
-
 		// Find leftmost and rightmost x-pixels of the top 
 		if (p.y == TopMost && (TopMost_MostLeft == -1 || p.x < (StatsInt)TopMost_MostLeft))
 			TopMost_MostLeft = p.x;
@@ -161,7 +160,7 @@ std::tuple<int, int, int, int, int, int, int, int, int, int, int, int, int, int,
 	};
 }
 
-void ExtremaFeature::save_value (std::vector<std::vector<double>>& fvals)
+void ExtremaFeature::save_value (FeatureValues& fvals)
 {
 	fvals [EXTREMA_P1_Y][0] = y1;
 	fvals [EXTREMA_P1_X][0] = x1;
@@ -181,7 +180,13 @@ void ExtremaFeature::save_value (std::vector<std::vector<double>>& fvals)
 	fvals[EXTREMA_P8_X][0] = x8;
 }
 
-void ExtremaFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void ExtremaFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Extrema/Ex/#4aaaea", "\t=");
+	reduce (start, end, ptrLabels, ptrLabelData);
+}
+
+void ExtremaFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -20,7 +20,7 @@ public:
 	void osized_calculate (LR& r, ImageLoader& imloader);
 
 	// Result saver
-	void save_value(std::vector<std::vector<double>>& feature_vals);
+	void save_value(FeatureValues& feature_vals);
 
 	// Compatibility with manual
 	static bool required(const FeatureSet& fs) 
@@ -44,7 +44,8 @@ public:
 			EXTREMA_P8_X });
 	}
 	std::tuple<int, int, int, int, int, int, int, int, int, int, int, int, int, int, int, int> get_values();
-	static void reduce(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	static void reduce(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 private:
 	int x1 =0, y1 =0, x2 =0, y2 =0, x3 =0, y3 =0, x4 =0, y4 =0, x5 =0, y5 =0, x6 =0, y6 =0, x7 =0, y7 =0, x8 =0, y8 =0;
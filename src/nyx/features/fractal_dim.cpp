@@ -1,5 +1,6 @@
 #include "fractal_dim.h"
 #include "image_matrix.h"
+#include "../helpers/timing.h"
 
 FractalDimensionFeature::FractalDimensionFeature() : FeatureMethod("FractalDimensionFeature")
 {
@@ -67,13 +68,19 @@ void FractalDimensionFeature::osized_add_online_pixel(size_t x, size_t y, uint32
 void FractalDimensionFeature::osized_calculate(LR& r, ImageLoader& imloader)
 {}
 
-void FractalDimensionFeature::save_value(std::vector<std::vector<double>>& fvals)
+void FractalDimensionFeature::save_value(FeatureValues& fvals)
 {
 	fvals[FRACT_DIM_BOXCOUNT][0] = box_count_fd;
 	fvals[FRACT_DIM_PERIMETER][0] = perim_fd;
 }
 
-void FractalDimensionFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void FractalDimensionFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/Fractal dimension/Fd/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void FractalDimensionFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -2,6 +2,8 @@
 #include <cmath>
 #include <omp.h>
 #include "gabor.h"
+#include "../environment.h"
+#include "../helpers/timing.h"
 
 using namespace std;
 
@@ -268,11 +270,9 @@ void GaborFeature::calculate_gpu_multi_filter (LR& r)
 }
 #endif
 
-void GaborFeature::save_value(std::vector<std::vector<double>>& feature_vals)
+void GaborFeature::save_value(FeatureValues& feature_vals)
 {
-    feature_vals[GABOR].resize(fvals.size());
-    for (int i = 0; i < fvals.size(); i++)
-        feature_vals[GABOR][i] = fvals[i];
+    feature_vals[GABOR] = fvals;
 }
 
 //  conv
@@ -833,7 +833,32 @@ void GaborFeature::GaborEnergyGPUMultiFilter (
 }
 #endif
 
-void GaborFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void GaborFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+    #ifdef USE_GPU
+        // Did the user opt out from using GPU?
+        if (theEnvironment().using_gpu())
+        {
+            STOPWATCH("GPU-Gabor/GPU-Gabor/Gabor/#f58231", "\t=");
+            gpu_process_all_rois (*ptrLabels, *ptrLabelData);
+            return;
+        }
+    #endif
+
+    STOPWATCH("Gabor/Gabor/Gabor/#f58231", "\t=");
+    reduce (start, end, ptrLabels, ptrLabelData);
+}
+
+bool GaborFeature::roi_granular()
+{
+    #ifdef USE_GPU
+        return ! theEnvironment().using_gpu();	// the GPU-side calculation takes the whole batch at once
+    #else
+        return true;
+    #endif
+}
+
+void GaborFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
     for (auto i = start; i < end; i++)
     {
@@ -849,7 +874,7 @@ void GaborFeature::reduce (size_t start, size_t end, std::vector<int>* ptrLabels
 }
 
 #ifdef USE_GPU
-void GaborFeature::gpu_process_all_rois( std::vector<int>& ptrLabels, std::unordered_map <int, LR>& ptrLabelData) 
+void GaborFeature::gpu_process_all_rois( std::vector<int>& ptrLabels, RoiStore& ptrLabelData) 
 {
     for (auto& lab: ptrLabels) {
         LR& r = ptrLabelData[lab];
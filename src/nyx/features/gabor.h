@@ -30,7 +30,7 @@ public:
     #ifdef USE_GPU
         void calculate_gpu(LR& r);
         void calculate_gpu_multi_filter (LR& r);
-        static void gpu_process_all_rois( std::vector<int>& ptrLabels, std::unordered_map <int, LR>& ptrLabelData);
+        static void gpu_process_all_rois( std::vector<int>& ptrLabels, RoiStore& ptrLabelData);
     #endif
 
     // Non-trivial
@@ -38,9 +38,11 @@ public:
     void osized_calculate(LR& r, ImageLoader& imloader);
 
     // Result saver
-    void save_value(std::vector<std::vector<double>>& feature_vals);
+    void save_value(FeatureValues& feature_vals);
 
-    static void reduce(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+    static void reduce(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+    void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+    bool roi_granular();
 
 private:
     // Trivial ROIs
@@ -101,7 +103,7 @@ private:
         ImageLoader& imloader,
         ReadImageMatrix_nontriv& Im,
         WriteImageMatrix_nontriv& out,
-        WriteImageMatrix_nontriv& auxC,
+        PagedImageMatrix_nontriv<double>& auxC,
         double* Gexp,
         double f0,
         double sig2lam,
@@ -111,7 +113,7 @@ private:
     void osized_Gabor(double* Gex, double f0, double sig2lam, double gamma, double theta, double fi, int n);
     void osized_conv_dud(
         ImageLoader& imloader,
-        WriteImageMatrix_nontriv& C,
+        PagedImageMatrix_nontriv<double>& C,
         ReadImageMatrix_nontriv& A,
         double* B,
         int na, int ma, int nb, int mb);
@@ -7,6 +7,7 @@
 GaborFeature::GaborFeature() : FeatureMethod("GaborFeature") 
 {
     provide_features ({ GABOR });
+    add_dependencies ({ MIN });
 }
 
 void GaborFeature::osized_calculate (LR& r, ImageLoader& imloader)
@@ -23,7 +24,7 @@ void GaborFeature::osized_calculate (LR& r, ImageLoader& imloader)
     unsigned long originalScore = 0;
 
     //---readOnlyPixels im0_plane = Im0.ReadablePixels();
-    ReadImageMatrix_nontriv Im0 (r.aabb);
+    ReadImageMatrix_nontriv Im0 (r.aabb, r.label);
 
     // --1
     WriteImageMatrix_nontriv e2img ("e2img", r.label);
@@ -33,7 +34,7 @@ void GaborFeature::osized_calculate (LR& r, ImageLoader& imloader)
 
     // --2
     //---std::vector<double> auxC((Im0.width + n - 1) * (Im0.height + n - 1) * 2);
-    WriteImageMatrix_nontriv auxC ("auxC", r.label);
+    PagedImageMatrix_nontriv<double> auxC ("auxC", r.label);
     auxC.allocate((roiWidth + n - 1) * (roiHeight + n - 1) * 2);
 
     // --3
@@ -78,18 +79,16 @@ void GaborFeature::osized_calculate (LR& r, ImageLoader& imloader)
 
 void GaborFeature::osized_conv_dud (
     ImageLoader& imloader, 
-    WriteImageMatrix_nontriv& C, //--- double* C,
+    PagedImageMatrix_nontriv<double>& C, //--- double* C,
     ReadImageMatrix_nontriv& A, //--- const unsigned int* A,
     double* B,
     int na, int ma, int nb, int mb)
 {
-    int ip, iq;     // Pointer to elements in 'A' and 'C' matrices
+    int ip;     // Pointer to elements in 'C' matrix
 
     double wr, wi;  // Imaginary and real weights from matrix B
     int mc, nc;
 
-    int ir = 0;         // Pointer to elements in 'b' matrix
-
     mc = ma + mb - 1;
     nc = (na + nb - 1) * 2;
 
@@ -98,28 +97,28 @@ void GaborFeature::osized_conv_dud (
     for (int i = 0; i < mcnc; i++)
         C.set_at(i, 0.0); //--- C[i] = 0.0;
 
-    for (int j = 0; j < mb; ++j)
+    // Stream 'A' once, spreading each element (l,k) over 'C' by the weights of 'B'
+    A.for_each_segment (imloader, [&] (size_t l, size_t k0, const PixIntens* rowA, size_t n)
     {
-        // For each element in b 
-        for (int i = 0; i < nb; ++i)
+        for (size_t k = k0; k < k0 + n; k++)
         {
-            // Get weight from B matrix
-            wr = B[ir];
-            wi = B[ir + 1];
-            ir += 2;
-
-            // Start at first row of A in C 
-            ip = j * nc + i * 2;
-            iq = 0;
+            double a = rowA[k - k0];
+            if (a == 0)
+                continue;
 
-            for (int l = 0; l < ma; l++)
+            int ir = 0;         // Pointer to elements in 'b' matrix
+            for (int j = 0; j < mb; ++j)
             {
-                // For each row of A ... 
-                for (int k = 0; k < na; k++)
+                // For each element in b 
+                for (int i = 0; i < nb; ++i)
                 {
-                    // cache A[iq]
-                    double a = A.get_at(imloader, iq); //--- A[iq];
-                    iq++;
+                    // Get weight from B matrix
+                    wr = B[ir];
+                    wi = B[ir + 1];
+                    ir += 2;
+
+                    // Position of (l,k) of A in C shifted by (j,i)
+                    ip = int((j + l) * nc + (i + k) * 2);
 
                     // multiply by the real weight and add
                     //--- C[ip] += a * wr;
@@ -130,21 +129,17 @@ void GaborFeature::osized_conv_dud (
                     //--- C[ip + 1] += a * wi;
                     tmp = C.get_at(ip+1) + a * wi;
                     C.set_at(ip + 1, tmp);
-                    ip += 2;
                 }
-
-                // Jump to next row position of A in C
-                ip += (nb - 1) * 2;
             }
         }
-    }
+    });
 }
 
 void GaborFeature::osized_GaborEnergy(
     ImageLoader& imloader, 
     ReadImageMatrix_nontriv & Im, //--- const ImageMatrix& Im,
     WriteImageMatrix_nontriv& out, //--- PixIntens* /* double* */ out,
-    WriteImageMatrix_nontriv& auxC, //--- double* auxC,
+    PagedImageMatrix_nontriv<double>& auxC, //--- double* auxC,
     double* Gexp,
     double f0,
     double sig2lam,
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "geodetic_len_thickness.h"
+#include "../helpers/timing.h"
 
 GeodeticLengthThicknessFeature::GeodeticLengthThicknessFeature() : FeatureMethod("GeodeticLengthThicknessFeature")
 {
@@ -32,13 +33,19 @@ void GeodeticLengthThicknessFeature::osized_calculate (LR& r, ImageLoader&)
 
 void GeodeticLengthThicknessFeature::osized_add_online_pixel (size_t x, size_t y, uint32_t intensity) {}
 
-void GeodeticLengthThicknessFeature::save_value (std::vector<std::vector<double>>& fvals)
+void GeodeticLengthThicknessFeature::save_value (FeatureValues& fvals)
 {
 	fvals[GEODETIC_LENGTH][0] = geodetic_length;
 	fvals[THICKNESS][0] = thickness;
 }
 
-void GeodeticLengthThicknessFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void GeodeticLengthThicknessFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/HexPolygEncloInsCircleGeodetLenThickness/HP/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void GeodeticLengthThicknessFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -1,12 +1,24 @@
 #include "glcm.h"
 #include "../helpers/helpers.h"
 #include "../environment.h"
+#include "../helpers/timing.h"
 
 #define EPSILON 0.000000001
 
-int GLCMFeature::offset = 1;
-int GLCMFeature::n_levels = 8;
-std::vector<int> GLCMFeature::angles = { 0, 45, 90, 135 };
+int GLCMFeature::offset()
+{
+	return Nyxus::theEnvironment().glcmOffset;
+}
+
+int GLCMFeature::n_levels()
+{
+	return Nyxus::theEnvironment().glcmNLevels;
+}
+
+const std::vector<int>& GLCMFeature::angles()
+{
+	return Nyxus::theEnvironment().glcmAngles;
+}
 
 GLCMFeature::GLCMFeature() : FeatureMethod("GLCMFeature")
 {
@@ -32,18 +44,18 @@ GLCMFeature::GLCMFeature() : FeatureMethod("GLCMFeature")
 
 void GLCMFeature::calculate(LR& r)
 {
-	for (auto a: angles)
+	for (auto a: angles())
 		Extract_Texture_Features2 (a, r.aux_image_matrix, r.aux_min, r.aux_max); 
 }
 
 void GLCMFeature::osized_add_online_pixel(size_t x, size_t y, uint32_t intensity) {}		// Not supporting the online mode for this feature method
 
-void GLCMFeature::copyfvals (AngledFeatures& dst, const AngledFeatures& src)
+void GLCMFeature::copyfvals (FeatureCell dst, const AngledFeatures& src)
 {
 	dst.assign(src.begin(), src.end());
 }
 
-void GLCMFeature::save_value(std::vector<std::vector<double>>& fvals)
+void GLCMFeature::save_value(FeatureValues& fvals)
 {
 	copyfvals (fvals[GLCM_ANGULAR2NDMOMENT], fvals_ASM);
 	copyfvals (fvals[GLCM_CONTRAST], fvals_contrast);
@@ -63,7 +75,13 @@ void GLCMFeature::save_value(std::vector<std::vector<double>>& fvals)
 	copyfvals (fvals[GLCM_VARIANCE], fvals_variance);
 }
 
-void GLCMFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void GLCMFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Texture/GLCM texture/GLCM/#bbbbbb", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void GLCMFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -71,25 +89,25 @@ void GLCMFeature::parallel_process_1_batch(size_t start, size_t end, std::vector
 		LR& r = (*ptrLabelData)[lab];
 
 		// Skip calculation in case of bad data
-		auto minI = Nyxus::to_grayscale(r.aux_min, r.aux_min, r.aux_max-r.aux_min, theEnvironment.get_coarse_gray_depth()),
-			maxI = Nyxus::to_grayscale(r.aux_max, r.aux_min, r.aux_max - r.aux_min, theEnvironment.get_coarse_gray_depth());
+		auto minI = Nyxus::to_grayscale(r.aux_min, r.aux_min, r.aux_max-r.aux_min, theEnvironment().get_coarse_gray_depth()),
+			maxI = Nyxus::to_grayscale(r.aux_max, r.aux_min, r.aux_max - r.aux_min, theEnvironment().get_coarse_gray_depth());
 		if (minI == maxI)
 		{
-			auto n = angles.size();
+			auto n = angles().size();
 			// Zero out each angled feature value 
-			r.fvals [GLCM_ANGULAR2NDMOMENT].resize (n, 0);
-			r.fvals [GLCM_CONTRAST].resize (n, 0);
-			r.fvals [GLCM_CORRELATION].resize (n, 0);
-			r.fvals [GLCM_VARIANCE].resize (n, 0);
-			r.fvals [GLCM_INVERSEDIFFERENCEMOMENT].resize (n, 0);
-			r.fvals [GLCM_SUMAVERAGE].resize (n, 0);
-			r.fvals [GLCM_SUMVARIANCE].resize (n, 0);
-			r.fvals [GLCM_SUMENTROPY].resize(n, 0);
-			r.fvals [GLCM_ENTROPY].resize(n, 0);
-			r.fvals [GLCM_DIFFERENCEVARIANCE].resize(n, 0);
-			r.fvals [GLCM_DIFFERENCEENTROPY].resize(n, 0);
-			r.fvals [GLCM_INFOMEAS1].resize(n, 0);
-			r.fvals [GLCM_INFOMEAS2].resize(n, 0);
+			r.fvals [GLCM_ANGULAR2NDMOMENT].assign (n, 0);
+			r.fvals [GLCM_CONTRAST].assign (n, 0);
+			r.fvals [GLCM_CORRELATION].assign (n, 0);
+			r.fvals [GLCM_VARIANCE].assign (n, 0);
+			r.fvals [GLCM_INVERSEDIFFERENCEMOMENT].assign (n, 0);
+			r.fvals [GLCM_SUMAVERAGE].assign (n, 0);
+			r.fvals [GLCM_SUMVARIANCE].assign (n, 0);
+			r.fvals [GLCM_SUMENTROPY].assign (n, 0);
+			r.fvals [GLCM_ENTROPY].assign (n, 0);
+			r.fvals [GLCM_DIFFERENCEVARIANCE].assign (n, 0);
+			r.fvals [GLCM_DIFFERENCEENTROPY].assign (n, 0);
+			r.fvals [GLCM_INFOMEAS1].assign (n, 0);
+			r.fvals [GLCM_INFOMEAS2].assign (n, 0);
 			continue;
 		}
 
@@ -105,28 +123,28 @@ void GLCMFeature::Extract_Texture_Features2 (int angle, const ImageMatrix & gray
 	int ncols = grays.width;
 
 	// Allocate Px and Py vectors
-	std::vector<double> Px (n_levels * 2), 
-		Py (n_levels);
+	std::vector<double> Px (n_levels() * 2), 
+		Py (n_levels());
 
 	// Compute the gray-tone spatial dependence matrix 
 	int dx, dy;
 	switch (angle)
 	{
 		case 0:
-			dx = offset;
+			dx = offset();
 			dy = 0;
 			break;
 		case 45:
-			dx = offset;
-			dy = offset;
+			dx = offset();
+			dy = offset();
 			break;
 		case 90:
 			dx = 0;
-			dy = offset;
+			dy = offset();
 			break;
 		case 135:
-			dx = -offset;
-			dy = offset;
+			dx = -offset();
+			dy = offset();
 			break;
 		default:
 			std::cerr << "Cannot create co-occurence matrix for angle " << angle << ": unsupported angle\n";
@@ -137,52 +155,52 @@ void GLCMFeature::Extract_Texture_Features2 (int angle, const ImageMatrix & gray
 
 	// Compute Haralick statistics 
 	double f;
-	f = theFeatureSet.isEnabled(GLCM_ANGULAR2NDMOMENT) ? f_asm(P_matrix, n_levels) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_ANGULAR2NDMOMENT) ? f_asm(P_matrix, n_levels()) : 0.0;
 	fvals_ASM.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_CONTRAST) ? f_contrast(P_matrix, n_levels) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_CONTRAST) ? f_contrast(P_matrix, n_levels()) : 0.0;
 	fvals_contrast.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_CORRELATION) ? f_corr(P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_CORRELATION) ? f_corr(P_matrix, n_levels(), Px) : 0.0;
 	fvals_correlation.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_ENERGY) ? f_energy (P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_ENERGY) ? f_energy (P_matrix, n_levels(), Px) : 0.0;
 	fvals_energy.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_HOMOGENEITY) ? f_homogeneity (P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_HOMOGENEITY) ? f_homogeneity (P_matrix, n_levels(), Px) : 0.0;
 	fvals_homo.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_VARIANCE) ? f_var (P_matrix, n_levels) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_VARIANCE) ? f_var (P_matrix, n_levels()) : 0.0;
 	fvals_variance.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_INVERSEDIFFERENCEMOMENT) ? f_idm (P_matrix, n_levels) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_INVERSEDIFFERENCEMOMENT) ? f_idm (P_matrix, n_levels()) : 0.0;
 	fvals_IDM.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_SUMAVERAGE) ? f_savg (P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_SUMAVERAGE) ? f_savg (P_matrix, n_levels(), Px) : 0.0;
 	fvals_sum_avg.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_SUMENTROPY) ? f_sentropy (P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_SUMENTROPY) ? f_sentropy (P_matrix, n_levels(), Px) : 0.0;
 	fvals_sum_entropy.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_SUMVARIANCE) ? f_svar (P_matrix, n_levels, f, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_SUMVARIANCE) ? f_svar (P_matrix, n_levels(), f, Px) : 0.0;
 	fvals_sum_var.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_ENTROPY) ? f_entropy (P_matrix, n_levels) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_ENTROPY) ? f_entropy (P_matrix, n_levels()) : 0.0;
 	fvals_entropy.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_DIFFERENCEVARIANCE) ? f_dvar (P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_DIFFERENCEVARIANCE) ? f_dvar (P_matrix, n_levels(), Px) : 0.0;
 	fvals_diff_var.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_DIFFERENCEENTROPY) ? f_dentropy (P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_DIFFERENCEENTROPY) ? f_dentropy (P_matrix, n_levels(), Px) : 0.0;
 	fvals_diff_entropy.push_back (f);
 
-	f = theFeatureSet.isEnabled (GLCM_DIFFERENCEAVERAGE) ? f_difference_avg (P_matrix, n_levels, Px) : 0.0;
+	f = theFeatureSet().isEnabled (GLCM_DIFFERENCEAVERAGE) ? f_difference_avg (P_matrix, n_levels(), Px) : 0.0;
 	fvals_diff_avg.push_back(f);
 
-	f = theFeatureSet.isEnabled(GLCM_INFOMEAS1) ? f_info_meas_corr1 (P_matrix, n_levels, Px, Py) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_INFOMEAS1) ? f_info_meas_corr1 (P_matrix, n_levels(), Px, Py) : 0.0;
 	fvals_meas_corr1.push_back (f);
 
-	f = theFeatureSet.isEnabled(GLCM_INFOMEAS2) ? f_info_meas_corr2 (P_matrix, n_levels, Px, Py) : 0.0;
+	f = theFeatureSet().isEnabled(GLCM_INFOMEAS2) ? f_info_meas_corr2 (P_matrix, n_levels(), Px, Py) : 0.0;
 	fvals_meas_corr2.push_back (f);
 
 	fvals_max_corr_coef.push_back (0.0);
@@ -199,9 +217,9 @@ void GLCMFeature::calculateCoocMatAtAngle(
 	PixIntens max_val, 
 	bool normalize)
 {
-	matrix.allocate(n_levels, n_levels, 0.0); 
+	int nLevels = n_levels();
+	matrix.allocate(nLevels, nLevels, 0.0); 
 
-	int d = GLCMFeature::offset;
 	int count = 0;	// normalizing factor 
 
 	int rows = grays.height,
@@ -225,8 +243,8 @@ void GLCMFeature::calculateCoocMatAtAngle(
 					continue;
 
 				// Cast intensities on the 1-n_levels scale
-				int x = GLCMFeature::cast_to_range (raw_lvl_x, min_val, max_val, 1, GLCMFeature::n_levels) -1, 
-					y = GLCMFeature::cast_to_range (raw_lvl_y, min_val, max_val, 1, GLCMFeature::n_levels) -1;
+				int x = GLCMFeature::cast_to_range (raw_lvl_x, min_val, max_val, 1, nLevels) -1, 
+					y = GLCMFeature::cast_to_range (raw_lvl_y, min_val, max_val, 1, nLevels) -1;
 
 				// Increment the symmetric count
 				count += 2;	
@@ -246,18 +264,19 @@ void GLCMFeature::calculateCoocMatAtAngle(
 		return;
 
 	double realCnt = count;
-	for (int i = 0; i < GLCMFeature::n_levels; i++)
-		for (int j = 0; j < GLCMFeature::n_levels; j++)
+	for (int i = 0; i < nLevels; i++)
+		for (int j = 0; j < nLevels; j++)
 			matrix.xy(i, j) /= (realCnt + EPSILON);
 }
 
 void GLCMFeature::calculatePxpmy()
 {
-	Pxpy.resize (2 * n_levels - 1, 0.0);
-	Pxmy.resize (n_levels, 0.0);
+	int nLevels = n_levels();
+	Pxpy.resize (2 * nLevels - 1, 0.0);
+	Pxmy.resize (nLevels, 0.0);
 
-	for (int x = 0; x < n_levels; x++) 
-		for (int y = 0; y < n_levels; y++) 
+	for (int x = 0; x < nLevels; x++) 
+		for (int y = 0; y < nLevels; y++) 
 		{
 			Pxpy[x + y] += P_matrix.xy(x,y);
 			Pxmy[std::abs(x - y)] += P_matrix.xy(x,y); 
@@ -24,9 +24,9 @@ class GLCMFeature: public FeatureMethod
 
 public:
 
-	static int offset;	// default value: 1
-	static int n_levels;	// default value: 8
-	static std::vector<int> angles;	// default value: {0,45,90,135} (the supreset)
+	static int offset();	// the current context's GLCM offset, default value: 1
+	static int n_levels();	// the current context's number of GLCM grey levels, default value: 8
+	static const std::vector<int>& angles();	// the current context's --glcmAngles, default value: {0,45,90,135} (the supreset)
 
 	static bool required(const FeatureSet& fs) 
 	{
@@ -54,8 +54,9 @@ public:
 	void calculate(LR& r);
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity);
 	void osized_calculate(LR& r, ImageLoader& imloader);
-	void save_value(std::vector<std::vector<double>>& feature_vals);
-	static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	void save_value(FeatureValues& feature_vals);
+	static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 private:
 
@@ -135,7 +136,7 @@ private:
 	double f_dvar (const SimpleMatrix<double>& P_matrix, int tone_count, std::vector<double>& px);
 	double f_dentropy (const SimpleMatrix<double>& P_matrix, int tone_count, std::vector<double>& px);
 
-	void copyfvals(AngledFeatures& dst, const AngledFeatures& src);
+	void copyfvals(FeatureCell dst, const AngledFeatures& src);
 
 	std::vector<double> fvals_ASM,
 		fvals_contrast,
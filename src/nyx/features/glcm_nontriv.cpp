@@ -3,13 +3,13 @@
 void GLCMFeature::osized_calculate(LR& r, ImageLoader& imloader)
 {
 	// Calculate normalized graytones
-	OOR_ReadMatrix G(imloader, r.aabb);
+	OOR_ReadMatrix G(imloader, r.aabb, r.label);
 	G.apply_normalizing_range(r.aux_min, r.aux_max, 255.0);
 
 	int Angles[] = { 0, 45, 90, 135 },
 		nAngs = sizeof(Angles) / sizeof(Angles[0]);
 	for (int i = 0; i < nAngs; i++)
-		Extract_Texture_Features_nontriv(offset, Angles[i], G);
+		Extract_Texture_Features_nontriv(offset(), Angles[i], G);
 }
 
 void GLCMFeature::Extract_Texture_Features_nontriv(
@@ -17,21 +17,20 @@ void GLCMFeature::Extract_Texture_Features_nontriv(
 	int angle,
 	const OOR_ReadMatrix& grays)
 {
-	int nrows = grays.get_height();
-	int ncols = grays.get_width();
-
 	int tone_LUT[PGM_MAXMAXVAL + 1]; // LUT mapping gray tone(0-255) to matrix indicies 
 	int tone_count = 0; // number of tones actually in the img. atleast 1 less than 255 
 
 	// Determine the number of different gray tones (not maxval) 
 	for (int row = PGM_MAXMAXVAL; row >= 0; --row)
 		tone_LUT[row] = -1;
-	for (int row = nrows - 1; row >= 0; --row)
-		for (int col = 0; col < ncols; ++col)
+	grays.for_each_segment ([&] (size_t row, size_t col, const PixIntens* I, size_t n)
 		{
-			size_t v = grays.get_normed_at(row, col);
-			tone_LUT[v] = v;
-		}
+			for (size_t k = 0; k < n; k++)
+			{
+				size_t v = grays.normed (I[k]);
+				tone_LUT[v] = v;
+			}
+		});
 
 	for (int row = PGM_MAXMAXVAL; row >= 0; --row)
 		if (tone_LUT[row] != -1)
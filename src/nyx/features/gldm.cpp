@@ -5,6 +5,7 @@
 #include <unordered_set>
 #include "gldm.h"
 #include "../environment.h"
+#include "../helpers/timing.h"
 
 GLDMFeature::GLDMFeature() : FeatureMethod("GLDMFeature")
 {
@@ -41,7 +42,7 @@ void GLDMFeature::calculate(LR& r)
 	// Prepare ROI's intensity range for normalize_I()
 	PixIntens piRange = r.aux_max - r.aux_min;
 
-	unsigned int nGrays = theEnvironment.get_coarse_gray_depth();
+	unsigned int nGrays = theEnvironment().get_coarse_gray_depth();
 
 	// Gather zones
 	for (int row = 1; row < D.height() - 1; row++)
@@ -129,7 +130,7 @@ void GLDMFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	//==== While scanning clusters, learn unique intensities 
 	std::unordered_set<PixIntens> U;
 
-	ReadImageMatrix_nontriv D(r.aabb); //-- const pixData& D = r.aux_image_matrix.ReadablePixels();
+	ReadImageMatrix_nontriv D(r.aabb, r.label); //-- const pixData& D = r.aux_image_matrix.ReadablePixels();
 
 	// Gather zones
 	for (int row = 1; row < D.get_height() - 1; row++)
@@ -194,7 +195,7 @@ void GLDMFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	}
 }
 
-void GLDMFeature::save_value(std::vector<std::vector<double>>& fvals)
+void GLDMFeature::save_value(FeatureValues& fvals)
 {
 	fvals[GLDM_SDE][0] = calc_SDE();
 	fvals[GLDM_LDE][0] = calc_LDE();
@@ -502,7 +503,13 @@ double GLDMFeature::calc_LDHGLE()
 	return retval;
 }
 
-void GLDMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void GLDMFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Texture/GLDM/D/#bbbbbb", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void GLDMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
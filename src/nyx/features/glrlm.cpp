@@ -5,6 +5,7 @@
 #include <unordered_set>
 #include "glrlm.h"
 #include "../environment.h"
+#include "../helpers/timing.h"
 
 GLRLMFeature::GLRLMFeature() : FeatureMethod("GLRLMFeature")
 {
@@ -89,7 +90,7 @@ void GLRLMFeature::calculate (LR& r)
 		pixData& D = M.WriteablePixels();
 
 		// Squeeze the intensity range
-		unsigned int nGrays = theEnvironment.get_coarse_gray_depth();
+		unsigned int nGrays = theEnvironment().get_coarse_gray_depth();
 		for (size_t i = 0; i < D.size(); i++)
 			D[i] = Nyxus::to_grayscale (D[i], r.aux_min, piRange, nGrays);
 
@@ -289,7 +290,7 @@ void GLRLMFeature::osized_calculate(LR& r, ImageLoader& imloader)
 		return;
 	}
 
-	ReadImageMatrix_nontriv im(r.aabb); //-- const ImageMatrix& im = r.aux_image_matrix;
+	ReadImageMatrix_nontriv im(r.aabb, r.label); //-- const ImageMatrix& im = r.aux_image_matrix;
 
 	//--debug-- im.print("initial ROI\n");
 
@@ -484,7 +485,7 @@ void GLRLMFeature::osized_calculate(LR& r, ImageLoader& imloader)
 	calc_LRHGLE(angled_LRHGLE);
 }
 
-void GLRLMFeature::save_value(std::vector<std::vector<double>>& fvals)
+void GLRLMFeature::save_value(FeatureValues& fvals)
 {
 	fvals[GLRLM_SRE] = angled_SRE;
 	fvals[GLRLM_LRE] = angled_LRE;
@@ -1064,7 +1065,13 @@ void GLRLMFeature::calc_LRHGLE (AngledFtrs& af)
 	}
 }
 
-void GLRLMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void GLRLMFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Texture/GLRLM/RL/#bbbbbb", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void GLRLMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
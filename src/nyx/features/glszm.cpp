@@ -5,6 +5,7 @@
 #include <unordered_set>
 #include "glszm.h"
 #include "../environment.h"
+#include "../helpers/timing.h"
 
 GLSZMFeature::GLSZMFeature() : FeatureMethod("GLSZMFeature")
 {
@@ -45,7 +46,7 @@ void GLSZMFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	int maxZoneArea = 0;
 
 	// Copy the image matrix
-	ReadImageMatrix_nontriv M(r.aabb);	//-- auto M = r.aux_image_matrix;
+	ReadImageMatrix_nontriv M(r.aabb, r.label);	//-- auto M = r.aux_image_matrix;
 
 	WriteImageMatrix_nontriv D ("GLSZMFeature_osized_calculate_D", r.label);	//-- pixData& D = M.WriteablePixels();
 	D.allocate (r.aabb.get_width(), r.aabb.get_height());
@@ -199,7 +200,7 @@ void GLSZMFeature::calculate(LR& r)
 
 	// Squeeze the intensity range
 	PixIntens piRange = r.aux_max - r.aux_min;		// Prepare ROI's intensity range
-	unsigned int nGrays = theEnvironment.get_coarse_gray_depth();
+	unsigned int nGrays = theEnvironment().get_coarse_gray_depth();
 	for (size_t i = 0; i < D.size(); i++)
 		D[i] = Nyxus::to_grayscale (D[i], r.aux_min, piRange, nGrays);
 
@@ -330,7 +331,7 @@ void GLSZMFeature::calculate(LR& r)
 	}
 }
 
-void GLSZMFeature::save_value (std::vector<std::vector<double>>& fvals)
+void GLSZMFeature::save_value (FeatureValues& fvals)
 {
 	fvals[GLSZM_SAE][0] = calc_SAE();
 	fvals[GLSZM_LAE][0] = calc_LAE();
@@ -674,7 +675,13 @@ double GLSZMFeature::calc_LAHGLE()
 	return retval;
 }
 
-void GLSZMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void GLSZMFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Texture/GLSZM/SZ/#bbbbbb", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void GLSZMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
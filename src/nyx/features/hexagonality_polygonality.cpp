@@ -2,6 +2,7 @@
 #include <cmath>
 #include <vector>
 #include "hexagonality_polygonality.h"
+#include "../helpers/timing.h"
 
 HexagonalityPolygonalityFeature::HexagonalityPolygonalityFeature() : FeatureMethod("HexagonalityPolygonalityFeature")
 {
@@ -151,14 +152,20 @@ void HexagonalityPolygonalityFeature::osized_calculate(LR& r, ImageLoader&)
     calculate (r);
 }
 
-void HexagonalityPolygonalityFeature::save_value(std::vector<std::vector<double>>& fvals)
+void HexagonalityPolygonalityFeature::save_value(FeatureValues& fvals)
 {
     fvals[POLYGONALITY_AVE][0] = polyAve;
     fvals[HEXAGONALITY_AVE][0] = hexAve;
     fvals[HEXAGONALITY_STDDEV][0] = hexSd;
 }
 
-void HexagonalityPolygonalityFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void HexagonalityPolygonalityFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/HexPolygEncloInsCircleGeodetLenThickness/HP/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void HexagonalityPolygonalityFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
     for (auto i = start; i < end; i++)
     {
@@ -18,7 +18,8 @@ class TrivialHistogram
 public:
 	TrivialHistogram() {}
 
-	void initialize (HistoItem min_value, HistoItem max_value, const std::vector<Pixel2>& raw_data)
+	template <class Cloud>
+	void initialize (HistoItem min_value, HistoItem max_value, const Cloud& raw_data)
 	{
 		// Allocate 
 		// -- "binary"
@@ -269,26 +269,38 @@ void ImageMatrix::histogram(double* bins, unsigned short nbins, bool imhist, con
 	return;
 }
 
-void ImageMatrix::apply_distance_to_contour_weights (const std::vector<Pixel2>& raw_pixels, const std::vector<Pixel2>& contour_pixels)
+// Weighs matrix pixels of a cloud (std::vector<Pixel2> or PixelCache) by their distance to the contour
+template <class Cloud>
+static void weigh_by_distance_to_contour (pixData& plane, const AABB& aabb, const Cloud& raw_pixels, const std::vector<Pixel2>& contour_pixels)
 {
 	const double epsilon = 0.1;
 
-	for (auto& p : raw_pixels)
+	for (const auto& p : raw_pixels)
 	{
 		auto mind = p.min_sqdist (contour_pixels);
 		double dist = std::sqrt(mind);
 
 		// (row, column) coordinates in the image matrix
-		auto c = p.x - original_aabb.get_xmin(),
-			r = p.y - original_aabb.get_ymin();
+		auto c = p.x - aabb.get_xmin(),
+			r = p.y - aabb.get_ymin();
 		
 		// Weighted intensity
-		PixIntens wi = _pix_plane.yx(r, c) / (dist + epsilon) + 0.5/*rounding*/;
+		PixIntens wi = plane.yx(r, c) / (dist + epsilon) + 0.5/*rounding*/;
 		
-		_pix_plane.yx(r,c) = wi;
+		plane.yx(r,c) = wi;
 	}
 }
 
+void ImageMatrix::apply_distance_to_contour_weights (const std::vector<Pixel2>& raw_pixels, const std::vector<Pixel2>& contour_pixels)
+{
+	weigh_by_distance_to_contour (_pix_plane, original_aabb, raw_pixels, contour_pixels);
+}
+
+void ImageMatrix::apply_distance_to_contour_weights (const PixelCache& raw_pixels, const std::vector<Pixel2>& contour_pixels)
+{
+	weigh_by_distance_to_contour (_pix_plane, original_aabb, raw_pixels, contour_pixels);
+}
+
 // Returns chord length at x
 int ImageMatrix::get_chlen (int col)
 {
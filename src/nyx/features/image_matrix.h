@@ -7,6 +7,7 @@
 #include "pixel.h"
 #include "aabb.h"
 #include "moments.h"
+#include "pixel_cache.h"
 #include "../helpers/helpers.h"
 
 // functor to call add on a reference using the () operator
@@ -236,6 +237,32 @@ public:
 		}
 	}
 
+	ImageMatrix(const PixelCache& labels_raw_pixels, AABB & aabb) :
+		original_aabb (aabb),
+		_pix_plane(aabb.get_width(), aabb.get_height())
+	{
+		// Dimensions
+		width = aabb.get_width();
+		height = aabb.get_height();
+
+		// Zero the matrix and read pixels
+		_pix_plane.allocate_and_initialize (width, height, 0);
+		scatter_pixels (labels_raw_pixels);
+	}
+
+	ImageMatrix(const PixelCache& labels_raw_pixels):
+		original_aabb(labels_raw_pixels), 
+		_pix_plane(original_aabb.get_width(), original_aabb.get_height())
+	{
+		// Dimensions
+		width = original_aabb.get_width();
+		height = original_aabb.get_height();
+
+		// Zero the matrix and read pixels
+		_pix_plane.allocate_and_initialize (width, height, 0);
+		scatter_pixels (labels_raw_pixels);
+	}
+
 	ImageMatrix(const std::vector <Pixel2>& labels_raw_pixels):
 		original_aabb(labels_raw_pixels), 
 		_pix_plane(original_aabb.get_width(), original_aabb.get_height())
@@ -286,6 +313,34 @@ public:
 		}
 	}
 
+	void calculate_from_pixelcloud (const PixelCache& labels_raw_pixels, const AABB& aabb)
+	{
+		original_aabb = aabb;
+
+		// Dimensions
+		width = original_aabb.get_width();
+		height = original_aabb.get_height();
+
+		// Zero the matrix and read pixels
+		_pix_plane.clear();
+		_pix_plane.allocate_and_initialize (width, height, 0);
+		scatter_pixels (labels_raw_pixels);
+	}
+
+	/// @brief Writes intensities of cached pixels to the matrix. Pixel (x,y) lands in column x-xmin+pad_x and row y-ymin+pad_y where xmin and ymin are of 'original_aabb'
+	void scatter_pixels (const PixelCache& cloud, StatsInt pad_x = 0, StatsInt pad_y = 0)
+	{
+		StatsInt dx = cloud.get_x0() - original_aabb.get_xmin() + pad_x,
+			dy = cloud.get_y0() - original_aabb.get_ymin() + pad_y;
+		PixIntens* M = _pix_plane.data();
+		StatsInt w = width;
+		cloud.visit ([&] (const auto* X, const auto* Y, const PixIntens* I, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+				M[(Y[i] + dy) * w + X[i] + dx] = I[i];
+		});
+	}
+
 	void allocate(int w, int h)
 	{
 		width = w;
@@ -329,6 +384,7 @@ public:
 
 	// Based on X.Shu, Q.Zhang, J.Shi and Y.Qi - "A Comparative Study on Weighted Central Moment and Its Application in 2D Shape Retrieval" (2016) https://pdfs.semanticscholar.org/8927/2bef7ba9496c59081ae102925ebc0134bceb.pdf
 	void apply_distance_to_contour_weights(const std::vector<Pixel2>& raw_pixels, const std::vector<Pixel2>& contour_pixels);
+	void apply_distance_to_contour_weights(const PixelCache& raw_pixels, const std::vector<Pixel2>& contour_pixels);
 
 	// Returns chord length at x
 	int get_chlen(int col);
@@ -375,4 +431,20 @@ public:
 			_pix_plane[y * width + x] = pxl.inten;
 		}
 	}
+
+	Power2PaddedImageMatrix(const PixelCache& labels_raw_pixels, const AABB& aabb):
+		ImageMatrix ()
+	{
+		original_aabb = aabb;
+
+		int bigSide = std::max(aabb.get_width(), aabb.get_height());
+		StatsInt paddedSide = Nyxus::closest_pow2 (bigSide);
+		allocate (paddedSide, paddedSide);
+
+		int padOffsetX = (paddedSide - original_aabb.get_width()) / 2;
+		int padOffsetY = (paddedSide - original_aabb.get_height()) / 2;
+
+		// Read pixels
+		scatter_pixels (labels_raw_pixels, padOffsetX, padOffsetY);
+	}
 };
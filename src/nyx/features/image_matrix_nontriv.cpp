@@ -7,8 +7,17 @@
 #else
   error "Missing the <filesystem> header."
 #endif
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <utility>
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
 #include "../environment.h"
 #include "image_matrix_nontriv.h"
 
@@ -16,32 +25,129 @@ OutOfRamPixelCloud::OutOfRamPixelCloud()
 {
 }
 
+OutOfRamPixelCloud::~OutOfRamPixelCloud()
+{
+	clear();
+}
+
+OutOfRamPixelCloud::OutOfRamPixelCloud (OutOfRamPixelCloud&& other) noexcept
+{
+	*this = std::move (other);
+}
+
+OutOfRamPixelCloud& OutOfRamPixelCloud::operator= (OutOfRamPixelCloud&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	clear();
+	n_items = std::exchange (other.n_items, 0);
+	filepath = std::move (other.filepath);
+	pF = std::exchange (other.pF, nullptr);
+	staged = std::move (other.staged);
+	mapped = std::exchange (other.mapped, nullptr);
+	n_mapped = std::exchange (other.n_mapped, 0);
+	window = std::move (other.window);
+	window_start = std::exchange (other.window_start, 0);
+	return *this;
+}
+
 void OutOfRamPixelCloud::init (unsigned int _roi_label, std::string name)
 {
-	std::stringstream ssPath;
-	ssPath << Nyxus::theEnvironment.get_temp_dir_path() << name << _roi_label;
-	filepath = ssPath.str();
+	clear();
+
+	filepath = (fs::path (Nyxus::theTempDirPath()) / (name + std::to_string(_roi_label))).string();
 	pF = fopen(filepath.c_str(), "w+b");
+	if (! pF)
+	{
+		std::stringstream ss;
+		ss << "Error: cannot create pixel cloud file " << filepath;
+		#ifdef WITH_PYTHON_H
+			throw ss.str();
+		#endif
+		std::cerr << ss.str() << "\n";
+		return;
+	}
 
-	if (std::setvbuf(pF, nullptr, _IOFBF, 32768) != 0)
-		std::cout << "setvbuf failed\n";
+	staged.reserve (CHUNK_LEN);
 }
 
 void OutOfRamPixelCloud::clear()
 {
+	unmap();
+	window.clear();
+	window.shrink_to_fit();
+	staged.clear();
+	staged.shrink_to_fit();
+	n_items = 0;
+
 	if (pF)
 	{
 		fclose(pF);
 		pF = nullptr;
-		fs::remove (filepath);
+		std::error_code ec;
+		fs::remove (filepath, ec);
+	}
+}
+
+void OutOfRamPixelCloud::reset()
+{
+	unmap();
+	window.clear();
+	staged.clear();
+	n_items = 0;
+
+	if (pF)
+		pF = freopen (filepath.c_str(), "w+b", pF);
+}
+
+void OutOfRamPixelCloud::add_pixel (const Pixel2& p)
+{
+	staged.push_back (p);
+	n_items++;
+	if (staged.size() >= CHUNK_LEN)
+		write_staged();
+}
+
+void OutOfRamPixelCloud::add_pixels (const Pixel2* p, size_t n)
+{
+	// Big batches go to the file directly, small ones are staged
+	if (staged.size() + n >= CHUNK_LEN)
+	{
+		write_staged();
+		if (pF)
+		{
+			fseek (pF, 0, SEEK_END);
+			fwrite ((const void*) p, sizeof(Pixel2), n, pF);
+		}
+		window.clear();
+	}
+	else
+		staged.insert (staged.end(), p, p + n);
+	n_items += n;
+}
+
+void OutOfRamPixelCloud::write_staged() const
+{
+	if (staged.empty())
+		return;
+	if (pF)
+	{
+		fseek (pF, 0, SEEK_END);
+		fwrite ((const void*) staged.data(), sizeof(Pixel2), staged.size(), pF);
 	}
+	staged.clear();
+	window.clear();
 }
 
-void OutOfRamPixelCloud::add_pixel(const Pixel2& p)
+void OutOfRamPixelCloud::unmap() const
 {
-	fwrite((const void*) &(p.x), sizeof(p.x), 1, pF);
-	fwrite((const void*)&(p.y), sizeof(p.y), 1, pF);
-	fwrite((const void*)&(p.inten), sizeof(p.inten), 1, pF);
+	#ifndef _WIN32
+	if (mapped)
+		munmap ((void*) mapped, n_mapped * sizeof(Pixel2));
+	#endif
+	mapped = nullptr;
+	n_mapped = 0;
 }
 
 size_t OutOfRamPixelCloud::get_size() const
@@ -49,31 +155,68 @@ size_t OutOfRamPixelCloud::get_size() const
 	return n_items;
 }
 
-Pixel2 OutOfRamPixelCloud::get_at(size_t idx) const
+Pixel2 OutOfRamPixelCloud::get_at (size_t idx) const
 {
-	size_t offs = idx * item_size;
-	fseek(pF, offs, SEEK_SET);
-	Pixel2 px;
-	fread((void*)&(px.x), sizeof(px.x), 1, pF);
-	fread((void*)&(px.y), sizeof(px.y), 1, pF);
-	fread((void*)&(px.inten), sizeof(px.inten), 1, pF);
-	return px;
+	size_t n;
+	const Pixel2* p = get_span (idx, n);
+	return n ? *p : Pixel2();
 }
 
+const Pixel2* OutOfRamPixelCloud::get_span (size_t idx, size_t& n) const
+{
+	n = 0;
+	if (idx >= n_items || ! pF)
+		return nullptr;
+
+	#ifndef _WIN32
+	// (Re)map the whole file if it has grown since it was last mapped
+	if (n_mapped != n_items)
+	{
+		write_staged();
+		fflush (pF);
+		unmap();
+		void* m = mmap (nullptr, n_items * sizeof(Pixel2), PROT_READ, MAP_SHARED, fileno(pF), 0);
+		if (m != MAP_FAILED)
+		{
+			madvise (m, n_items * sizeof(Pixel2), MADV_SEQUENTIAL);
+			mapped = static_cast<const Pixel2*> (m);
+			n_mapped = n_items;
+		}
+	}
+	if (mapped)
+	{
+		n = n_mapped - idx;
+		return mapped + idx;
+	}
+	#endif
 
-WriteImageMatrix_nontriv::WriteImageMatrix_nontriv (const std::string& _name, unsigned int _roi_label)
+	// Read the chunk holding pixel 'idx' unless it's at hand
+	if (idx < window_start || idx >= window_start + window.size())
+	{
+		write_staged();
+		window_start = idx / CHUNK_LEN * CHUNK_LEN;
+		window.resize (std::min (CHUNK_LEN, n_items - window_start));
+		fseek (pF, window_start * sizeof(Pixel2), SEEK_SET);
+		fread ((void*) window.data(), sizeof(Pixel2), window.size(), pF);
+	}
+	n = window_start + window.size() - idx;
+	return window.data() + (idx - window_start);
+}
+
+
+template <typename T>
+PagedImageMatrix_nontriv<T>::PagedImageMatrix_nontriv (const std::string& _name, unsigned int _roi_label)
 {
-	std::stringstream ssPath;
-	ssPath << fs::temp_directory_path() << "/imagematrix_nontriv" << _roi_label;
-	filepath = ssPath.str();
+	filepath = (fs::path (Nyxus::theTempDirPath()) / (_name + std::to_string(_roi_label))).string();
 	pF = fopen (filepath.c_str(), "w+b");
-
-	if (std::setvbuf (pF, nullptr, _IOFBF, 32768) != 0) 
-		std::cout << "setvbuf failed\n";
+	if (! pF)
+		throw std::runtime_error ("cannot create image matrix file " + filepath);
 }
 
-WriteImageMatrix_nontriv::~WriteImageMatrix_nontriv()
+template <typename T>
+PagedImageMatrix_nontriv<T>::~PagedImageMatrix_nontriv()
 {
+	release_pages();
 	if (pF)
 	{
 		fclose(pF);
@@ -82,38 +225,63 @@ WriteImageMatrix_nontriv::~WriteImageMatrix_nontriv()
 	}
 }
 
-void WriteImageMatrix_nontriv::allocate (int w, int h, double ini_value)
+template <typename T>
+void PagedImageMatrix_nontriv<T>::allocate (int w, int h, T ini_value)
 {
+	// Forget the previous content
+	release_pages();
+
 	width = w;
 	height = h;
-
-	// Fill the file with 0-s
-	auto n = width * height;
-	double buf = ini_value;
-	for (size_t i=0; i<n; i++)
-		fwrite((const void*)&buf, sizeof(buf), 1, pF);
-	fflush(pF);
+	page_rows = std::max (size_t(1), std::min (PAGE_ROWS, (size_t) height));
+	page_cols = PAGE_LEN / page_rows;
+	n_page_cols = (width + page_cols - 1) / page_cols;
+	n_pages = n_page_cols * ((height + page_rows - 1) / page_rows);
+	slot_of.assign (n_pages, -1);
+
+	// Keep as many pages resident as the RAM limit allows
+	capacity = std::max (size_t(4), Nyxus::theEnvironment().get_ram_limit() / RAM_SHARE / page_bytes());
+	capacity = std::min (capacity, n_pages);
+
+	// Size the file: its pages read as 0-s until written
+	fflush (pF);
+	#ifdef _WIN32
+		bool sized = _chsize_s (_fileno(pF), 0) == 0 && _chsize_s (_fileno(pF), (__int64) (n_pages * page_bytes())) == 0;
+	#else
+		bool sized = ftruncate (fileno(pF), 0) == 0 && ftruncate (fileno(pF), (off_t) (n_pages * page_bytes())) == 0;
+		mappable = sized && page_bytes() % (size_t) sysconf(_SC_PAGESIZE) == 0;
+	#endif
+	if (! sized)
+		throw std::runtime_error ("cannot allocate " + std::to_string (n_pages * page_bytes()) + " bytes in image matrix file " + filepath);
+
+	if (ini_value != 0)
+		for (size_t p = 0; p < n_pages; p++)
+		{
+			T* data = page (p, true);
+			std::fill (data, data + PAGE_LEN, ini_value);
+		}
 }
 
-void WriteImageMatrix_nontriv::init_with_cloud (const OutOfRamPixelCloud & cloud, const AABB & aabb)
+template <typename T>
+void PagedImageMatrix_nontriv<T>::init_with_cloud (const OutOfRamPixelCloud & cloud, const AABB & aabb)
 {
+	// Cache some parameters
+	original_aabb = aabb;
+
 	// Allocate space
 	allocate(aabb.get_width(), aabb.get_height());
 	
 	// Fill it with cloud pixels 
-	for (size_t i = 0; i < cloud.get_size(); i++)
+	for (const Pixel2& p : cloud)
 	{
-		const Pixel2 p = cloud.get_at(i);
 		auto y = p.y - aabb.get_ymin(),
 			x = p.x - aabb.get_xmin();
 		set_at (y, x, p.inten);
 	}
-
-	// Flush the buffer
-	fflush(pF);
 }
 
-void WriteImageMatrix_nontriv::init_with_cloud_distance_to_contour_weights (const OutOfRamPixelCloud& cloud, const AABB& aabb, std::vector<Pixel2>& contour_pixels)
+template <typename T>
+void PagedImageMatrix_nontriv<T>::init_with_cloud_distance_to_contour_weights (const OutOfRamPixelCloud& cloud, const AABB& aabb, std::vector<Pixel2>& contour_pixels)
 {
 	double epsilon = 0.1;
 
@@ -124,10 +292,8 @@ void WriteImageMatrix_nontriv::init_with_cloud_distance_to_contour_weights (cons
 	allocate(aabb.get_width(), aabb.get_height());
 
 	// Fill it with cloud pixels 
-	for (size_t i = 0; i < cloud.get_size(); i++)
+	for (const Pixel2& p : cloud)
 	{
-		const Pixel2 p = cloud.get_at(i);
-
 		auto [mind, maxd] = p.min_max_sqdist (contour_pixels);
 		double dist = std::sqrt (mind);
 
@@ -138,26 +304,20 @@ void WriteImageMatrix_nontriv::init_with_cloud_distance_to_contour_weights (cons
 		PixIntens wi = p.inten / (dist + epsilon) + 0.5/*rounding*/;
 		set_at (y, x, p.inten);
 	}
-
-	// Flush the buffer
-	fflush(pF);
 }
 
-void WriteImageMatrix_nontriv::copy (WriteImageMatrix_nontriv& other)
+template <typename T>
+void PagedImageMatrix_nontriv<T>::copy (PagedImageMatrix_nontriv& other)
 {
-	fs::path p (filepath);
-	fs::remove (p);
-
 	original_aabb = other.original_aabb;
-	allocate (original_aabb.get_width(), original_aabb.get_height(), 0.0);
+	allocate (other.width, other.height);
 
-	for (size_t idx = 0; idx < other.size(); idx++)
+	// Same geometry, so page by page
+	for (size_t p = 0; p < n_pages; p++)
 	{
-		double val = other.get_at(idx);
-		set_at(idx, val);
+		const T* src = other.page (p, false);
+		std::copy (src, src + PAGE_LEN, page (p, true));
 	}
-
-	fflush(pF);
 }
 
 /*
@@ -180,74 +340,152 @@ void WriteImageMatrix_nontriv::init_with_matrix (ImageLoader& imloader, ReadImag
 }
 */
 
-void WriteImageMatrix_nontriv::set_at(size_t idx, double val)
+template <typename T>
+void PagedImageMatrix_nontriv<T>::make_current (size_t p, bool modify)
 {
-	size_t offs = idx * item_size;
-	fseek(pF, offs, SEEK_SET);
-	fwrite((const void*)&val, sizeof(val), 1, pF);
-	fflush(pF);
+	cur_data = page (p, modify);
+	cur_page = p;
+	const ResidentPage& rp = resident[slot_of[p]];
+	cur_dirty = rp.view || rp.dirty;	// Modifying a view needs no bookkeeping
 }
 
-void WriteImageMatrix_nontriv::set_at (int row, int col, double val)
+// Returns resident page 'p', loading it in place of the least recently used one if needed
+template <typename T>
+T* PagedImageMatrix_nontriv<T>::page (size_t p, bool modify)
 {
-	size_t idx = row * width + col;
-	set_at(idx, val);
+	int s = slot_of[p];
+	if (s < 0)
+	{
+		if (resident.size() < capacity)
+		{
+			s = (int) resident.size();
+			resident.emplace_back();
+			lru.push_front (s);
+			resident[s].lru_pos = lru.begin();
+		}
+		else
+		{
+			s = (int) lru.back();
+			evict (s);
+			lru.splice (lru.begin(), lru, resident[s].lru_pos);
+		}
+		load (s, p);
+	}
+	else
+		lru.splice (lru.begin(), lru, resident[s].lru_pos);
+
+	ResidentPage& rp = resident[s];
+	rp.dirty = rp.dirty || modify;
+	return rp.data;
 }
 
-double WriteImageMatrix_nontriv::get_at(size_t idx)
+template <typename T>
+void PagedImageMatrix_nontriv<T>::load (size_t slot, size_t p)
 {
-	size_t offs = idx * item_size;
-	fseek(pF, offs, SEEK_SET);
-	double val;
-	fread ((void*)&val, sizeof(val), 1, pF);
-	return val;
+	ResidentPage& rp = resident[slot];
+	rp.page = p;
+	rp.dirty = false;
+	rp.view = false;
+	slot_of[p] = (int) slot;
+
+	#ifndef _WIN32
+		if (mappable)
+		{
+			void* a = mmap (nullptr, page_bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fileno(pF), (off_t) (p * page_bytes()));
+			if (a != MAP_FAILED)
+			{
+				rp.data = (T*) a;
+				rp.view = true;
+				return;
+			}
+			// Out of mappings - this page will be a buffer
+		}
+	#endif
+
+	rp.buffer.resize (PAGE_LEN);
+	rp.data = rp.buffer.data();
+	fseek (pF, p * page_bytes(), SEEK_SET);
+	fread ((void*) rp.data, sizeof(T), PAGE_LEN, pF);
 }
 
-double WriteImageMatrix_nontriv::get_at (int row, int col)
+template <typename T>
+void PagedImageMatrix_nontriv<T>::evict (size_t slot)
 {
-	size_t idx = row * width + col;
-	double val = get_at (idx);
-	return val;
+	ResidentPage& rp = resident[slot];
+	if (rp.page == cur_page)
+		cur_page = SIZE_MAX;
+	slot_of[rp.page] = -1;
+
+	#ifndef _WIN32
+		if (rp.view)
+		{
+			munmap ((void*) rp.data, page_bytes());	// The system writes modified views back
+			return;
+		}
+	#endif
+
+	if (rp.dirty)
+	{
+		fseek (pF, rp.page * page_bytes(), SEEK_SET);
+		fwrite ((const void*) rp.data, sizeof(T), PAGE_LEN, pF);
+	}
 }
 
-double WriteImageMatrix_nontriv::get_max()
+// Drops resident pages without writing them back
+template <typename T>
+void PagedImageMatrix_nontriv<T>::release_pages()
+{
+	#ifndef _WIN32
+		for (auto& rp : resident)
+			if (rp.view)
+				munmap ((void*) rp.data, page_bytes());
+	#endif
+	resident.clear();
+	lru.clear();
+	std::fill (slot_of.begin(), slot_of.end(), -1);
+	cur_page = SIZE_MAX;
+}
+
+template <typename T>
+T PagedImageMatrix_nontriv<T>::get_max()
 {
 	bool blank = true;
-	double retval;
+	T retval = 0;
 
-	auto n = width * height;
-	double buf = 0.0;
-	for (size_t i = 0; i < n; i++)
-	{
-		fread ((void*)&buf, sizeof(buf), 1, pF);
-		if (blank)
+	for (int row = 0; row < height; row++)
+		for (int col = 0; col < width; col++)
 		{
-			blank = true;
-			retval = buf;
+			T val = get_at (row, col);
+			if (blank || val > retval)
+			{
+				blank = false;
+				retval = val;
+			}
 		}
-		else
-			retval = std::max(retval, buf);
-	}
 	return retval;
 }
 
-size_t WriteImageMatrix_nontriv::size()
+template <typename T>
+size_t PagedImageMatrix_nontriv<T>::size()
 {
-	return width * height;
+	return (size_t) width * height;
 }
 
-size_t WriteImageMatrix_nontriv::get_width()
+template <typename T>
+size_t PagedImageMatrix_nontriv<T>::get_width()
 {
 	return width;
 }
 
-size_t WriteImageMatrix_nontriv::get_height()
+template <typename T>
+size_t PagedImageMatrix_nontriv<T>::get_height()
 {
 	return height;
 }
 
 // Returns chord length at x
-size_t WriteImageMatrix_nontriv::get_chlen (size_t col)
+template <typename T>
+size_t PagedImageMatrix_nontriv<T>::get_chlen (size_t col)
 {
 	bool noSignal = true;
 	int chlen = 0, maxChlen = 0;	// We will find the maximum chord in case ROI has holes
@@ -256,7 +494,7 @@ size_t WriteImageMatrix_nontriv::get_chlen (size_t col)
 	{
 		if (noSignal)
 		{
-			if (get_at(row, col) != 0)
+			if (get_at(row, (int) col) != 0)
 			{
 				// begin tracking a new chord
 				noSignal = false;
@@ -265,7 +503,7 @@ size_t WriteImageMatrix_nontriv::get_chlen (size_t col)
 		}
 		else // in progress tracking a signal
 		{
-			if (get_at(row, col) != 0)
+			if (get_at(row, (int) col) != 0)
 				chlen++;	// signal continues
 			else
 			{
@@ -280,31 +518,96 @@ size_t WriteImageMatrix_nontriv::get_chlen (size_t col)
 	return maxChlen;
 }
 
-bool WriteImageMatrix_nontriv::safe(size_t x, size_t y) const
+template <typename T>
+bool PagedImageMatrix_nontriv<T>::safe (size_t row, size_t col) const
 {
-	if (x >= width || y >= height)
+	if (row >= (size_t) height || col >= (size_t) width)
 		return false;
 	else
 		return true;
 }
 
-double OOR_ReadMatrix::get_at (size_t pixel_row, size_t pixel_col) const
+// Intensity matrices and Gabor's complex convolution buffers
+template class PagedImageMatrix_nontriv<PixIntens>;
+template class PagedImageMatrix_nontriv<double>;
+
+ResidentRoiTiles::ResidentRoiTiles (const AABB& aabb, int _label) :
+	xmin (aabb.get_xmin()), ymin (aabb.get_ymin()), xmax (aabb.get_xmax()), ymax (aabb.get_ymax()), label (_label), 
+	any_label (Nyxus::theEnvironment().singleROI)
+{
+}
+
+void ResidentRoiTiles::init_geometry (ImageLoader& imloader)
 {
-	size_t tile_x = imloader.get_tile_x(pixel_col),
-		tile_y = imloader.get_tile_y(pixel_row);
-	imloader.load_tile(tile_y, tile_x);
-	auto& dataI = imloader.get_int_tile_buffer();
-	size_t idx = imloader.get_within_tile_idx(pixel_row, pixel_col);
-	auto val = dataI[idx];
-	return (double)val;
+	tw = imloader.get_tile_width();
+	th = imloader.get_tile_height();
+	ntw = imloader.get_num_tiles_vert();
+
+	// Two rows of tiles across the ROI or, if the RAM limit allows, more but not more than the ROI has
+	size_t n_across = xmax / tw - xmin / tw + 1,
+		n_roi_tiles = n_across * (ymax / th - ymin / th + 1),
+		n_affordable = Nyxus::theEnvironment().get_ram_limit() / RAM_SHARE / (tw * th * sizeof(PixIntens));
+	capacity = std::min (std::max (2 * n_across, n_affordable), n_roi_tiles);
+	tiles.reserve (capacity);
+}
+
+void ResidentRoiTiles::make_current (ImageLoader& imloader, size_t t)
+{
+	// Resident?
+	ResidentTile* rt = nullptr;
+	for (auto& x : tiles)
+		if (x.tile == t)
+		{
+			rt = &x;
+			break;
+		}
+
+	if (! rt)
+	{
+		if (! imloader.load_tile (t))
+			throw std::runtime_error ("cannot fetch tile " + std::to_string (t));
+
+		// Take a free slot or that of the least recently used tile
+		if (tiles.size() < capacity)
+		{
+			tiles.emplace_back();
+			rt = &tiles.back();
+		}
+		else
+			rt = &*std::min_element (tiles.begin(), tiles.end(), 
+				[] (const ResidentTile& a, const ResidentTile& b) { return a.last_used < b.last_used; });
+
+		// Keep the ROI's pixels
+		rt->tile = t;
+		rt->I.resize (tw * th);
+		auto keep = [&] (const auto& dataI, const auto& dataL)
+		{
+			if (any_label)
+				for (size_t i = 0; i < rt->I.size(); i++)
+					rt->I[i] = dataL[i] != 0 ? dataI[i] : 0;
+			else
+				for (size_t i = 0; i < rt->I.size(); i++)
+					rt->I[i] = dataL[i] == label ? dataI[i] : 0;
+		};
+		if (imloader.native_16bit())
+			keep (imloader.get_int_tile_buffer_16(), imloader.get_seg_tile_buffer_16());
+		else
+			keep (imloader.get_int_tile_buffer(), imloader.get_seg_tile_buffer());
+	}
+
+	rt->last_used = ++n_uses;
+	cur_tile = t;
+	cur_data = rt->I.data();
+}
+
+double OOR_ReadMatrix::get_at (size_t row, size_t col) const
+{
+	return tiles.get_at (imloader, row, col);
 }
 
 double OOR_ReadMatrix::get_at(size_t idx) const
 {
-	auto y = aabb.get_ymin() + idx / aabb.get_width(),
-		x = aabb.get_xmin() + idx % aabb.get_width();
-	double retval = get_at(y, x);
-	return retval;
+	return get_at (idx / aabb.get_width(), idx % aabb.get_width());
 }
 
 size_t OOR_ReadMatrix::get_width() const
@@ -330,36 +633,26 @@ std::tuple<size_t, size_t> OOR_ReadMatrix::idx_2_rc(size_t idx) const
 	return { row, col };
 }
 
-bool OOR_ReadMatrix::safe(size_t x, size_t y) const
+bool OOR_ReadMatrix::safe (size_t row, size_t col) const
 {
-	if (x >= aabb.get_width() || y >= aabb.get_height())
+	if (row >= aabb.get_height() || col >= aabb.get_width())
 		return false;
 	else
 		return true;
 }
 
-ReadImageMatrix_nontriv::ReadImageMatrix_nontriv (const AABB & _aabb)
+ReadImageMatrix_nontriv::ReadImageMatrix_nontriv (const AABB & _aabb, int label) : aabb(_aabb), tiles(_aabb, label)
 {
-	aabb = _aabb;
 }
 
-double ReadImageMatrix_nontriv::get_at (ImageLoader& imloader, size_t pixel_row, size_t pixel_col)
+double ReadImageMatrix_nontriv::get_at (ImageLoader& imloader, size_t row, size_t col)
 {
-	size_t tile_x = imloader.get_tile_x (pixel_col),
-		tile_y = imloader.get_tile_y (pixel_row);
-	imloader.load_tile (tile_y, tile_x);
-	auto& dataI = imloader.get_int_tile_buffer();
-	size_t idx = imloader.get_within_tile_idx (pixel_row, pixel_col);
-	auto val = dataI[idx];
-	return (double)val;
+	return tiles.get_at (imloader, row, col);
 }
 
 double ReadImageMatrix_nontriv::get_at (ImageLoader& imloader, size_t idx)
 {
-	auto y = aabb.get_ymin() + idx / aabb.get_width(),
-		x = aabb.get_xmin() + idx % aabb.get_width();
-	double retval = get_at(imloader, y, x);
-	return retval;
+	return get_at (imloader, idx / aabb.get_width(), idx % aabb.get_width());
 }
 
 size_t ReadImageMatrix_nontriv::get_width() const
@@ -385,9 +678,9 @@ std::tuple<size_t, size_t> ReadImageMatrix_nontriv::idx_2_rc (size_t idx) const
 	return {row, col};
 }
 
-bool ReadImageMatrix_nontriv::safe(size_t x, size_t y) const
+bool ReadImageMatrix_nontriv::safe (size_t row, size_t col) const
 {
-	if (x >= aabb.get_width() || y >= aabb.get_height())
+	if (row >= aabb.get_height() || col >= aabb.get_width())
 		return false;
 	else
 		return true;
@@ -1,37 +1,180 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <iterator>
+#include <list>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include "aabb.h"
 #include "pixel.h"
 #include "../image_loader.h"
 
-/// @brief Writeable out of memory pixel cloud
+/// @brief Writeable out of memory pixel cloud: an append-only temporary file of fixed-size Pixel2 records. Appended pixels are staged
+/// in a chunk-sized buffer and written in bulk. For reading, the file is memory-mapped (POSIX) or, elsewhere, read a chunk at a time,
+/// so oversized ROIs' pixels are browsed at memory speed without counting against the RAM limit - mapped pages are backed by the file.
+///
+/// Example:
+///		for (const Pixel2& px : cloud)
+///			sum += px.inten;
 class OutOfRamPixelCloud
 {
 public:
+	static constexpr size_t CHUNK_LEN = 65536;	// Pixels staged before a write and, if the file isn't mapped, read at once
+
 	OutOfRamPixelCloud();
+	~OutOfRamPixelCloud();
+
+	// The file belongs to one cloud. Moves take it over along with its mapping
+	OutOfRamPixelCloud (const OutOfRamPixelCloud&) = delete;
+	OutOfRamPixelCloud& operator= (const OutOfRamPixelCloud&) = delete;
+	OutOfRamPixelCloud (OutOfRamPixelCloud&& other) noexcept;
+	OutOfRamPixelCloud& operator= (OutOfRamPixelCloud&& other) noexcept;
+
 	void init (unsigned int _roi_label, std::string name);
 	void clear();
+
+	/// @brief Drops all the pixels keeping the cloud ready for new ones
+	void reset();
+
 	void add_pixel (const Pixel2& p);
+
+	/// @brief Appends 'n' pixels at once
+	void add_pixels (const Pixel2* p, size_t n);
+
 	size_t get_size() const;
 	Pixel2 get_at (size_t idx) const;
 
+	/// @brief Returns pixels [idx, idx+n) as an array that stays valid until the next reading call or append. 'n' is at least 1 for
+	/// 'idx' within the cloud and is 0 otherwise
+	const Pixel2* get_span (size_t idx, size_t& n) const;
+
+	/// @brief Sequential iterator reading the cloud a span at a time
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Pixel2;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Pixel2*;
+		using reference = const Pixel2&;
+
+		const_iterator (const OutOfRamPixelCloud* c, size_t i) : cloud(c), idx(i) {}
+
+		reference operator* () const
+		{
+			if (cur == last)
+			{
+				size_t n;
+				cur = cloud->get_span (idx, n);
+				last = cur + n;
+			}
+			return *cur;
+		}
+		pointer operator-> () const { return &**this; }
+		const_iterator& operator++ ()
+		{
+			idx++;
+			if (cur != last)
+				cur++;
+			return *this;
+		}
+		bool operator== (const const_iterator& other) const { return idx == other.idx; }
+		bool operator!= (const const_iterator& other) const { return idx != other.idx; }
+
+	private:
+		const OutOfRamPixelCloud* cloud;
+		size_t idx;
+		mutable const Pixel2* cur = nullptr,	// span holding pixel 'idx' unless 'cur' == 'last'
+			* last = nullptr;
+	};
+
+	const_iterator begin() const { return const_iterator (this, 0); }
+	const_iterator end() const { return const_iterator (this, n_items); }
+
 private:
+	static_assert (std::is_trivially_copyable<Pixel2>::value, "pixels are stored as raw records");
+
+	void write_staged() const;
+	void unmap() const;
+
 	size_t n_items = 0;
 	std::string filepath;
 	FILE* pF = nullptr;
-	size_t item_size = sizeof(Pixel2::x) + sizeof(Pixel2::y) + sizeof(Pixel2::inten);
+	mutable std::vector<Pixel2> staged;	// pixels appended but not written yet
+
+	// Read access
+	mutable const Pixel2* mapped = nullptr;	// mapping of the file's first 'n_mapped' pixels
+	mutable size_t n_mapped = 0;
+	mutable std::vector<Pixel2> window;	// where the file isn't mapped, chunk of pixels starting at 'window_start'
+	mutable size_t window_start = 0;
 };
 
-/// @brief Read-only out of memory pixel matrix browsable via ImageLoader
+/// @brief Tiles of an oversized ROI resident in RAM for random and neighbourhood access to its pixels. A tile is loaded once per 
+/// residence, its pixels of other ROIs zeroed (in the single-ROI mode, its pixels of zero mask). The least recently used tile gives way to a missing one. At least two rows of tiles 
+/// across the ROI stay resident, more if 1/RAM_SHARE of the RAM limit allows, so raster scans of neighbourhoods load each tile once
+class ResidentRoiTiles
+{
+public:
+	static constexpr size_t RAM_SHARE = 8;
+
+	ResidentRoiTiles (const AABB& aabb, int label);
+
+	/// @brief Returns the intensity at ROI-relative position ('row', 'col'), 0 if the pixel doesn't belong to the ROI
+	PixIntens get_at (ImageLoader& imloader, size_t row, size_t col)
+	{
+		size_t y = row + ymin,
+			x = col + xmin;
+		if (tw == 0)
+			init_geometry (imloader);
+		size_t t = (y / th) * ntw + x / tw;
+		if (t != cur_tile)
+			make_current (imloader, t);
+		return cur_data[(y % th) * tw + x % tw];
+	}
+
+	/// @brief Streams the ROI tile by tile, calling 'visit (row, col, I, n)' for ROI-relative row segments (see ImageLoader::for_each_roi_segment())
+	template <class F>
+	void for_each_segment (ImageLoader& imloader, F visit) const
+	{
+		imloader.for_each_roi_segment (xmin, ymin, xmax, ymax, label, any_label, [&] (size_t row, size_t col, const PixIntens* I, size_t n)
+			{
+				visit (row - ymin, col - xmin, I, n);
+			});
+	}
+
+private:
+	void init_geometry (ImageLoader& imloader);
+	void make_current (ImageLoader& imloader, size_t t);
+
+	struct ResidentTile
+	{
+		size_t tile;
+		uint64_t last_used;
+		std::vector<PixIntens> I;
+	};
+
+	size_t xmin, ymin, xmax, ymax;
+	uint32_t label;
+	bool any_label;		// pixels of any nonzero mask value belong to the ROI (single-ROI mode)
+	size_t tw = 0, th = 0, ntw = 0, capacity = 0;
+	std::vector<ResidentTile> tiles;
+	uint64_t n_uses = 0;
+	size_t cur_tile = SIZE_MAX;
+	const PixIntens* cur_data = nullptr;
+};
+
+/// @brief Read-only out of memory pixel matrix of a ROI browsable via ImageLoader. Pixels of other ROIs read as 0-s
 class OOR_ReadMatrix
 {
 public:
-	OOR_ReadMatrix (ImageLoader& _imloader, const AABB& _aabb) : imloader(_imloader), aabb(_aabb) {}
+	OOR_ReadMatrix (ImageLoader& _imloader, const AABB& _aabb, int label) : imloader(_imloader), aabb(_aabb), tiles(_aabb, label) {}
 	size_t get_width() const;
 	size_t get_height() const;
 	size_t get_size() const;
-	bool safe(size_t x, size_t y) const;
+	bool safe (size_t row, size_t col) const;
 
 	/// @brief Helps constructing a Pixel2 instance at index 'idx' in intensity matrix scenarios
 	/// 
@@ -47,20 +190,28 @@ public:
 	double get_at (size_t row, size_t col) const;
 	double get_at (size_t idx) const;
 
+	/// @brief Streams the matrix tile by tile (see ResidentRoiTiles::for_each_segment())
+	template <class F>
+	void for_each_segment (F visit) const { tiles.for_each_segment (imloader, visit); }
+
 	// Normalization
 	void apply_normalizing_range (double _minval, double _maxval, double _normalization_ceil) 
 	{ 
 		minval = _minval; 
 		maxval = _maxval; 
 		normalization_ceil = _normalization_ceil;
-		scale = normalization_ceil * (maxval - minval);
+		scale = maxval > minval ? normalization_ceil / (maxval - minval) : 0.0;
 	}
-	double get_normed_at(size_t row, size_t col) const { return (get_at(row, col) - minval)* scale;  }
-	double get_normed_at(size_t idx) const { return (get_at(idx) - minval) * scale; }
+	// Pixels of other ROIs stay 0
+	double get_normed_at(size_t row, size_t col) const { return normed (get_at(row, col)); }
+	double get_normed_at(size_t idx) const { return normed (get_at(idx)); }
+	double normed (double x) const { return x == 0 ? 0 : (x - minval) * scale; }
 
 private:
+
 	ImageLoader& imloader;
 	AABB aabb;
+	mutable ResidentRoiTiles tiles;
 
 	// Retrieving normalized elements
 	double normalization_ceil = 255.0, minval = 0.0, maxval = 1.0, scale = 255.0;
@@ -70,9 +221,16 @@ private:
 class ReadImageMatrix_nontriv
 {
 public:
-	ReadImageMatrix_nontriv (const AABB & aabb);
+	ReadImageMatrix_nontriv (const AABB & aabb, int label);
+
+	// ROI-relative access. Pixels of other ROIs read as 0-s
 	double get_at (ImageLoader& imloader, size_t row, size_t col);
 	double get_at (ImageLoader& imloader, size_t idx);
+
+	/// @brief Streams the matrix tile by tile (see ResidentRoiTiles::for_each_segment())
+	template <class F>
+	void for_each_segment (ImageLoader& imloader, F visit) const { tiles.for_each_segment (imloader, visit); }
+
 	size_t get_width() const;
 	size_t get_height() const;
 	size_t get_size() const;
@@ -88,42 +246,90 @@ public:
 	/// @return 0-based row and column 
 	std::tuple<size_t, size_t> idx_2_rc (size_t idx) const;
 
-	bool safe(size_t x, size_t y) const;
+	bool safe (size_t row, size_t col) const;
 
 private:
 	AABB aabb;
+	ResidentRoiTiles tiles;
 };
 
-/// @brief Writable out of RAM version of class ImageMatrix
-class WriteImageMatrix_nontriv
+/// @brief Writable out of RAM version of class ImageMatrix: a temporary file of elements of type 'T' tiled into fixed-size 2D pages,
+/// so that neighbourhood access in any direction touches few pages. Pages in use stay resident in an LRU cache bounded by a share of
+/// the RAM limit. Resident pages are mapped views of the file (POSIX) or, elsewhere, buffers written back on eviction if modified.
+template <typename T>
+class PagedImageMatrix_nontriv
 {
 public:
-	WriteImageMatrix_nontriv (const std::string&  _name, unsigned int _roi_label);
-	~WriteImageMatrix_nontriv();
-	
+	static constexpr size_t PAGE_LEN = 4096;	// Elements in a page
+	static constexpr size_t PAGE_ROWS = 64;	// Rows of a page of a matrix at least that tall, otherwise pages span the whole height
+	static constexpr size_t RAM_SHARE = 8;	// Resident pages of a matrix take up to 1/RAM_SHARE of the RAM limit
+
+	PagedImageMatrix_nontriv (const std::string& _name, unsigned int _roi_label);
+	~PagedImageMatrix_nontriv();
+	PagedImageMatrix_nontriv (const PagedImageMatrix_nontriv&) = delete;
+	PagedImageMatrix_nontriv& operator= (const PagedImageMatrix_nontriv&) = delete;
+
 	// Initialization
-	void allocate (int w, int h=1, double ini_value=0.0);
+	void allocate (int w, int h=1, T ini_value=0);
 	void init_with_cloud (const OutOfRamPixelCloud& cloud, const AABB& aabb);
 	void init_with_cloud_distance_to_contour_weights (const OutOfRamPixelCloud& cloud, const AABB& aabb, std::vector<Pixel2>& contour);
-	void copy(WriteImageMatrix_nontriv & other);
+	void copy (PagedImageMatrix_nontriv& other);
 
-	void set_at(int row, int col, double val);
-	void set_at(size_t idx,  double val);
-	double get_at(int row, int col);
-	double get_at(size_t idx);
-	double get_max();
+	void set_at (int row, int col, T val) { *element (row, col, true) = val; }
+	void set_at (size_t idx, T val) { set_at (int (idx / width), int (idx % width), val); }
+	T get_at (int row, int col) { return *element (row, col, false); }
+	T get_at (size_t idx) { return get_at (int (idx / width), int (idx % width)); }
+	T get_max();
 	size_t size();
 	size_t get_width();
 	size_t get_height();
-	size_t get_chlen(size_t x);
-	bool safe(size_t x, size_t y) const;
+	size_t get_chlen (size_t x);
+	bool safe (size_t row, size_t col) const;
 
 private:
+	// Address of element (row, col) in its resident page. Consecutive accesses to one page skip the cache lookup
+	T* element (size_t row, size_t col, bool modify)
+	{
+		size_t pr = row / page_rows,
+			pc = col / page_cols,
+			p = pr * n_page_cols + pc;
+		if (p != cur_page || (modify && ! cur_dirty))
+			make_current (p, modify);
+		return cur_data + (row - pr * page_rows) * page_cols + (col - pc * page_cols);
+	}
+
+	void make_current (size_t p, bool modify);
+	T* page (size_t p, bool modify);
+	void load (size_t slot, size_t p);
+	void evict (size_t slot);
+	void release_pages();
+	size_t page_bytes() const { return PAGE_LEN * sizeof(T); }
+
+	struct ResidentPage
+	{
+		size_t page;
+		T* data;
+		bool dirty;
+		bool view;	// 'data' is a mapped view of the file, otherwise it's 'buffer'
+		std::vector<T> buffer;	// Used if the file isn't mapped
+		std::list<size_t>::iterator lru_pos;
+	};
+
 	std::string filepath;
 	FILE* pF = nullptr;
-	int width, height;
-	size_t item_size = sizeof(double);
+	int width = 0, height = 0;
+	size_t page_rows = 1, page_cols = PAGE_LEN, n_page_cols = 0, n_pages = 0, capacity = 0;
+	bool mappable = false;	// Pages can be mapped views of the file
+	std::vector<ResidentPage> resident;
+	std::vector<int> slot_of;	// Slot in 'resident' of each page, -1 if the page isn't resident
+	std::list<size_t> lru;	// Slots, most recently used first
+	size_t cur_page = SIZE_MAX;
+	T* cur_data = nullptr;
+	bool cur_dirty = false;
 	AABB original_aabb;
 };
 
+/// @brief Writable out of RAM image matrix of intensities in their native type
+using WriteImageMatrix_nontriv = PagedImageMatrix_nontriv<PixIntens>;
+
 
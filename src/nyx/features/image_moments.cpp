@@ -1,5 +1,6 @@
 #include "../environment.h"
 #include "image_moments.h"
+#include "../helpers/timing.h"
 
 ImageMomentsFeature::ImageMomentsFeature() : FeatureMethod("ImageMomentsFeature")
 {
@@ -136,7 +137,7 @@ void ImageMomentsFeature::calculate_via_gpu (LR& r, size_t roi_idx)
 
 void ImageMomentsFeature::osized_add_online_pixel (size_t x, size_t y, uint32_t intensity) {} // Not supporting online for image moments
 
-void ImageMomentsFeature::save_value(std::vector<std::vector<double>>& fvals)
+void ImageMomentsFeature::save_value(FeatureValues& fvals)
 {
     fvals[SPAT_MOMENT_00][0] = m00;
     fvals[SPAT_MOMENT_01][0] = m01;
@@ -368,12 +369,37 @@ void ImageMomentsFeature::calcNormSpatialMoments (const pixData& D)
     w30 = NormSpatMom (D, 3, 0);
 }
 
+void ImageMomentsFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+    #ifdef USE_GPU
+        // Did the user opt out from using GPU?
+        if (theEnvironment().using_gpu())
+        {
+            STOPWATCH("GPU-Moments/GPU-Moments/2D moms/#FFFACD", "\t=");
+            gpu_process_all_rois (*ptrLabels, *ptrLabelData);
+            return;
+        }
+    #endif
+
+    STOPWATCH("Moments/Moments/2D moms/#FFFACD", "\t=");
+    parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+bool ImageMomentsFeature::roi_granular()
+{
+    #ifdef USE_GPU
+        return ! theEnvironment().using_gpu();	// the GPU-side calculation takes the whole batch at once
+    #else
+        return true;
+    #endif
+}
+
 /// @brief Calculates the features for a subset of ROIs in a thread-safe way with other ROI subsets
 /// @param start Start index of the ROI label vector
 /// @param end End index of the ROI label vector
 /// @param ptrLabels ROI label vector
 /// @param ptrLabelData ROI data
-void ImageMomentsFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void ImageMomentsFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
     for (auto i = start; i < end; i++)
     {
@@ -393,10 +419,10 @@ void ImageMomentsFeature::parallel_process_1_batch (size_t start, size_t end, st
 /// @brief Calculates the features for all the ROIs in a single thread (for calculating via GPU) 
 /// @param ptrLabels ROI label vector
 /// @param ptrLabelData ROI data
-void ImageMomentsFeature::gpu_process_all_rois (const std::vector<int> & Labels, std::unordered_map <int, LR>& RoiData)
+void ImageMomentsFeature::gpu_process_all_rois (const std::vector<int> & Labels, RoiStore& RoiData)
 {
     // Send image matrices to GPU-side
-    bool ok = send_imgmatrices_to_gpu (ImageMatrixBuffer, imageMatrixBufferLen);
+    bool ok = send_imgmatrices_to_gpu (ImageMatrixBuffer(), imageMatrixBufferLen());
 
     // Prepare consolidated all-ROI contours for pixel weighting in weighted moments
     std::vector<size_t> hoIndices;
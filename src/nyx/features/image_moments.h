@@ -21,9 +21,11 @@ public:
     void calculate(LR& r);
     void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity);
     void osized_calculate(LR& r, ImageLoader& imloader);
-    void save_value(std::vector<std::vector<double>>& feature_vals);
-    static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
-    static void gpu_process_all_rois (const std::vector<int>& ptrLabels, std::unordered_map <int, LR>& ptrLabelData);
+    void save_value(FeatureValues& feature_vals);
+    static void parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+    void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+    bool roi_granular();
+    static void gpu_process_all_rois (const std::vector<int>& ptrLabels, RoiStore& ptrLabelData);
 
     // Compatibility with manual reduce
     static bool required(const FeatureSet& fs)
@@ -171,6 +173,6 @@ bool free_imgmatrices_on_gpu();
 
 namespace Nyxus
 {
-    extern PixIntens* ImageMatrixBuffer;
-    extern size_t imageMatrixBufferLen;
+    PixIntens*& ImageMatrixBuffer();
+    size_t& imageMatrixBufferLen();
 }
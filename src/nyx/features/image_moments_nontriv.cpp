@@ -4,7 +4,7 @@ void ImageMomentsFeature::osized_calculate(LR& r, ImageLoader& imlo)
 {
     const ImageMatrix& im = r.aux_image_matrix;
 
-    ReadImageMatrix_nontriv I(r.aabb); 
+    ReadImageMatrix_nontriv I(r.aabb, r.label); 
     calcOrigins_nontriv (imlo, I);
     calcSpatialMoments_nontriv (imlo, I);
     calcCentralMoments_nontriv (imlo, I);
@@ -22,15 +22,13 @@ void ImageMomentsFeature::osized_calculate(LR& r, ImageLoader& imlo)
 
 double ImageMomentsFeature::Moment_nontriv (ImageLoader& imlo, ReadImageMatrix_nontriv& I, int p, int q)
 {
-    // calc (p+q)th moment of object
+    // calc (p+q)th moment of object in one pass over its tiles
     double sum = 0;
-    for (size_t x = 0; x < I.get_width(); x++)
+    I.for_each_segment (imlo, [&] (size_t y, size_t x0, const PixIntens* inten, size_t n)
     {
-        for (size_t y = 0; y < I.get_height(); y++)
-        {
-            sum += I.get_at(imlo, y, x) * pow(x, p) * pow(y, q);
-        }
-    }
+        for (size_t x = x0; x < x0 + n; x++)
+            sum += inten[x - x0] * pow(x, p) * pow(y, q);
+    });
     return sum;
 }
 
@@ -66,15 +64,13 @@ void ImageMomentsFeature::calcOrigins_nontriv (WriteImageMatrix_nontriv & I)
 
 double ImageMomentsFeature::CentralMom_nontriv (ImageLoader& imlo, ReadImageMatrix_nontriv& I, int p, int q)
 {
-    // calculate central moment
+    // calculate central moment in one pass over the object's tiles
     double sum = 0;
-    for (int x = 0; x < I.get_width(); x++)
+    I.for_each_segment (imlo, [&] (size_t y, size_t x0, const PixIntens* inten, size_t n)
     {
-        for (int y = 0; y < I.get_height(); y++)
-        {
-            sum += I.get_at(imlo, y, x) * pow((double(x) - originOfX), p) * pow((double(y) - originOfY), q);
-        }
-    }
+        for (size_t x = x0; x < x0 + n; x++)
+            sum += inten[x - x0] * pow((double(x) - originOfX), p) * pow((double(y) - originOfY), q);
+    });
     return sum;
 }
 
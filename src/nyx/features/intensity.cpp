@@ -3,6 +3,7 @@
 #include "histogram.h"
 #include "intensity.h"
 #include "pixel.h"
+#include "../helpers/timing.h"
 
 
 PixelIntensityFeatures::PixelIntensityFeatures() : FeatureMethod("PixelIntensityFeatures")
@@ -42,19 +43,19 @@ void PixelIntensityFeatures::calculate(LR& r)
 
 	double n = r.aux_area;
 
-	// --MEAN, ENERGY, CENTROID_XY
+	// Cached intensities
+	const PixIntens* I = r.raw_pixels.intensities();
+	size_t np = r.raw_pixels.size();
+
+	// --MEAN, ENERGY
 	double mean_ = 0.0;
 	double energy = 0.0;
-	double cen_x = 0.0,
-		cen_y = 0.0,
-		integInten = 0.0;
-	for (auto& px : r.raw_pixels)
+	double integInten = 0.0;
+	for (size_t i = 0; i < np; i++)
 	{
-		mean_ += px.inten;
-		energy += px.inten * px.inten;
-		cen_x += px.x;
-		cen_y += px.y;
-		integInten += px.inten;
+		mean_ += I[i];
+		energy += I[i] * I[i];
+		integInten += I[i];
 	}
 	mean_ /= n;
 	val_MEAN = mean_;
@@ -65,9 +66,9 @@ void PixelIntensityFeatures::calculate(LR& r)
 	// --MAD, VARIANCE, STDDEV
 	double mad = 0.0,
 		var = 0.0;
-	for (auto& px : r.raw_pixels)
+	for (size_t i = 0; i < np; i++)
 	{
-		double diff = px.inten - mean_;
+		double diff = I[i] - mean_;
 		mad += std::abs(diff);
 		var += diff * diff;
 	}
@@ -106,17 +107,17 @@ void PixelIntensityFeatures::calculate(LR& r)
 
 	// Skewness
 	Moments4 mom;
-	for (auto& px : r.raw_pixels)
-		mom.add(px.inten);
+	for (size_t i = 0; i < np; i++)
+		mom.add(I[i]);
 	val_SKEWNESS = mom.skewness();
 
 	// Kurtosis
 	val_KURTOSIS = mom.kurtosis();
 
 	double sumPow5 = 0, sumPow6 = 0;
-	for (auto& px : r.raw_pixels)
+	for (size_t i = 0; i < np; i++)
 	{
-		double diff = px.inten - mean_;
+		double diff = I[i] - mean_;
 		sumPow5 += std::pow(diff, 5.);
 		sumPow6 += std::pow(diff, 6.);
 	}
@@ -131,48 +132,41 @@ void PixelIntensityFeatures::calculate(LR& r)
 }
 
 void PixelIntensityFeatures::osized_add_online_pixel(size_t x, size_t y, uint32_t intensity)
-{}
+{
+	online.add (intensity);
+}
+
+void PixelIntensityFeatures::osized_merge_online (const FeatureMethod& other)
+{
+	online.merge (static_cast<const PixelIntensityFeatures&>(other).online);
+}
 
 void PixelIntensityFeatures::osized_calculate (LR& r, ImageLoader& imloader)
 {
+	// The features are calculated like calculate() does from the summary of pixels fed online. It's exact unless the ROI's range of
+	// intensities is too wide (see OnlineIntensityStats), then histogram-based features are approximate
+	double n = online.count();
+	if (n == 0)
+		return;
+
 	// --MIN, MAX
-	val_MIN = r.aux_min;
-	val_MAX = r.aux_max;
+	val_MIN = online.min();
+	val_MAX = online.max();
 	val_RANGE = val_MAX - val_MIN;
 
-	double n = r.aux_area;
-
-	// --MEAN, ENERGY, CENTROID_XY
-	double mean_ = 0.0;
-	double energy = 0.0;
-	double cen_x = 0.0,
-		cen_y = 0.0,
-		integInten = 0.0;
-	for (size_t i = 0; i < n; i++) //--- for (auto& px : r.raw_pixels)
-	{
-		Pixel2 px = r.osized_pixel_cloud.get_at(i);
-		mean_ += px.inten;
-		energy += px.inten * px.inten;
-		cen_x += px.x;
-		cen_y += px.y;
-		integInten += px.inten;
-	}
-	mean_ /= n;
+	// --MEAN, ENERGY
+	MergeableMoments mom = online.moments();
+	double mean_ = mom.mean();
 	val_MEAN = mean_;
-	val_ENERGY = energy;
+	val_ENERGY = mom.central_sum(2) + n * mean_ * mean_;
 	val_ROOT_MEAN_SQUARED = sqrt(val_ENERGY / n);
-	val_INTEGRATED_INTENSITY = integInten;
+	val_INTEGRATED_INTENSITY = mean_ * n;
 
 	// --MAD, VARIANCE, STDDEV
-	double mad = 0.0,
-		var = 0.0;
-	for (auto& px : r.raw_pixels)
-	{
-		mad += std::abs(px.inten - mean_);
-		var += (px.inten - mean_) * (px.inten - mean_);
-	}
+	double mad = 0.0;
+	online.for_each_bin ([&mad, mean_] (double v, size_t cnt) { mad += std::abs(v - mean_) * cnt; });
 	val_MEAN_ABSOLUTE_DEVIATION = mad / n;
-	var /= n;
+	double var = n > 1 ? mom.central_sum(2) / (n - 1) : 0.0;
 	double stddev = sqrt(var);
 	val_STANDARD_DEVIATION = stddev;
 
@@ -180,13 +174,11 @@ void PixelIntensityFeatures::osized_calculate (LR& r, ImageLoader& imloader)
 	val_STANDARD_ERROR = stddev / sqrt(n);
 
 	//==== Do not calculate features of all-blank intensities (to avoid NANs)
-	if (r.aux_min == 0 && r.aux_max == 0)
+	if (val_MIN == 0 && val_MAX == 0)
 		return;
 
 	// P10, 25, 75, 90, IQR, RMAD, entropy, uniformity
-	TrivialHistogram H;
-	H.initialize(r.aux_min, r.aux_max, r.raw_pixels);
-	auto [median_, mode_, p01_, p10_, p25_, p75_, p90_, p99_, iqr_, rmad_, entropy_, uniformity_] = H.get_stats();
+	auto [median_, mode_, p01_, p10_, p25_, p75_, p90_, p99_, iqr_, rmad_, entropy_, uniformity_] = online.get_stats();
 	val_MEDIAN = median_;
 	val_P01 = p01_;
 	val_P10 = p10_;
@@ -200,35 +192,25 @@ void PixelIntensityFeatures::osized_calculate (LR& r, ImageLoader& imloader)
 	val_MODE = mode_;
 	val_UNIFORMITY = uniformity_;
 
-	// --Uniformity calculated as PIU, percent image uniformity - see "A comparison of five standard methods for evaluating image 
-	//	intensity uniformity in partially parallel imaging MRI" [https://www.ncbi.nlm.nih.gov/pmc/articles/PMC3745492/] 
-	//	and https://aapm.onlinelibrary.wiley.com/doi/abs/10.1118/1.2241606
-	double piu = (1.0 - double(r.aux_max - r.aux_min) / double(r.aux_max + r.aux_min)) * 100.0;
+	// --Uniformity calculated as PIU, percent image uniformity - see calculate()
+	double piu = (1.0 - (val_MAX - val_MIN) / (val_MAX + val_MIN)) * 100.0;
 	val_UNIFORMITY_PIU = piu;
 
-	// Skewness
-	//--Formula 1--	lr.fvals[SKEWNESS][0] = std::sqrt(n) * lr.aux_M3 / std::pow(lr.aux_M2, 1.5);
-	//--Formula 2-- skewness = 3 * (mean - median) / stddev
-	Moments4 mom;
-	for (size_t i = 0; i < n; i++) //--- for (auto& px : r.raw_pixels)
-	{
-		Pixel2 px = r.osized_pixel_cloud.get_at(i);
-		mom.add(px.inten);
-	}
-	val_SKEWNESS = mom.skewness();
+	// Skewness and kurtosis like Moments4 calculates them
+	double M2 = mom.central_sum(2);
+	val_SKEWNESS = M2 == 0.0 || n <= 3 ? 0.0 : std::sqrt(n) * mom.central_sum(3) / std::pow(M2, 1.5);
+	val_KURTOSIS = M2 == 0.0 || n <= 4 ? 0.0 : n * mom.central_sum(4) / (M2 * M2);
 
-	// Kurtosis
-	//--Formula-- k1 = mean((x - mean(x)). ^ 4) / std(x). ^ 4
-	val_KURTOSIS = mom.kurtosis();
-
-	// Hyperskewness hs = E[x-mean].^5 / std(x).^5
-	val_HYPERSKEWNESS = mom.hyperskewness();
+	// Hyperskewness
+	double denom = (n * std::pow(val_STANDARD_DEVIATION, 5.));
+	val_HYPERSKEWNESS = denom == 0. ? 0. : mom.central_sum(5) / denom;
 
-	// Hyperflatness hf = E[x-mean].^6 / std(x).^6
-	val_HYPERFLATNESS = mom.hyperflatness();
+	// Hyperflatness
+	denom = (n * std::pow(val_STANDARD_DEVIATION, 6.));
+	val_HYPERFLATNESS = denom == 0. ? 0. : mom.central_sum(6) / denom;
 }
 
-void PixelIntensityFeatures::save_value(std::vector<std::vector<double>>& fvals)
+void PixelIntensityFeatures::save_value(FeatureValues& fvals)
 {
 	fvals [INTEGRATED_INTENSITY][0] = val_INTEGRATED_INTENSITY; 
 	fvals[MEAN][0] = val_MEAN;
@@ -259,15 +241,13 @@ void PixelIntensityFeatures::save_value(std::vector<std::vector<double>>& fvals)
 	fvals[ROBUST_MEAN_ABSOLUTE_DEVIATION][0] = val_ROBUST_MEAN_ABSOLUTE_DEVIATION;
 }
 
-void PixelIntensityFeatures::parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)
+void PixelIntensityFeatures::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
-	size_t jobSize = roi_labels.size(),
-		workPerThread = jobSize / n_threads;
-
-	runParallel(PixelIntensityFeatures::parallel_process_1_batch, n_threads, workPerThread, jobSize, &roi_labels, &roiData);
+	STOPWATCH("Intensity/Intensity/Int/#FFFF00", "\t=");
+	reduce (start, end, ptrLabels, ptrLabelData);
 }
 
-void PixelIntensityFeatures::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void PixelIntensityFeatures::parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	// Calculate the feature for each batch ROI item 
 	for (auto i = firstitem; i < lastitem; i++)
@@ -287,7 +267,7 @@ void PixelIntensityFeatures::parallel_process_1_batch(size_t firstitem, size_t l
 	}
 }
 
-void PixelIntensityFeatures::reduce(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void PixelIntensityFeatures::reduce(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -323,5 +303,7 @@ void PixelIntensityFeatures::cleanup_instance()
 		val_P01 = 0, val_P10 = 0, val_P25 = 0, val_P75 = 0, val_P90 = 0, val_P99 = 0,
 		val_INTERQUARTILE_RANGE = 0,
 		val_ROBUST_MEAN_ABSOLUTE_DEVIATION = 0;
+
+	online.reset();
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "../feature_method.h"
+#include "online_stats.h"
 
 class PixelIntensityFeatures : public FeatureMethod
 {
@@ -7,11 +8,13 @@ public:
 	PixelIntensityFeatures();
 	void calculate(LR& r);
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity);
+	bool osized_online_only() { return true; }
+	void osized_merge_online (const FeatureMethod& other);
 	void osized_calculate(LR& r, ImageLoader& imloader);
-	void save_value (std::vector<std::vector<double>>& feature_vals);
-	void parallel_process(std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads);
-	static void parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
-	static void reduce(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	void save_value (FeatureValues& feature_vals);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	static void parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	static void reduce(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 	void cleanup_instance();
 
 private:
@@ -38,4 +41,7 @@ private:
 		val_P01 = 0, val_P10 = 0, val_P25 = 0, val_P75 = 0, val_P90 = 0, val_P99 = 0,
 		val_INTERQUARTILE_RANGE = 0,
 		val_ROBUST_MEAN_ABSOLUTE_DEVIATION = 0;
+
+	// Summary of an oversized ROI's pixels fed online
+	OnlineIntensityStats online;
 };
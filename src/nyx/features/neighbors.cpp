@@ -9,8 +9,11 @@
 #include <thread>
 #include <future>
 #include "../globals.h"
+#include "../nyxus_context.h"
 #include "../environment.h"
 #include "neighbors.h"
+#include "../thread_pool.h"
+#include "../helpers/timing.h"
 
 NeighborsFeature::NeighborsFeature(): FeatureMethod("NeighborsFeature")
 {
@@ -25,6 +28,8 @@ NeighborsFeature::NeighborsFeature(): FeatureMethod("NeighborsFeature")
 		ANG_BW_NEIGHBORS_STDDEV,
 		ANG_BW_NEIGHBORS_MODE
 		});
+
+	add_dependencies ({ PERIMETER, CENTROID_X });	// uses ROI contours and centroids
 }
 
 void NeighborsFeature::calculate(LR& r)
@@ -39,31 +44,38 @@ void NeighborsFeature::osized_calculate(LR& r, ImageLoader& imloader)
 
 /// @brief All the logic is in parallel_process()
 /// @param feature_vals 
-void NeighborsFeature::save_value(std::vector<std::vector<double>>& feature_vals) {}
+void NeighborsFeature::save_value(FeatureValues& feature_vals) {}
 
 /// @brief All the logic is in parallel_process()
 /// @param start 
 /// @param end 
 /// @param ptrLabels 
 /// @param ptrLabelData 
-void NeighborsFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData) 
+void NeighborsFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData) 
 {
 }
 
 // Calculates the features using spatial hashing approach (indirectly)
-void NeighborsFeature::parallel_process (std::vector<int>& roi_labels, std::unordered_map <int, LR>& roiData, int n_threads)
+void NeighborsFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
+	STOPWATCH("Neighbors/Neighbors/N/#FF69B4", "\t=");
 	manual_reduce();
 }
 
+/// @brief Neighbors are found among all the ROIs at once
+bool NeighborsFeature::roi_granular()
+{
+	return false;
+}
+
 /// @brief Implements the narrow phase
 /// @param start 
 /// @param end 
 /// @param ptrLabels 
 /// @param ptrLabelData 
-void parallel_process_1_batch_of_collision_pairs (size_t start, size_t end, std::vector<std::pair<int, int>>* ptrCollisionPairsVec, std::unordered_map <int, LR>* ptrLabelData)
+void parallel_process_1_batch_of_collision_pairs (size_t start, size_t end, std::vector<std::pair<int, int>>* ptrCollisionPairsVec, RoiStore* ptrLabelData)
 {
-	int radius = theEnvironment.get_pixel_distance();
+	int radius = theEnvironment().get_pixel_distance();
 
 	size_t radius2 = radius * radius;	// We will compare radius with L2 distances
 
@@ -72,8 +84,8 @@ void parallel_process_1_batch_of_collision_pairs (size_t start, size_t end, std:
 		auto colpair = (*ptrCollisionPairsVec)[i];
 		auto l1 = colpair.first;
 		auto l2 = colpair.second;
-		LR& r1 = roiData[l1];
-		LR& r2 = roiData[l2];
+		LR& r1 = roiData()[l1];
+		LR& r2 = roiData()[l2];
 
 		// Make sure that segment's outer pixels are available
 		if (r1.contour.size() == 0)
@@ -117,15 +129,13 @@ void NeighborsFeature::manual_reduce()
 	//	imCont.print (hdr, "t");
 	//}
 
-	int radius = theEnvironment.get_pixel_distance();
+	int radius = theEnvironment().get_pixel_distance();
 	int n_threads = 1; 
 
 	//==== Collision detection, method 1 (greedy)
-	auto n_ul = uniqueLabels.size();
+	auto n_ul = roiData().size();
 	
-	std::vector <int> LabsVec;
-	LabsVec.reserve (uniqueLabels.size());
-	LabsVec.insert (LabsVec.end(), uniqueLabels.begin(), uniqueLabels.end());
+	const std::vector <int>& LabsVec = roiData().labels();
 
 	std::vector <std::pair<int, int>> CM2;
 	CM2.reserve (n_ul * n_ul / 4);	// estimate: 25% of the segment population
@@ -139,7 +149,7 @@ void NeighborsFeature::manual_reduce()
 	for (size_t i1 = 0; i1 < n_ul; i1++) 
 	{
 		auto l1 = LabsVec[i1];
-		LR& r1 = roiData[l1];
+		LR& r1 = roiData()[l1];
 
 		for (size_t i2 = 0; i2 < n_ul; i2++) 
 		{
@@ -149,7 +159,7 @@ void NeighborsFeature::manual_reduce()
 			if (n_threads==1 && i1 > i2) 
 				continue;	// No need to check the upper triangle for single-threaded runs. Multi-threaded runs require the upper triangle for thread-safe results.
 
-			LR& r2 = roiData[l2];
+			LR& r2 = roiData()[l2];
 			bool noOverlap = r2.aabb.get_xmin() > r1.aabb.get_xmax() || r2.aabb.get_xmax() < r1.aabb.get_xmin() 
 				|| r2.aabb.get_ymin() > r1.aabb.get_ymax() || r2.aabb.get_ymax() < r1.aabb.get_ymin() ;
 			if (! noOverlap)
@@ -175,7 +185,7 @@ void NeighborsFeature::manual_reduce()
 	for (size_t i1 = 0; i1 < nul; i1++) 
 	{
 		auto l1 = LabsVec[i1];
-		LR& r1 = roiData[l1];
+		LR& r1 = roiData()[l1];
 
 		for (size_t i2 = 0; i2 < nul; i2++) 
 		{
@@ -189,7 +199,7 @@ void NeighborsFeature::manual_reduce()
 			{
 				// Check if these labels are close enough
 				auto l2 = LabsVec[i2];
-				LR& r2 = roiData[l2];
+				LR& r2 = roiData()[l2];
 
 				// Iterate r1's contour pixels
 				double mind = r1.contour[0].min_sqdist (r2.contour);
@@ -228,42 +238,79 @@ void NeighborsFeature::manual_reduce()
 	
 	if (n_threads == 1)
 	{
-		// single thread
+		// Each pair is listed once. Its contours' distance is measured on the thread pool, then the measurements are applied 
+		// to both ROIs serially
 		size_t radius2 = radius * radius;	// We will compare radius with L2 distances
-		for (auto pa : CM2)
-		{
-			auto l1 = pa.first;
-			auto l2 = pa.second;
-			LR& r1 = roiData[l1];
-			LR& r2 = roiData[l2];
-
-			// Make sure that segment's outer pixels are available
-			if (r1.contour.size() == 0)
-				continue;
-
-			// Make sure that the other ROI's pixel cloud is non-empty
-			if (r2.contour.size() == 0)
-				continue;
 
-			// Iterate r1's outer pixels
-			double mind = r1.contour[0].min_sqdist(r2.contour);
+		// Measure distances of pairs' contours on the thread pool, pairs of the longest contours first
+		struct PairMeasure 
+		{
+			bool measured = false;
+			double mind = 0;
 			size_t n_touchingOuterPixels = 0;
-			for (auto& cp : r1.contour)
+		};
+		std::vector<PairMeasure> M (CM2.size());
+
+		std::vector<size_t> order (CM2.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		auto pairCost = [&CM2] (size_t i) { return roiData().find(CM2[i].first)->contour.size() * roiData().find(CM2[i].second)->contour.size() + 1; };
+		std::stable_sort (order.begin(), order.end(), [&pairCost] (size_t a, size_t b) { return pairCost(a) > pairCost(b); });
+		std::vector<size_t> costs;
+		costs.reserve (order.size());
+		for (auto i : order)
+			costs.push_back (pairCost(i));
+
+		std::vector<ThreadPool::Task> T;
+		for (auto& rng : split_by_cost (costs, theEnvironment().n_reduce_threads))
+			T.push_back ([&CM2, &M, &order, rng] 
 			{
-				double minD = cp.min_sqdist(r2.contour);
-				mind = std::min(mind, minD);		//--We aren't interested in max distance-->	maxd = std::max(maxd, maxD);
+				for (size_t k = rng.first; k < rng.second; k++)
+				{
+					size_t i = order[k];
+					const LR& r1 = *roiData().find (CM2[i].first);
+					const LR& r2 = *roiData().find (CM2[i].second);
+
+					// Make sure that segment's outer pixels are available
+					if (r1.contour.size() == 0)
+						continue;
+
+					// Make sure that the other ROI's pixel cloud is non-empty
+					if (r2.contour.size() == 0)
+						continue;
+
+					// Iterate r1's outer pixels
+					double mind = r1.contour[0].min_sqdist(r2.contour);
+					size_t n_touchingOuterPixels = 0;
+					for (auto& cp : r1.contour)
+					{
+						double minD = cp.min_sqdist(r2.contour);
+						mind = std::min(mind, minD);		//--We aren't interested in max distance-->	maxd = std::max(maxd, maxD);
 
-				// Maintain touching pixels stats
-				if (minD == 0) // (minD <= radius2)
-					n_touchingOuterPixels++;
-			}
+						// Maintain touching pixels stats
+						if (minD == 0) // (minD <= radius2)
+							n_touchingOuterPixels++;
+					}
+
+					M[i] = { true, mind, n_touchingOuterPixels };
+				}
+			});
+		theThreadPool().run (T, theEnvironment().n_reduce_threads);
+
+		// Apply the measurements in the pair order
+		for (size_t i = 0; i < CM2.size(); i++)
+		{
+			auto l1 = CM2[i].first;
+			auto l2 = CM2[i].second;
+			LR& r1 = roiData()[l1];
+			LR& r2 = roiData()[l2];
 
 			// Check versus the radius
-			if (mind > radius2)
+			if (! M[i].measured || M[i].mind > radius2)
 				continue;
 
 			// Save partial statis of r1's touching pixel stats
-			r1.fvals[PERCENT_TOUCHING][0] += n_touchingOuterPixels;
+			r1.fvals[PERCENT_TOUCHING][0] += M[i].n_touchingOuterPixels;
 
 			// Definitely neigbors
 			r1.fvals[NUM_NEIGHBORS][0]++;
@@ -276,7 +323,7 @@ void NeighborsFeature::manual_reduce()
 		for (auto pa : CM2)
 		{
 			auto l1 = pa.first;
-			LR& r1 = roiData[l1];
+			LR& r1 = roiData()[l1];
 			// Finalize the % touching calculation
 			r1.fvals[PERCENT_TOUCHING][0] = 100.0 * double(r1.fvals[PERCENT_TOUCHING][0]) / double(r1.contour.size());
 		}
@@ -294,7 +341,7 @@ void NeighborsFeature::manual_reduce()
 				idxE = idxS + workPerThread;
 			if (t == n_threads - 1)
 				idxE = jobSize; // include the tail
-			T.push_back (std::async(std::launch::async, parallel_process_1_batch_of_collision_pairs, idxS, idxE, &CM2, &roiData));
+			T.push_back (std::async(std::launch::async, in_current_context (parallel_process_1_batch_of_collision_pairs), idxS, idxE, &CM2, &roiData()));
 		}
 	}
 
@@ -309,9 +356,8 @@ void NeighborsFeature::manual_reduce()
 	int m = 100;
 	std::vector <std::vector<int>> HT(m);
 
-	for (auto l : Nyxus::uniqueLabels)
+	for (LR& r : Nyxus::roiData())
 	{
-		LR& r = Nyxus::roiData[l];
 
 		/*
 		auto h1 = spat_hash_2d(r.aabb.get_xmin(), r.aabb.get_ymin(), m),
@@ -383,13 +429,13 @@ void NeighborsFeature::manual_reduce()
 		// Perform the N^2 check
 		for (auto& l1 : bin)
 		{
-			LR& r1 = Nyxus::roiData[l1];
+			LR& r1 = Nyxus::roiData()[l1];
 
 			for (auto& l2 : bin)
 			{
 				if (l1 < l2)	// Lower triangle 
 				{
-					LR& r2 = Nyxus::roiData[l2];
+					LR& r2 = Nyxus::roiData()[l2];
 					bool overlap = !aabbNoOverlap(r1, r2, radius);
 					if (overlap)
 					{
@@ -408,9 +454,8 @@ void NeighborsFeature::manual_reduce()
 #endif
 
 	// Closest neighbors
-	for (auto l : Nyxus::uniqueLabels)
+	for (LR& r : Nyxus::roiData())
 	{
-		LR& r = Nyxus::roiData[l];
 		int n_neigs = int(r.fvals[NUM_NEIGHBORS][0]);
 
 		// Any neighbors of this ROI ?
@@ -424,7 +469,7 @@ void NeighborsFeature::manual_reduce()
 		dists.reserve(r.aux_neighboring_labels.size());
 		for (auto l_neig : r.aux_neighboring_labels)
 		{
-			LR& r_neig = Nyxus::roiData[l_neig];
+			LR& r_neig = Nyxus::roiData()[l_neig];
 			double cenx_n = r_neig.fvals[CENTROID_X][0],
 				ceny_n = r_neig.fvals[CENTROID_Y][0],
 				dx = cenx - cenx_n,
@@ -442,7 +487,7 @@ void NeighborsFeature::manual_reduce()
 		r.fvals[CLOSEST_NEIGHBOR1_DIST][0] = dists[closest_1_idx];
 
 		// Save angle with neighbor #1
-		LR& r1 = Nyxus::roiData[closest1label];
+		LR& r1 = Nyxus::roiData()[closest1label];
 		r.fvals[CLOSEST_NEIGHBOR1_ANG][0] = 180.0 * angle(cenx, ceny, r1.fvals[CENTROID_X][0], r1.fvals[CENTROID_X][0]);
 
 		// Find idx of 2nd minimum
@@ -460,7 +505,7 @@ void NeighborsFeature::manual_reduce()
 			r.fvals[CLOSEST_NEIGHBOR2_DIST][0] = dists[closest_2_idx];
 
 			// Save angle with neighbor #2
-			LR& r2 = Nyxus::roiData[closest2label];
+			LR& r2 = Nyxus::roiData()[closest2label];
 			r.fvals[CLOSEST_NEIGHBOR2_ANG][0] = 180.0 * angle(cenx, ceny, r2.fvals[CENTROID_X][0], r2.fvals[CENTROID_X][0]); 
 		}
 	}
@@ -468,9 +513,8 @@ void NeighborsFeature::manual_reduce()
 	// Angle between neigbors
 	Moments2 mom2;
 	std::vector<int> anglesRounded;
-	for (auto l : Nyxus::uniqueLabels)
+	for (LR& r : Nyxus::roiData())
 	{
-		LR& r = Nyxus::roiData[l];
 		int n_neigs = int(r.fvals[NUM_NEIGHBORS][0]);
 
 		// Any neighbors of this ROI ?
@@ -483,7 +527,7 @@ void NeighborsFeature::manual_reduce()
 		// Iterate all the neighbors
 		for (auto l_neig : r.aux_neighboring_labels)
 		{
-			LR& r_neig = Nyxus::roiData[l_neig];
+			LR& r_neig = Nyxus::roiData()[l_neig];
 			double cenx_n = r_neig.fvals[CENTROID_X][0],
 				ceny_n = r_neig.fvals[CENTROID_Y][0];
 
@@ -6,6 +6,7 @@
 #include "ngtdm.h"
 #include "image_matrix_nontriv.h"
 #include "../environment.h"
+#include "../helpers/timing.h"
 
 NGTDMFeature::NGTDMFeature(): FeatureMethod("NGTDMFeature")
 {
@@ -42,7 +43,7 @@ void NGTDMFeature::calculate (LR& r)
 	const pixData& D = im.ReadablePixels();
 
 	// Gather zones
-	unsigned int nGrays = theEnvironment.get_coarse_gray_depth();
+	unsigned int nGrays = theEnvironment().get_coarse_gray_depth();
 	for (int row = 0; row < D.height(); row++)
 		for (int col = 0; col < D.width(); col++)
 		{
@@ -151,7 +152,7 @@ void NGTDMFeature::calculate (LR& r)
 	_strength = calc_Strength();
 }
 
-void NGTDMFeature::save_value(std::vector<std::vector<double>>& fvals)
+void NGTDMFeature::save_value(FeatureValues& fvals)
 {
 	fvals[NGTDM_COARSENESS][0] = _coarseness;
 	fvals[NGTDM_CONTRAST][0] = _contrast;
@@ -174,7 +175,7 @@ void NGTDMFeature::osized_calculate (LR& r, ImageLoader& imloader)
 		return;
 	}	
 	
-	ReadImageMatrix_nontriv Im (r.aabb);
+	ReadImageMatrix_nontriv Im (r.aabb, r.label);
 
 	//==== Make a list of intensity clusters (zones)
 	using AveNeighborhoodInte = std::pair<PixIntens, double>;	// Pairs of (intensity, average intensity of all 8 neighbors)
@@ -408,7 +409,13 @@ double NGTDMFeature::calc_Strength()
 	return retval;
 }
 
-void NGTDMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void NGTDMFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Texture/NGTDM/NG/#bbbbbb", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void NGTDMFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
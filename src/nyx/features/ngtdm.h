@@ -30,7 +30,7 @@ public:
 	void calculate(LR& r);
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity);
 	void osized_calculate(LR& r, ImageLoader& imloader);
-	void save_value(std::vector<std::vector<double>>& feature_vals);
+	void save_value(FeatureValues& feature_vals);
 
 	// Coarseness
 	double calc_Coarseness();
@@ -43,7 +43,8 @@ public:
 	// Strength
 	double calc_Strength();
 
-	static void parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	static void parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 	// Comaptibility with manual reduce
 	static bool required(const FeatureSet& fs) 
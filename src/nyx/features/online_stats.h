@@ -0,0 +1,448 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <vector>
+#include "../helpers/helpers.h"
+#include "histogram.h"
+
+/// @brief Central moments of orders 2 to 6 of a stream of values, mergeable with those of another stream. Updates follow Pebay,
+/// "Formulas for robust, one-pass parallel computation of covariances and arbitrary-order statistical moments" (2008)
+class MergeableMoments
+{
+public:
+	static constexpr int MAX_ORDER = 6;
+
+	void add (double x)
+	{
+		n++;
+		if (n == 1)
+		{
+			mu = x;
+			return;
+		}
+
+		// Merging with a 1-item stream. Higher orders go first as they depend on the previous values of lower ones
+		double nA = n - 1,
+			d = x - mu,
+			a = -d / n,
+			c = nA * d / n;
+		for (int p = MAX_ORDER; p >= 2; p--)
+		{
+			double s = M[p],
+				ak = 1;
+			for (int k = 1; k <= p - 2; k++)
+			{
+				ak *= a;
+				s += binomial(p, k) * ak * M[p - k];
+			}
+			s += std::pow(c, p) * (1.0 - std::pow(-1.0 / nA, p - 1));
+			M[p] = s;
+		}
+		mu += d / n;
+	}
+
+	void merge (const MergeableMoments& other)
+	{
+		if (other.n == 0)
+			return;
+		if (n == 0)
+		{
+			*this = other;
+			return;
+		}
+
+		double nA = n,
+			nB = other.n,
+			N = nA + nB,
+			d = other.mu - mu,
+			a = -nB / N * d,
+			b = nA / N * d,
+			c = nA * nB / N * d;
+		for (int p = MAX_ORDER; p >= 2; p--)
+		{
+			double s = M[p] + other.M[p],
+				ak = 1,
+				bk = 1;
+			for (int k = 1; k <= p - 2; k++)
+			{
+				ak *= a;
+				bk *= b;
+				s += binomial(p, k) * (ak * M[p - k] + bk * other.M[p - k]);
+			}
+			s += std::pow(c, p) * (std::pow(1.0 / nB, p - 1) - std::pow(-1.0 / nA, p - 1));
+			M[p] = s;
+		}
+		mu += d * nB / N;
+		n += other.n;
+	}
+
+	size_t count() const { return n; }
+	double mean() const { return mu; }
+
+	/// @brief Sum of the values' 'p'-th powers of deviations from the mean, 2 <= p <= MAX_ORDER
+	double central_sum (int p) const { return M[p]; }
+
+	/// @brief Moments of 'counts[i]' times repeated values 'values[i]'
+	static MergeableMoments of_counts (const std::vector<double>& values, const std::vector<size_t>& counts)
+	{
+		MergeableMoments m;
+		double s = 0;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			m.n += counts[i];
+			s += values[i] * counts[i];
+		}
+		if (m.n == 0)
+			return m;
+		m.mu = s / m.n;
+
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			double d = values[i] - m.mu,
+				dp = d;
+			for (int p = 2; p <= MAX_ORDER; p++)
+			{
+				dp *= d;
+				m.M[p] += dp * counts[i];
+			}
+		}
+		return m;
+	}
+
+private:
+	size_t n = 0;
+	double mu = 0,
+		M[MAX_ORDER + 1] = {};
+
+	static double binomial (int p, int k)
+	{
+		static const double C[MAX_ORDER + 1][MAX_ORDER + 1] = {
+			{1},
+			{1, 1},
+			{1, 2, 1},
+			{1, 3, 3, 1},
+			{1, 4, 6, 4, 1},
+			{1, 5, 10, 10, 5, 1},
+			{1, 6, 15, 20, 15, 6, 1} };
+		return C[p][k];
+	}
+};
+
+/// @brief Mergeable online summary of a stream of pixel intensities: count, min, max, moments, and a histogram of bounded size.
+/// Intensities are counted exactly while their range doesn't exceed 'exact_span' values. Wider ranges are counted in a quantile
+/// sketch of logarithmic buckets, each containing values within SKETCH_ACCURACY relative distance of its representative value,
+/// and the moments are updated online. Memory doesn't depend on the number of intensities, so summaries of tiles or threads'
+/// parts of an arbitrarily large ROI can be accumulated independently and merged
+class OnlineIntensityStats
+{
+public:
+	static constexpr size_t EXACT_SPAN = 1 << 16;
+	static constexpr double SKETCH_ACCURACY = 0.005;
+
+	explicit OnlineIntensityStats (size_t exact_span = EXACT_SPAN) : exactSpan (exact_span) {}
+
+	void reset()
+	{
+		n = 0;
+		minVal = maxVal = 0;
+		base = 0;
+		counts.clear();
+		counts.shrink_to_fit();
+		sketched = false;
+		zeroCount = 0;
+		buckets.clear();
+		buckets.shrink_to_fit();
+		sketchMoments = MergeableMoments();
+	}
+
+	void add (PixIntens x)
+	{
+		if (n == 0)
+			minVal = maxVal = x;
+		else
+		{
+			minVal = std::min (minVal, x);
+			maxVal = std::max (maxVal, x);
+		}
+		n++;
+
+		if (! sketched)
+		{
+			if (x >= base && x - base < counts.size())
+			{
+				counts[x - base]++;
+				return;
+			}
+			if (widen (x, x))
+			{
+				counts[x - base]++;
+				return;
+			}
+			to_sketch();
+		}
+
+		sketch_add (x, 1);
+		sketchMoments.add (x);
+	}
+
+	void merge (const OnlineIntensityStats& other)
+	{
+		if (other.n == 0)
+			return;
+		if (n == 0)
+		{
+			*this = other;
+			return;
+		}
+
+		minVal = std::min (minVal, other.minVal);
+		maxVal = std::max (maxVal, other.maxVal);
+		n += other.n;
+
+		if (! sketched && ! other.sketched && widen (other.minVal, other.maxVal))
+		{
+			for (size_t x = other.minVal; x <= other.maxVal; x++)
+				counts[x - base] += other.counts[x - other.base];
+			return;
+		}
+
+		if (! sketched)
+			to_sketch();
+		if (other.sketched)
+		{
+			zeroCount += other.zeroCount;
+			for (size_t i = 0; i < other.buckets.size(); i++)
+				buckets[i] += other.buckets[i];
+		}
+		else
+			other.for_each_bin ([this] (double v, size_t cnt) { sketch_add ((PixIntens) v, cnt); });
+		sketchMoments.merge (other.moments());
+	}
+
+	size_t count() const { return n; }
+	PixIntens min() const { return minVal; }
+	PixIntens max() const { return maxVal; }
+
+	/// @brief Tells if the histogram is exact, otherwise values of for_each_bin() and quantiles are approximate
+	bool exact() const { return ! sketched; }
+
+	MergeableMoments moments() const
+	{
+		if (sketched)
+			return sketchMoments;
+
+		std::vector<double> V;
+		std::vector<size_t> C;
+		for_each_bin ([&V, &C] (double v, size_t cnt) { V.push_back(v); C.push_back(cnt); });
+		return MergeableMoments::of_counts (V, C);
+	}
+
+	/// @brief Calls 'f (value, count)' for each distinct intensity in ascending order or, if the histogram isn't exact, for
+	/// representative intensities of the sketch's buckets
+	template <class F>
+	void for_each_bin (F f) const
+	{
+		if (! sketched)
+		{
+			for (size_t i = 0; i < counts.size(); i++)
+				if (counts[i])
+					f (double(base + i), counts[i]);
+			return;
+		}
+
+		if (zeroCount)
+			f (0.0, zeroCount);
+		for (size_t i = 0; i < buckets.size(); i++)
+			if (buckets[i])
+				f (std::min (std::max (representative(i), double(minVal)), double(maxVal)), buckets[i]);
+	}
+
+	/// @brief Statistics calculated like TrivialHistogram::get_stats() does from all the intensities
+	/// @return [0] median, [1] mode, [2-7] p1, p10, p25, p75, p90, p99, [8] IQR, [9] RMAD, [10] entropy, [11] uniformity
+	std::tuple<double, HistoItem, double, double, double, double, double, double, double, double, double, double> get_stats() const
+	{
+		if (n == 0)
+			return { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+		std::vector<double> V;
+		std::vector<size_t> C;
+		for_each_bin ([&V, &C] (double v, size_t cnt) { V.push_back(v); C.push_back(cnt); });
+
+		// Median - the middle item or the mean of the two middle ones
+		double median = n % 2 ? nth_value (V, C, n / 2) : (nth_value (V, C, n / 2 - 1) + nth_value (V, C, n / 2)) / 2.0;
+
+		// Mode - the lowest of the most frequent values
+		size_t iMode = 0;
+		for (size_t i = 1; i < V.size(); i++)
+			if (C[iMode] < C[i])
+				iMode = i;
+		HistoItem mode = (HistoItem) V[iMode];
+
+		// Histograms
+		HistoItem valRange = maxVal - minVal;
+		int n_bins = int ((1. + log2(n)) + 0.5);
+		double binW = double(valRange) / double(n_bins),
+			binW100 = double(valRange) / 100.;
+		std::vector<size_t> bins (n_bins + 1, 0),
+			bins100 (100 + 1, 0),
+			bins256 (256 + 1, 0);
+		for (size_t i = 0; i < V.size(); i++)
+		{
+			HistoItem h = (HistoItem) V[i];
+			bins [bin_index (double(h - minVal) / binW, n_bins)] += C[i];
+			bins100 [bin_index (double(h - minVal) / binW100, 100)] += C[i];
+			bins256 [valRange ? std::min (Nyxus::to_grayscale (h, minVal, valRange, 256), 256u) : 0] += C[i];
+		}
+		bins[n_bins - 1] += bins[n_bins];
+		bins100[100 - 1] += bins100[100];
+		bins256[256 - 1] += bins256[256];
+
+		// Percentiles interpolated in the "percentile" histogram
+		double q[] = { 0.01, 0.1, 0.25, 0.75, 0.9, 0.99 },
+			P[] = { 0, 0, 0, 0, 0, 0 };
+		size_t runSum = 0;
+		for (int i = 0; i < 100; i++)
+		{
+			for (int k = 0; k < 6; k++)
+			{
+				double cnt_p = double(n) * q[k] + 0.5;
+				if (runSum <= cnt_p && cnt_p <= runSum + bins100[i])
+					P[k] = (cnt_p - runSum) * binW100 / double(bins100[i]) + minVal + binW100 * i;
+			}
+			runSum += bins100[i];
+		}
+
+		// RMAD 10-90 % of the "binary" histogram's bin centers
+		double lowBound = minVal + valRange * 0.1,
+			uprBound = minVal + valRange * 0.9,
+			sum1090 = 0.0;
+		size_t population1090 = 0;
+		for (int i = 0; i < n_bins; i++)
+		{
+			double binC = (minVal + binW * i + minVal + binW * i + binW) / 2.f;
+			if (binC >= lowBound && binC <= uprBound)
+			{
+				sum1090 += binC;
+				population1090++;
+			}
+		}
+		double rmad = 0;
+		if (population1090)
+		{
+			double mean1090 = sum1090 / double(population1090),
+				sumAbs = 0.0;
+			for (int i = 0; i < n_bins; i++)
+			{
+				double binC = (minVal + binW * i + minVal + binW * i + binW) / 2.f;
+				if (binC >= lowBound && binC <= uprBound)
+					sumAbs += std::abs (binC - mean1090);
+			}
+			rmad = sumAbs / double(population1090);
+		}
+
+		// Entropy of the "binary" histogram
+		double entropy = 0.0;
+		for (int i = 0; i < n_bins; i++)
+		{
+			double p = double(bins[i]) / double(n);
+			if (bins[i] == 0 || fabs(p) < 1e-15)
+				continue;
+			entropy += p * log2(p);
+		}
+
+		// Uniformity of the "uint8" histogram
+		double uniformity = 0.0;
+		for (int i = 0; i < 256; i++)
+			uniformity += std::pow (bins256[i], 2);
+
+		return { median, mode, P[0], P[1], P[2], P[3], P[4], P[5], P[3] - P[2], rmad, -entropy, uniformity };
+	}
+
+private:
+	size_t exactSpan;
+	size_t n = 0;
+	PixIntens minVal = 0,
+		maxVal = 0;
+
+	// Exact histogram: counts of intensities base, base+1, ...
+	PixIntens base = 0;
+	std::vector<size_t> counts;
+
+	// Sketch: counts of zeros and of intensities in buckets (gamma^(i-1), gamma^i]
+	bool sketched = false;
+	size_t zeroCount = 0;
+	std::vector<size_t> buckets;
+	MergeableMoments sketchMoments;
+
+	static double gamma() { return (1.0 + SKETCH_ACCURACY) / (1.0 - SKETCH_ACCURACY); }
+	static size_t bucket_of (PixIntens x) { return (size_t) std::max (0.0, std::ceil (std::log(double(x)) / std::log(gamma()))); }
+	static double representative (size_t i) { return 2.0 * std::pow(gamma(), double(i)) / (gamma() + 1.0); }
+
+	/// @brief Extends the exact histogram to intensities 'lo' ... 'hi' with some slack for further widening in the same direction.
+	/// Returns false if the range would exceed 'exactSpan'
+	bool widen (PixIntens lo, PixIntens hi)
+	{
+		uint64_t curLo = counts.empty() ? lo : base,
+			curHi = counts.empty() ? hi : base + counts.size() - 1,
+			newLo = std::min (curLo, (uint64_t) lo),
+			newHi = std::max (curHi, (uint64_t) hi),
+			span = newHi - newLo + 1;
+		if (span > exactSpan)
+			return false;
+
+		uint64_t slack = std::min (span, exactSpan - span);
+		if (newLo < curLo)
+			newLo = newLo > slack ? newLo - slack : 0;
+		if (newHi > curHi || counts.empty())
+			newHi = std::min (newHi + slack, (uint64_t) std::numeric_limits<PixIntens>::max());
+
+		std::vector<size_t> C (newHi - newLo + 1, 0);
+		std::copy (counts.begin(), counts.end(), C.begin() + (curLo - newLo));
+		counts.swap (C);
+		base = (PixIntens) newLo;
+		return true;
+	}
+
+	void sketch_add (PixIntens x, size_t cnt)
+	{
+		if (x == 0)
+			zeroCount += cnt;
+		else
+			buckets[bucket_of(x)] += cnt;
+	}
+
+	void to_sketch()
+	{
+		sketchMoments = moments();
+		buckets.assign (bucket_of(std::numeric_limits<PixIntens>::max()) + 1, 0);
+		zeroCount = 0;
+		sketched = true;
+		for (size_t i = 0; i < counts.size(); i++)
+			if (counts[i])
+				sketch_add (PixIntens(base + i), counts[i]);
+		counts.clear();
+		counts.shrink_to_fit();
+	}
+
+	static size_t bin_index (double realIdx, int n_bins)
+	{
+		return std::isnan(realIdx) ? 0 : std::min ((size_t) realIdx, (size_t) n_bins);
+	}
+
+	/// @brief Value of the 'k'-th (0-based) item of the sorted stream
+	double nth_value (const std::vector<double>& V, const std::vector<size_t>& C, size_t k) const
+	{
+		size_t runSum = 0;
+		for (size_t i = 0; i < V.size(); i++)
+		{
+			runSum += C[i];
+			if (k < runSum)
+				return V[i];
+		}
+		return V.empty() ? 0 : V.back();
+	}
+};
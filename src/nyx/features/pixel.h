@@ -133,7 +133,8 @@ struct Pixel2 : public Point2i
 	}
 
 	// Returns an index in argument 'cloud'
-	static int find_center (const std::vector<Pixel2> & cloud, const std::vector<Pixel2> & contour)
+	template <class Cloud>
+	static int find_center (const Cloud & cloud, const std::vector<Pixel2> & contour)
 	{
 		int idxMinDif = 0;
 		auto minmaxDist = cloud[idxMinDif].min_max_sqdist(contour);
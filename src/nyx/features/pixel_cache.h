@@ -0,0 +1,293 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "aabb.h"
+#include "pixel.h"
+
+/// @brief Structure-of-arrays cache of ROI pixels. Coordinates are kept relative to an anchor point - normally the top left corner
+/// of ROI's AABB - as 16-bit values if the anchor box is within 65536 x 65536 pixels or as 32-bit values otherwise. Until anchored,
+/// the cache keeps absolute 32-bit coordinates.
+///
+/// The three arrays share one block of storage which is either owned by the cache or attached to it from outside, normally a span of
+/// the batch arena sized for the ROI's known pixel count.
+///
+/// Hot feature loops should use visit() to get ahold of the raw arrays of actual width; the iterator and operator[] decode pixels into Pixel2
+/// instances for the rest of the code.
+class PixelCache
+{
+public:
+	class const_iterator
+	{
+	public:
+		const_iterator (const PixelCache* c, size_t i) : cache(c), idx(i) {}
+		Pixel2 operator* () const { return (*cache)[idx]; }
+		const_iterator& operator++ () { idx++; return *this; }
+		bool operator== (const const_iterator& other) const { return idx == other.idx; }
+		bool operator!= (const const_iterator& other) const { return idx != other.idx; }
+	private:
+		const PixelCache* cache;
+		size_t idx;
+	};
+
+	PixelCache() = default;
+
+	PixelCache (const PixelCache& other) :
+		x0(other.x0), y0(other.y0), narrow(other.narrow), anchored(other.anchored)
+	{
+		append (other);
+	}
+
+	PixelCache (PixelCache&& other) noexcept { swap (other); }
+
+	PixelCache& operator= (const PixelCache& other)
+	{
+		if (this != &other)
+		{
+			PixelCache copy (other);
+			swap (copy);
+		}
+		return *this;
+	}
+
+	PixelCache& operator= (PixelCache&& other) noexcept
+	{
+		PixelCache gone (std::move(*this));
+		swap (other);
+		return *this;
+	}
+
+	void swap (PixelCache& other) noexcept
+	{
+		std::swap (x0, other.x0);
+		std::swap (y0, other.y0);
+		std::swap (narrow, other.narrow);
+		std::swap (anchored, other.anchored);
+		std::swap (owned, other.owned);
+		std::swap (X, other.X);
+		std::swap (Y, other.Y);
+		std::swap (I, other.I);
+		std::swap (n, other.n);
+		std::swap (cap, other.cap);
+	}
+
+	/// @brief Anchors coordinates to the top left corner of the box re-encoding the pixels cached so far
+	void anchor (const AABB& aabb)
+	{
+		StatsInt ax = aabb.get_xmin(),
+			ay = aabb.get_ymin();
+		bool nrw = is_narrow (aabb);
+		if (anchored && ax == x0 && ay == y0 && nrw == narrow)
+			return;
+
+		if (size() == 0)
+		{
+			// Storage laid out for the other coordinate width is of no use
+			if (nrw != narrow)
+				detach();
+			x0 = ax;
+			y0 = ay;
+			narrow = nrw;
+		}
+		else
+		{
+			PixelCache rebased;
+			rebased.x0 = ax;
+			rebased.y0 = ay;
+			rebased.narrow = nrw;
+			rebased.anchored = true;
+			rebased.append (*this);
+			swap (rebased);
+		}
+		anchored = true;
+	}
+
+	/// @brief Makes an empty cache keep its pixels in externally owned 'storage' of storage_size(capacity) bytes, e.g. a span of a BatchArena.
+	/// The storage should outlive the cache or be detached from it. If more than 'capacity' pixels are pushed, the cache moves to storage of its own
+	void attach (void* storage, size_t capacity)
+	{
+		detach();
+		layout (static_cast<uint8_t*>(storage), capacity);
+	}
+
+	/// @brief Forgets the cached pixels and the storage
+	void detach()
+	{
+		owned.reset();
+		X = Y = nullptr;
+		I = nullptr;
+		n = cap = 0;
+	}
+
+	void push_back (StatsInt x, StatsInt y, PixIntens inten)
+	{
+		if (n == cap)
+			grow (cap ? 2 * cap : MIN_CAPACITY);
+		if (narrow)
+		{
+			static_cast<uint16_t*>(X)[n] = uint16_t(x - x0);
+			static_cast<uint16_t*>(Y)[n] = uint16_t(y - y0);
+		}
+		else
+		{
+			static_cast<uint32_t*>(X)[n] = uint32_t(x - x0);
+			static_cast<uint32_t*>(Y)[n] = uint32_t(y - y0);
+		}
+		I[n++] = inten;
+	}
+
+	void push_back (const Pixel2& p) { push_back (p.x, p.y, p.inten); }
+
+	void append (const PixelCache& other)
+	{
+		reserve (size() + other.size());
+
+		if (other.narrow == narrow && other.x0 == x0 && other.y0 == y0)
+		{
+			size_t cw = coord_width();
+			if (other.n)
+			{
+				std::memcpy (static_cast<uint8_t*>(X) + n * cw, other.X, other.n * cw);
+				std::memcpy (static_cast<uint8_t*>(Y) + n * cw, other.Y, other.n * cw);
+				std::memcpy (I + n, other.I, other.n * sizeof(PixIntens));
+			}
+			n += other.n;
+			return;
+		}
+
+		for (size_t i = 0; i < other.size(); i++)
+			push_back (other[i]);
+	}
+
+	void reserve (size_t capacity)
+	{
+		if (capacity > cap)
+			grow (capacity);
+	}
+
+	void clear() { n = 0; }
+
+	void shrink_to_fit()
+	{
+		if (n == 0)
+			detach();
+		else
+			if (owned && n < cap)
+				grow (n);
+	}
+
+	size_t size() const { return n; }
+	bool empty() const { return n == 0; }
+
+	Pixel2 operator[] (size_t i) const
+	{
+		if (narrow)
+			return Pixel2 (x0 + StatsInt(static_cast<const uint16_t*>(X)[i]), y0 + StatsInt(static_cast<const uint16_t*>(Y)[i]), I[i]);
+		else
+			return Pixel2 (x0 + StatsInt(static_cast<const uint32_t*>(X)[i]), y0 + StatsInt(static_cast<const uint32_t*>(Y)[i]), I[i]);
+	}
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+
+	/// @brief Coordinates of the anchor point
+	StatsInt get_x0() const { return x0; }
+	StatsInt get_y0() const { return y0; }
+
+	/// @brief Returns true if relative coordinates are stored as 16-bit values
+	bool is_narrow() const { return narrow; }
+
+	const PixIntens* intensities() const { return I; }
+
+	/// @brief Calls f(xs, ys, intensities, n) passing arrays of relative coordinates of their actual type (uint16_t or uint32_t).
+	/// Absolute coordinates are xs[i] + get_x0() and ys[i] + get_y0()
+	template <class F>
+	void visit (F&& f) const
+	{
+		if (narrow)
+			f (static_cast<const uint16_t*>(X), static_cast<const uint16_t*>(Y), static_cast<const PixIntens*>(I), size());
+		else
+			f (static_cast<const uint32_t*>(X), static_cast<const uint32_t*>(Y), static_cast<const PixIntens*>(I), size());
+	}
+
+	/// @brief Decodes the cache into a vector of pixels
+	std::vector<Pixel2> to_pixels() const
+	{
+		std::vector<Pixel2> P;
+		P.reserve (size());
+		for (size_t i = 0; i < size(); i++)
+			P.push_back ((*this)[i]);
+		return P;
+	}
+
+	/// @brief Expected size of a cached pixel of a ROI of specified AABB
+	static size_t pixel_footprint (const AABB& aabb)
+	{
+		return 2 * (is_narrow(aabb) ? sizeof(uint16_t) : sizeof(uint32_t)) + sizeof(PixIntens);
+	}
+
+	/// @brief Bytes of storage needed to keep 'capacity' pixels of a ROI of specified AABB, see attach()
+	static size_t storage_size (size_t capacity, const AABB& aabb)
+	{
+		return storage_size (capacity, is_narrow(aabb));
+	}
+
+private:
+	static constexpr StatsInt NARROW_SPAN = 1 << 16;
+	static constexpr size_t MIN_CAPACITY = 16,
+		ALIGNMENT = 64;
+
+	static size_t aligned (size_t n) { return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+	static bool is_narrow (const AABB& aabb) { return aabb.get_width() <= NARROW_SPAN && aabb.get_height() <= NARROW_SPAN; }
+
+	// Layout of the storage: X coordinates | Y coordinates | intensities, each array starting at an aligned offset
+	static size_t storage_size (size_t capacity, bool nrw)
+	{
+		size_t cw = nrw ? sizeof(uint16_t) : sizeof(uint32_t);
+		return 2 * aligned(capacity * cw) + aligned(capacity * sizeof(PixIntens));
+	}
+
+	size_t coord_width() const { return narrow ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+	void layout (uint8_t* storage, size_t capacity)
+	{
+		size_t coordBytes = aligned (capacity * coord_width());
+		X = storage;
+		Y = storage + coordBytes;
+		I = reinterpret_cast<PixIntens*> (storage + 2 * coordBytes);
+		cap = capacity;
+	}
+
+	// Moves the pixels to storage of our own
+	void grow (size_t capacity)
+	{
+		std::unique_ptr<uint8_t[]> buf (new uint8_t [storage_size(capacity, narrow)]);
+		void* oldX = X, 
+			* oldY = Y;
+		PixIntens* oldI = I;
+		layout (buf.get(), capacity);
+		if (n)
+		{
+			size_t cw = coord_width();
+			std::memcpy (X, oldX, n * cw);
+			std::memcpy (Y, oldY, n * cw);
+			std::memcpy (I, oldI, n * sizeof(PixIntens));
+		}
+		owned = std::move (buf);
+	}
+
+	StatsInt x0 = 0,
+		y0 = 0;
+	bool narrow = false,
+		anchored = false;
+	std::unique_ptr<uint8_t[]> owned;	// empty if the storage is external
+	void* X = nullptr, 
+		* Y = nullptr;
+	PixIntens* I = nullptr;
+	size_t n = 0,
+		cap = 0;
+};
@@ -6,6 +6,7 @@
 #include "radial_distribution.h"
 #include "image_matrix.h"
 #include "../globals.h"
+#include "../helpers/timing.h"
 
 RadialDistributionFeature::RadialDistributionFeature() : FeatureMethod("RadialDistributionFeature")
 {
@@ -46,7 +47,7 @@ void RadialDistributionFeature::calculate(LR& r)
 
 	// Distribute pixels into radial bins
 	double binWidth = 1.0 / double(num_bins - 1);
-	for (auto& pxA : raw_pixels)
+	for (auto pxA : raw_pixels)
 	{
 		// If 'px' is a contour point, skip it
 		if (pxA.belongs_to(contour_pixels))
@@ -95,9 +96,9 @@ void RadialDistributionFeature::calculate(LR& r)
 			// Show A
 			std::stringstream ss;
 			if (dstOC < dstAC)
-				ss << Nyxus::theIntFname << " Weird: OC=" << dstOC << " < AC=" << dstAC << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
+				ss << Nyxus::theIntFname() << " Weird: OC=" << dstOC << " < AC=" << dstAC << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
 			if (dstOC < dstOA)
-				ss << Nyxus::theIntFname << " Weird: OC=" << dstOC << " < OA=" << dstOA << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
+				ss << Nyxus::theIntFname() << " Weird: OC=" << dstOC << " < OA=" << dstOA << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
 			ImageMatrix imCont(contour_pixels);
 			imCont.print(ss.str(), "", { {pxO.x, pxO.y, "(O)"},  {pxA.x, pxA.y, "(A)"}, {pxContour.x, pxContour.y, "(C)"} });
 		}
@@ -128,10 +129,11 @@ size_t RadialDistributionFeature::find_osized_cloud_center (OutOfRamPixelCloud&
 	auto minmaxDist = cloud.get_at(idxMindiff).min_max_sqdist (contour);	//--triv--> auto minmaxDist = cloud[idxMindiff].min_max_sqdist(contour);
 	double minDif = minmaxDist.second - minmaxDist.first;
 
-	for (size_t i = 1; i < cloud.get_size(); i++)
+	size_t i = 0;
+	for (const Pixel2& px : cloud)
 	{
 		// Caclculate the difference of distances
-		minmaxDist = cloud.get_at(i).min_max_sqdist (contour);	//--triv--> auto minmaxDist = cloud[i].min_max_sqdist(contour);
+		minmaxDist = px.min_max_sqdist (contour);	//--triv--> auto minmaxDist = cloud[i].min_max_sqdist(contour);
 
 		// Update the minimum difference
 		double dif = minmaxDist.second - minmaxDist.first;
@@ -140,6 +142,7 @@ size_t RadialDistributionFeature::find_osized_cloud_center (OutOfRamPixelCloud&
 			minDif = dif;
 			idxMindiff = i;
 		}
+		i++;
 	}
 
 	return idxMindiff;
@@ -176,9 +179,8 @@ void RadialDistributionFeature::osized_calculate (LR& r, ImageLoader& imlo)
 
 	// Distribute pixels into radial bins
 	double binWidth = 1.0 / double(num_bins - 1);
-	for (size_t i = 0; i < cloud.get_size(); i++)	//--triv--> for (auto& pxA : raw_pixels)
+	for (const Pixel2& pxA : cloud)	//--triv--> for (auto& pxA : raw_pixels)
 	{
-		auto pxA = cloud.get_at(i);
 
 		// If 'px' is a contour point, skip it
 		if (pxA.belongs_to(contour))
@@ -226,9 +228,9 @@ void RadialDistributionFeature::osized_calculate (LR& r, ImageLoader& imlo)
 			// Show A
 			std::stringstream ss;
 			if (dstOC < dstAC)
-				ss << Nyxus::theIntFname << " Weird: OC=" << dstOC << " < AC=" << dstAC << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
+				ss << Nyxus::theIntFname() << " Weird: OC=" << dstOC << " < AC=" << dstAC << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
 			if (dstOC < dstOA)
-				ss << Nyxus::theIntFname << " Weird: OC=" << dstOC << " < OA=" << dstOA << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
+				ss << Nyxus::theIntFname() << " Weird: OC=" << dstOC << " < OA=" << dstOA << ". Points O(" << pxO.x << "," << pxO.y << "), A(" << pxA.x << "," << pxA.y << "), and C(" << pxContour.x << "," << pxContour.y << ")";
 			ImageMatrix imCont(contour);
 			imCont.print(ss.str(), "", { {pxO.x, pxO.y, "(O)"},  {pxA.x, pxA.y, "(A)"}, {pxContour.x, pxContour.y, "(C)"} });
 		}
@@ -249,14 +251,20 @@ void RadialDistributionFeature::osized_calculate (LR& r, ImageLoader& imlo)
 	get_RadialCV();
 }
 
-void RadialDistributionFeature::save_value(std::vector<std::vector<double>>& fvals)
+void RadialDistributionFeature::save_value(FeatureValues& fvals)
 {
 	fvals[FRAC_AT_D] = values_FracAtD; 
 	fvals[MEAN_FRAC] = values_MeanFrac;  
 	fvals[RADIAL_CV] = values_RadialCV;  
 }
 
-void RadialDistributionFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void RadialDistributionFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("RDistribution/Rdist/Rd/#00FFFF", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void RadialDistributionFeature::parallel_process_1_batch(size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
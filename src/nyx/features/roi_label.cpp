@@ -3,7 +3,7 @@
 void LR::reduce_pixel_intensity_features()
 {
 	LR& lr = *this;
-	for (auto& pxl : lr.raw_pixels)
+	for (auto pxl : lr.raw_pixels)
 	{
 		auto intensity = pxl.inten;
 		auto x = pxl.x, y = pxl.y;
@@ -1,4 +1,5 @@
 #include "roi_radius.h"
+#include "../helpers/timing.h"
 
 RoiRadiusFeature::RoiRadiusFeature() : FeatureMethod("RoiRadiusFeature")
 {
@@ -8,17 +9,23 @@ RoiRadiusFeature::RoiRadiusFeature() : FeatureMethod("RoiRadiusFeature")
 
 void RoiRadiusFeature::calculate (LR& r)
 {
-	const std::vector<Pixel2>& cloud = r.raw_pixels;
 	const std::vector<Pixel2>& contour = r.contour;
 
 	Moments2 mom2;
 	std::vector<HistoItem> dists;
-	for (auto& pxA : cloud)
+	dists.reserve (r.raw_pixels.size());
+	StatsInt x0 = r.raw_pixels.get_x0(),
+		y0 = r.raw_pixels.get_y0();
+	r.raw_pixels.visit ([&] (const auto* X, const auto* Y, const PixIntens* I, size_t np)
 	{
-		auto minSD = pxA.min_sqdist(contour);
-		mom2.add(minSD);
-		dists.push_back(minSD);
-	}
+		for (size_t i = 0; i < np; i++)
+		{
+			Pixel2 pxA (x0 + X[i], y0 + Y[i], I[i]);
+			auto minSD = pxA.min_sqdist(contour);
+			mom2.add(minSD);
+			dists.push_back(minSD);
+		}
+	});
 
 	// Mean
 	mean_r = mom2.mean();
@@ -41,9 +48,8 @@ void RoiRadiusFeature::osized_calculate (LR& r, ImageLoader& imloader)
 
 	Moments2 mom2;
 	std::vector<HistoItem> dists;
-	for (size_t i=0; i<cloud.get_size(); i++) 
+	for (const Pixel2& pxA : cloud) 
 	{
-		Pixel2 pxA = cloud.get_at(i);
 		auto [minSD, maxSD] = pxA.min_max_sqdist(contour);
 		mom2.add(minSD);
 		dists.push_back(minSD);
@@ -61,14 +67,20 @@ void RoiRadiusFeature::osized_calculate (LR& r, ImageLoader& imloader)
 	median_r = h.get_median();
 }
 
-void RoiRadiusFeature::save_value (std::vector<std::vector<double>>& fvals)
+void RoiRadiusFeature::save_value (FeatureValues& fvals)
 {
 	fvals[ROI_RADIUS_MEAN][0] = mean_r;
 	fvals[ROI_RADIUS_MAX][0] = max_r;
 	fvals[ROI_RADIUS_MEDIAN][0] = median_r; 
 }
 
-void RoiRadiusFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void RoiRadiusFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("Morphology/RoiR/R/#4aaaea", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void RoiRadiusFeature::parallel_process_1_batch (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = start; i < end; i++)
 	{
@@ -1,4 +1,5 @@
 #define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
 #include "rotation.h"
 
@@ -74,21 +75,39 @@ void Rotation::rotate_cloud(
 	OutOfRamPixelCloud& rotated_cloud,
 	AABB& rotated_aabb)
 {
-	for (size_t i=0; i<cloud.get_size(); i++)
+	rotated_cloud.reset();
+	rotated_aabb = AABB();
+
+	// Rotate the cloud a chunk at a time
+	std::vector<Pixel2> rotated;
+	for (size_t i = 0; i < cloud.get_size(); )
 	{
-		const Pixel2 p = cloud.get_at(i);
+		size_t n;
+		const Pixel2* P = cloud.get_span (i, n);
+		n = std::min (n, OutOfRamPixelCloud::CHUNK_LEN);
 
-		// Background:
-		//		x_rot = ((x - cx) * cos(theta)) - ((y - cy) * sin(theta)) + cx;
-		//		y_rot = ((x - cx) * sin(theta)) + ((y - cy) * cos(theta)) + cy;
+		rotated.clear();
+		for (size_t k = 0; k < n; k++)
+		{
+			const Pixel2& p = P[k];
 
-		// Screen coordinate system:
-		double x_rot = ((p.x - cx) * cos(theta_radians)) - ((cy - p.y) * sin(theta_radians)) + cx;
-		double y_rot = cy - ((cy - p.y) * cos(theta_radians)) + ((p.x - cx) * sin(theta_radians));
+			// Background:
+			//		x_rot = ((x - cx) * cos(theta)) - ((y - cy) * sin(theta)) + cx;
+			//		y_rot = ((x - cx) * sin(theta)) + ((y - cy) * cos(theta)) + cy;
+
+			// Screen coordinate system:
+			double x_rot = ((p.x - cx) * cos(theta_radians)) - ((cy - p.y) * sin(theta_radians)) + cx;
+			double y_rot = cy - ((cy - p.y) * cos(theta_radians)) + ((p.x - cx) * sin(theta_radians));
+
+			Pixel2 p_rot((int)x_rot, (int)y_rot, p.inten);
+			rotated_aabb.update_x (p_rot.x);
+			rotated_aabb.update_y (p_rot.y);
 
-		Pixel2 p_rot((int)x_rot, (int)y_rot, p.inten);
+			rotated.push_back (p_rot);
+		}
+		rotated_cloud.add_pixels (rotated.data(), rotated.size());
 
-		rotated_cloud.add_pixel (p_rot);
+		i += n;
 	}
 }
 
@@ -31,8 +31,7 @@
 #include <unordered_map>
 #include "../roi_cache.h"
 #include "zernike.h"
-
-int ZernikeFeature::num_feature_values_calculated = 0;
+#include "../helpers/timing.h"
 
 ZernikeFeature::ZernikeFeature() : FeatureMethod("ZernikeFeature")
 {
@@ -41,14 +40,9 @@ ZernikeFeature::ZernikeFeature() : FeatureMethod("ZernikeFeature")
 
 void ZernikeFeature::osized_add_online_pixel (size_t x, size_t y, uint32_t intensity) {} // Not supporting
 
-void ZernikeFeature::save_value (std::vector<std::vector<double>>& fvals)
+void ZernikeFeature::save_value (FeatureValues& fvals)
 {
-	fvals[ZERNIKE2D].clear();
-	for (int i=0; i<ZernikeFeature::num_feature_values_calculated; i++)
-	{
-		auto f = coeffs[i];
-		fvals[ZERNIKE2D].push_back(f);
-	}
+	fvals[ZERNIKE2D].assign (coeffs.begin(), coeffs.begin() + ZernikeFeature::num_feature_values_calculated());
 }
 
 /*  
@@ -339,7 +333,7 @@ void ZernikeFeature::mb_zernike2D (const ImageMatrix& Im, double order, double r
 
 void ZernikeFeature::zernike2D(
 	// in
-	std::vector <Pixel2>& roi_cloud,
+	const PixelCache& roi_cloud,
 	AABB& aabb,
 	int order)
 {
@@ -351,7 +345,6 @@ void ZernikeFeature::zernike2D(
 	// Calculate features
 	long output_size;   // output size is normally 72 (NUM_FEATURE_VALS)
 	mb_zernike2D (I, order, 0/*rad*/, coeffs.data(), &output_size); 
-	ZernikeFeature::num_feature_values_calculated = output_size;
 }
 
 void ZernikeFeature::calculate (LR& r)
@@ -369,7 +362,13 @@ void ZernikeFeature::calculate (LR& r)
 	}
 }
 
-void ZernikeFeature::parallel_process_1_batch (size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+void ZernikeFeature::parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
+{
+	STOPWATCH("RDistribution/Zernike/Rz/#00FFFF", "\t=");
+	parallel_process_1_batch (start, end, ptrLabels, ptrLabelData);
+}
+
+void ZernikeFeature::parallel_process_1_batch (size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 {
 	for (auto i = firstitem; i < lastitem; i++)
 	{
@@ -16,11 +16,20 @@ public:
 	void calculate(LR& r);
 	void osized_add_online_pixel(size_t x, size_t y, uint32_t intensity);
 	void osized_calculate(LR& r, ImageLoader& imloader);
-	void save_value(std::vector<std::vector<double>>& feature_vals);
-	static void parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	void save_value(FeatureValues& feature_vals);
+	static void parallel_process_1_batch(size_t firstitem, size_t lastitem, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallel_process (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 
 	static const short ZERNIKE2D_ORDER = 9, NUM_FEATURE_VALS = 72;
-	static int num_feature_values_calculated;
+
+	/// @brief Number of moments calculated per ROI: of orders n = 0 ... ZERNIKE2D_ORDER and repetitions m = 0 ... n where n - m is even
+	static constexpr int num_feature_values_calculated()
+	{
+		int n_moments = 0;
+		for (int n = 0; n <= ZERNIKE2D_ORDER; n++)
+			n_moments += n / 2 + 1;
+		return n_moments;
+	}
 
 	// Compatibility with manual reduce
 	static bool required(const FeatureSet& fs) { return fs.isEnabled(ZERNIKE2D); }
@@ -42,7 +51,7 @@ private:
 	/// @param aabb 
 	/// @param order 
 	void zernike2D(
-		std::vector <Pixel2>& nonzero_intensity_pixels,
+		const PixelCache& nonzero_intensity_pixels,
 		AABB& aabb,
 		int order);
 
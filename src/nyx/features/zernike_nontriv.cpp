@@ -34,7 +34,7 @@
 
 void ZernikeFeature::osized_calculate(LR& r, ImageLoader& imloader)
 {
-	OOR_ReadMatrix I (imloader, r.aabb);
+	OOR_ReadMatrix I (imloader, r.aabb, r.label);
 
 	zernike2D_nontriv (I, ZernikeFeature::ZERNIKE2D_ORDER);
 
@@ -109,18 +109,17 @@ void ZernikeFeature::mb_zernike2D_nontriv (OOR_ReadMatrix& I, double order, doub
 
 	// compute x/0, y/0 and 0/0 moments to center the unit circle on the centroid
 	double moment10 = 0.0, moment00 = 0.0, moment01 = 0.0;
-	double intensity;
-	for (i = 0; i < cols; i++)
-		for (j = 0; j < rows; j++)
+	I.for_each_segment ([&] (size_t row, size_t col, const PixIntens* inten, size_t n)
 		{
-			if (std::isnan(I.get_at(j, i)))
-				continue; //MM
-			intensity = I.get_at(j, i);
-			sum += intensity;
-			moment10 += (i + 1) * intensity;
-			moment00 += intensity;
-			moment01 += (j + 1) * intensity;
-		}
+			for (size_t k = 0; k < n; k++)
+			{
+				double intensity = inten[k];
+				sum += intensity;
+				moment10 += (col + k + 1) * intensity;
+				moment00 += intensity;
+				moment01 += (row + 1) * intensity;
+			}
+		});
 	double m10_m00 = moment10 / moment00;
 	double m01_m00 = moment01 / moment00;
 
@@ -151,20 +150,21 @@ void ZernikeFeature::mb_zernike2D_nontriv (OOR_ReadMatrix& I, double order, doub
 		}
 	}
 
+	// Row by row for the pixels to come from resident tiles
 	area = M_PI * rad * rad;
-	for (i = 0; i < cols; i++)
+	for (j = 0; j < rows; j++)
 	{
 		// In the paper, the center of the unit circle was the center of the image
-		//	x = (double)(2*i+1-N)/(double)D;
-		x = (i + 1 - m10_m00) / rad;
-		for (j = 0; j < rows; j++)
+		//	y = (double)(2*j+1-N)/(double)D;
+		y = (j + 1 - m01_m00) / rad;
+		for (i = 0; i < cols; i++)
 		{
 			if (std::isnan(I.get_at(j, i)))
 				continue; //MM
 
 		// In the paper, the center of the unit circle was the center of the image
-		//	y = (double)(2*j+1-N)/(double)D;
-			y = (j + 1 - m01_m00) / rad;
+		//	x = (double)(2*i+1-N)/(double)D;
+			x = (i + 1 - m10_m00) / rad;
 			r2 = x * x + y * y;
 			r = sqrt(r2);
 			if (r < DBL_EPSILON || r > 1.0)
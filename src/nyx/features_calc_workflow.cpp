@@ -46,17 +46,15 @@ namespace Nyxus
 	// Preallocates the intensely accessed main containers
 	void init_feature_buffers()
 	{
-		uniqueLabels.reserve(N2R);
-		roiData.reserve(N2R);
-		labelMutexes.reserve(N2R);
+		roiData().reserve(N2R);
+		labelMutexes().reserve(N2R);
 	}
 
 	// Resets the main containers
 	void clear_feature_buffers()
 	{
-		uniqueLabels.clear();
-		roiData.clear();
-		labelMutexes.clear();
+		roiData().clear();
+		labelMutexes().clear();
 	}
 
 	// Label Record (structure 'LR') is where the state of label's pixels scanning and feature calculations is maintained. This function initializes an LR instance for the 1st pixel.
@@ -65,12 +63,8 @@ namespace Nyxus
 		r.segFname = segFile;
 		r.intFname = intFile;
 
-		// Allocate the value matrix
-		for (int i = 0; i < AvailableFeatures::_COUNT_; i++)
-		{
-			std::vector<StatsReal> row{ 0.0 };	// One value initialy. More values can be added for Haralick and Zernike type methods
-			r.fvals.push_back(row);
-		}
+		// Allocate the feature value row
+		r.fvals.initialize();
 
 		r.label = label;
 
@@ -81,10 +75,10 @@ namespace Nyxus
 		r.raw_pixels.push_back(Pixel2(x, y, intensity));
 
 		r.fvals[AREA_PIXELS_COUNT][0] = 1;
-		if (theEnvironment.xyRes == 0.0)
+		if (theEnvironment().xyRes == 0.0)
 			r.fvals[AREA_UM2][0] = 0;
 		else
-			r.fvals[AREA_UM2][0] = std::pow(theEnvironment.pixelSizeUm, 2);
+			r.fvals[AREA_UM2][0] = std::pow(theEnvironment().pixelSizeUm, 2);
 
 		// Min
 		r.fvals[MIN][0] = r.aux_min = intensity;
@@ -163,4 +157,16 @@ namespace Nyxus
 		lr.update_aabb (x,y);
 	}
 
-}
\ No newline at end of file
+	// Merges phase 1 metrics of a ROI gathered by different pixel scanner threads
+	void merge_label_record_2 (LR& lr, const LR& other)
+	{
+		lr.host_tiles.insert (other.host_tiles.begin(), other.host_tiles.end());
+		lr.aux_area += other.aux_area;
+		lr.aux_min = std::min(lr.aux_min, other.aux_min);
+		lr.aux_max = std::max(lr.aux_max, other.aux_max);
+		lr.update_aabb (other.aabb.get_xmin(), other.aabb.get_ymin());
+		lr.update_aabb (other.aabb.get_xmax(), other.aabb.get_ymax());
+		lr.raw_pixels.append (other.raw_pixels);
+	}
+
+}
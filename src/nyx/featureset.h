@@ -420,6 +420,6 @@ private:
 
 namespace Nyxus
 {
-	extern FeatureSet theFeatureSet;
+	FeatureSet& theFeatureSet();
 	extern std::map <std::string, AvailableFeatures> UserFacingFeatureNames;
 }
@@ -6,22 +6,8 @@ std::map <std::string, double> Stopwatch::totals;
 
 namespace Nyxus
 {
-	// Command line info and default values
-	Environment theEnvironment;
+	// Command line info, images, ROI data, and features are the state of a NyxusContext (nyxus_context.cpp)
 
-	// Everything related to images
-	ImageLoader theImLoader;
-	std::string theSegFname, theIntFname;
-
-	// Everything related to ROI data
-	std::unordered_set <int> uniqueLabels;
-	std::unordered_map <int, LR> roiData;
-	std::unordered_map <int, std::shared_ptr<std::mutex>> labelMutexes;
-
-	// Features
-	FeatureSet theFeatureSet;
-	FeatureManager theFeatureMgr;
-
-	// Results cache serving Nyxus' CLI & Python API, NyxusHie's CLI & Python API
+	// Results cache serving NyxusHie's CLI & Python API
 	ResultsCache theResultsCache;
 }
@@ -7,6 +7,7 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include "batch_arena.h"
 #include "featureset.h"
 #include "feature_method.h"
 #include "feature_mgr.h"
@@ -16,20 +17,22 @@
 
 namespace Nyxus
 {
-	extern FeatureManager theFeatureMgr;
-	extern ImageLoader theImLoader;
+	// Accessors of the current context's (see nyxus_context.h) state
+	FeatureManager& theFeatureMgr();
+	ImageLoader& theImLoader();
 
 	bool scanFilePairParallel(const std::string& intens_fpath, const std::string& label_fpath, int num_fastloader_threads, int num_sensemaker_threads, int filepair_index, int tot_num_filepairs);
 	std::string getPureFname(const std::string& fpath);
 	int processDataset(const std::vector<std::string>& intensFiles, const std::vector<std::string>& labelFiles, int numFastloaderThreads, int numSensemakerThreads, int numReduceThreads, int min_online_roi_size, bool save2csv, const std::string& csvOutputDir);
-	bool gatherRoisMetrics(const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads);
-	bool processTrivialRois (const std::vector<int>& trivRoiLabels, const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, size_t memory_limit);
+	bool gatherRoisMetrics(const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, bool cache_pixels, bool& pixels_cached);
+	bool gatherRoisMetrics_ahead (const std::string& intens_fpath, const std::string& label_fpath, size_t cache_budget, RoiStore& roi_store, bool& pixels_cached);
+	bool processTrivialRois (const std::vector<int>& trivRoiLabels, const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, size_t memory_limit, bool pixels_cached = false);
 	bool processNontrivialRois (const std::vector<int>& nontrivRoiLabels, const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads);
 	void dump_roi_metrics(const std::string & label_fpath);
 
 	// 2 scenarios of saving a result of feature calculation of a label-intensity file pair: saving to a CSV-file and saving to a matrix to be later consumed by a Python endpoint
-	bool save_features_2_csv (std::string intFpath, std::string segFpath, std::string outputDir);
-	bool save_features_2_buffer (ResultsCache& results_cache);		
+	bool save_features_2_csv (std::string intFpath, std::string segFpath, std::string outputDir, RoiStore& roi_store);
+	bool save_features_2_buffer (ResultsCache& results_cache, RoiStore& roi_store);
 
 	void init_feature_buffers();
 	void clear_feature_buffers();	
@@ -44,38 +47,48 @@ namespace Nyxus
 	void reduce_by_feature (int nThr, int min_online_roi_size);
 	void reduce_by_roi (int nThr, int min_online_roi_size);
 	void reduce_trivial_rois (std::vector<int>& PendingRoisLabels);
-	void reduce_trivial_rois_manual (std::vector<int>& PendingRoisLabels);
 	void reduce_neighbors();
 
 	void init_label_record(LR& lr, const std::string& segFile, const std::string& intFile, int x, int y, int label, PixIntens intensity);
 	void init_label_record_2(LR& lr, const std::string& segFile, const std::string& intFile, int x, int y, int label, PixIntens intensity, unsigned int tile_index);
 	void update_label_record(LR& lr, int x, int y, int label, PixIntens intensity);
 	void update_label_record_2(LR& lr, int x, int y, int label, PixIntens intensity, unsigned int tile_index);
+	void merge_label_record_2(LR& lr, const LR& other);
 	void reduce_neighbors(int labels_collision_radius);
 
+	void reserveTrivialRoisArena (const std::vector<int>& Pending, bool pixels_cached);
 	void allocateTrivialRoisBuffers(const std::vector<int>& Pending);
 	void freeTrivialRoisBuffers(const std::vector<int>& Pending);
+	BatchArena& trivialRoisArena();	// Memory of trivial ROIs' pixel caches, reused by consecutive batches
+	PixIntens*& ImageMatrixBuffer();	// Image matrices of a batch of trivial ROIs sent to GPU
+	size_t& imageMatrixBufferLen();
 
 	// Label data
-	extern std::string theSegFname, theIntFname;	// Cached file names while iterating a dataset
-	extern std::unordered_set<int> uniqueLabels;
-	extern std::unordered_map <int, LR> roiData;
-	extern std::unordered_map <int, std::shared_ptr<std::mutex>> labelMutexes;
-
-	/// @brief Feeds a pixel to image measurement object to gauge the image RAM footprint without caching the pixel. Updates 'uniqueLabels' and 'roiData'.
+	std::string& theSegFname();	// Cached file names while iterating a dataset
+	std::string& theIntFname();
+	RoiStore& roiData();
+	std::unordered_map <int, std::shared_ptr<std::mutex>>& labelMutexes();
+
+	/// @brief Feeds a pixel to image measurement object to gauge the image RAM footprint without caching the pixel. Updates 'roi_table', 
+	/// e.g. 'roiData' or a thread's private table. The caller resolves the table and the file names once per scan, not per pixel
+	/// @param roi_table -- label-to-metrics table
+	/// @param seg_fname -- mask image path
+	/// @param int_fname -- intensity image path
 	/// @param x -- x-coordinate of the pixel in the image
 	/// @param y -- y-coordinate of the pixel in the image
-	/// @param label -- label of pixel's segment 
 	/// @param intensity -- pixel's intensity
+	/// @param label -- label of pixel's segment 
 	/// @param tile_index -- index of pixel's tile in the image
-	void feed_pixel_2_metrics(int x, int y, PixIntens intensity, int label, unsigned int tile_index);
+	/// @return -- the ROI record the pixel has been fed to
+	LR& feed_pixel_2_metrics (RoiStore& roi_table, const std::string& seg_fname, const std::string& int_fname, int x, int y, PixIntens intensity, int label, unsigned int tile_index);
 
 	/// @brief Copies a pixel to the ROI's cache. 
+	/// @param roi_table -- label-to-metrics table holding the ROI, e.g. 'roiData'
 	/// @param x -- x-coordinate of the pixel in the image
 	/// @param y -- y-coordinate of the pixel in the image
 	/// @param label -- label of pixel's segment 
 	/// @param intensity -- pixel's intensity
-	void feed_pixel_2_cache(int x, int y, PixIntens intensity, int label);
+	void feed_pixel_2_cache (RoiStore& roi_table, int x, int y, PixIntens intensity, int label);
 
 	// System resources
 	unsigned long long getAvailPhysMemory();
@@ -13,7 +13,6 @@ static const int blockSize = 512;   // used by non-reducing kernels
 namespace Nyxus
 {
     // Image matrices (allocated and initialized with data each time a pending ROI batch is formed)
-    extern PixIntens* ImageMatrixBuffer;
     PixIntens* devImageMatrixBuffer = nullptr;
 
     // ROI contour data
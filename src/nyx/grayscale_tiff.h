@@ -10,13 +10,102 @@
 #else
 #include <tiffio.h>
 #endif
+#include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <memory>
+#include <new>
 #include <sstream>
 
 constexpr size_t STRIP_TILE_HEIGHT = 1024;
 constexpr size_t STRIP_TILE_WIDTH = 1024;
 constexpr size_t STRIP_TILE_DEPTH = 1;
 
+/// @brief Converter of a run of file samples to the logical (feature extraction facing) buffer's type
+template<class DataType>
+using SampleConverter = void (*)(const void* src, DataType* dest, size_t n);
+
+/// @brief Copies and casts 'n' file samples. A plain loop over contiguous memory the compiler vectorizes
+/// @tparam FileType Type inside the file
+template<class DataType, typename FileType>
+void convertSamples(const void* src, DataType* dest, size_t n)
+{
+    const FileType* s = (const FileType*) src;
+    for (size_t i = 0; i < n; i++)
+        dest[i] = (DataType) s[i];
+}
+
+/// @brief Picks the sample converter of a file when the file is opened, so that loading a tile doesn't dispatch on the sample format
+/// @param sampleFormat Sample format as defined by libtiff
+/// @param bitsPerSample Bits per sample
+/// @param sampleSize Output size of a file sample in bytes
+/// @return The converter. Throws if the format isn't supported
+template<class DataType>
+SampleConverter<DataType> selectSampleConverter(short sampleFormat, short bitsPerSample, size_t& sampleSize)
+{
+    sampleSize = bitsPerSample / 8;
+
+    std::stringstream message;
+    switch (sampleFormat)
+    {
+    case 1:
+        switch (bitsPerSample)
+        {
+        case 8: return convertSamples<DataType, uint8_t>;
+        case 16: return convertSamples<DataType, uint16_t>;
+        case 32: return convertSamples<DataType, uint32_t>;
+        case 64: return convertSamples<DataType, uint64_t>;
+        }
+        message << "Tile Loader ERROR: The data format is not supported for unsigned integer, number bits per pixel = " << bitsPerSample;
+        break;
+    case 2:
+        switch (bitsPerSample)
+        {
+        case 8: return convertSamples<DataType, int8_t>;
+        case 16: return convertSamples<DataType, int16_t>;
+        case 32: return convertSamples<DataType, int32_t>;
+        case 64: return convertSamples<DataType, int64_t>;
+        }
+        message << "Tile Loader ERROR: The data format is not supported for signed integer, number bits per pixel = " << bitsPerSample;
+        break;
+    case 3:
+        switch (bitsPerSample)
+        {
+        case 32: return convertSamples<DataType, float>;
+        case 64: return convertSamples<DataType, double>;
+        }
+        message << "Tile Loader ERROR: The data format is not supported for float, number bits per pixel = " << bitsPerSample;
+        break;
+    default:
+        message << "Tile Loader ERROR: The data format is not supported, sample format = " << sampleFormat;
+    }
+    throw (std::runtime_error(message.str()));
+}
+
+/// @brief Scratch buffer of a tile loader. It is allocated once when the file is opened and reused by every tile
+class TiffScratchBuffer
+{
+public:
+    /// @brief (Re)allocates the buffer
+    /// @param szb Size in bytes
+    void allocate(size_t szb)
+    {
+        data_.reset(static_cast<uint8_t*>(::operator new(szb, std::align_val_t(alignment))));
+        size_ = szb;
+    }
+    uint8_t* data() const { return data_.get(); }
+    size_t size() const { return size_; }
+
+private:
+    static constexpr size_t alignment = 64;     ///< Cache line
+    struct Deleter
+    {
+        void operator()(uint8_t* p) const { ::operator delete(p, std::align_val_t(alignment)); }
+    };
+    std::unique_ptr<uint8_t, Deleter> data_;
+    size_t size_ = 0;
+};
+
 /// @brief Tile Loader for 2D Grayscale tiff files
 /// @tparam DataType AbstractView's internal type
 template<class DataType>
@@ -68,6 +157,38 @@ public:
             { 
                 sampleFormat_ = 1; 
             }
+
+            // Pyramid. Reduced resolution levels are stored in SubIFDs of the full resolution image (OME-TIFF layout)
+            levels_.push_back({ fullHeight_, fullWidth_, tileHeight_, tileWidth_, 0 });
+            tmsize_t maxTileSize = TIFFTileSize(tiff_);
+            uint16_t nSubIfds = 0;
+            toff_t* subIfds = nullptr;
+            if (TIFFGetField(tiff_, TIFFTAG_SUBIFD, &nSubIfds, &subIfds) && nSubIfds > 0)
+            {
+                std::vector<toff_t> offsets(subIfds, subIfds + nSubIfds);   // libtiff's array doesn't survive a directory change
+                for (auto offset : offsets)
+                {
+                    if (!TIFFSetSubDirectory(tiff_, offset) || TIFFIsTiled(tiff_) == 0)
+                        break;
+                    Level lvl;
+                    TIFFGetField(tiff_, TIFFTAG_IMAGEWIDTH, &temp);
+                    lvl.fullWidth = temp;
+                    TIFFGetField(tiff_, TIFFTAG_IMAGELENGTH, &temp);
+                    lvl.fullHeight = temp;
+                    TIFFGetField(tiff_, TIFFTAG_TILEWIDTH, &temp);
+                    lvl.tileWidth = temp;
+                    TIFFGetField(tiff_, TIFFTAG_TILELENGTH, &temp);
+                    lvl.tileHeight = temp;
+                    lvl.subIfd = offset;
+                    levels_.push_back(lvl);
+                    maxTileSize = std::max(maxTileSize, TIFFTileSize(tiff_));
+                }
+                TIFFSetDirectory(tiff_, 0);
+            }
+
+            // Tile decoding resources
+            convert_ = selectSampleConverter<DataType>(sampleFormat_, bitsPerSample_, sampleSize_);
+            tiffTile_.allocate(maxTileSize);
         }
         else 
         { 
@@ -100,10 +221,8 @@ public:
         // Get ahold of the logical (feature extraction facing) tile buffer from its smart pointer
         std::vector<DataType>& tileDataVec = *tile;
 
-        tdata_t tiffTile = nullptr;
-        auto t_szb = TIFFTileSize(tiff_);
-        tiffTile = _TIFFmalloc(t_szb);
-        auto errcode = TIFFReadTile(tiff_, tiffTile, indexColGlobalTile * tileWidth_, indexRowGlobalTile * tileHeight_, 0, 0);
+        setLevel(level);
+        auto errcode = TIFFReadTile(tiff_, tiffTile_.data(), indexColGlobalTile * tileWidth_, indexRowGlobalTile * tileHeight_, 0, 0);
         if (errcode < 0)
         {
             std::stringstream message;
@@ -112,105 +231,63 @@ public:
                 << errcode;
             throw (std::runtime_error(message.str()));
         }
-        std::stringstream message;
-        switch (sampleFormat_) 
-        {
-        case 1:
-            switch (bitsPerSample_) 
-            {
-            case 8:
-                loadTile <uint8_t> (tiffTile, tileDataVec);
-                break;
-            case 16:
-                loadTile <uint16_t> (tiffTile, tileDataVec);    
-                break;
-            case 32:
-                loadTile <size_t> (tiffTile, tileDataVec);
-                break;
-            case 64:
-                loadTile <uint64_t> (tiffTile, tileDataVec);
-                break;
-            default:
-                message
-                    << "Tile Loader ERROR: The data format is not supported for unsigned integer, number bits per pixel = "
-                    << bitsPerSample_;
-                throw (std::runtime_error(message.str()));
-            }
-            break;
-        case 2:
-            switch (bitsPerSample_) 
-            {
-            case 8:
-                loadTile<int8_t>(tiffTile, tileDataVec);
-                break;
-            case 16:
-                loadTile<int16_t>(tiffTile, tileDataVec);
-                break;
-            case 32:
-                loadTile<int32_t>(tiffTile, tileDataVec);
-                break;
-            case 64:
-                loadTile<int64_t>(tiffTile, tileDataVec);
-                break;
-            default:
-                message
-                    << "Tile Loader ERROR: The data format is not supported for signed integer, number bits per pixel = "
-                    << bitsPerSample_;
-                throw (std::runtime_error(message.str()));
-            }
-            break;
-        case 3:
-            switch (bitsPerSample_) 
-            {
-            case 8:
-            case 16:
-            case 32:
-                loadTile<float>(tiffTile, tileDataVec);
-                break;
-            case 64:
-                loadTile<double>(tiffTile, tileDataVec);
-                break;
-            default:
-                message
-                    << "Tile Loader ERROR: The data format is not supported for float, number bits per pixel = "
-                    << bitsPerSample_;
-                throw (std::runtime_error(message.str()));
-            }
-            break;
-        default:
-            message << "Tile Loader ERROR: The data format is not supported, sample format = " << sampleFormat_;
-            throw (std::runtime_error(message.str()));
-        }
 
-        _TIFFfree(tiffTile);
+        loadTile(tiffTile_.data(), tileDataVec);
     }
 
 
     /// @brief Tiff file height
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Full height
-    [[nodiscard]] size_t fullHeight([[maybe_unused]] size_t level) const override { return fullHeight_; }
+    [[nodiscard]] size_t fullHeight(size_t level) const override { return level < levels_.size() ? levels_[level].fullHeight : 0; }
     /// @brief Tiff full width
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Full width
-    [[nodiscard]] size_t fullWidth([[maybe_unused]] size_t level) const override { return fullWidth_; }
+    [[nodiscard]] size_t fullWidth(size_t level) const override { return level < levels_.size() ? levels_[level].fullWidth : 0; }
     /// @brief Tiff tile width
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Tile width
-    [[nodiscard]] size_t tileWidth([[maybe_unused]] size_t level) const override { return tileWidth_; }
+    [[nodiscard]] size_t tileWidth(size_t level) const override { return level < levels_.size() ? levels_[level].tileWidth : 0; }
     /// @brief Tiff tile height
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Tile height
-    [[nodiscard]] size_t tileHeight([[maybe_unused]] size_t level) const override { return tileHeight_; }
+    [[nodiscard]] size_t tileHeight(size_t level) const override { return level < levels_.size() ? levels_[level].tileHeight : 0; }
     /// @brief Tiff bits per sample
     /// @return Size of a sample in bits
     [[nodiscard]] short bitsPerSample() const override { return bitsPerSample_; }
     /// @brief Level accessor
-    /// @return 1
-    [[nodiscard]] size_t numberPyramidLevels() const override { return 1; }
+    /// @return Number of resolution levels, the full resolution one included
+    [[nodiscard]] size_t numberPyramidLevels() const override { return levels_.size(); }
 
 private:
 
+    /// @brief Geometry of a resolution level
+    struct Level
+    {
+        size_t fullHeight, fullWidth, tileHeight, tileWidth;
+        toff_t subIfd;              ///< SubIFD offset of a reduced resolution level
+    };
+
+    /// @brief Makes pyramid level 'level' the current directory
+    void setLevel(size_t level)
+    {
+        if (level == level_)
+            return;
+
+        if (level >= levels_.size() || (level == 0 ? TIFFSetDirectory(tiff_, 0) : TIFFSetSubDirectory(tiff_, levels_[level].subIfd)) == 0)
+        {
+            std::stringstream message;
+            message << "Tile Loader ERROR: can not switch to pyramid level " << level << " of " << levels_.size();
+            throw (std::runtime_error(message.str()));
+        }
+
+        fullHeight_ = levels_[level].fullHeight;
+        fullWidth_ = levels_[level].fullWidth;
+        tileHeight_ = levels_[level].tileHeight;
+        tileWidth_ = levels_[level].tileWidth;
+        level_ = level;
+    }
+
     #if 0   // A faster implementation is available. Keeping this for records.
     /// @brief Private function to copy and cast the values
     /// @tparam FileType Type inside the file
@@ -234,12 +311,10 @@ private:
     #endif
 
     /// @brief Private function to copy and cast the values
-    /// @tparam FileType Type inside the file
     /// @param src Piece of memory coming from libtiff
     /// @param dst_as_vector Feature extraction facing logical buffer to fill
     /// 
-    template<typename FileType>
-    void loadTile(tdata_t src, std::vector<DataType>& dst_as_vector)
+    void loadTile(const uint8_t* src, std::vector<DataType>& dst_as_vector)
     {
         // Get ahold of the raw pointer
         DataType* dest = dst_as_vector.data();
@@ -253,31 +328,34 @@ private:
 
             // Copy pixels assuming the row-major layout both in the physical (TIFF) and logical (ROI scanner facing) buffers
             for (size_t r = 0; r < fullHeight_; r++)
-                for (size_t c = 0; c < fullWidth_; c++)
-                {
-                    size_t logOffs = r * tileWidth_ + c,
-                        physOffs = r * tileWidth_ + c;
-                    *(dest + logOffs) = (DataType) *(((FileType*)src) + physOffs);
-                }
+                convert_(src + r * tileWidth_ * sampleSize_, dest + r * tileWidth_, fullWidth_);
         }
         else
             // General case the logical buffer is same size (specifically, tile size) as the physical one even if tileWidth_ (e.g. 1024) < fullWidth_ (e.g. 1080)
-            {
-                size_t n = tileHeight_ * tileWidth_;
-                for (size_t i = 0; i < n; i++)
-                    *(dest + i) = (DataType) *(((FileType*)src) + i);
-            }
-
+            convert_(src, dest, tileHeight_ * tileWidth_);
     }
 
     TIFF*
         tiff_ = nullptr;             ///< Tiff file pointer
 
+    TiffScratchBuffer
+        tiffTile_;                  ///< Decoded tile
+
+    SampleConverter<DataType>
+        convert_ = nullptr;         ///< Converter of the file's samples
+
+    size_t
+        sampleSize_ = 0;            ///< Size of a file sample in bytes
+
+    std::vector<Level>
+        levels_;                    ///< Pyramid levels, the full resolution one first
+
     size_t
-        fullHeight_ = 0,           ///< Full height in pixel
-        fullWidth_ = 0,            ///< Full width in pixel
-        tileHeight_ = 0,            ///< Tile height
-        tileWidth_ = 0;             ///< Tile width
+        level_ = 0,                 ///< Current pyramid level
+        fullHeight_ = 0,           ///< Full height in pixel of the current level
+        fullWidth_ = 0,            ///< Full width in pixel of the current level
+        tileHeight_ = 0,            ///< Tile height of the current level
+        tileWidth_ = 0;             ///< Tile width of the current level
 
     short
         sampleFormat_ = 0,          ///< Sample format as defined by libtiff
@@ -315,6 +393,12 @@ public:
 
             fullDepth_ = TIFFNumberOfDirectories(tiff_);
 
+            // Strip layout
+            uint32_t temp;
+            TIFFGetFieldDefaulted(tiff_, TIFFTAG_ROWSPERSTRIP, &temp);
+            rowsPerStrip_ = std::min((size_t)temp, fullHeight_);
+            scanlineSize_ = TIFFScanlineSize(tiff_);
+
             tileWidth_ = std::min(fullWidth_, STRIP_TILE_WIDTH);
             tileHeight_ = std::min(fullHeight_, STRIP_TILE_HEIGHT);
             tileDepth_ = std::min(fullDepth_, STRIP_TILE_DEPTH);
@@ -332,6 +416,11 @@ public:
             {
                 sampleFormat_ = 1;
             }
+
+            // Band decoding resources
+            convert_ = selectSampleConverter<DataType>(sampleFormat_, bitsPerSample_, sampleSize_);
+            bandBuffer_.allocate(tileHeight_ * scanlineSize_);
+            stripBuffer_.allocate(rowsPerStrip_ * scanlineSize_);
         }
         else 
         { 
@@ -364,11 +453,8 @@ public:
         // Get ahold of the logical (feature extraction facing) tile buffer from its smart pointer
         std::vector<DataType>& tileDataVec = *tile;
 
-        tdata_t buf;
         uint32_t row, layer;
 
-        buf = _TIFFmalloc(TIFFScanlineSize(tiff_));
-
         size_t
             startLayer = indexLayerGlobalTile * tileDepth_,
             endLayer = std::min((indexLayerGlobalTile + 1) * tileDepth_, fullDepth_),
@@ -379,72 +465,11 @@ public:
 
         for (layer = startLayer; layer < endLayer; ++layer) 
         {
-            TIFFSetDirectory(tiff_, layer);
+            // Rows of this tile row are served from the band cache
+            loadBand (layer, indexRowGlobalTile);
             for (row = startRow; row < endRow; row++) 
-            {
-                TIFFReadScanline(tiff_, buf, row);
-                std::stringstream message;
-                switch (sampleFormat_) 
-                {
-                case 1:
-                    switch (bitsPerSample_) 
-                    {
-                    case 8:copyRow<uint8_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    case 16:copyRow<uint16_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    case 32:copyRow<size_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    case 64:copyRow<uint64_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    default:
-                        message
-                            << "Tile Loader ERROR: The data format is not supported for unsigned integer, number bits per pixel = "
-                            << bitsPerSample_;
-                        throw (std::runtime_error(message.str()));
-                    }
-                    break;
-                case 2:
-                    switch (bitsPerSample_) 
-                    {
-                    case 8:copyRow<int8_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    case 16:copyRow<int16_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    case 32:copyRow<int32_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    case 64:copyRow<int64_t>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    default:
-                        message
-                            << "Tile Loader ERROR: The data format is not supported for signed integer, number bits per pixel = "
-                            << bitsPerSample_;
-                        throw (std::runtime_error(message.str()));
-                    }
-                    break;
-                case 3:
-                    switch (bitsPerSample_) 
-                    {
-                    case 8:
-                    case 16:
-                    case 32:copyRow<float>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    case 64:copyRow<double>(buf, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
-                        break;
-                    default:
-                        message
-                            << "Tile Loader ERROR: The data format is not supported for float, number bits per pixel = "
-                            << bitsPerSample_;
-                        throw (std::runtime_error(message.str()));
-                    }
-                    break;
-                default:
-                    message << "Tile Loader ERROR: The data format is not supported, sample format = " << sampleFormat_;
-                    throw (std::runtime_error(message.str()));
-                }
-            }
+                copyRow(bandBuffer_.data() + (row - startRow) * scanlineSize_, tileDataVec, layer - startLayer, row - startRow, startCol, endCol);
         }
-        _TIFFfree(buf);
     }
 
 
@@ -519,44 +544,80 @@ private:
     #endif
 
     /// @brief Private function to copy and cast the values
-    /// @tparam FileType Type inside the file
-    /// @param src Piece of memory coming from libtiff
+    /// @param src Decoded row of the band
     /// @param dest_as_vector Feature extraction facing buffer to fill
     /// @param layer Destination layer
     /// @param row Destination row
-    /// @param startCol Starting column tile to copy
-    /// @param endCol End column tile to copy
-    template<typename FileType>
-    void copyRow(tdata_t src,
+    /// @param start_col Starting column tile to copy
+    /// @param end_col End column tile to copy. Callers keep it within the image
+    void copyRow(const uint8_t* src,
         std::vector<DataType>& dest_as_vector,
         size_t layer,
         size_t row,
         size_t start_col,
         size_t end_col) 
     {
-        // Get ahold of the raw pointer
-        DataType* dest = dest_as_vector.data();
+        DataType* dest = dest_as_vector.data() + tileWidth_ * tileHeight_ * layer + tileWidth_ * row;
+        convert_(src + start_col * sampleSize_, dest, end_col - start_col);
+    }
+
+    /// @brief Decodes rows of tile row 'band' of layer 'layer' into 'bandBuffer_' unless they are cached already. 
+    /// Strips are decoded as a whole with TIFFReadEncodedStrip(), and the last decoded strip is kept to serve a strip straddling 2 bands 
+    /// @param layer Layer (directory) index
+    /// @param band Tile row index
+    void loadBand(size_t layer, size_t band)
+    {
+        if (layer == bandLayer_ && band == bandIndex_)
+            return;
 
-        for (size_t col = start_col; col < end_col; col++)
+        if (layer != bandLayer_)
         {
-            // Logic to prevent "noise" in images whose dimensions are smaller than the default tile buffer size 1024x1024
-            DataType dataItem = (DataType) 0;    // Zero-fill gaps
+            TIFFSetDirectory(tiff_, (tdir_t)layer);
+            stripIndex_ = SIZE_MAX;
+        }
 
-            // - Informative zone of the strip
-            if (layer < fullDepth_ && row < fullHeight_ && col < fullWidth_)
-                dataItem = (DataType)((FileType*)(src))[col];
-            
-            // - Save the informative or zero-filled value
-            dest[
-                tileWidth_ * tileHeight_ * layer
-                    + tileWidth_ * row
-                    + col - start_col] = dataItem;
+        size_t startRow = band * tileHeight_,
+            endRow = std::min((band + 1) * tileHeight_, fullHeight_);
+
+        for (size_t row = startRow; row < endRow; row++)
+        {
+            size_t strip = row / rowsPerStrip_;
+            if (strip != stripIndex_)
+            {
+                if (TIFFReadEncodedStrip(tiff_, (tstrip_t)strip, stripBuffer_.data(), (tmsize_t)stripBuffer_.size()) < 0)
+                {
+                    bandLayer_ = bandIndex_ = stripIndex_ = SIZE_MAX;
+                    std::stringstream message;
+                    message << "Tile Loader ERROR: error reading strip " << strip << " of layer " << layer;
+                    throw (std::runtime_error(message.str()));
+                }
+                stripIndex_ = strip;
+            }
+            std::memcpy(bandBuffer_.data() + (row - startRow) * scanlineSize_, stripBuffer_.data() + (row - strip * rowsPerStrip_) * scanlineSize_, scanlineSize_);
         }
+
+        bandLayer_ = layer;
+        bandIndex_ = band;
     }
 
     TIFF*
         tiff_ = nullptr;             ///< Tiff file pointer
 
+    TiffScratchBuffer
+        bandBuffer_,              ///< Decoded rows of the cached band (tile row)
+        stripBuffer_;             ///< Last decoded strip
+
+    SampleConverter<DataType>
+        convert_ = nullptr;       ///< Converter of the file's samples
+
+    size_t
+        bandLayer_ = SIZE_MAX,    ///< Layer of the cached band
+        bandIndex_ = SIZE_MAX,    ///< Tile row index of the cached band
+        stripIndex_ = SIZE_MAX,   ///< Index of the strip in 'stripBuffer_'
+        rowsPerStrip_ = 0,        ///< Strip height
+        scanlineSize_ = 0,        ///< Size of a decoded row in bytes
+        sampleSize_ = 0;          ///< Size of a file sample in bytes
+
     size_t
         fullHeight_ = 0,          ///< Full height in pixel
         fullWidth_ = 0,           ///< Full width in pixel
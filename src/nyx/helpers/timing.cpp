@@ -1,15 +1,22 @@
 #include <fstream>
+#include <mutex>
 #include "../environment.h"
 #include "helpers.h"
 #include "timing.h"
 
+// Feature groups are timed concurrently
+static std::mutex totalsMux;
+
 Stopwatch::Stopwatch (const std::string& header_, const std::string& tail_)
 {
 	header = header_;
 	tail = tail_;
 
-	if (totals.find(header) == totals.end())
-		totals[header] = 0.0;
+	{
+		std::lock_guard<std::mutex> lk (totalsMux);
+		if (totals.find(header) == totals.end())
+			totals[header] = 0.0;
+	}
 
 	start = std::chrono::system_clock::now();
 	if (header.length() > 0)
@@ -21,7 +28,9 @@ Stopwatch::~Stopwatch()
 	end = std::chrono::system_clock::now();
 	std::chrono::duration<double, Unit> elap = end - start;
 	VERBOSLVL1(std::cout << tail << " " << elap.count() << " us\n"; )
-		totals[header] = totals[header] + elap.count();
+
+	std::lock_guard<std::mutex> lk (totalsMux);
+	totals[header] = totals[header] + elap.count();
 }
 
 void Stopwatch::print_stats()
@@ -77,7 +86,7 @@ void Stopwatch::save_stats (const std::string& fpath)
 			<< fcolor << "\",\"" << facro << " " << Nyxus::round2(perc) << "%\","
 			<< t.second 
 			<< "," << total
-			<< "," << Nyxus::theEnvironment.n_reduce_threads 
+			<< "," << Nyxus::theEnvironment().n_reduce_threads 
 			<< "\n";
 	}
 }
@@ -7,147 +7,213 @@
 #else
   error "Missing the <filesystem> header."
 #endif
+#include <chrono>
 #include <iostream>
 #include "image_loader.h"
 #include "grayscale_tiff.h"
+#include "mmap_tiff.h"
 #include "omezarr.h"
 #include "dirs_and_files.h"
 
 ImageLoader::ImageLoader() {}
 
-bool ImageLoader::open(const std::string& int_fpath, const std::string& seg_fpath)
+ImageLoader::~ImageLoader()
+{
+	stop_prefetch();
+}
+
+/// @brief Creates a tile loader of the format of file 'fpath'. Each loader owns its file handle, so different loaders can be used concurrently
+template <typename T>
+AbstractTileLoader<T>* ImageLoader::create_tile_loader (const std::string& fpath)
+{
+	int n_threads = 1;	// threads of a single file handle. Parallel decoding is achieved via multiple handles
+
+	if (fs::path(fpath).extension() == ".zarr")
+	{
+		#ifdef OMEZARR_SUPPORT
+		return new NyxusOmeZarrLoader<T>(n_threads, fpath);
+		#else
+		std::cout << "This version of Nyxus was not build with OmeZarr support." <<std::endl; 
+		return nullptr;
+		#endif
+	}
+
+	// Uncompressed TIFFs are read straight from a memory mapping. The mapping loader serves only the full resolution
+	if (lvl == 0 && NyxusGrayscaleTiffMmapLoader<T>::supports(fpath))
+		return new NyxusGrayscaleTiffMmapLoader<T>(n_threads, fpath);
+
+	if (Nyxus::check_tile_status(fpath))
+		return new NyxusGrayscaleTiffTileLoader<T>(n_threads, fpath);
+	else 
+		return new NyxusGrayscaleTiffStripLoader<T>(n_threads, fpath);
+}
+
+/// @brief Opens one more handle of each file of the pair
+bool ImageLoader::add_file_handles()
 {
-	int n_threads = 1;
+	bool first = get_num_file_handles() == 0;
 
+	std::string fpath = intFpath;
 	try 
 	{
-		if 	(fs::path(int_fpath).extension() == ".zarr")
+		if (native16)
 		{
-			#ifdef OMEZARR_SUPPORT
-			intFL = new NyxusOmeZarrLoader<uint32_t>(n_threads, int_fpath);
-			#else
-			std::cout << "This version of Nyxus was not build with OmeZarr support." <<std::endl; 
-			#endif
+			std::unique_ptr<AbstractTileLoader<uint16_t>> iFL (create_tile_loader<uint16_t> (intFpath));
+			fpath = segFpath;
+			std::unique_ptr<AbstractTileLoader<uint16_t>> sFL (create_tile_loader<uint16_t> (segFpath));
+			if (iFL == nullptr || sFL == nullptr)
+				return false;
+			intFL16s.push_back (std::move(iFL));
+			segFL16s.push_back (std::move(sFL));
 		}
-		else 
+		else
 		{
-			if (Nyxus::check_tile_status(int_fpath))
-			{
-				intFL = new NyxusGrayscaleTiffTileLoader<uint32_t>(n_threads, int_fpath);
-			} 
-			else 
-			{
-				intFL = new NyxusGrayscaleTiffStripLoader<uint32_t>(n_threads, int_fpath);
-			}
+			std::unique_ptr<AbstractTileLoader<uint32_t>> iFL (loaderFactory ? loaderFactory (intFpath) : create_tile_loader<uint32_t> (intFpath));
+			fpath = segFpath;
+			std::unique_ptr<AbstractTileLoader<uint32_t>> sFL (loaderFactory ? loaderFactory (segFpath) : create_tile_loader<uint32_t> (segFpath));
+			if (iFL == nullptr || sFL == nullptr)
+				return false;
+			intFLs.push_back (std::move(iFL));
+			segFLs.push_back (std::move(sFL));
 		}
 	}
 	catch (std::exception const& e)	
 	{
-		std::cout << "Error while initializing the image loader for intensity image file " << int_fpath << ": " << e.what() << "\n";
+		if (first)
+			std::cout << "Error while initializing the image loader for " << (fpath == intFpath ? "intensity" : "mask") << " image file " << fpath << ": " << e.what() << "\n";
+		else
+			std::cerr << "Error opening extra handles of " << intFpath << " and " << segFpath << " for parallel decoding: " << e.what() << "\n";
 		return false;
 	}
 
-	if (intFL == nullptr)
-		return false;
-
-	try {
-		if 	(fs::path(seg_fpath).extension() == ".zarr")
-		{
-			#ifdef OMEZARR_SUPPORT
-			segFL = new NyxusOmeZarrLoader<uint32_t>(n_threads, seg_fpath);
-			#else
-			std::cout << "This version of Nyxus was not build with OmeZarr support." <<std::endl;
-			#endif
-		}
-		else
-		{
-			if (Nyxus::check_tile_status(seg_fpath))
-			{
-				segFL = new NyxusGrayscaleTiffTileLoader<uint32_t>(n_threads, seg_fpath);
-			} 
-			else 
-			{
-				segFL = new NyxusGrayscaleTiffStripLoader<uint32_t>(n_threads, seg_fpath);
-			}
-		}
+	return true;
+}
 
+size_t ImageLoader::get_num_file_handles()
+{
+	return native16 ? intFL16s.size() : intFLs.size();
+}
 
-	}
-	catch (std::exception const& e)	
+/// @brief Reads image and tile dimensions of the file pair and checks their consistency
+template <typename T>
+bool ImageLoader::read_geometry (AbstractTileLoader<T>& int_loader, AbstractTileLoader<T>& seg_loader)
+{
+	// Requested pyramid level
+	auto nl_int = int_loader.numberPyramidLevels(),
+		nl_seg = seg_loader.numberPyramidLevels();
+	if ((size_t) lvl >= nl_int || (size_t) lvl >= nl_seg)
 	{
-		std::cout << "Error while initializing the image loader for mask image file " <<  seg_fpath << ": " << e.what() << "\n";
+		std::cout << "\terror: INT: " << intFpath << " SEG: " << segFpath << " :  pyramid level " << lvl << " is requested while the files have " << nl_int << " and " << nl_seg << " levels\n";
 		return false;
 	}
 
-	if (segFL == nullptr)
-		return false;
-	
 	// File #1 (intensity)
-	th = intFL->tileHeight(lvl);
-	tw = intFL->tileWidth(lvl);
-	td = intFL->tileDepth(lvl);
+	th = int_loader.tileHeight(lvl);
+	tw = int_loader.tileWidth(lvl);
+	td = int_loader.tileDepth(lvl);
 	tileSize = th * tw;
 
-	fh = intFL->fullHeight(lvl);
-	fw = intFL->fullWidth(lvl);
-	fd = intFL->fullDepth(lvl);
+	fh = int_loader.fullHeight(lvl);
+	fw = int_loader.fullWidth(lvl);
+	fd = int_loader.fullDepth(lvl);
 
-	ntw = intFL->numberTileWidth(lvl);
-	nth = intFL->numberTileHeight(lvl);
-	ntd = intFL->numberTileDepth(lvl);
+	ntw = int_loader.numberTileWidth(lvl);
+	nth = int_loader.numberTileHeight(lvl);
+	ntd = int_loader.numberTileDepth(lvl);
 
 	// File #2 (labels)
 
 	// -- check whole file consistency
-	auto fh_seg = segFL->fullHeight(lvl),
-		fw_seg = segFL->fullWidth(lvl), 
-		fd_seg = segFL->fullDepth(lvl);
+	auto fh_seg = seg_loader.fullHeight(lvl),
+		fw_seg = seg_loader.fullWidth(lvl), 
+		fd_seg = seg_loader.fullDepth(lvl);
 	if (fh != fh_seg || fw != fw_seg || fd != fd_seg)
 	{
-		std::cout << "\terror: INT: " << int_fpath << " SEG: " << seg_fpath << " :  mismatch in full height, width, or depth FH " << fh << ":" << fh_seg << " FW " << fw << ":" << fw_seg << " FD " << fd << ":" << fd_seg << "\n";
+		std::cout << "\terror: INT: " << intFpath << " SEG: " << segFpath << " :  mismatch in full height, width, or depth FH " << fh << ":" << fh_seg << " FW " << fw << ":" << fw_seg << " FD " << fd << ":" << fd_seg << "\n";
 		return false;
 	}
 
 	// -- check tile consistency
-	auto th_seg = segFL->tileHeight(lvl),
-		tw_seg = segFL->tileWidth(lvl),
-		td_seg = segFL->tileDepth(lvl);
-	if (th != segFL->tileHeight(lvl) || tw != segFL->tileWidth(lvl) || td != segFL->tileDepth(lvl))
+	auto th_seg = seg_loader.tileHeight(lvl),
+		tw_seg = seg_loader.tileWidth(lvl),
+		td_seg = seg_loader.tileDepth(lvl);
+	if (th != th_seg || tw != tw_seg || td != td_seg)
 	{
-		std::cout << "\terror: INT: " << int_fpath << " SEG: " << seg_fpath << " :  mismatch in tile height, width, or depth TH " << th << ":" << th_seg << " TW " << tw << ":" << tw_seg << " TD " << td << ":" << td_seg << "\n";
+		std::cout << "\terror: INT: " << intFpath << " SEG: " << segFpath << " :  mismatch in tile height, width, or depth TH " << th << ":" << th_seg << " TW " << tw << ":" << tw_seg << " TD " << td << ":" << td_seg << "\n";
 		return false;
 	}
 
-#if 0 // Tests
-	ptrI = std::make_shared<std::vector<uint32_t>>(tileSize);
-	// Experiment
-	ptrL = std::make_shared<std::vector<uint32_t>>(tileSize);
-	segFL->loadTileFromFile(ptrL, 
-		0, //row, 
-		0, //col, 
-		0, //lyr, 
-		0); // lvl);
-	auto& dataL = *ptrL;
-#endif
+	return true;
+}
+
+bool ImageLoader::open(const std::string& int_fpath, const std::string& seg_fpath)
+{
+	// Release the previously open file pair, if any
+	close();
+
+	intFpath = int_fpath;
+	segFpath = seg_fpath;
+
+	// Files of unsigned samples of at most 16 bits are read in their native width
+	native16 = ! loaderFactory && Nyxus::check_16bit_unsigned (int_fpath) && Nyxus::check_16bit_unsigned (seg_fpath);
 
-	ptrI = std::make_shared<std::vector<uint32_t>>(tileSize);
-	ptrL = std::make_shared<std::vector<uint32_t>>(tileSize);
+	if (! add_file_handles())
+		return false;
+
+	bool ok = native16 ? read_geometry (*intFL16s[0], *segFL16s[0]) : read_geometry (*intFLs[0], *segFLs[0]);
+	if (! ok)
+		return false;
+
+	allocate_tile_buffers (tile);
+	widenedI = widenedL = false;
 
 	return true;
 }
 
+void ImageLoader::set_tile_loader_factory (TileLoaderFactory factory)
+{
+	loaderFactory = factory;
+}
+
 void ImageLoader::close()
 {
-	if (segFL)
+	stop_prefetch();
+
+	prefetchRing.clear();
+	intFLs.clear();
+	segFLs.clear();
+	intFL16s.clear();
+	segFL16s.clear();
+}
+
+void ImageLoader::allocate_tile_buffers (TileBuffers& buffers)
+{
+	if (native16)
 	{
-		delete segFL;
-		segFL = nullptr;
+		buffers.I16 = std::make_shared<std::vector<uint16_t>>(tileSize);
+		buffers.L16 = std::make_shared<std::vector<uint16_t>>(tileSize);
 	}
+	else
+	{
+		buffers.I = std::make_shared<std::vector<uint32_t>>(tileSize);
+		buffers.L = std::make_shared<std::vector<uint32_t>>(tileSize);
+	}
+}
 
-	if (intFL)
+/// @brief Decodes a tile into 'buffers' via file handle 'handle'
+void ImageLoader::decode_tile (size_t handle, size_t tile_idx, TileBuffers& buffers)
+{
+	auto row = tile_idx / ntw;
+	auto col = tile_idx % ntw;
+	if (native16)
 	{
-		delete intFL;
-		intFL = nullptr;
+		intFL16s[handle]->loadTileFromFile (buffers.I16, row, col, lyr, lvl);
+		segFL16s[handle]->loadTileFromFile (buffers.L16, row, col, lyr, lvl);
+	}
+	else
+	{
+		intFLs[handle]->loadTileFromFile (buffers.I, row, col, lyr, lvl);
+		segFLs[handle]->loadTileFromFile (buffers.L, row, col, lyr, lvl);
 	}
 }
 
@@ -156,10 +222,11 @@ bool ImageLoader::load_tile(size_t tile_idx)
 	if (tile_idx >= ntw * nth * ntd)
 		return false;
 
-	auto row = tile_idx / ntw;
-	auto col = tile_idx % ntw;
-	intFL->loadTileFromFile (ptrI, row, col, lyr, lvl);
-	segFL->loadTileFromFile (ptrL, row, col, lyr, lvl);
+	if (! prefetchThreads.empty())
+		return load_prefetched_tile (tile_idx);
+
+	decode_tile (0, tile_idx, tile);
+	widenedI = widenedL = false;
 	
 	return true;
 }
@@ -169,18 +236,198 @@ bool ImageLoader::load_tile (size_t tile_row, size_t tile_col)
 	if (tile_row >= nth || tile_col >= ntw)
 		return false;
 
-	intFL->loadTileFromFile (ptrI, tile_row, tile_col, lyr, lvl);
-	segFL->loadTileFromFile (ptrL, tile_row, tile_col, lyr, lvl);
-	return true;
+	return load_tile (tile_row * ntw + tile_col);
+}
+
+void ImageLoader::set_pyramid_level (int level)
+{
+	lvl = std::max (level, 0);
 }
+
+void ImageLoader::set_prefetch_depth (int depth)
+{
+	prefetchDepth = std::max (depth, 0);
+}
+
+void ImageLoader::set_loader_threads (int n_threads)
+{
+	n_decoders = std::max (n_threads, 1);
+}
+
+void ImageLoader::start_prefetch (const std::vector<size_t>& tile_indices)
+{
+	stop_prefetch();
+
+	stallTime = 0;
+
+	// Each decoder needs at least 1 slot of the ring
+	size_t ringSize = n_decoders > 1 ? std::max (prefetchDepth, n_decoders) : prefetchDepth;
+	if (ringSize == 0 || tile_indices.empty())
+		return;
+
+	// Open extra file handles for decoders other than the 1st one
+	while (get_num_file_handles() < (size_t) n_decoders)
+		if (! add_file_handles())
+			break;
+
+	// (Re)allocate the ring. It is released when a file pair is closed
+	if (prefetchRing.size() != ringSize)
+	{
+		prefetchRing.resize (ringSize);
+		for (auto& slot : prefetchRing)
+			allocate_tile_buffers (slot);
+	}
+	for (auto& slot : prefetchRing)
+		slot.seq = SIZE_MAX;
+
+	prefetchSchedule = tile_indices;
+	n_claimed = n_consumed = 0;
+	stopPrefetching = false;
+	size_t n_workers = std::min (get_num_file_handles(), (size_t) n_decoders);
+	for (size_t h = 0; h < n_workers; h++)
+		prefetchThreads.emplace_back (&ImageLoader::prefetch_worker, this, h);
+}
+
+void ImageLoader::stop_prefetch()
+{
+	if (prefetchThreads.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock (prefetchMutex);
+		stopPrefetching = true;
+	}
+	prefetchCv.notify_all();
+	for (auto& t : prefetchThreads)
+		t.join();
+	prefetchThreads.clear();
+}
+
+double ImageLoader::get_prefetch_stall_time()
+{
+	return stallTime;
+}
+
+void ImageLoader::prefetch_worker (size_t handle)
+{
+	size_t ringSize = prefetchRing.size();
+
+	for (;;)
+	{
+		// Claim the next tile as soon as its slot is released by the consumer
+		size_t k;
+		{
+			std::unique_lock<std::mutex> lock (prefetchMutex);
+			prefetchCv.wait (lock, [this, ringSize] { return stopPrefetching || n_claimed >= prefetchSchedule.size() || n_claimed < n_consumed + ringSize; });
+			if (stopPrefetching || n_claimed >= prefetchSchedule.size())
+				return;
+			k = n_claimed++;
+		}
+
+		// Decode the tile. The file handle is owned by this thread until stop_prefetch()
+		PrefetchSlot& slot = prefetchRing[k % ringSize];
+		size_t tileIdx = prefetchSchedule[k];
+		bool ok = tileIdx < ntw * nth * ntd;
+		if (ok)
+		{
+			try
+			{
+				decode_tile (handle, tileIdx, slot);
+			}
+			catch (std::exception const& e)
+			{
+				std::cerr << "Error prefetching tile " << tileIdx << ": " << e.what() << "\n";
+				ok = false;
+			}
+		}
+
+		// Let the consumer know
+		{
+			std::lock_guard<std::mutex> lock (prefetchMutex);
+			slot.ok = ok;
+			slot.seq = k;
+		}
+		prefetchCv.notify_all();
+	}
+}
+
+bool ImageLoader::load_prefetched_tile (size_t tile_idx)
+{
+	// Out-of-order request? Serve it synchronously
+	if (n_consumed >= prefetchSchedule.size() || prefetchSchedule[n_consumed] != tile_idx)
+	{
+		stop_prefetch();
+		return load_tile (tile_idx);
+	}
+
+	bool ok;
+	{
+		std::unique_lock<std::mutex> lock (prefetchMutex);
+
+		// Wait for the tile
+		PrefetchSlot& slot = prefetchRing[n_consumed % prefetchRing.size()];
+		if (slot.seq != n_consumed)
+		{
+			auto t0 = std::chrono::steady_clock::now();
+			prefetchCv.wait (lock, [this, &slot] { return slot.seq == n_consumed; });
+			stallTime += std::chrono::duration<double> (std::chrono::steady_clock::now() - t0).count();
+		}
+
+		// Take it
+		std::swap (tile.I, slot.I);
+		std::swap (tile.L, slot.L);
+		std::swap (tile.I16, slot.I16);
+		std::swap (tile.L16, slot.L16);
+		widenedI = widenedL = false;
+		ok = slot.ok;
+		n_consumed++;
+	}
+	prefetchCv.notify_all();
+
+	// Retire the background threads when the schedule is exhausted
+	if (n_consumed == prefetchSchedule.size())
+		stop_prefetch();
+
+	return ok;
+}
+
 const std::vector<uint32_t>& ImageLoader::get_int_tile_buffer()
 {
-	return *ptrI;
+	if (native16 && ! widenedI)
+	{
+		if (tile.I == nullptr)
+			tile.I = std::make_shared<std::vector<uint32_t>>(tileSize);
+		std::copy (tile.I16->begin(), tile.I16->end(), tile.I->begin());
+		widenedI = true;
+	}
+	return *tile.I;
 }
 
 const std::vector<uint32_t>& ImageLoader::get_seg_tile_buffer()
 {
-	return *ptrL;
+	if (native16 && ! widenedL)
+	{
+		if (tile.L == nullptr)
+			tile.L = std::make_shared<std::vector<uint32_t>>(tileSize);
+		std::copy (tile.L16->begin(), tile.L16->end(), tile.L->begin());
+		widenedL = true;
+	}
+	return *tile.L;
+}
+
+bool ImageLoader::native_16bit()
+{
+	return native16;
+}
+
+const std::vector<uint16_t>& ImageLoader::get_int_tile_buffer_16()
+{
+	return *tile.I16;
+}
+
+const std::vector<uint16_t>& ImageLoader::get_seg_tile_buffer_16()
+{
+	return *tile.L16;
 }
 
 size_t ImageLoader::get_tile_size()
@@ -236,4 +483,4 @@ size_t ImageLoader::get_full_width()
 size_t ImageLoader::get_full_height()
 {
 	return fh;
-}
\ No newline at end of file
+}
\ No newline at end of file
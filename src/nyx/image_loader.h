@@ -2,8 +2,12 @@
 
 #include <array>
 #include <algorithm>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include "abs_tile_loader.h"
 
@@ -12,12 +16,29 @@ class ImageLoader
 {
 public:
 	ImageLoader();
+	~ImageLoader();
 	bool open(const std::string & int_fpath, const std::string & seg_fpath);
+
+	/// @brief Makes subsequent open() calls create the tile loaders of both files via 'factory' instead of choosing them by file format, 
+	/// e.g. to read images held in memory. Such files are read in 32 bits. An empty factory restores the format-based choice
+	using TileLoaderFactory = std::function<AbstractTileLoader<uint32_t>* (const std::string& fpath)>;
+	void set_tile_loader_factory (TileLoaderFactory factory);
 	void close();
 	bool load_tile (size_t tile_idx);
 	bool load_tile (size_t tile_row, size_t tile_col);
+
+	/// @brief Returns the intensity samples of the current tile. In the native 16-bit mode they are widened on the 1st request
 	const std::vector<uint32_t>& get_int_tile_buffer();
+
+	/// @brief Returns the mask samples of the current tile. In the native 16-bit mode they are widened on the 1st request
 	const std::vector<uint32_t>& get_seg_tile_buffer();
+
+	/// @brief Tells if both files hold unsigned samples of at most 16 bits. Tiles of such files are decoded and kept in 16-bit buffers 
+	/// available via get_int_tile_buffer_16() and get_seg_tile_buffer_16()
+	bool native_16bit();
+	const std::vector<uint16_t>& get_int_tile_buffer_16();
+	const std::vector<uint16_t>& get_seg_tile_buffer_16();
+
 	size_t get_tile_size();
 	size_t get_num_tiles_vert();
 	size_t get_num_tiles_hor();
@@ -28,10 +49,112 @@ public:
 	size_t get_within_tile_idx (size_t pixel_row, size_t pixel_col);
 	size_t get_full_width();
 	size_t get_full_height();
+
+	/// @brief Walks rectangle ['xmin', 'xmax'] x ['ymin', 'ymax'] of the image tile by tile, loading each tile once and, if prefetching is 
+	/// enabled, decoding tiles ahead. Calls 'visit (row, col, I, n)' for each row segment of a tile within the rectangle: 'I' are the 
+	/// intensities of 'n' pixels starting at image position ('row', 'col'), those not belonging to ROI 'label' zeroed. If 'any_label' is 
+	/// set, pixels of any nonzero mask value belong to the ROI, e.g. in the single-ROI mode where the mask is the intensity image itself
+	///
+	/// Example:
+	///		imloader.for_each_roi_segment (xmin, ymin, xmax, ymax, label, false, [&] (size_t row, size_t col, const uint32_t* I, size_t n)
+	///		{
+	///			for (size_t k = 0; k < n; k++)
+	///				sum += I[k];
+	///		});
+	template <class F>
+	void for_each_roi_segment (size_t xmin, size_t ymin, size_t xmax, size_t ymax, uint32_t label, bool any_label, F visit)
+	{
+		std::vector<size_t> tiles;
+		for (size_t ty = ymin / th; ty <= ymax / th; ty++)
+			for (size_t tx = xmin / tw; tx <= xmax / tw; tx++)
+				tiles.push_back (ty * ntw + tx);
+		start_prefetch (tiles);
+
+		std::vector<uint32_t> segment (std::min (tw, xmax - xmin + 1));
+		auto scanTile = [&] (const auto& dataI, const auto& dataL, size_t ty, size_t tx)
+		{
+			size_t x0 = std::max (xmin, tx * tw),
+				x1 = std::min (xmax, (tx + 1) * tw - 1),
+				y1 = std::min (ymax, (ty + 1) * th - 1);
+			for (size_t y = std::max (ymin, ty * th); y <= y1; y++)
+			{
+				size_t i = (y - ty * th) * tw + (x0 - tx * tw);
+				if (any_label)
+					for (size_t x = x0; x <= x1; x++, i++)
+						segment[x - x0] = dataL[i] != 0 ? dataI[i] : 0;
+				else
+					for (size_t x = x0; x <= x1; x++, i++)
+						segment[x - x0] = dataL[i] == label ? dataI[i] : 0;
+				visit (y, x0, (const uint32_t*) segment.data(), x1 - x0 + 1);
+			}
+		};
+
+		for (auto tileIdx : tiles)
+		{
+			if (! load_tile (tileIdx))
+				continue;
+			if (native16)
+				scanTile (get_int_tile_buffer_16(), get_seg_tile_buffer_16(), tileIdx / ntw, tileIdx % ntw);
+			else
+				scanTile (get_int_tile_buffer(), get_seg_tile_buffer(), tileIdx / ntw, tileIdx % ntw);
+		}
+		stop_prefetch();
+	}
+
+	/// @brief Sets the resolution level of pyramidal files opened by subsequent open() calls. 0 is the full resolution
+	void set_pyramid_level (int level);
+
+	/// @brief Sets the number of tiles decoded ahead of the consumer in the prefetching mode. 0 disables prefetching
+	void set_prefetch_depth (int depth);
+
+	/// @brief Sets the number of threads decoding tiles in the prefetching mode. Each thread reads the files via its own handles. 
+	/// More than 1 thread enables prefetching with at least 1 tile per thread decoded ahead
+	void set_loader_threads (int n_threads);
+
+	/// @brief Starts decoding tiles in background threads in the order the consumer is going to request them via load_tile(). 
+	/// Tiles are delivered in this order regardless of the order they are decoded in.
+	/// Out-of-order load_tile() requests stop prefetching and are served synchronously. No-op if prefetching is disabled
+	/// @param tile_indices Tile indices in the order of consumption
+	void start_prefetch (const std::vector<size_t>& tile_indices);
+
+	/// @brief Stops the background decoders, if any
+	void stop_prefetch();
+
+	/// @brief Returns the time [seconds] the consumer has spent waiting for tiles since the latest start_prefetch()
+	double get_prefetch_stall_time();
+
 private:
-	AbstractTileLoader<uint32_t> *segFL = nullptr, *intFL = nullptr; 
-	std::shared_ptr<std::vector<uint32_t>> ptrI = nullptr; 
-	std::shared_ptr<std::vector<uint32_t>> ptrL = nullptr; 
+	// Tile samples of the intensity and mask files. Only the 16-bit pair is decoded into in the native 16-bit mode
+	struct TileBuffers
+	{
+		std::shared_ptr<std::vector<uint32_t>> I, L;
+		std::shared_ptr<std::vector<uint16_t>> I16, L16;
+	};
+
+	template <typename T> 
+	AbstractTileLoader<T>* create_tile_loader (const std::string& fpath);
+	template <typename T> 
+	bool read_geometry (AbstractTileLoader<T>& int_loader, AbstractTileLoader<T>& seg_loader);
+	bool add_file_handles();
+	size_t get_num_file_handles();
+	void allocate_tile_buffers (TileBuffers& buffers);
+	void decode_tile (size_t handle, size_t tile_idx, TileBuffers& buffers);
+	bool load_prefetched_tile (size_t tile_idx);
+	void prefetch_worker (size_t handle);
+
+	std::string intFpath, segFpath;
+	TileLoaderFactory loaderFactory;
+
+	// File handles. Handle 0 serves synchronous loading, each handle serves a decoder in the prefetching mode
+	std::vector<std::unique_ptr<AbstractTileLoader<uint32_t>>> intFLs, segFLs;
+	std::vector<std::unique_ptr<AbstractTileLoader<uint16_t>>> intFL16s, segFL16s;	// same in the native 16-bit mode
+	bool native16 = false;
+
+	// Current tile
+	TileBuffers tile;
+	bool widenedI = false,	// 32-bit buffers are up to date in the native 16-bit mode
+		widenedL = false;
+
 	// Tile height, width, and depth
 	size_t th,
 		tw,
@@ -52,4 +175,23 @@ private:
 
 	int lvl = 0,	// Pyramid level
 		lyr = 0;	//	Layer
-};
\ No newline at end of file
+
+	// Prefetching mode. Decoders claim tiles of 'prefetchSchedule' in order. Ring slot k % ring size receives k-th tile when the consumer 
+	// has taken (k - ring size)-th tile. Consumer takes a tile by swapping slot's buffers with those of 'tile'
+	struct PrefetchSlot : TileBuffers
+	{
+		size_t seq;		// index of the decoded tile in 'prefetchSchedule'
+		bool ok = true;
+	};
+	int prefetchDepth = 0,
+		n_decoders = 1;
+	std::vector<PrefetchSlot> prefetchRing;
+	std::vector<size_t> prefetchSchedule;
+	size_t n_claimed = 0,	// number of tiles of 'prefetchSchedule' claimed by decoders
+		n_consumed = 0;		// number of tiles of 'prefetchSchedule' taken by the consumer
+	bool stopPrefetching = false;
+	double stallTime = 0;
+	std::vector<std::thread> prefetchThreads;
+	std::mutex prefetchMutex;
+	std::condition_variable prefetchCv;
+};
\ No newline at end of file
@@ -12,20 +12,20 @@ int main (int argc, char** argv)
 {
 	VERBOSLVL1(std::cout << PROJECT_NAME << " /// " << PROJECT_VER << " /// (c) 2021-2022 Axle Informatics\t" << "Build of " << __TIMESTAMP__ << "\n";)
 
-	int parseRes = theEnvironment.parse_cmdline (argc, argv);
+	int parseRes = theEnvironment().parse_cmdline (argc, argv);
 	if (parseRes)
 	{
 		std::cout << "\nError: missing command line arguments\n\n";
-		theEnvironment.show_cmdline_help();
+		theEnvironment().show_cmdline_help();
 		return parseRes;
 	}
 
-	VERBOSLVL1(theEnvironment.show_summary("\n"/*head*/, "\n"/*tail*/);)
+	VERBOSLVL1(theEnvironment().show_summary("\n"/*head*/, "\n"/*tail*/);)
 
 	#ifdef USE_GPU
-		if (theEnvironment.using_gpu())
+		if (theEnvironment().using_gpu())
 		{
-			int gpuDevNo = theEnvironment.get_gpu_device_choice();
+			int gpuDevNo = theEnvironment().get_gpu_device_choice();
 			if (gpuDevNo >= 0 && gpu_initialize(gpuDevNo) == false)
 			{
 				std::cout << "Error: cannot use GPU device ID " << gpuDevNo << ". You can disable GPU usage via command line option " << USEGPU << "=false\n";
@@ -35,22 +35,22 @@ int main (int argc, char** argv)
 	#endif
 
 	// Have the feature manager prepare the feature toolset reflecting user's selection
-	if (!theFeatureMgr.compile())
+	if (!theFeatureMgr().compile())
 	{
 		std::cout << "Error: compiling feature methods failed\n";
 		return 1;
 	}
-	theFeatureMgr.apply_user_selection();
+	theFeatureMgr().apply_user_selection();
 
 	// Scan file names
 	std::vector <std::string> intensFiles, labelFiles;
 	int errorCode = Nyxus::read_dataset (
-		theEnvironment.intensity_dir, 
-		theEnvironment.labels_dir, 
-		theEnvironment.get_file_pattern(),
-		theEnvironment.output_dir, 
-		theEnvironment.intSegMapDir, 
-		theEnvironment.intSegMapFile, 
+		theEnvironment().intensity_dir, 
+		theEnvironment().labels_dir, 
+		theEnvironment().get_file_pattern(),
+		theEnvironment().output_dir, 
+		theEnvironment().intSegMapDir, 
+		theEnvironment().intSegMapFile, 
 		true, 
 		intensFiles, labelFiles);
 	if (errorCode)
@@ -71,12 +71,12 @@ int main (int argc, char** argv)
 	errorCode = processDataset (
 		intensFiles, 
 		labelFiles, 
-		theEnvironment.n_loader_threads, 
-		theEnvironment.n_pixel_scan_threads, 
-		theEnvironment.n_reduce_threads,
+		theEnvironment().n_loader_threads, 
+		theEnvironment().n_pixel_scan_threads, 
+		theEnvironment().n_reduce_threads,
 		min_online_roi_size,
 		true, // 'true' to save to csv
-		theEnvironment.output_dir);
+		theEnvironment().output_dir);
 
 	// Check the error code 
 	switch (errorCode)
@@ -0,0 +1,296 @@
+#pragma once
+#include "grayscale_tiff.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/// @brief Tile Loader for uncompressed 2D grayscale tiff files, tiled or organized in strips. Instead of reading pixels via libtiff,
+/// the file is memory-mapped and tiles are widened straight from the mapping to the logical (feature extraction facing) buffer.
+/// Strip files are cut in STRIP_TILE_HEIGHT x STRIP_TILE_WIDTH virtual tiles like in NyxusGrayscaleTiffStripLoader
+/// @tparam DataType AbstractView's internal type
+template<class DataType>
+class NyxusGrayscaleTiffMmapLoader : public AbstractTileLoader<DataType>
+{
+public:
+
+    /// @brief Checks if a file can be served by this loader: uncompressed, single-directory, grayscale, native byte order, and 8/16/32/64 bits per sample
+    /// @param filePath Path of tiff file
+    /// @return True if the file is eligible
+    static bool supports(std::string const& filePath)
+    {
+        TIFF* tiff = TIFFOpen(filePath.c_str(), "r");
+        if (tiff == nullptr)
+            return false;
+
+        uint16_t compression = 0, samplesPerPixel = 1, bitsPerSample = 0, sampleFormat = 1;
+        TIFFGetField(tiff, TIFFTAG_COMPRESSION, &compression);
+        TIFFGetField(tiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel);
+        TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+        TIFFGetField(tiff, TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+
+        bool ok = compression == COMPRESSION_NONE
+            && samplesPerPixel <= 1
+            && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 32 || bitsPerSample == 64)
+            && ! (sampleFormat == 3 && bitsPerSample < 32)
+            && ! TIFFIsByteSwapped(tiff)
+            && TIFFNumberOfDirectories(tiff) == 1;
+
+        TIFFClose(tiff);
+        return ok;
+    }
+
+    /// @brief NyxusGrayscaleTiffMmapLoader unique constructor
+    /// @param numberThreads Number of threads associated
+    /// @param filePath Path of tiff file
+    NyxusGrayscaleTiffMmapLoader(size_t numberThreads, std::string const& filePath)
+        : AbstractTileLoader<DataType>("NyxusGrayscaleTiffMmapLoader", numberThreads, filePath)
+    {
+        if (! supports(filePath))
+            throw (std::runtime_error("Tile Loader ERROR: The file can not be memory-mapped as it is compressed or not a single-layer greyscale image."));
+
+        // Load/parse header
+        TIFF* tiff = TIFFOpen(filePath.c_str(), "r");
+        if (tiff == nullptr)
+            throw (std::runtime_error("Tile Loader ERROR: The file can not be opened."));
+
+        uint32_t temp;  // Using this variable to correctly read 'uint32_t' TIFF field values into 'size_t' variables
+        TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &temp);
+        fullWidth_ = temp;
+        TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &temp);
+        fullHeight_ = temp;
+        TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample_);
+        TIFFGetField(tiff, TIFFTAG_SAMPLEFORMAT, &sampleFormat_);
+        // Interpret undefined data format as unsigned integer data
+        if (sampleFormat_ < 1 || sampleFormat_ > 3)
+            sampleFormat_ = 1;
+        convert_ = selectSampleConverter<DataType>(sampleFormat_, bitsPerSample_, sampleSize_);
+
+        tiled_ = TIFFIsTiled(tiff) != 0;
+        size_t nStriles;
+        if (tiled_)
+        {
+            TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &temp);
+            tileWidth_ = temp;
+            TIFFGetField(tiff, TIFFTAG_TILELENGTH, &temp);
+            tileHeight_ = temp;
+            nStriles = TIFFNumberOfTiles(tiff);
+        }
+        else
+        {
+            TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &temp);
+            rowsPerStrip_ = std::min((size_t)temp, fullHeight_);
+            tileWidth_ = std::min(fullWidth_, STRIP_TILE_WIDTH);
+            tileHeight_ = std::min(fullHeight_, STRIP_TILE_HEIGHT);
+            nStriles = TIFFNumberOfStrips(tiff);
+        }
+
+        // Locations of tiles or strips in the file
+        striles_.resize(nStriles);
+        for (size_t i = 0; i < nStriles; i++)
+            striles_[i] = TIFFGetStrileOffset(tiff, (uint32_t)i);
+
+        TIFFClose(tiff);
+
+        mapFile(filePath);
+
+        // Validate strile locations against the mapping
+        size_t strileSize = tiled_ ? tileWidth_ * tileHeight_ * bitsPerSample_ / 8 : rowsPerStrip_ * fullWidth_ * bitsPerSample_ / 8;
+        for (size_t i = 0; i < nStriles; i++)
+        {
+            size_t expectedSize = strileSize;
+            if (! tiled_ && i == nStriles - 1)
+                expectedSize = (fullHeight_ - i * rowsPerStrip_) * fullWidth_ * bitsPerSample_ / 8;     // the last strip may be short
+            if (striles_[i] + expectedSize > mapSize_)
+            {
+                unmapFile();
+                throw (std::runtime_error("Tile Loader ERROR: The file is truncated."));
+            }
+        }
+    }
+
+    /// @brief NyxusGrayscaleTiffMmapLoader destructor
+    ~NyxusGrayscaleTiffMmapLoader() override
+    {
+        unmapFile();
+    }
+
+    /// @brief Load a tiff tile from a view
+    /// @param tile Tile to copy into
+    /// @param indexRowGlobalTile Tile row index
+    /// @param indexColGlobalTile Tile column index
+    /// @param indexLayerGlobalTile Tile layer index
+    /// @param level Tile's level
+    void loadTileFromFile(std::shared_ptr<std::vector<DataType>> tile,
+        size_t indexRowGlobalTile,
+        size_t indexColGlobalTile,
+        [[maybe_unused]] size_t indexLayerGlobalTile,
+        [[maybe_unused]] size_t level) override
+    {
+        loadTile(*tile, indexRowGlobalTile, indexColGlobalTile);
+    }
+
+    /// @brief Tiff file height
+    /// @param level Tiff level [not used]
+    /// @return Full height
+    [[nodiscard]] size_t fullHeight([[maybe_unused]] size_t level) const override { return fullHeight_; }
+    /// @brief Tiff full width
+    /// @param level Tiff level [not used]
+    /// @return Full width
+    [[nodiscard]] size_t fullWidth([[maybe_unused]] size_t level) const override { return fullWidth_; }
+    /// @brief Tiff tile width
+    /// @param level Tiff level [not used]
+    /// @return Tile width
+    [[nodiscard]] size_t tileWidth([[maybe_unused]] size_t level) const override { return tileWidth_; }
+    /// @brief Tiff tile height
+    /// @param level Tiff level [not used]
+    /// @return Tile height
+    [[nodiscard]] size_t tileHeight([[maybe_unused]] size_t level) const override { return tileHeight_; }
+    /// @brief Tiff bits per sample
+    /// @return Size of a sample in bits
+    [[nodiscard]] short bitsPerSample() const override { return bitsPerSample_; }
+    /// @brief Level accessor
+    /// @return 1
+    [[nodiscard]] size_t numberPyramidLevels() const override { return 1; }
+
+private:
+
+    /// @brief Copies and casts pixels of a tile from the mapping to the logical buffer
+    /// @param dst_as_vector Feature extraction facing logical buffer to fill
+    /// @param row Tile row index
+    /// @param col Tile column index
+    void loadTile(std::vector<DataType>& dst_as_vector, size_t row, size_t col)
+    {
+        DataType* dest = dst_as_vector.data();
+
+        if (tiled_)
+        {
+            size_t ntw = (fullWidth_ + tileWidth_ - 1) / tileWidth_;
+            const uint8_t* src = mapBase_ + striles_[row * ntw + col];
+
+            // Special case of tileWidth_ (e.g. 1024) > fullWidth_ (e.g. 256): zero the margins
+            if (tileWidth_ > fullWidth_ && tileHeight_ > fullHeight_)
+            {
+                std::memset(dest, 0, tileHeight_ * tileWidth_ * sizeof(*dest));
+                for (size_t r = 0; r < fullHeight_; r++)
+                    convert_(src + r * tileWidth_ * sampleSize_, dest + r * tileWidth_, fullWidth_);
+            }
+            else
+                convert_(src, dest, tileHeight_ * tileWidth_);
+            return;
+        }
+
+        // Strips: copy the virtual tile row by row, zero-filling beyond the image
+        size_t startRow = row * tileHeight_,
+            endRow = std::min((row + 1) * tileHeight_, fullHeight_),
+            startCol = col * tileWidth_,
+            endCol = std::min((col + 1) * tileWidth_, fullWidth_),
+            n = endCol - startCol;
+        for (size_t r = startRow; r < startRow + tileHeight_; r++)
+        {
+            DataType* destRow = dest + (r - startRow) * tileWidth_;
+            if (r < endRow)
+            {
+                size_t strip = r / rowsPerStrip_;
+                const uint8_t* srcRow = mapBase_ + striles_[strip] + (r - strip * rowsPerStrip_) * fullWidth_ * sampleSize_;
+                convert_(srcRow + startCol * sampleSize_, destRow, n);
+                std::fill(destRow + n, destRow + tileWidth_, (DataType)0);
+            }
+            else
+                std::fill(destRow, destRow + tileWidth_, (DataType)0);
+        }
+    }
+
+    /// @brief Maps the whole file in memory for reading
+    void mapFile(std::string const& filePath)
+    {
+#ifdef _WIN32
+        hFile_ = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile_ == INVALID_HANDLE_VALUE)
+            throw (std::runtime_error("Tile Loader ERROR: The file can not be opened."));
+        LARGE_INTEGER sz;
+        GetFileSizeEx(hFile_, &sz);
+        mapSize_ = (size_t)sz.QuadPart;
+        hMapping_ = CreateFileMappingA(hFile_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping_ != nullptr)
+            mapBase_ = (const uint8_t*)MapViewOfFile(hMapping_, FILE_MAP_READ, 0, 0, 0);
+        if (mapBase_ == nullptr)
+        {
+            unmapFile();
+            throw (std::runtime_error("Tile Loader ERROR: The file can not be memory-mapped."));
+        }
+#else
+        fd_ = ::open(filePath.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            throw (std::runtime_error("Tile Loader ERROR: The file can not be opened."));
+        struct stat st;
+        fstat(fd_, &st);
+        mapSize_ = (size_t)st.st_size;
+        void* p = mmap(nullptr, mapSize_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED)
+        {
+            unmapFile();
+            throw (std::runtime_error("Tile Loader ERROR: The file can not be memory-mapped."));
+        }
+        mapBase_ = (const uint8_t*)p;
+#endif
+    }
+
+    /// @brief Releases the mapping
+    void unmapFile()
+    {
+#ifdef _WIN32
+        if (mapBase_)
+            UnmapViewOfFile(mapBase_);
+        if (hMapping_)
+            CloseHandle(hMapping_);
+        if (hFile_ != INVALID_HANDLE_VALUE)
+            CloseHandle(hFile_);
+        hMapping_ = nullptr;
+        hFile_ = INVALID_HANDLE_VALUE;
+#else
+        if (mapBase_)
+            munmap((void*)mapBase_, mapSize_);
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+#endif
+        mapBase_ = nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE
+        hFile_ = INVALID_HANDLE_VALUE,  ///< File handle
+        hMapping_ = nullptr;            ///< File mapping handle
+#else
+    int fd_ = -1;                       ///< File descriptor
+#endif
+    const uint8_t* mapBase_ = nullptr;  ///< Start of the mapping
+    size_t mapSize_ = 0;                ///< Size of the mapping in bytes
+
+    std::vector<uint64_t> striles_;     ///< File offsets of tiles or strips
+
+    SampleConverter<DataType> convert_ = nullptr;   ///< Converter of the file's samples
+    size_t sampleSize_ = 0;             ///< Size of a file sample in bytes
+
+    bool tiled_ = false;                ///< Tiled or strip file
+
+    size_t
+        fullHeight_ = 0,                ///< Full height in pixel
+        fullWidth_ = 0,                 ///< Full width in pixel
+        tileHeight_ = 0,                ///< Tile height (virtual tile height for strip files)
+        tileWidth_ = 0,                 ///< Tile width (virtual tile width for strip files)
+        rowsPerStrip_ = 0;              ///< Strip height
+
+    short
+        sampleFormat_ = 0,              ///< Sample format as defined by libtiff
+        bitsPerSample_ = 0;             ///< Bit Per Sample as defined by libtiff
+};
@@ -0,0 +1,95 @@
+#if __has_include(<filesystem>)
+  #include <filesystem>
+  namespace fs = std::filesystem;
+#elif __has_include(<experimental/filesystem>)
+  #include <experimental/filesystem> 
+  namespace fs = std::experimental::filesystem;
+#else
+  error "Missing the <filesystem> header."
+#endif
+#include <atomic>
+#include <iostream>
+#ifdef _WIN32
+	#include <process.h>
+	#define getpid _getpid
+#else
+	#include <unistd.h>
+#endif
+#include "nyxus_context.h"
+#include "globals.h"
+#include "features/image_moments.h"
+
+namespace Nyxus
+{
+	// Context bound to the thread, nullptr - the default one
+	static thread_local NyxusContext* boundContext = nullptr;
+
+	ContextTempDir::~ContextTempDir()
+	{
+		if (path.empty())
+			return;
+		std::error_code ec;
+		fs::remove_all (path, ec);
+	}
+
+	std::string ContextTempDir::get (const std::string& parent_dir)
+	{
+		static std::atomic<uint64_t> n_dirs { 0 };
+
+		std::lock_guard<std::mutex> lock (mutex);
+		if (path.empty())
+		{
+			path = (fs::path (parent_dir) / ("nyxus-" + std::to_string (getpid()) + "-" + std::to_string (n_dirs++))).string();
+			std::error_code ec;
+			fs::create_directories (path, ec);
+			if (ec)
+				std::cerr << "Error: cannot create temp directory " << path << ": " << ec.message() << "\n";
+		}
+		return path;
+	}
+
+	NyxusContext::NyxusContext() :
+		threadPool ([this] { bind_context (this); })	// pool workers work in the context owning the pool
+	{}
+
+	static NyxusContext& default_context()
+	{
+		static NyxusContext ctx;
+		return ctx;
+	}
+
+	NyxusContext& current_context()
+	{
+		return boundContext ? *boundContext : default_context();
+	}
+
+	NyxusContext* bind_context (NyxusContext* ctx)
+	{
+		NyxusContext* previous = boundContext;
+		boundContext = ctx;
+		return previous;
+	}
+
+	// Accessors of the current context's state declared along with the types of the state
+
+	Environment& theEnvironment() { return current_context().environment; }
+	FeatureSet& theFeatureSet() { return current_context().featureSet; }
+	FeatureManager& theFeatureMgr() { return current_context().featureMgr; }
+	FeatureValueLayout& theFeatureValueLayout() { return current_context().featureValueLayout; }
+	ImageLoader& theImLoader() { return current_context().imLoader; }
+	ZarrChunkCache<uint32_t>& theZarrChunkCache() { return current_context().zarrChunkCache; }
+	std::string& theSegFname() { return current_context().segFname; }
+	std::string& theIntFname() { return current_context().intFname; }
+	RoiStore& roiData() { return current_context().roiData; }
+	std::unordered_map <int, std::shared_ptr<std::mutex>>& labelMutexes() { return current_context().labelMutexes; }
+	BatchArena& trivialRoisArena() { return current_context().trivialRoisArena; }
+	PixIntens*& ImageMatrixBuffer() { return current_context().imageMatrixBuffer; }
+	size_t& imageMatrixBufferLen() { return current_context().imageMatrixBufferLen; }
+	ThreadPool& theThreadPool() { return current_context().threadPool; }
+
+	std::string theTempDirPath()
+	{
+		NyxusContext& ctx = current_context();
+		return ctx.tempDir.get (ctx.environment.get_temp_dir_path());
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "batch_arena.h"
+#include "environment.h"
+#include "feature_mgr.h"
+#include "feature_values.h"
+#include "featureset.h"
+#include "image_loader.h"
+#include "results_cache.h"
+#include "roi_cache.h"
+#include "thread_pool.h"
+#include "zarr_chunk_cache.h"
+
+namespace Nyxus
+{
+	/// @brief Directory of a context's temporary files, e.g. those of oversized ROIs. It's created on the 1st request under the 
+	/// environment's temp directory and named uniquely to the process and the context, so extractions running concurrently never 
+	/// share files even if their ROIs share labels. It's removed with its content along with the context
+	class ContextTempDir
+	{
+	public:
+		ContextTempDir() {}
+		~ContextTempDir();
+		ContextTempDir (const ContextTempDir&) = delete;
+		ContextTempDir& operator= (const ContextTempDir&) = delete;
+
+		/// @brief Returns the directory's path, creating the directory in 'parent_dir' if it doesn't exist yet
+		std::string get (const std::string& parent_dir);
+
+	private:
+		std::mutex mutex;
+		std::string path;
+	};
+
+	/// @brief State of a feature extraction: parameters, feature selection, the image loader, ROI data, intermediate buffers, and
+	/// results. The phases reach it through accessors like theEnvironment() and roiData() that resolve to the context bound to the
+	/// calling thread or, if none is, to the process' default one. Independent extractions can thus run concurrently in one process,
+	/// e.g. one per file pair or one per Python Nyxus object, each in a thread bound to its own context.
+	class NyxusContext
+	{
+	public:
+		NyxusContext();
+		NyxusContext (const NyxusContext&) = delete;
+		NyxusContext& operator= (const NyxusContext&) = delete;
+
+		// Declared first to outlive the files of the state below
+		ContextTempDir tempDir;
+
+		// Parameters and feature selection
+		Environment environment;
+		FeatureSet featureSet;
+		FeatureManager featureMgr;
+		FeatureValueLayout featureValueLayout;
+
+		// Everything related to images
+		ZarrChunkCache<uint32_t> zarrChunkCache;	// Decoded OME-Zarr chunks of the context's loaders, which must not outlive it
+		ImageLoader imLoader;
+		std::string segFname, intFname;	// Cached file names while iterating a dataset
+
+		// Everything related to ROI data
+		RoiStore roiData;
+		std::unordered_map <int, std::shared_ptr<std::mutex>> labelMutexes;
+		BatchArena trivialRoisArena;	// Memory of trivial ROIs' pixel caches, reused by consecutive batches
+		PixIntens* imageMatrixBuffer = nullptr;	// Image matrices of a batch of trivial ROIs sent to GPU
+		size_t imageMatrixBufferLen = 0;
+
+		// Results
+		ResultsCache resultsCache;
+		bool csvHeaderPending = true;	// Flipped to 'false' when the header of a 'singlecsv' output is written
+
+		// Declared last to stop the workers before the state they work on is gone
+		ThreadPool threadPool;
+	};
+
+	/// @brief Context bound to the calling thread or, if none is, the default one
+	NyxusContext& current_context();
+
+	/// @brief Binds context 'ctx' (nullptr - the default one) to the calling thread and returns the previously bound one
+	NyxusContext* bind_context (NyxusContext* ctx);
+
+	/// @brief Binds a context to the calling thread for the scope's lifetime
+	class ContextBinding
+	{
+	public:
+		explicit ContextBinding (NyxusContext& ctx) : previous (bind_context (&ctx)) {}
+		~ContextBinding() { bind_context (previous); }
+		ContextBinding (const ContextBinding&) = delete;
+		ContextBinding& operator= (const ContextBinding&) = delete;
+
+	private:
+		NyxusContext* previous;
+	};
+
+	/// @brief Wraps callable 'f' so that it runs in the calling thread's context in whichever thread it's invoked, e.g. std::async's
+	template <class F>
+	auto in_current_context (F f)
+	{
+		NyxusContext* ctx = &current_context();
+		return [ctx, f] (auto&&... args)
+		{
+			ContextBinding binding (*ctx);
+			return f (std::forward<decltype(args)>(args)...);
+		};
+	}
+}
@@ -3,7 +3,14 @@
 #ifdef OMEZARR_SUPPORT
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
 #include "abs_tile_loader.h"
+#include "zarr_chunk_cache.h"
 #include "nlohmann/json.hpp"
 #include "xtensor/xarray.hpp"
 
@@ -15,11 +22,28 @@
 #include "z5/multiarray/xtensor_access.hxx"
 // attribute functionality
 #include "z5/attributes.hxx"
-/// @brief Tile Loader for OMEZarr
+
+/// @brief Tile Loader for OMEZarr. Tiles are chunks of the 2D plane. Chunks are decoded straight into the tile buffer and shared via ZarrChunkCache. 
+/// Parallel decoding is achieved by multiple loader instances, see ImageLoader::set_loader_threads()
 /// @tparam DataType AbstractView's internal type
 template<class DataType>
 class NyxusOmeZarrLoader : public AbstractTileLoader<DataType> 
 {
+    /// @brief Dataset and geometry of a resolution level
+    struct Level
+    {
+        std::string path;           ///< Dataset path
+        std::unique_ptr<z5::Dataset> dataset;   ///< Open dataset
+        size_t
+            full_height = 0,        ///< Full height in pixel
+            full_width = 0,         ///< Full width in pixel
+            full_depth = 0,         ///< Full depth in pixel
+            tile_width = 0,         ///< Tile width
+            tile_height = 0,        ///< Tile height
+            tile_depth = 0;         ///< Tile depth
+        DataType fill_value = 0;    ///< Samples of chunks missing from the dataset
+    };
+
 public:
 
     /// @brief NyxusOmeZarrLoader constructor
@@ -31,24 +55,42 @@ public:
         : AbstractTileLoader<DataType>("NyxusOmeZarrLoader", numberThreads, filePath)
     {
         // Open the file
+        zarrPath_ = filePath;
         zarr_ptr_ = std::make_unique<z5::filesystem::handle::File>(filePath.c_str());
         nlohmann::json file_attributes, ds_attributes;
         z5::readAttributes(*zarr_ptr_, file_attributes);
 
-         // assume only one dataset is present
-        std::string ds_name = file_attributes["multiscales"][0]["datasets"][0]["path"].get<std::string>();
-        const auto ds_handle = z5::filesystem::handle::Dataset(*zarr_ptr_, ds_name);
-        fs::path metadata_path;
-        auto success = z5::filesystem::metadata_detail::getMetadataPath(ds_handle, metadata_path);
-        z5::filesystem::metadata_detail::readMetadata(metadata_path, ds_attributes);
-        
-        full_depth_ = ds_attributes["shape"][2].get<size_t>();
-        full_height_ = ds_attributes["shape"][3].get<size_t>();
-        full_width_ = ds_attributes["shape"][4].get<size_t>();
-        tile_depth_ = ds_attributes["chunks"][2].get<size_t>();
-        tile_height_ = ds_attributes["chunks"][3].get<size_t>();
-        tile_width_ = ds_attributes["chunks"][4].get<size_t>();
-        std::string dtype_str = ds_attributes["dtype"].get<std::string>();
+        // Datasets of the 1st multiscale are pyramid levels, the full resolution one first
+        std::string dtype_str;
+        size_t maxChunkSize = 0;
+        for (auto& ds : file_attributes["multiscales"][0]["datasets"])
+        {
+            Level lvl;
+            lvl.path = ds["path"].get<std::string>();
+            const auto ds_handle = z5::filesystem::handle::Dataset(*zarr_ptr_, lvl.path);
+            fs::path metadata_path;
+            z5::filesystem::metadata_detail::getMetadataPath(ds_handle, metadata_path);
+            z5::filesystem::metadata_detail::readMetadata(metadata_path, ds_attributes);
+
+            lvl.full_depth = ds_attributes["shape"][2].get<size_t>();
+            lvl.full_height = ds_attributes["shape"][3].get<size_t>();
+            lvl.full_width = ds_attributes["shape"][4].get<size_t>();
+            lvl.tile_depth = ds_attributes["chunks"][2].get<size_t>();
+            lvl.tile_height = ds_attributes["chunks"][3].get<size_t>();
+            lvl.tile_width = ds_attributes["chunks"][4].get<size_t>();
+            lvl.fill_value = fillValue(ds_attributes);
+            if (levels_.empty())
+            {
+                dtype_str = ds_attributes["dtype"].get<std::string>();
+                direct_ = ds_attributes.value("order", std::string("C")) == "C" && dtype_str != "<f2";
+            }
+            lvl.dataset = z5::openDataset(*zarr_ptr_, lvl.path);
+            maxChunkSize = std::max(maxChunkSize, lvl.dataset->defaultChunkSize());
+            levels_.push_back(std::move(lvl));
+        }
+        if (levels_.empty())
+            throw (std::runtime_error("Tile Loader ERROR: The file has no multiscale datasets."));
+
         if      (dtype_str == "<u1") {data_format_=1;} //uint8_t
         else if (dtype_str == "<u2") {data_format_=2;} //uint16_t
         else if (dtype_str == "<u4") {data_format_=3;} //uint32_t
@@ -61,6 +103,26 @@ public:
         else if (dtype_str == "<f4") {data_format_=9;} //float
         else if (dtype_str == "<f8") {data_format_=10;} //double
         else {data_format_=2;} //uint16_t
+
+        // Chunk decoding resources
+        switch (data_format_)
+        {
+        case 1: convert_ = convertChunk<uint8_t>; sampleSize_ = 1; break;
+        case 3: convert_ = convertChunk<uint32_t>; sampleSize_ = 4; break;
+        case 4: convert_ = convertChunk<uint64_t>; sampleSize_ = 8; break;
+        case 5: convert_ = convertChunk<int8_t>; sampleSize_ = 1; break;
+        case 6: convert_ = convertChunk<int16_t>; sampleSize_ = 2; break;
+        case 7: convert_ = convertChunk<int32_t>; sampleSize_ = 4; break;
+        case 8: convert_ = convertChunk<int64_t>; sampleSize_ = 8; break;
+        case 9: convert_ = convertChunk<float>; sampleSize_ = 4; break;
+        case 10: convert_ = convertChunk<double>; sampleSize_ = 8; break;
+        default: convert_ = convertChunk<uint16_t>; sampleSize_ = 2; break;
+        }
+        chunkBuffer_.resize(maxChunkSize * sampleSize_);
+
+        // Chunks are cached in the context opening the file, whichever thread decodes them later, e.g. a prefetching one
+        if constexpr (std::is_same<DataType, uint32_t>::value)
+            cache_ = &Nyxus::theZarrChunkCache();
     }
 
     /// @brief NyxusOmeZarrLoader destructor
@@ -79,60 +141,143 @@ public:
         size_t indexRowGlobalTile,
         size_t indexColGlobalTile,
         size_t indexLayerGlobalTile,
-        [[maybe_unused]] size_t level) override 
+        size_t level) override 
     {
-        size_t pixel_row_index = indexRowGlobalTile*tile_height_;
-        size_t pixel_col_index = indexColGlobalTile*tile_width_;
-        size_t pixel_layer_index = indexLayerGlobalTile*tile_depth_;
+        if (level >= levels_.size())
+        {
+            std::stringstream message;
+            message << "Tile Loader ERROR: no pyramid level " << level << " of " << levels_.size();
+            throw (std::runtime_error(message.str()));
+        }
+        const Level& lvl = levels_[level];
+
+        // Tiles are chunks: decode the chunk, unless it's cached, straight into the tile
+        if (direct_)
+        {
+            loadChunk(*tile, lvl, indexRowGlobalTile, indexColGlobalTile, indexLayerGlobalTile);
+            return;
+        }
+
+        // Fortran-ordered and half-float chunks are read via xtensor
+        size_t pixel_row_index = indexRowGlobalTile*lvl.tile_height;
+        size_t pixel_col_index = indexColGlobalTile*lvl.tile_width;
+        size_t pixel_layer_index = indexLayerGlobalTile*lvl.tile_depth;
 
         
         switch (data_format_)
         {
         case 1:
-            loadTile<uint8_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<uint8_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 2:
-            loadTile<uint16_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<uint16_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 3:
-            loadTile<uint32_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<uint32_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 4:
-            loadTile<uint64_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<uint64_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 5:
-            loadTile<int8_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<int8_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 6:
-            loadTile<int16_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<int16_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 7:
-            loadTile<int32_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<int32_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 8:
-            loadTile<int64_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<int64_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 9:
-            loadTile<float>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<float>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         case 10:
-            loadTile<double>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<double>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         default:
-            loadTile<uint16_t>(tile, pixel_row_index, pixel_col_index, pixel_layer_index);
+            loadTile<uint16_t>(tile, lvl, pixel_row_index, pixel_col_index, pixel_layer_index);
             break;
         }
     }
     
+    /// @brief Copies tile's chunk from the chunk cache or, if it's not cached, decodes the chunk straight into the tile and caches it
+    /// @param dest Tile buffer
+    /// @param lvl Pyramid level
+    /// @param row Tile (chunk) row index
+    /// @param col Tile (chunk) column index
+    /// @param layer Tile (chunk) layer index
+    void loadChunk(std::vector<DataType>& dest, const Level& lvl, size_t row, size_t col, size_t layer)
+    {
+        size_t tileSize = lvl.tile_height * lvl.tile_width;   // the 1st plane of the chunk
+
+        bool caching = cache_ && cache_->capacity() > 0;
+        std::string key;
+        if (caching)
+        {
+            key = zarrPath_ + "/" + lvl.path + "/" + std::to_string(layer) + "." + std::to_string(row) + "." + std::to_string(col);
+            if (auto chunk = cache_->acquire(key))
+            {
+                std::copy(chunk->begin(), chunk->end(), dest.begin());
+                return;
+            }
+        }
+
+        try
+        {
+            z5::types::ShapeType chunkId = { 0, 0, layer, row, col };
+            if (lvl.dataset->chunkExists(chunkId))
+            {
+                lvl.dataset->readChunk(chunkId, chunkBuffer_.data());
+                convert_(chunkBuffer_.data(), dest.data(), tileSize);
+            }
+            else
+                std::fill(dest.begin(), dest.begin() + tileSize, lvl.fill_value);  // missing chunks hold the fill value
+        }
+        catch (...)
+        {
+            if (caching)
+                cache_->abandon(key);
+            throw;
+        }
+
+        if (caching)
+            cache_->publish(key, std::make_shared<const std::vector<DataType>>(dest.begin(), dest.begin() + tileSize));
+    }
+
+    /// @brief Returns the dataset's fill value cast like decoded samples. Null (no fill value) and non-finite fill values give 0
+    /// @param zarray Dataset metadata
+    static DataType fillValue(const nlohmann::json& zarray)
+    {
+        auto fv = zarray.find("fill_value");
+        if (fv == zarray.end() || ! fv->is_number())
+            return 0;
+        if (fv->is_number_unsigned())
+            return (DataType)fv->get<uint64_t>();
+        if (fv->is_number_integer())
+            return (DataType)fv->get<int64_t>();
+        double v = fv->get<double>();
+        return std::isfinite(v) ? (DataType)v : (DataType)0;
+    }
+
+    /// @brief Copies and casts decoded chunk samples. A plain loop over contiguous memory the compiler vectorizes
+    /// @tparam FileType Type inside the file
     template<typename FileType>
-    void loadTile(std::shared_ptr<std::vector<DataType>> &dest, size_t pixel_row_index, size_t pixel_col_index, size_t pixel_layer_index){
-        std::vector<std::string> datasets;
-        zarr_ptr_->keys(datasets);
-        auto ds = z5::openDataset(*zarr_ptr_, datasets[0]);
+    static void convertChunk(const void* src, DataType* dest, size_t n)
+    {
+        const FileType* s = (const FileType*)src;
+        for (size_t i = 0; i < n; i++)
+            dest[i] = (DataType)s[i];
+    }
+
+    template<typename FileType>
+    void loadTile(std::shared_ptr<std::vector<DataType>> &dest, const Level& lvl, size_t pixel_row_index, size_t pixel_col_index, size_t pixel_layer_index){
+        auto ds = z5::openDataset(*zarr_ptr_, lvl.path);
         
-        size_t data_height = tile_height_, data_width = tile_width_;
-        if (pixel_row_index + data_height > full_height_) {data_height = full_height_ - pixel_row_index;}
-        if (pixel_col_index + data_width > full_width_) {data_width = full_width_ - pixel_col_index;}
+        size_t data_height = lvl.tile_height, data_width = lvl.tile_width;
+        if (pixel_row_index + data_height > lvl.full_height) {data_height = lvl.full_height - pixel_row_index;}
+        if (pixel_col_index + data_width > lvl.full_width) {data_width = lvl.full_width - pixel_col_index;}
 
         typename xt::xarray<FileType>::shape_type shape = {1,1,1,data_height,data_width };
         z5::types::ShapeType offset = { 0,0,pixel_layer_index, pixel_row_index, pixel_col_index };
@@ -143,55 +288,56 @@ public:
         
         for (size_t k=0;k<data_height;++k)
         {
-            std::copy(tmp.begin()+ k*data_width, tmp.begin()+(k+1)*data_width, dest->begin()+k*tile_width_);
+            std::copy(tmp.begin()+ k*data_width, tmp.begin()+(k+1)*data_width, dest->begin()+k*lvl.tile_width);
         }
         //*dest = std::vector<DataType> (array.begin(), array.end());
     }
 
     /// @brief Tiff file height
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Full height
-    [[nodiscard]] size_t fullHeight([[maybe_unused]] size_t level) const override { return full_height_; }
+    [[nodiscard]] size_t fullHeight(size_t level) const override { return level < levels_.size() ? levels_[level].full_height : 0; }
     /// @brief Tiff full width
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Full width
-    [[nodiscard]] size_t fullWidth([[maybe_unused]] size_t level) const override { return full_width_; }
+    [[nodiscard]] size_t fullWidth(size_t level) const override { return level < levels_.size() ? levels_[level].full_width : 0; }
     /// @brief Tiff full depth
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Full Depth
-    [[nodiscard]] size_t fullDepth([[maybe_unused]] size_t level) const override { return full_depth_; }
+    [[nodiscard]] size_t fullDepth(size_t level) const override { return level < levels_.size() ? levels_[level].full_depth : 0; }
 
     /// @brief Tiff tile width
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Tile width
-    [[nodiscard]] size_t tileWidth([[maybe_unused]] size_t level) const override { return tile_width_; }
+    [[nodiscard]] size_t tileWidth(size_t level) const override { return level < levels_.size() ? levels_[level].tile_width : 0; }
     /// @brief Tiff tile height
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Tile height
-    [[nodiscard]] size_t tileHeight([[maybe_unused]] size_t level) const override { return tile_height_; }
+    [[nodiscard]] size_t tileHeight(size_t level) const override { return level < levels_.size() ? levels_[level].tile_height : 0; }
     /// @brief Tiff tile depth
-    /// @param level Tiff level [not used]
+    /// @param level Pyramid level
     /// @return Tile depth
-    [[nodiscard]] size_t tileDepth([[maybe_unused]] size_t level) const override { return tile_depth_; }
+    [[nodiscard]] size_t tileDepth(size_t level) const override { return level < levels_.size() ? levels_[level].tile_depth : 0; }
 
     /// @brief Tiff bits per sample
     /// @return Size of a sample in bits
     [[nodiscard]] short bitsPerSample() const override { return 1; }
     /// @brief Level accessor
-    /// @return 1
-    [[nodiscard]] size_t numberPyramidLevels() const override { return 1; }
+    /// @return Number of resolution levels, the full resolution one included
+    [[nodiscard]] size_t numberPyramidLevels() const override { return levels_.size(); }
 
 private:
 
-    size_t
-        full_height_ = 0,          ///< Full height in pixel
-        full_width_ = 0,           ///< Full width in pixel
-        full_depth_ = 0,           ///< Full depth in pixel
-        tile_width_ = 0,           ///< Tile width
-        tile_height_ = 0,          ///< Tile height
-        tile_depth_ = 0;           ///< Tile depth
+    std::vector<Level> levels_;     ///< Pyramid levels, the full resolution one first
 
     short data_format_ = 0;
+    std::string zarrPath_;
     std::unique_ptr<z5::filesystem::handle::File> zarr_ptr_;
+
+    bool direct_ = true;                    ///< Chunks are decoded straight into tiles (C-ordered, not half-float)
+    void (*convert_)(const void*, DataType*, size_t) = nullptr;     ///< Converter of decoded samples
+    size_t sampleSize_ = 0;                 ///< Size of a file sample in bytes
+    std::vector<uint8_t> chunkBuffer_;      ///< Decoded chunk in the file's sample type, allocated once
+    ZarrChunkCache<DataType>* cache_ = nullptr;     ///< Chunk cache of the context, nullptr - chunks aren't cached
 };
 #endif //OMEZARR_SUPPORT
\ No newline at end of file
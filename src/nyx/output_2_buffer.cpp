@@ -25,12 +25,12 @@
 
 namespace Nyxus
 {
-	/// @brief Copies ROIs' feature values into a ResultsCache structure that will then shape them as a table
-	bool save_features_2_buffer (ResultsCache& rescache)
+	/// @brief Copies feature values of ROIs 'roi_store' into a ResultsCache structure that will then shape them as a table
+	bool save_features_2_buffer (ResultsCache& rescache, RoiStore& roi_store)
 	{
-		std::vector<int> L{ uniqueLabels.begin(), uniqueLabels.end() };
+		std::vector<int> L = roi_store.labels();
 		std::sort(L.begin(), L.end());
-		std::vector<std::tuple<std::string, AvailableFeatures>> F = theFeatureSet.getEnabledFeatures();
+		std::vector<std::tuple<std::string, AvailableFeatures>> F = theFeatureSet().getEnabledFeatures();
 
 		// We only fill in the header once.
 		// We depend on the caller to manage headerBuf contents and clear it appropriately...
@@ -69,7 +69,7 @@ namespace Nyxus
 				if (textureFeature)
 				{
 					// Polulate with angles
-					for (auto ang : theEnvironment.glcmAngles)
+					for (auto ang : theEnvironment().glcmAngles)
 					{
 						std::string col = fn + "_" + std::to_string(ang);
 						rescache.add_to_header(col);	
@@ -167,7 +167,7 @@ namespace Nyxus
 				if (fc == ZERNIKE2D)
 				{
 					// Populate with indices
-					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated; i++)
+					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated(); i++)
 					{
 						std::string col = fn + "_" + std::to_string(i);
 						rescache.add_to_header(col);
@@ -185,7 +185,7 @@ namespace Nyxus
 		// -- Values
 		for (auto l : L)
 		{
-			LR& r = roiData[l];
+			LR& r = roi_store[l];
 			rescache.inc_num_rows();	
 
 			// Tear off pure file names from segment and intensity file paths
@@ -221,7 +221,7 @@ namespace Nyxus
 				if (textureFeature)
 				{
 					// Polulate with angles
-					for (int i = 0; i < theEnvironment.glcmAngles.size(); i++)
+					for (int i = 0; i < theEnvironment().glcmAngles.size(); i++)
 						rescache.add_numeric(vv[i]);		
 					
 					// Proceed with other features
@@ -269,7 +269,7 @@ namespace Nyxus
 				// --Zernike family
 				if (fc == ZERNIKE2D)
 				{
-					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated; i++)
+					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated(); i++)
 						rescache.add_numeric(vv[i]);		
 
 					// Proceed with other features
@@ -23,6 +23,7 @@
 #include "features/glrlm.h"
 #include "features/zernike.h"
 #include "globals.h"
+#include "nyxus_context.h"
 
 namespace Nyxus
 {
@@ -34,7 +35,7 @@ namespace Nyxus
 	double auto_precision (std::stringstream& ss, double x)
 	{
 		if (std::abs(x) >= 1.0)
-			ss << std::setprecision(theEnvironment.get_floating_point_precision());
+			ss << std::setprecision(theEnvironment().get_floating_point_precision());
 		else
 			if (x == 0.0)
 				ss << std::setprecision(1);
@@ -48,24 +49,24 @@ namespace Nyxus
 					tmp4 = tmp3 + 0.5;
 				int n = int(tmp4);
 
-				ss << std::setprecision(theEnvironment.get_floating_point_precision() + n);
+				ss << std::setprecision(theEnvironment().get_floating_point_precision() + n);
 			}
 
 		return x;
 	}
 
-	// Saves the result of image scanning and feature calculation. Must be called after the reduction phase.
-	bool save_features_2_csv (std::string intFpath, std::string segFpath, std::string outputDir)
+	// Saves the result of image scanning and feature calculation of ROIs 'roi_store'. Must be called after the reduction phase.
+	bool save_features_2_csv (std::string intFpath, std::string segFpath, std::string outputDir, RoiStore& roi_store)
 	{
 		// Sort the labels
-		std::vector<int> L{ uniqueLabels.begin(), uniqueLabels.end() };
+		std::vector<int> L = roi_store.labels();
 		std::sort(L.begin(), L.end());
 
 		FILE* fp = nullptr;
 
-		static bool mustRenderHeader = true;	// This can be flipped to 'false' in 'singlecsv' scenario
+		bool& mustRenderHeader = current_context().csvHeaderPending;	// This can be flipped to 'false' in 'singlecsv' scenario
 
-		if (theEnvironment.separateCsv)
+		if (theEnvironment().separateCsv)
 		{
 			std::string fullPath = outputDir + "/_INT_" + getPureFname(intFpath) + "_SEG_" + getPureFname(segFpath) + ".csv";
 			VERBOSLVL1(std::cout << "\t--> " << fullPath << "\n";)
@@ -92,7 +93,7 @@ namespace Nyxus
 		}
 
 		// Learn what features need to be displayed
-		std::vector<std::tuple<std::string, AvailableFeatures>> F = theFeatureSet.getEnabledFeatures();
+		std::vector<std::tuple<std::string, AvailableFeatures>> F = theFeatureSet().getEnabledFeatures();
 
 		// -- Header
 		if (mustRenderHeader)
@@ -133,7 +134,7 @@ namespace Nyxus
 				if (textureFeature)
 				{
 					// Polulate with angles
-					for (auto ang : theEnvironment.glcmAngles)
+					for (auto ang : theEnvironment().glcmAngles)
 					{
 						// CSV separator
 						//if (ang != theEnvironment.rotAngles[0])
@@ -218,7 +219,7 @@ namespace Nyxus
 				if (fc == ZERNIKE2D)
 				{
 					// Populate with indices
-					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated; i++)	// i < ZernikeFeature::num_feature_values_calculated
+					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated(); i++)	// i < ZernikeFeature::num_feature_values_calculated
 						ssHead << "," << fn << "_Z" << i;						
 
 					// Proceed with other features
@@ -232,7 +233,7 @@ namespace Nyxus
 			fprintf(fp, "%s\n", ssHead.str().c_str());
 
 			// Prevent rendering the header again for another image's portion of labels
-			if (theEnvironment.separateCsv == false)
+			if (theEnvironment().separateCsv == false)
 				mustRenderHeader = false;
 		}
 
@@ -244,7 +245,7 @@ namespace Nyxus
 			// Floating point precision
 			ssVals << std::fixed;
 
-			LR& r = roiData[l];
+			LR& r = roi_store[l];
 
 			// Tear off pure file names from segment and intensity file paths
 			fs::path pseg(r.segFname), pint(r.intFname);
@@ -275,10 +276,10 @@ namespace Nyxus
 				if (textureFeature)
 				{
 					// Mock angled values if they haven't been calculated for some error reason
-					if (vv.size() < GLCMFeature::angles.size())
-						vv.resize(GLCMFeature::angles.size(), 0.0);
+					if (vv.size() < GLCMFeature::angles().size())
+						vv.resize(GLCMFeature::angles().size(), 0.0);
 					// Output the sub-values
-					for (int i = 0; i < GLCMFeature::angles.size(); i++) // theEnvironment.rotAngles.size(); i++)
+					for (int i = 0; i < GLCMFeature::angles().size(); i++) // theEnvironment.rotAngles.size(); i++)
 					{
 						#ifndef DIAGNOSE_NYXUS_OUTPUT
 							ssVals << "," << vv[i];
@@ -346,7 +347,7 @@ namespace Nyxus
 				// --Zernike feature values
 				if (fc == ZERNIKE2D)
 				{
-					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated; i++)
+					for (int i = 0; i < ZernikeFeature::num_feature_values_calculated(); i++)
 					{
 						#ifndef DIAGNOSE_NYXUS_OUTPUT
 							ssVals << "," << vv[i];
@@ -427,7 +428,7 @@ namespace Nyxus
 				continue;
 
 			std::stringstream ss;
-			LR& lr = roiData[l];
+			LR& lr = roi_store[l];
 			auto& I = lr.raw_intensities;
 			ss << outputDir << "/" << "intensities_label_" << l << ".txt";
 			fullPath = ss.str();
@@ -11,7 +11,9 @@
 #include <array>
 #include "environment.h"
 #include "globals.h"
+#include "nyxus_context.h"
 #include "grayscale_tiff.h"
+#include "parallel.h"
 #include <string>
 //#include <map>
 
@@ -32,24 +34,20 @@ namespace Nyxus
 		{
 			std::lock_guard<std::mutex> lg(glock);
 
-			auto itm = labelMutexes.find(label);
-			if (itm == labelMutexes.end())
+			auto itm = labelMutexes().find(label);
+			if (itm == labelMutexes().end())
 			{
 				//=== Create a label-specific mutex
-				itm = labelMutexes.emplace(label, std::make_shared <std::mutex>()).first;
+				itm = labelMutexes().emplace(label, std::make_shared <std::mutex>()).first;
 
 				//=== Create a label record
-				auto it = uniqueLabels.find(label);
-				if (it != uniqueLabels.end())
+				if (roiData().contains(label))
 					std::cout << "\n\tERROR\n";
 
-				// Remember this label
-				uniqueLabels.insert(label);
-
 				// Initialize the label record
 				LR lr;
-				init_label_record(lr, theSegFname, theIntFname, x, y, label, intensity);
-				roiData[label] = lr;
+				init_label_record(lr, theSegFname(), theIntFname(), x, y, label, intensity);
+				roiData()[label] = std::move (lr);
 
 				// We're done processing the very first pixel of a label, return
 				return;
@@ -71,7 +69,7 @@ namespace Nyxus
 #endif
 
 			// Update label's stats
-			LR& lr = roiData[label];
+			LR& lr = roiData()[label];
 			update_label_record(lr, x, y, label, intensity);
 		}
 	}
@@ -88,7 +86,7 @@ namespace Nyxus
 					x = i % tw;
 
 				// Collapse all the labels to one if single-ROI mde is requested
-				if (theEnvironment.singleROI)
+				if (theEnvironment().singleROI)
 					label = 1;
 
 				update_label_parallel(x, y, label, (*dataI)[i]);
@@ -179,7 +177,7 @@ namespace Nyxus
 							idxE = idxS + workPerThread;
 						if (t == num_sensemaker_threads - 1)
 							idxE = tileSize; // include the tail
-						T.push_back(std::async(std::launch::async, processPixels, idxS, idxE, &dataL, &dataI, tw));
+						T.push_back(std::async(std::launch::async, in_current_context (processPixels), idxS, idxE, &dataL, &dataI, tw));
 					}
 				}
 
@@ -190,4 +188,31 @@ namespace Nyxus
 		return true;
 	}
 
+	RoiTaskPlan plan_roi_tasks (const std::vector<int>& labels, RoiStore& roi_data, int nThr)
+	{
+		RoiTaskPlan plan;
+		plan.labels = labels;
+		plan.n_threads = std::max (nThr, 1);
+		plan.roi_data = &roi_data;
+
+		if (plan.n_threads == 1)
+		{
+			if (! labels.empty())
+				plan.ranges.push_back ({ 0, labels.size() });
+			return plan;
+		}
+
+		// Largest ROIs first so that the costliest tasks don't end up trailing
+		std::stable_sort (plan.labels.begin(), plan.labels.end(),
+			[&roi_data] (int a, int b) { return roi_data[a].aux_area > roi_data[b].aux_area; });
+
+		std::vector<size_t> costs;
+		costs.reserve (plan.labels.size());
+		for (auto lab : plan.labels)
+			costs.push_back (size_t(roi_data[lab].aux_area) + 1);
+		plan.ranges = split_by_cost (costs, plan.n_threads);
+
+		return plan;
+	}
+
 } // namespace Nyxus
@@ -4,34 +4,53 @@
 #include <thread>
 #include <future>
 #include "roi_cache.h"
+#include "thread_pool.h"
 
 namespace Nyxus
 {
 	/// @brief Defines a parallelizable function 
-	typedef void (*functype) (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	typedef void (*functype) (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+
+	/// @brief ROI-granular tasks of processing a set of ROIs: ROI labels ordered by decreasing area and ranges of them making tasks of comparable cost
+	struct RoiTaskPlan
+	{
+		std::vector<int> labels;
+		std::vector<std::pair<size_t, size_t>> ranges;
+		int n_threads = 1;
+		RoiStore* roi_data = nullptr;
+	};
+
+	/// @brief Plans processing ROIs 'labels' on 'nThr' threads. Single-threaded plans keep the ROI order
+	RoiTaskPlan plan_roi_tasks (const std::vector<int>& labels, RoiStore& roi_data, int nThr);
+
+	/// @brief Runs a ROI data processing function on the thread pool according to a plan and returns when all the ROIs are processed
+	/// @param f Global function or static class method
+	/// @param plan Tasks made by plan_roi_tasks()
+	inline void runParallel (functype f, RoiTaskPlan& plan)
+	{
+		std::vector<ThreadPool::Task> T;
+		T.reserve (plan.ranges.size());
+		for (auto& rng : plan.ranges)
+			T.push_back ([f, &plan, rng] { f (rng.first, rng.second, &plan.labels, plan.roi_data); });
+		theThreadPool().run (T, plan.n_threads);
+	}
 
 	/// @brief Runs ROI data processing functions in parallel 
 	/// @param f Global function or static class method
 	/// @param nThr Number of threads
-	/// @param workPerThread Number of ROIs per thread
+	/// @param workPerThread Unused, ROIs are distributed among threads by their size
 	/// @param datasetSize Total of ROIs
 	/// @param ptrLabels ROI labels "dictionary"
 	/// @param ptrLabelData ROI data
-	inline void runParallel (functype f, int nThr, size_t workPerThread, size_t datasetSize, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData)
+	inline void runParallel (functype f, int nThr, size_t workPerThread, size_t datasetSize, std::vector<int>* ptrLabels, RoiStore* ptrLabelData)
 	{
-		std::vector<std::future<void>> T;
-		for (int t = 0; t < nThr; t++)
-		{
-			size_t idxS = t * workPerThread,
-				idxE = idxS + workPerThread;
-			if (t == nThr - 1)
-				idxE = datasetSize; // include the tail
-			T.push_back(std::async(std::launch::async, f, idxS, idxE, ptrLabels, ptrLabelData));
-		}
+		std::vector<int> L (ptrLabels->begin(), ptrLabels->begin() + datasetSize);
+		RoiTaskPlan plan = plan_roi_tasks (L, *ptrLabelData, nThr);
+		runParallel (f, plan);
 	}
 
 	void calcRoiIntensityFeatures (LR& lr);
 	void calcRoiContour(LR& r);
-	void parallelReduceContour (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
-	void parallelReduceConvHull (size_t start, size_t end, std::vector<int>* ptrLabels, std::unordered_map <int, LR>* ptrLabelData);
+	void parallelReduceContour (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
+	void parallelReduceConvHull (size_t start, size_t end, std::vector<int>* ptrLabels, RoiStore* ptrLabelData);
 }
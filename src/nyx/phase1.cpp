@@ -1,38 +1,328 @@
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <map>
 #include <array>
+#include <future>
+#include <memory>
+#include <unordered_map>
 #ifdef WITH_PYTHON_H
 #include <pybind11/pybind11.h>
 #endif
 #include "environment.h"
 #include "globals.h"
+#include "nyxus_context.h"
 #include "helpers/timing.h"
 
 namespace Nyxus
 {
-	bool gatherRoisMetrics (const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads)
+	/// @brief Phase 1 worker scanning a contiguous range of tiles (in the row-major tile order) into a private ROI metrics table
+	/// @param intens_fpath Intensity image path
+	/// @param label_fpath Mask image path
+	/// @param tile_start Index of the 1st tile of the range
+	/// @param tile_end Index of the tile past the range
+	/// @param ptrRoiTable Thread's private label-to-metrics table
+	/// @param cache_budget Amount of RAM [bytes] the thread may spend on caching ROI pixels in the fused scan mode, or 0 if pixels shouldn't be cached
+	/// @param ptrCacheOverflow Output flag set if the thread has run out of 'cache_budget'
+	/// @return Success status
+	bool gatherRoisMetrics_tile_range (const std::string& intens_fpath, const std::string& label_fpath, size_t tile_start, size_t tile_end, RoiStore* ptrRoiTable, size_t cache_budget, bool* ptrCacheOverflow)
 	{
+		bool cachePixels = cache_budget > 0;
+		size_t cacheDemand = 0;
+		// Each worker owns an image loader as TIFF handles can't be shared across threads
+		ImageLoader imlo;
+		imlo.set_pyramid_level (theEnvironment().pyramid_level);
+		if (! imlo.open(intens_fpath, label_fpath))
+			return false;
+
+		size_t ntw = imlo.get_num_tiles_vert(),
+			th = imlo.get_tile_height(),
+			tw = imlo.get_tile_width(),
+			tileSize = imlo.get_tile_size(),
+			fullwidth = imlo.get_full_width(),
+			fullheight = imlo.get_full_height();
+
+		RoiStore& roiTable = *ptrRoiTable;
+
+		// Decode the range's tiles ahead of the pixel loop
+		std::vector<size_t> schedule;
+		for (size_t tileIdx = tile_start; tileIdx < tile_end; tileIdx++)
+			schedule.push_back (tileIdx);
+		imlo.set_prefetch_depth (theEnvironment().n_prefetch_depth);
+		imlo.start_prefetch (schedule);
+
+		// Scans a tile's pixels. Sample types are the files' native ones (see ImageLoader::native_16bit())
+		const Environment& env = theEnvironment();
+		bool singleRoi = env.singleROI,
+			filterRois = ! singleRoi && ! env.roiWhitelist.empty();
+		auto scanTile = [&] (const auto& dataI, const auto& dataL, size_t tileIdx)
+		{
+			size_t row = tileIdx / ntw,
+				col = tileIdx % ntw;
+
+			for (size_t i = 0; i < tileSize; i++)
+			{
+				// Skip non-mask pixels
+				auto label = dataL[i];
+				if (!label)
+					continue;
+
+				// Skip ROIs not selected for processing
+				if (filterRois && ! env.roi_whitelisted(label))
+					continue;
+
+				int y = row * th + i / tw,
+					x = col * tw + i % tw;
+
+				// Skip tile buffer pixels beyond the image's bounds
+				if (x >= fullwidth || y >= fullheight)
+					continue;
+
+				// Collapse all the labels to one if single-ROI mde is requested
+				if (singleRoi)
+					label = 1;
+
+				LR& r = feed_pixel_2_metrics (roiTable, label_fpath, intens_fpath, x, y, dataI[i], label, (unsigned int) tileIdx);
+
+				// Fused scan mode: cache the pixel too
+				if (cachePixels)
+				{
+					r.raw_pixels.push_back (Pixel2(x, y, dataI[i]));
+					cacheDemand += sizeof(Pixel2);
+					if (cacheDemand > cache_budget)
+					{
+						// Out of budget - give up caching
+						cachePixels = false;
+						*ptrCacheOverflow = true;
+						for (LR& r : roiTable)
+							r.clear_pixels_cache();
+					}
+				}
+			}
+		};
+
+		for (size_t tileIdx = tile_start; tileIdx < tile_end; tileIdx++)
+		{
+			if (! imlo.load_tile(tileIdx))
+			{
+				std::cerr << "Error fetching tile " << tileIdx << "\n";
+				imlo.close();
+				return false;
+			}
+
+			if (imlo.native_16bit())
+				scanTile (imlo.get_int_tile_buffer_16(), imlo.get_seg_tile_buffer_16(), tileIdx);
+			else
+				scanTile (imlo.get_int_tile_buffer(), imlo.get_seg_tile_buffer(), tileIdx);
+		}
+
+		imlo.close();
+		return true;
+	}
+
+	/// @brief Multithreaded version of phase 1. Tiles are split in contiguous ranges among 'n_threads' workers. Each worker gathers ROI metrics 
+	/// in its own table. Tables are merged into 'roi_store' in the order of tile ranges, so the result doesn't depend on thread scheduling.
+	/// Neither 'theImLoader' nor 'roiData' is used, so a file pair can be scanned while another one is being processed.
+	/// @param intens_fpath Intensity image path
+	/// @param label_fpath Mask image path
+	/// @param nTiles Number of tiles of the image pair
+	/// @param n_threads Number of pixel scanner threads
+	/// @param cache_budget Amount of RAM [bytes] the threads may spend together on caching ROI pixels (the fused scan mode), or 0 if pixels shouldn't be cached
+	/// @param roi_store Output ROI metrics
+	/// @param pixels_cached Output flag telling if all the ROI pixels are cached
+	/// @return Success status
+	static bool gatherRoisMetrics_parallel (const std::string& intens_fpath, const std::string& label_fpath, size_t nTiles, int n_threads, size_t cache_budget, RoiStore& roi_store, bool& pixels_cached)
+	{
+		if (nTiles < (size_t) n_threads)
+			n_threads = (int) nTiles;
+		size_t workPerThread = nTiles / n_threads;
+
+		VERBOSLVL1(std::cout << "\tscanning " << nTiles << " tiles with " << n_threads << " threads\n";)
+
+		// Scan
+		std::vector<RoiStore> roiTables (n_threads);
+		std::unique_ptr<bool[]> cacheOverflows (new bool[n_threads]());
+		size_t cacheBudget = cache_budget / n_threads;
+		std::vector<std::future<bool>> T;
+		for (int t = 0; t < n_threads; t++)
+		{
+			size_t idxS = t * workPerThread,
+				idxE = idxS + workPerThread;
+			if (t == n_threads - 1)
+				idxE = nTiles; // include the tail
+			T.push_back (std::async(std::launch::async, in_current_context (gatherRoisMetrics_tile_range), intens_fpath, label_fpath, idxS, idxE, &roiTables[t], cacheBudget, &cacheOverflows[t]));
+		}
+
+		bool ok = true;
+		for (auto& f : T)
+			ok = f.get() && ok;
+		if (!ok)
+		{
+			std::stringstream ss;
+			ss << "Error scanning " << intens_fpath << " and " << label_fpath;
+			#ifdef WITH_PYTHON_H
+				throw ss.str();
+			#endif	
+			std::cerr << ss.str() << "\n";
+			return false;
+		}
+
+		// Pixels are useful only if all the threads have cached them
+		pixels_cached = cache_budget > 0;
+		for (int t = 0; t < n_threads; t++)
+			pixels_cached = pixels_cached && ! cacheOverflows[t];
+
+		// Merge. Labels are visited in the order of their 1st occurrence in the row-major scan, as in the single-threaded scan
+		for (int t = 0; t < n_threads; t++)
+		{
+			auto& tbl = roiTables[t];
+			for (LR& r : tbl)
+			{
+				if (! pixels_cached)
+					r.clear_pixels_cache();
+				LR* found = roi_store.find (r.label);
+				if (! found)
+					roi_store[r.label] = std::move(r);
+				else
+					merge_label_record_2 (*found, r);
+			}
+			tbl.clear();
+		}
+
+		VERBOSLVL1(std::cout << "\t100%\t" << roi_store.size() << " ROIs" << "\n";)
+
+		return true;
+	}
+
+	/// @brief Phase 1 of a file pair scanned ahead of the one being processed in the pipelined mode. Leaves 'theImLoader' and 'roiData' alone
+	/// @param cache_budget Amount of RAM [bytes] that may be spent on caching ROI pixels (the fused scan mode)
+	/// @param roi_store Output ROI metrics
+	/// @param pixels_cached Output flag telling if all the ROI pixels are cached
+	/// @return Success status
+	bool gatherRoisMetrics_ahead (const std::string& intens_fpath, const std::string& label_fpath, size_t cache_budget, RoiStore& roi_store, bool& pixels_cached)
+	{
+		ImageLoader imlo;
+		imlo.set_pyramid_level (theEnvironment().pyramid_level);
+		if (! imlo.open(intens_fpath, label_fpath))
+		{
+			std::stringstream ss;
+			ss << "Error opening " << intens_fpath << " and " << label_fpath;
+			#ifdef WITH_PYTHON_H
+				throw ss.str();
+			#endif	
+			std::cerr << ss.str() << "\n";
+			return false;
+		}
+		size_t nTiles = imlo.get_num_tiles_hor() * imlo.get_num_tiles_vert();
+		imlo.close();
+
+		return gatherRoisMetrics_parallel (intens_fpath, label_fpath, nTiles, std::max (theEnvironment().n_pixel_scan_threads, 1), cache_budget, roi_store, pixels_cached);
+	}
+
+	/// @brief Phase 1 - scans the image pair to gather ROI metrics ('roiData'). In the fused scan mode ('cache_pixels') also caches 
+	/// ROI pixels as long as they fit in the RAM limit, sparing phase 2 the image rescan
+	/// @param cache_pixels Request to cache ROI pixels
+	/// @param pixels_cached Output flag telling if all the ROI pixels are cached
+	/// @return Success status
+	bool gatherRoisMetrics (const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, bool cache_pixels, bool& pixels_cached)
+	{
+		// Multithreaded scan?
+		if (theEnvironment().n_pixel_scan_threads > 1)
+		{
+			size_t nTiles = theImLoader().get_num_tiles_hor() * theImLoader().get_num_tiles_vert();
+			bool ok = gatherRoisMetrics_parallel (intens_fpath, label_fpath, nTiles, theEnvironment().n_pixel_scan_threads, cache_pixels ? theEnvironment().get_ram_limit() : 0, roiData(), pixels_cached);
+#ifdef WITH_PYTHON_H
+			if (PyErr_CheckSignals() != 0)
+				throw pybind11::error_already_set();
+#endif
+			return ok;
+		}
+
+		// Fused scan mode: cache pixels as long as they fit in the RAM limit
+		pixels_cached = cache_pixels;
+		size_t cacheDemand = 0, 
+			cacheBudget = theEnvironment().get_ram_limit();
+
 		int lvl = 0, // Pyramid level
 			lyr = 0; //	Layer
 
 		// Read the tiff. The image loader is put in the open state in processDataset()
-		size_t nth = theImLoader.get_num_tiles_hor(),
-			ntv = theImLoader.get_num_tiles_vert(),
-			fw = theImLoader.get_tile_width(),
-			th = theImLoader.get_tile_height(),
-			tw = theImLoader.get_tile_width(),
-			tileSize = theImLoader.get_tile_size(),
-			fullwidth = theImLoader.get_full_width(),
-			fullheight = theImLoader.get_full_height();
+		size_t nth = theImLoader().get_num_tiles_hor(),
+			ntv = theImLoader().get_num_tiles_vert(),
+			fw = theImLoader().get_tile_width(),
+			th = theImLoader().get_tile_height(),
+			tw = theImLoader().get_tile_width(),
+			tileSize = theImLoader().get_tile_size(),
+			fullwidth = theImLoader().get_full_width(),
+			fullheight = theImLoader().get_full_height();
+
+		// Decode tiles ahead of the pixel loop
+		std::vector<size_t> schedule (nth * ntv);
+		for (size_t tileIdx = 0; tileIdx < schedule.size(); tileIdx++)
+			schedule[tileIdx] = tileIdx;
+		theImLoader().start_prefetch (schedule);
+
+		// Scans a tile's pixels. Sample types are the files' native ones (see ImageLoader::native_16bit()). The context's state 
+		// is resolved once, not per pixel
+		const Environment& env = theEnvironment();
+		RoiStore& roiStore = roiData();
+		const std::string& segFname = theSegFname(),
+			& intFname = theIntFname();
+		bool singleRoi = env.singleROI,
+			filterRois = ! singleRoi && ! env.roiWhitelist.empty();
+		auto scanTile = [&] (const auto& dataI, const auto& dataL, unsigned int row, unsigned int col)
+		{
+			auto tileIdx = row * ntv + col;
+
+			for (size_t i = 0; i < tileSize; i++)
+			{
+				// Skip non-mask pixels
+				auto label = dataL[i];
+				if (!label)
+					continue;
+
+				// Skip ROIs not selected for processing
+				if (filterRois && ! env.roi_whitelisted(label))
+					continue;
+
+				int y = row * th + i / tw,
+					x = col * tw + i % tw;
+				
+				// Skip tile buffer pixels beyond the image's bounds
+				if (x >= fullwidth || y >= fullheight)
+					continue;
+
+				// Collapse all the labels to one if single-ROI mde is requested
+				if (singleRoi)
+					label = 1;
+				
+				// Update pixel's ROI metrics
+				LR& r = feed_pixel_2_metrics (roiStore, segFname, intFname, x, y, dataI[i], label, tileIdx); // Updates 'roiData'
+
+				// Fused scan mode: cache the pixel too
+				if (pixels_cached)
+				{
+					r.raw_pixels.push_back (Pixel2(x, y, dataI[i]));
+					cacheDemand += sizeof(Pixel2);
+					if (cacheDemand > cacheBudget)
+					{
+						// Out of budget - fall back to the 2-pass scan
+						VERBOSLVL1(std::cout << "\tROI pixels exceed the RAM limit, falling back to 2-pass scan\n";)
+						pixels_cached = false;
+						for (LR& r : roiStore)
+							r.clear_pixels_cache();
+					}
+				}
+			}
+		};
 
 		int cnt = 1;
 		for (unsigned int row = 0; row < nth; row++)
 			for (unsigned int col = 0; col < ntv; col++)
 			{
 				// Fetch the tile 
-				bool ok = theImLoader.load_tile(row, col);
+				bool ok = theImLoader().load_tile(row, col);
 				if (!ok)
 				{
 					std::stringstream ss;
@@ -44,33 +334,11 @@ namespace Nyxus
 					return false;
 				}
 
-				// Get ahold of tile's pixel buffer
-				auto tileIdx = row * nth + col;
-				auto dataI = theImLoader.get_int_tile_buffer(),
-					dataL = theImLoader.get_seg_tile_buffer();
-
-				// Iterate pixels
-				for (size_t i = 0; i < tileSize; i++)
-				{
-					// Skip non-mask pixels
-					auto label = dataL[i];
-					if (!label)
-						continue;
-
-					int y = row * th + i / tw,
-						x = col * tw + i % tw;
-					
-					// Skip tile buffer pixels beyond the image's bounds
-					if (x >= fullwidth || y >= fullheight)
-						continue;
-
-					// Collapse all the labels to one if single-ROI mde is requested
-					if (theEnvironment.singleROI)
-						label = 1;
-					
-					// Update pixel's ROI metrics
-					feed_pixel_2_metrics (x, y, dataI[i], label, tileIdx); // Updates 'uniqueLabels' and 'roiData'
-				}
+				// Iterate pixels of tile's buffers
+				if (theImLoader().native_16bit())
+					scanTile (theImLoader().get_int_tile_buffer_16(), theImLoader().get_seg_tile_buffer_16(), row, col);
+				else
+					scanTile (theImLoader().get_int_tile_buffer(), theImLoader().get_seg_tile_buffer(), row, col);
 
 #ifdef WITH_PYTHON_H
 				if (PyErr_CheckSignals() != 0)
@@ -79,10 +347,12 @@ namespace Nyxus
 
 				// Show stayalive progress info
 				if (cnt++ % 4 == 0)
-					std::cout << "\t" << int((row * nth + col) * 100 / float(nth * ntv) * 100) / 100. << "%\t" << uniqueLabels.size() << " ROIs" << "\n";
+					std::cout << "\t" << int((row * nth + col) * 100 / float(nth * ntv) * 100) / 100. << "%\t" << roiData().size() << " ROIs" << "\n";
 			}
 
+		VERBOSLVL2(std::cout << "\ttile prefetch stall time " << theImLoader().get_prefetch_stall_time() << " s\n";)
+
 		return true;
 	}
 
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <set>
 #include <array>
+#include <algorithm>
 #ifdef WITH_PYTHON_H
 #include <pybind11/pybind11.h>
 #endif
@@ -17,14 +19,14 @@ namespace Nyxus
 	#ifdef DUMP_ALL_ROI
 	void dump_all_roi()
 	{
-		std::string fpath = theEnvironment.output_dir + "/all_roi.txt";
+		std::string fpath = theEnvironment().output_dir + "/all_roi.txt";
 		std::cout << "Dumping all the ROIs to " << fpath << " ...\n";
 
 		std::ofstream f(fpath);
 
-		for (auto lab : uniqueLabels)
+		for (auto lab : roiData().labels())
 		{
-			auto& r = roiData[lab];
+			auto& r = roiData()[lab];
 			std::cout << "Dumping ROI " << lab << "\n";
 
 			r.aux_image_matrix.print(f);
@@ -45,7 +47,7 @@ namespace Nyxus
 				<< "NyxusPixel testData[] = {\n";
 			for (auto i=0; i<r.raw_pixels.size(); i++)
 			{
-				auto& px = r.raw_pixels[i];
+				auto px = r.raw_pixels[i];
 				f << "\t{" << px.x-r.aabb.get_xmin() << ", " << px.y- r.aabb.get_ymin() << ", " << px.inten << "}, ";
 				if (i > 0 && i % 4 == 0)
 					f << "\n";
@@ -58,7 +60,7 @@ namespace Nyxus
 			f << "pixelCloud = [ \n";
 			for (auto i = 0; i < r.raw_pixels.size(); i++)
 			{
-				auto& px = r.raw_pixels[i];
+				auto px = r.raw_pixels[i];
 				f << px.inten << "; % [" << i << "] \n";
 			}
 			f << "]; \n";
@@ -66,7 +68,7 @@ namespace Nyxus
 			f << "testData = zeros(" << r.aabb.get_height() << "," << r.aabb.get_width() << ");\n";
 			for (auto i = 0; i < r.raw_pixels.size(); i++)
 			{
-				auto& px = r.raw_pixels[i];
+				auto px = r.raw_pixels[i];
 				f << "testData(" << (px.y - r.aabb.get_ymin() + 1) << "," << (px.x - r.aabb.get_xmin() + 1) << ")=" << px.inten << "; ";	// +1 due to 1-based nature of Matlab
 				if (i > 0 && i % 4 == 0)
 					f << "\n";
@@ -88,25 +90,80 @@ namespace Nyxus
 		std::vector<int> whiteList = batch_labels;
 		std::sort (whiteList.begin(), whiteList.end());
 
+		// Only the tiles hosting the batch's ROIs need to be read. An ordered set keeps the row-major tile order, hence ROI pixels are cached in the same order as in a full-image scan
+		std::set<unsigned int> batchTiles;
+		for (auto lab : batch_labels)
+		{
+			LR& r = roiData()[lab];
+			batchTiles.insert (r.host_tiles.begin(), r.host_tiles.end());
+
+			// Cache pixels in the compact AABB-relative form, right in the ROI's span of the batch arena
+			r.raw_pixels.anchor (r.aabb);
+			void* span = r.raw_pixels.empty() ? trivialRoisArena().allocate (PixelCache::storage_size(r.aux_area, r.aabb)) : nullptr;
+			if (span)
+				r.raw_pixels.attach (span, r.aux_area);
+			else
+				r.raw_pixels.reserve (r.aux_area);
+		}
+
 		int lvl = 0,	// Pyramid level
 			lyr = 0;	//	Layer
 
 		// Read the tiffs
-		size_t nth = theImLoader.get_num_tiles_hor(),
-			ntv = theImLoader.get_num_tiles_vert(),
-			fw = theImLoader.get_tile_width(),
-			th = theImLoader.get_tile_height(),
-			tw = theImLoader.get_tile_width(),
-			tileSize = theImLoader.get_tile_size(),
-			fullwidth = theImLoader.get_full_width(),
-			fullheight = theImLoader.get_full_height();
+		size_t nth = theImLoader().get_num_tiles_hor(),
+			ntv = theImLoader().get_num_tiles_vert(),
+			fw = theImLoader().get_tile_width(),
+			th = theImLoader().get_tile_height(),
+			tw = theImLoader().get_tile_width(),
+			tileSize = theImLoader().get_tile_size(),
+			fullwidth = theImLoader().get_full_width(),
+			fullheight = theImLoader().get_full_height();
+
+		VERBOSLVL1(std::cout << "\tscanning " << batchTiles.size() << " of " << nth * ntv << " tiles\n";)
+
+		// Decode tiles ahead of the pixel loop
+		theImLoader().start_prefetch (std::vector<size_t> (batchTiles.begin(), batchTiles.end()));
+
+		// Caches a tile's pixels of the batch ROIs. Sample types are the files' native ones (see ImageLoader::native_16bit())
+		RoiStore& roiStore = roiData();
+		bool singleRoi = theEnvironment().singleROI;
+		auto scanTile = [&] (const auto& dataI, const auto& dataL, unsigned int row, unsigned int col)
+		{
+			for (unsigned long i = 0; i < tileSize; i++)
+			{
+				// Skip non-mask pixels
+				auto label = dataL[i];
+				if (! label)
+					continue;
+
+				// Skip this ROI if the label isn't in the pending set of a multi-ROI mode
+				if (! singleRoi && ! std::binary_search(whiteList.begin(), whiteList.end(), label)) //--slow-- if (std::find(PendingRoiLabels.begin(), PendingRoiLabels.end(), label) == PendingRoiLabels.end())
+					continue;
+
+				int y = row * th + i / tw,
+					x = col * tw + i % tw;
+
+				// Skip tile buffer pixels beyond the image's bounds
+				if (x >= fullwidth || y >= fullheight)
+					continue;
+
+				// Collapse all the labels to one if single-ROI mde is requested
+				if (singleRoi)
+					label = 1;
+
+				// Cache this pixel 
+				feed_pixel_2_cache (roiStore, x, y, dataI[i], label);
+			}
+		};
 
 		int cnt = 1;
-		for (unsigned int row = 0; row < nth; row++)
-			for (unsigned int col = 0; col < ntv; col++)
+		for (auto tileIdx : batchTiles)
 			{
+				unsigned int row = tileIdx / ntv, 
+					col = tileIdx % ntv;
+
 				// Fetch the tile 
-				bool ok = theImLoader.load_tile(row, col);
+				bool ok = theImLoader().load_tile(row, col);
 				if (!ok)
 				{
 					std::stringstream ss;
@@ -118,98 +175,122 @@ namespace Nyxus
 					return false;
 				}
 
-				// Get ahold of tile's pixel buffer
-				auto dataI = theImLoader.get_int_tile_buffer(),
-					dataL = theImLoader.get_seg_tile_buffer();
-
-				// Iterate pixels
-				for (unsigned long i = 0; i < tileSize; i++)
-				{
-					// Skip non-mask pixels
-					auto label = dataL[i];
-					if (! label)
-						continue;
-
-					// Skip this ROI if the label isn't in the pending set of a multi-ROI mode
-					if (! theEnvironment.singleROI && ! std::binary_search(whiteList.begin(), whiteList.end(), label)) //--slow-- if (std::find(PendingRoiLabels.begin(), PendingRoiLabels.end(), label) == PendingRoiLabels.end())
-						continue;
-
-					auto inten = dataI[i];
-					int y = row * th + i / tw,
-						x = col * tw + i % tw;
-
-					// Skip tile buffer pixels beyond the image's bounds
-					if (x >= fullwidth || y >= fullheight)
-						continue;
-
-					// Collapse all the labels to one if single-ROI mde is requested
-					if (theEnvironment.singleROI)
-						label = 1;
-
-					// Cache this pixel 
-					feed_pixel_2_cache (x, y, dataI[i], label);
-				}
+				// Iterate pixels of tile's buffers
+				if (theImLoader().native_16bit())
+					scanTile (theImLoader().get_int_tile_buffer_16(), theImLoader().get_seg_tile_buffer_16(), row, col);
+				else
+					scanTile (theImLoader().get_int_tile_buffer(), theImLoader().get_seg_tile_buffer(), row, col);
 
 				// Show stayalive progress info
 				if (cnt++ % 4 == 0)
-					VERBOSLVL1(std::cout << "\tscan trivial " << int((row * nth + col) * 100 / float(nth * ntv) * 100) / 100. << "% of image scanned \n";)
+					VERBOSLVL1(std::cout << "\tscan trivial " << int(cnt * 100 / float(batchTiles.size()) * 100) / 100. << "% of batch tiles scanned \n";)
 			}
 
+		VERBOSLVL2(std::cout << "\ttile prefetch stall time " << theImLoader().get_prefetch_stall_time() << " s\n";)
+
 		return true;
 	}
 
-	PixIntens* ImageMatrixBuffer = nullptr;
-	size_t imageMatrixBufferLen = 0;
+	/// @brief Sizes the batch arena for pixel spans of the batch's ROIs (unless their pixels are cached already) and, if features are calculated on GPU, for the batch's image matrix buffer
+	void reserveTrivialRoisArena (const std::vector<int>& Pending, bool pixels_cached)
+	{
+		size_t demand = BatchArena::ALIGNMENT;	// alignment slack of the image matrix buffer
+		for (auto lab : Pending)
+		{
+			LR& r = roiData()[lab];
+			if (! pixels_cached)
+				demand += BatchArena::aligned (PixelCache::storage_size(r.aux_area, r.aabb));
+			#ifdef USE_GPU
+			if (theEnvironment().using_gpu())
+				demand += r.aabb.get_width() * r.aabb.get_height() * sizeof(PixIntens);
+			#endif
+		}
+		trivialRoisArena().reset (demand);
+	}
 
 	void allocateTrivialRoisBuffers(const std::vector<int>& Pending)
 	{
 		// Calculate the total memory demand (in # of items) of all segments' image matrices
+		imageMatrixBufferLen() = 0;
 		for (auto lab : Pending)
 		{
-			LR& r = roiData[lab];
-			imageMatrixBufferLen += r.aabb.get_width() * r.aabb.get_height();
+			LR& r = roiData()[lab];
+			imageMatrixBufferLen() += r.aabb.get_width() * r.aabb.get_height();
 		}
 
-		ImageMatrixBuffer = new PixIntens[imageMatrixBufferLen];
+		// The consolidated image matrix buffer is only consumed by the GPU-side code
+		ImageMatrixBuffer() = nullptr;
+		#ifdef USE_GPU
+		if (theEnvironment().using_gpu())
+			ImageMatrixBuffer() = static_cast<PixIntens*> (trivialRoisArena().allocate (imageMatrixBufferLen() * sizeof(PixIntens)));
+		#endif
 
 		// Allocate image matrices and remember each ROI's image matrix offset in 'ImageMatrixBuffer'
 		size_t baseIdx = 0;
 		for (auto lab : Pending)
 		{
-			LR& r = roiData[lab];
+			LR& r = roiData()[lab];
 
 			// matrix data offset
 			r.im_buffer_offset = baseIdx;
-
-			// matrix data
 			size_t imgLen = r.aabb.get_width() * r.aabb.get_height();
-			r.aux_image_matrix.bind_to_buffer(ImageMatrixBuffer + baseIdx, ImageMatrixBuffer + baseIdx + imgLen);
-			baseIdx += imgLen;
+
+			// Pixels cached in phase 1 are yet to be made AABB-relative
+			r.raw_pixels.anchor (r.aabb);
 
 			// Calculate the image matrix
 			r.aux_image_matrix.calculate_from_pixelcloud(r.raw_pixels, r.aabb);
+
+			// matrix data
+			if (ImageMatrixBuffer())
+			{
+				const pixData& M = r.aux_image_matrix.ReadablePixels();
+				std::copy (M.begin(), M.end(), ImageMatrixBuffer() + baseIdx);
+			}
+			baseIdx += imgLen;
 		}
 	}
 
 	void freeTrivialRoisBuffers(const std::vector<int>& Pending)
 	{
-		delete ImageMatrixBuffer;
+		// Pixel spans and the image matrix buffer belong to the batch arena which is reused by the next batch
+		for (auto lab : Pending)
+		{
+			LR& r = roiData()[lab];
+			r.raw_pixels.detach();
+			r.recycle_aux_obj (IMAGE_MATRIX);
+			r.aux_image_matrix.WriteablePixels().shrink_to_fit();
+		}
+		ImageMatrixBuffer() = nullptr;
 	}
 
-	bool processTrivialRois (const std::vector<int>& trivRoiLabels, const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, size_t memory_limit)
+	/// @brief Phase 2 - calculates features of trivial ROIs in batches fitting in the RAM limit
+	/// @param pixels_cached Flag telling that pixels of all 'trivRoiLabels' have been cached in the fused phase 1 scan, so they make a single batch that doesn't need to be scanned
+	bool processTrivialRois (const std::vector<int>& trivRoiLabels, const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, size_t memory_limit, bool pixels_cached)
 	{
 		std::vector<int> Pending;
 		size_t batchDemand = 0;
 		int roiBatchNo = 1;
 
+		// Form batches by spatial locality: visit ROIs in the row-major order of their 1st host tile, so that each batch touches a compact set of tiles
+		std::vector<std::pair<unsigned int, int>> spatialOrder;	// (1st host tile, label)
+		spatialOrder.reserve (trivRoiLabels.size());
 		for (auto lab : trivRoiLabels)
 		{
-			LR& r = roiData[lab];
+			LR& r = roiData()[lab];
+			unsigned int firstTile = *std::min_element (r.host_tiles.begin(), r.host_tiles.end());
+			spatialOrder.push_back ({ firstTile, lab });
+		}
+		std::sort (spatialOrder.begin(), spatialOrder.end());
+
+		for (auto& [firstTile, lab] : spatialOrder)
+		{
+			LR& r = roiData()[lab];
 
 			size_t itemFootprint = r.get_ram_footprint_estimate();
 
 			// Sheck if we are good to accumulate this ROI in the current batch or should close the batch and reduce it
-			if (batchDemand + itemFootprint < memory_limit)
+			if (pixels_cached || batchDemand + itemFootprint < memory_limit)
 			{
 				Pending.push_back(lab);
 				batchDemand += itemFootprint;
@@ -218,13 +299,14 @@ namespace Nyxus
 			{
 				// Scan pixels of pending trivial ROIs 
 				std::sort (Pending.begin(), Pending.end());
-				VERBOSLVL1(std::cout << ">>> Scanning batch #" << roiBatchNo << " of " << Pending.size() << " pending ROIs of " << uniqueLabels.size() << " all ROIs\n";)
+				VERBOSLVL1(std::cout << ">>> Scanning batch #" << roiBatchNo << " of " << Pending.size() << " pending ROIs of " << roiData().size() << " all ROIs\n";)
 				VERBOSLVL1(
 					if (Pending.size() ==1)					
 						std::cout << ">>> (single ROI " << Pending[0] << ")\n";
 					else
 						std::cout << ">>> (ROIs " << Pending[0] << " ... " << Pending[Pending.size() - 1] << ")\n";
 					)
+				reserveTrivialRoisArena (Pending, false);
 				scanTrivialRois(Pending, intens_fpath, label_fpath, num_FL_threads);
 
 				// Allocate memory
@@ -233,12 +315,11 @@ namespace Nyxus
 
 				// Reduce them
 				VERBOSLVL1(std::cout << "\treducing ROIs\n";)
-				// reduce_trivial_rois(Pending);	
-				reduce_trivial_rois_manual(Pending);
+				reduce_trivial_rois(Pending);
 
 				// Free memory
 				VERBOSLVL1(std::cout << "\tfreeing ROI buffers\n";)
-				freeTrivialRoisBuffers (Pending);	// frees what's allocated by feed_pixel_2_cache() and allocateTrivialRoisBuffers()
+				freeTrivialRoisBuffers (Pending);	// gives back what's allocated by feed_pixel_2_cache() and allocateTrivialRoisBuffers()
 
 				// Reset the RAM footprint accumulator
 				batchDemand = 0;
@@ -266,14 +347,20 @@ namespace Nyxus
 		{
 			// Scan pixels of pending trivial ROIs 
 			std::sort (Pending.begin(), Pending.end());
-			VERBOSLVL1(std::cout << ">>> Scanning batch #" << roiBatchNo << " of " << Pending.size() << " pending ROIs of " << uniqueLabels.size() << " all ROIs\n";)
+			VERBOSLVL1(std::cout << ">>> Scanning batch #" << roiBatchNo << " of " << Pending.size() << " pending ROIs of " << roiData().size() << " all ROIs\n";)
 			VERBOSLVL1(
 				if (Pending.size() == 1)
 					std::cout << ">>> (single ROI " << Pending[0] << ")\n";
 				else
 					std::cout << ">>> (ROIs " << Pending[0] << " ... " << Pending[Pending.size() - 1] << ")\n";
 				)
-			scanTrivialRois(Pending, intens_fpath, label_fpath, num_FL_threads);
+			reserveTrivialRoisArena (Pending, pixels_cached);
+			if (pixels_cached)
+			{
+				VERBOSLVL1(std::cout << "\tusing pixels cached in phase 1\n";)
+			}
+			else
+				scanTrivialRois(Pending, intens_fpath, label_fpath, num_FL_threads);
 
 			// Allocate memory
 			VERBOSLVL1(std::cout << "\tallocating ROI buffers\n";)
@@ -286,8 +373,7 @@ namespace Nyxus
 
 			// Reduce them
 			VERBOSLVL1(std::cout << "\treducing ROIs\n";)
-			//reduce_trivial_rois(Pending);	
-			reduce_trivial_rois_manual(Pending);
+			reduce_trivial_rois(Pending);
 
 			// Output results
 			//outputRoisFeatures(Pending);
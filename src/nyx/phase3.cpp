@@ -1,123 +1,431 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <map>
-#include <array>
 #ifdef WITH_PYTHON_H
 #include <pybind11/pybind11.h>
 #endif
 #include "environment.h"
 #include "globals.h"
+#include "nyxus_context.h"
+#include "features/image_matrix_nontriv.h"
 #include "helpers/timing.h"
 
 namespace Nyxus
 {
-	/// @brief Processes so called nontrivial i.e. oversized ROIs - those exceeding certain memory limit
-	/// @param intens_fpath Intensity image path
-	/// @param label_fpath Mask image path
-	/// @param num_FL_threads Number of threads of FastLoader based TIFF tile browser
-	/// @param memory_limit RAM limit in bytes
-	/// @return Success status
-	/// 
-	bool processNontrivialRois (const std::vector<int>& nontrivRoiLabels, const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads)
+	/// @brief Splits oversized ROIs into groups of ROIs sharing host tiles directly or through other ROIs of the group, so that
+	/// groups can be swept independently. Groups are listed in the order of decreasing number of host tiles
+	static std::vector<std::vector<LR*>> group_by_host_tiles (const std::vector<int>& labels)
 	{
-		for (auto lab : nontrivRoiLabels)
+		// Union-find of ROI indices, a tile joins ROIs hosted by it to the first one seen in it
+		std::vector<size_t> parent (labels.size());
+		std::iota (parent.begin(), parent.end(), 0);
+		auto root = [&parent] (size_t i)
 		{
-			LR& r = roiData[lab];
+			while (parent[i] != i)
+				i = parent[i] = parent[parent[i]];
+			return i;
+		};
 
-			VERBOSLVL1(std::cout << "Processing oversized ROI " << lab << "\n");
+		std::unordered_map<unsigned int, size_t> tileOwner;
+		for (size_t i = 0; i < labels.size(); i++)
+			for (auto tileIdx : roiData()[labels[i]].host_tiles)
+			{
+				auto ins = tileOwner.emplace (tileIdx, i);
+				if (! ins.second)
+					parent[root(i)] = root (ins.first->second);
+			}
 
-			// Scan one label-intensity pair 
-			bool ok = theImLoader.open(intens_fpath, label_fpath);
-			if (ok == false)
+		std::unordered_map<size_t, size_t> groupOf;
+		std::vector<std::vector<LR*>> groups;
+		std::vector<size_t> cost;
+		for (size_t i = 0; i < labels.size(); i++)
+		{
+			auto ins = groupOf.emplace (root(i), groups.size());
+			if (ins.second)
 			{
-				std::cout << "Terminating\n";
-				return false;
+				groups.emplace_back();
+				cost.push_back (0);
 			}
-			
-			//=== Features permitting raster scan
+			LR& r = roiData()[labels[i]];
+			groups[ins.first->second].push_back (&r);
+			cost[ins.first->second] += r.host_tiles.size();
+		}
+
+		std::vector<size_t> order (groups.size());
+		std::iota (order.begin(), order.end(), 0);
+		std::stable_sort (order.begin(), order.end(), [&cost] (size_t a, size_t b) { return cost[a] > cost[b]; });
+		std::vector<std::vector<LR*>> sorted;
+		for (auto g : order)
+			sorted.push_back (std::move (groups[g]));
+		return sorted;
+	}
 
+	/// @brief Number of groups of oversized ROIs that can be processed concurrently. Each one is given an equal share of the RAM limit
+	/// that has to afford the resident tiles (see ResidentRoiTiles) of the widest ROI
+	static int num_group_workers (const std::vector<std::vector<LR*>>& groups)
+	{
+		size_t tw = theImLoader().get_tile_width(),
+			th = theImLoader().get_tile_height(),
+			minShare = 0;
+		for (const auto& g : groups)
+			for (const LR* r : g)
+			{
+				size_t n_across = r->aabb.get_xmax() / tw - r->aabb.get_xmin() / tw + 1;
+				minShare = std::max (minShare, ResidentRoiTiles::RAM_SHARE * 2 * n_across * tw * th * sizeof(PixIntens));
+			}
+
+		size_t n = std::min ((size_t) std::max (1, theEnvironment().n_reduce_threads), groups.size());
+		if (minShare)
+			n = std::min (n, std::max (size_t(1), theEnvironment().get_ram_limit() / minShare));
+		return (int) n;
+	}
+
+	/// @brief Extracts features of a group of oversized ROIs with the image loader and feature methods of the current context. Tiles of the
+	/// group are swept once, each pixel is routed to its ROI's pixel cloud. Then features are calculated ROI by ROI
+	static void process_roi_group (const std::vector<LR*>& group)
+	{
+		std::unordered_map<int, LR*> members;
+		for (LR* r : group)
+		{
+			members[r->label] = r;
 
 			// Initialize ROI's pixel cache
-			r.osized_pixel_cloud.init (r.label, "r_oor_pixel_cloud");
+			r->osized_pixel_cloud.init (r->label, "r_oor_pixel_cloud");
+		}
+
+		std::vector<FeatureMethod*> F;
+		for (int i = 0; i < theFeatureMgr().get_num_requested_features(); i++)
+			F.push_back (theFeatureMgr().get_feature_method(i));
+
+		//=== Features permitting raster scan
+
+		// Feature methods keep the online state of one ROI at a time, so they are fed the pixels during the sweep only if the group is 
+		// a single ROI. Otherwise each ROI's pixels are replayed to them from its pixel cloud
+		bool feedOnline = group.size() == 1;
 
-			// Iterate ROI's tiles and scan pixels
-			for (auto tileIdx : r.host_tiles)
+		ImageLoader& imlo = theImLoader();
+		size_t tileSize = imlo.get_tile_size(),
+			th = imlo.get_tile_height(),
+			tw = imlo.get_tile_width(),
+			ntw = imlo.get_num_tiles_vert(),
+			fullwidth = imlo.get_full_width(),
+			fullheight = imlo.get_full_height();
+		bool singleRoi = theEnvironment().singleROI;
+
+		// Scans pixels of a tile and routes those of the group's ROIs. Sample types are the files' native ones (see ImageLoader::native_16bit())
+		auto scanTile = [&] (const auto& dataI, const auto& dataL, size_t tileIdx)
+		{
+			size_t y0 = tileIdx / ntw * th,
+				x0 = tileIdx % ntw * tw;
+
+			// Neighbouring pixels mostly belong to the same ROI
+			int lastLabel = 0;
+			LR* r = nullptr;
+
+			for (size_t i = 0; i < tileSize; i++)
 			{
-				theImLoader.load_tile(tileIdx);
-				auto& dataI = theImLoader.get_int_tile_buffer();
-				auto& dataL = theImLoader.get_seg_tile_buffer();
-				for (unsigned long i = 0; i < theImLoader.get_tile_size(); i++)
+				int pixLabel = (int) dataL[i];
+
+				// Skip blanks
+				if (pixLabel == 0)
+					continue;
+
+				// Collapse all the labels to one if single-ROI mode is requested
+				if (singleRoi)
+					pixLabel = 1;
+
+				if (pixLabel != lastLabel)
 				{
-					auto pixLabel = dataL[i];
-
-					// Skip blanks and other ROI's pixel
-					if (pixLabel == 0 || pixLabel != r.label)
-						continue;
-
-					// Pixel intensity and global position
-					auto intens = dataI[i];
-					size_t row = tileIdx / theImLoader.get_num_tiles_hor(),
-						col = tileIdx / theImLoader.get_num_tiles_hor(),
-						th = theImLoader.get_tile_height(),
-						tw = theImLoader.get_tile_width();
-					int y = row * th + i / tw,
-						x = col * tw + i % tw;
-
-					// Feed the pixel to online features and helper objects
-					r.osized_pixel_cloud.add_pixel(Pixel2(x, y, intens));
-
-					// Manual
-					//		pixelIntensityFeatures->osized_add_online_pixel(x, y, intens);
-					//
-
-					// Automatic
-					int nrf = theFeatureMgr.get_num_requested_features();
-					for (int i = 0; i < nrf; i++)
-					{
-						auto feature = theFeatureMgr.get_feature_method(i);
-						feature->osized_add_online_pixel (x, y, intens);
-					}
+					lastLabel = pixLabel;
+					auto m = members.find (pixLabel);
+					r = m == members.end() ? nullptr : m->second;
 				}
+
+				// Skip other ROIs' pixels
+				if (r == nullptr)
+					continue;
+
+				// Pixel intensity and global position
+				auto intens = dataI[i];
+				size_t y = y0 + i / tw,
+					x = x0 + i % tw;
+
+				// Skip tile buffer pixels beyond the image's bounds
+				if (x >= fullwidth || y >= fullheight)
+					continue;
+
+				// Feed the pixel to online features and helper objects
+				r->osized_pixel_cloud.add_pixel (Pixel2(int(x), int(y), intens));
+				if (feedOnline)
+					for (auto feature : F)
+						feature->osized_add_online_pixel (x, y, intens);
 			}
+		};
+
+		// Iterate the group's tiles once and scan pixels. Tiles are decoded ahead of the pixel loop
+		std::vector<size_t> groupTiles;
+		for (LR* r : group)
+			groupTiles.insert (groupTiles.end(), r->host_tiles.begin(), r->host_tiles.end());
+		std::sort (groupTiles.begin(), groupTiles.end());
+		groupTiles.erase (std::unique (groupTiles.begin(), groupTiles.end()), groupTiles.end());
+
+		imlo.start_prefetch (groupTiles);
+		for (auto tileIdx : groupTiles)
+		{
+			imlo.load_tile (tileIdx);
+			if (imlo.native_16bit())
+				scanTile (imlo.get_int_tile_buffer_16(), imlo.get_seg_tile_buffer_16(), tileIdx);
+			else
+				scanTile (imlo.get_int_tile_buffer(), imlo.get_seg_tile_buffer(), tileIdx);
+		}
+		imlo.stop_prefetch();
+		VERBOSLVL2(std::cout << "\ttile prefetch stall time " << imlo.get_prefetch_stall_time() << " s\n";)
+
+		for (LR* r : group)
+		{
+			VERBOSLVL1(std::cout << "Processing oversized ROI " << r->label << "\n");
+
+			if (! feedOnline)
+				for (const Pixel2& p : r->osized_pixel_cloud)
+					for (auto feature : F)
+						feature->osized_add_online_pixel (p.x, p.y, p.inten);
 
 			//=== Features requiring non-raster access to pixels
-			
-			// Manual
-			//		contourFeature->osized_scan_whole_image(r, theImLoader);
-			//		convhullFeature->osized_scan_whole_image(r, theImLoader);
-			//		ellipsefitFeature->osized_scan_whole_image(r, theImLoader);
-			//		extremaFeature->osized_scan_whole_image(r, theImLoader);
-			//		eulerNumberFeature->osized_scan_whole_image(r, theImLoader);
-			//		chordsFeature->osized_scan_whole_image(r, theImLoader);
-			//		gaborFeature->osized_scan_whole_image(r, theImLoader);
-
-			// Automatic
-			int nrf = theFeatureMgr.get_num_requested_features();
-			for (int i = 0; i < nrf; i++)
-			{
-				auto feature = theFeatureMgr.get_feature_method(i);
 
+			for (auto feature : F)
+			{
 				try
 				{
-					feature->osized_scan_whole_image (r, theImLoader);
+					feature->osized_scan_whole_image (*r, imlo);
 				}
 				catch (std::exception const& e)
 				{
-					std::cout << "Error while computing feature " << feature->feature_info << " over oversized ROI " << r.label << " : " << e.what() << "\n";
+					std::cout << "Error while computing feature " << feature->feature_info << " over oversized ROI " << r->label << " : " << e.what() << "\n";
 				}
 
 				feature->cleanup_instance();
 			}
 
 			//=== Clean the ROI's cache
-			r.osized_pixel_cloud.clear();
+			r->osized_pixel_cloud.clear();
+		}
+	}
 
-			#ifdef WITH_PYTHON_H
-			// Allow heyboard interrupt.
-			if (PyErr_CheckSignals() != 0)
-                throw pybind11::error_already_set();
-			#endif
+	/// @brief Contexts of 'n_workers' workers sharing the current context's extraction. They have the same parameters and feature selection
+	/// but their own image loaders, feature method instances, and equal shares of the RAM limit. Workers enter them with enter_worker_context()
+	static std::vector<std::unique_ptr<NyxusContext>> make_worker_contexts (int n_workers)
+	{
+		std::vector<std::unique_ptr<NyxusContext>> workerCtxs;
+		for (int w = 0; w < n_workers; w++)
+		{
+			workerCtxs.emplace_back (new NyxusContext);
+			NyxusContext& ctx = *workerCtxs.back();
+			ctx.environment = theEnvironment();
+			ctx.environment.set_ram_limit (theEnvironment().get_ram_limit() / n_workers);
+			ctx.environment.n_reduce_threads = 1;
+			ctx.featureSet = theFeatureSet();
+			ctx.featureValueLayout = theFeatureValueLayout();
 		}
+		return workerCtxs;
+	}
+
+	/// @brief Prepares the context bound to the calling worker thread (see make_worker_contexts()) for processing a file pair
+	static bool enter_worker_context (const std::string& intens_fpath, const std::string& label_fpath)
+	{
+		theFeatureMgr().compile();
+		theFeatureMgr().apply_user_selection();
+		theImLoader().set_pyramid_level (theEnvironment().pyramid_level);
+		theImLoader().set_prefetch_depth (theEnvironment().n_prefetch_depth);
+		return theImLoader().open (intens_fpath, label_fpath);
+	}
+
+	/// @brief Tells if the requested features of oversized ROIs are calculated from the pixels fed online alone
+	static bool online_only_selection()
+	{
+		for (int i = 0; i < theFeatureMgr().get_num_requested_features(); i++)
+			if (! theFeatureMgr().get_feature_method(i)->osized_online_only())
+				return false;
+		return true;
+	}
+
+	/// @brief Extracts features of the whole-image ROI of the single-ROI mode, all of them calculated from the pixels fed online. Workers
+	/// feed ranges of the ROI's tiles to their own feature method instances, which are then merged into the current context's ones. Pixels
+	/// aren't cached, so the memory doesn't depend on the image's size
+	static bool process_single_roi_online (LR& r, const std::string& intens_fpath, const std::string& label_fpath)
+	{
+		VERBOSLVL1(std::cout << "Processing oversized ROI " << r.label << " online\n");
+
+		std::vector<size_t> roiTiles (r.host_tiles.begin(), r.host_tiles.end());
+		std::sort (roiTiles.begin(), roiTiles.end());
+		int n_workers = (int) std::max (size_t(1), std::min ((size_t) std::max (1, theEnvironment().n_reduce_threads), roiTiles.size()));
+		std::vector<std::unique_ptr<NyxusContext>> workerCtxs = make_worker_contexts (n_workers);
+
+		std::atomic<bool> opened (true);
+		std::vector<ThreadPool::Task> T;
+		for (int w = 0; w < n_workers; w++)
+		{
+			NyxusContext* ctx = workerCtxs[w].get();
+			size_t tileStart = roiTiles.size() * w / n_workers,
+				tileEnd = roiTiles.size() * (w + 1) / n_workers;
+			T.push_back ([&, ctx, tileStart, tileEnd]
+			{
+				ContextBinding binding (*ctx);
+				if (! enter_worker_context (intens_fpath, label_fpath))
+				{
+					opened = false;
+					return;
+				}
+
+				std::vector<FeatureMethod*> F;
+				for (int i = 0; i < theFeatureMgr().get_num_requested_features(); i++)
+					F.push_back (theFeatureMgr().get_feature_method(i));
+
+				ImageLoader& imlo = theImLoader();
+				size_t tileSize = imlo.get_tile_size(),
+					th = imlo.get_tile_height(),
+					tw = imlo.get_tile_width(),
+					ntw = imlo.get_num_tiles_vert(),
+					fullwidth = imlo.get_full_width(),
+					fullheight = imlo.get_full_height();
+
+				// Feeds the tile's non-blank pixels to the online features
+				auto scanTile = [&] (const auto& dataI, const auto& dataL, size_t tileIdx)
+				{
+					size_t y0 = tileIdx / ntw * th,
+						x0 = tileIdx % ntw * tw;
+					for (size_t i = 0; i < tileSize; i++)
+					{
+						size_t y = y0 + i / tw,
+							x = x0 + i % tw;
+						if (dataL[i] == 0 || x >= fullwidth || y >= fullheight)
+							continue;
+						for (auto feature : F)
+							feature->osized_add_online_pixel (x, y, dataI[i]);
+					}
+				};
+
+				std::vector<size_t> workerTiles (roiTiles.begin() + tileStart, roiTiles.begin() + tileEnd);
+				imlo.start_prefetch (workerTiles);
+				for (auto tileIdx : workerTiles)
+				{
+					imlo.load_tile (tileIdx);
+					if (imlo.native_16bit())
+						scanTile (imlo.get_int_tile_buffer_16(), imlo.get_seg_tile_buffer_16(), tileIdx);
+					else
+						scanTile (imlo.get_int_tile_buffer(), imlo.get_seg_tile_buffer(), tileIdx);
+				}
+				imlo.stop_prefetch();
+				imlo.close();
+			});
+		}
+		theThreadPool().run (T, n_workers);
+
+		if (! opened)
+		{
+			std::cout << "Terminating\n";
+			return false;
+		}
+
+		// Merge the workers' online states in the order of tiles and calculate the features
+		for (int i = 0; i < theFeatureMgr().get_num_requested_features(); i++)
+		{
+			auto feature = theFeatureMgr().get_feature_method(i);
+			for (auto& ctx : workerCtxs)
+				feature->osized_merge_online (*ctx->featureMgr.get_feature_method(i));
+
+			try
+			{
+				feature->osized_scan_whole_image (r, theImLoader());
+			}
+			catch (std::exception const& e)
+			{
+				std::cout << "Error while computing feature " << feature->feature_info << " over oversized ROI " << r.label << " : " << e.what() << "\n";
+			}
+
+			feature->cleanup_instance();
+		}
+
+		return true;
+	}
+
+	/// @brief Processes so called nontrivial i.e. oversized ROIs - those exceeding certain memory limit. ROIs sharing host tiles are
+	/// processed together sweeping their tiles once, independent groups of them are processed concurrently if the RAM limit allows
+	/// @param intens_fpath Intensity image path
+	/// @param label_fpath Mask image path
+	/// @param num_FL_threads Number of threads of FastLoader based TIFF tile browser
+	/// @return Success status
+	///
+	bool processNontrivialRois (const std::vector<int>& nontrivRoiLabels, const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads)
+	{
+		// Scan one label-intensity pair
+		bool ok = theImLoader().open(intens_fpath, label_fpath);
+		if (ok == false)
+		{
+			std::cout << "Terminating\n";
+			return false;
+		}
+
+		// The whole image as one ROI needn't be cached if its features can be calculated online
+		if (theEnvironment().singleROI && nontrivRoiLabels.size() == 1 && online_only_selection())
+			return process_single_roi_online (roiData()[nontrivRoiLabels[0]], intens_fpath, label_fpath);
+
+		std::vector<std::vector<LR*>> groups = group_by_host_tiles (nontrivRoiLabels);
+		int n_workers = num_group_workers (groups);
+		VERBOSLVL1(std::cout << nontrivRoiLabels.size() << " oversized ROIs in " << groups.size() << " groups of shared tiles, " << n_workers << " processed at a time\n";)
+
+		if (n_workers <= 1)
+		{
+			for (const auto& g : groups)
+			{
+				process_roi_group (g);
+
+				#ifdef WITH_PYTHON_H
+				// Allow heyboard interrupt.
+				if (PyErr_CheckSignals() != 0)
+					throw pybind11::error_already_set();
+				#endif
+			}
+			return true;
+		}
+
+		// Workers take the next unprocessed group, the biggest groups go first
+		std::vector<std::unique_ptr<NyxusContext>> workerCtxs = make_worker_contexts (n_workers);
+		std::atomic<size_t> nextGroup (0);
+		std::atomic<bool> opened (true);
+		std::vector<ThreadPool::Task> T;
+		for (auto& w : workerCtxs)
+		{
+			NyxusContext* ctx = w.get();
+			T.push_back ([&, ctx]
+			{
+				ContextBinding binding (*ctx);
+				if (! enter_worker_context (intens_fpath, label_fpath))
+				{
+					opened = false;
+					return;
+				}
+				for (size_t g = nextGroup++; g < groups.size() && opened; g = nextGroup++)
+					process_roi_group (groups[g]);
+				theImLoader().close();
+			});
+		}
+		theThreadPool().run (T, n_workers);
+
+		if (! opened)
+		{
+			std::cout << "Terminating\n";
+			return false;
+		}
+
+		#ifdef WITH_PYTHON_H
+		// Allow heyboard interrupt.
+		if (PyErr_CheckSignals() != 0)
+			throw pybind11::error_already_set();
+		#endif
 
 		return true;
 	}
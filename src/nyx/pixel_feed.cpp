@@ -11,41 +11,42 @@
 
 namespace Nyxus
 {
-	/// @brief Feeds a pixel to image measurement object to gauge the image RAM footprint without caching the pixel. Updates 'uniqueLabels' and 'roiData'.
+	/// @brief Feeds a pixel to image measurement object to gauge the image RAM footprint without caching the pixel. Updates 'roi_table', 
+	/// e.g. 'roiData' or a thread's private table. The caller resolves the table and the file names once per scan, not per pixel
+	/// @param roi_table -- label-to-metrics table
+	/// @param seg_fname -- mask image path
+	/// @param int_fname -- intensity image path
 	/// @param x -- x-coordinate of the pixel in the image
 	/// @param y -- y-coordinate of the pixel in the image
-	/// @param label -- label of pixel's segment 
 	/// @param intensity -- pixel's intensity
+	/// @param label -- label of pixel's segment 
 	/// @param tile_index -- index of pixel's tile in the image
-	void feed_pixel_2_metrics(int x, int y, PixIntens intensity, int label, unsigned int tile_index)
+	/// @return -- the ROI record the pixel has been fed to
+	LR& feed_pixel_2_metrics (RoiStore& roi_table, const std::string& seg_fname, const std::string& int_fname, int x, int y, PixIntens intensity, int label, unsigned int tile_index)
 	{
-		if (uniqueLabels.find(label) == uniqueLabels.end())
+		auto [r, isNew] = roi_table.try_emplace (label);
+		if (isNew)
 		{
-			// Remember this label
-			uniqueLabels.insert(label);
-
 			// Initialize the ROI label record
-			LR newData;
-			init_label_record_2(newData, theSegFname, theIntFname, x, y, label, intensity, tile_index);
-			roiData[label] = newData;
+			init_label_record_2 (*r, seg_fname, int_fname, x, y, label, intensity, tile_index);
 		}
 		else
 		{
 			// Update basic ROI info (info that doesn't require costly calculations)
-			LR& existingData = roiData[label];
-			update_label_record_2(existingData, x, y, label, intensity, tile_index);
+			update_label_record_2 (*r, x, y, label, intensity, tile_index);
 		}
+		return *r;
 	}
 
 	/// @brief Copies a pixel to the ROI's cache. 
+	/// @param roi_table -- label-to-metrics table holding the ROI, e.g. 'roiData'
 	/// @param x -- x-coordinate of the pixel in the image
 	/// @param y -- y-coordinate of the pixel in the image
 	/// @param label -- label of pixel's segment 
 	/// @param intensity -- pixel's intensity
-	void feed_pixel_2_cache(int x, int y, PixIntens intensity, int label)
+	void feed_pixel_2_cache (RoiStore& roi_table, int x, int y, PixIntens intensity, int label)
 	{
-		// Update basic ROI info (info that doesn't require costly calculations)
-		LR& r = roiData[label];
+		LR& r = roi_table[label];
 		r.raw_pixels.push_back(Pixel2(x, y, intensity));
 	}
 
@@ -8,6 +8,7 @@
 #include "../feature_mgr.h"
 #include "../dirs_and_files.h"  
 #include "../globals.h"
+#include "../nyxus_context.h"
 #include "../nested_feature_aggregation.h"
 
 namespace py = pybind11;
@@ -36,6 +37,7 @@ inline py::array_t<typename Sequence::value_type> as_pyarray(Sequence &&seq)
 }
 
 void initialize_environment(
+    NyxusContext& ctx,
     const std::vector<std::string> &features,
     float neighbor_distance,
     float pixels_per_micron,
@@ -44,24 +46,26 @@ void initialize_environment(
     uint32_t n_loader_threads,
     int using_gpu)
 {
-    theEnvironment.desiredFeatures = features;
-    theEnvironment.set_pixel_distance(static_cast<int>(neighbor_distance));
-    theEnvironment.set_verbosity_level (0);
-    theEnvironment.xyRes = theEnvironment.pixelSizeUm = pixels_per_micron;
-    theEnvironment.set_coarse_gray_depth(coarse_gray_depth);
-    theEnvironment.n_reduce_threads = n_reduce_threads;
-    theEnvironment.n_loader_threads = n_loader_threads;
+    ContextBinding binding (ctx);
+
+    theEnvironment().desiredFeatures = features;
+    theEnvironment().set_pixel_distance(static_cast<int>(neighbor_distance));
+    theEnvironment().set_verbosity_level (0);
+    theEnvironment().xyRes = theEnvironment().pixelSizeUm = pixels_per_micron;
+    theEnvironment().set_coarse_gray_depth(coarse_gray_depth);
+    theEnvironment().n_reduce_threads = n_reduce_threads;
+    theEnvironment().n_loader_threads = n_loader_threads;
 
     // Throws exception if invalid feature is supplied.
-    theEnvironment.process_feature_list();
-    theFeatureMgr.compile();
-    theFeatureMgr.apply_user_selection();
+    theEnvironment().process_feature_list();
+    theFeatureMgr().compile();
+    theFeatureMgr().apply_user_selection();
 
     #ifdef USE_GPU
         if(using_gpu == -1) {
-            theEnvironment.set_use_gpu(false);
+            theEnvironment().set_use_gpu(false);
         } else {
-            theEnvironment.set_gpu_device_id(using_gpu);
+            theEnvironment().set_gpu_device_id(using_gpu);
         }
     #else 
         if (using_gpu != -1) {
@@ -71,25 +75,28 @@ void initialize_environment(
 }
 
 py::tuple featurize_directory_imp (
+    NyxusContext& ctx,
     const std::string &intensity_dir,
     const std::string &labels_dir,
     const std::string &file_pattern)
 {
-    theEnvironment.intensity_dir = intensity_dir;
-    theEnvironment.labels_dir = labels_dir;
-    theEnvironment.set_file_pattern (file_pattern);
+    ContextBinding binding (ctx);
+
+    theEnvironment().intensity_dir = intensity_dir;
+    theEnvironment().labels_dir = labels_dir;
+    theEnvironment().set_file_pattern (file_pattern);
 
-    if (!theEnvironment.check_file_pattern(file_pattern))
+    if (!theEnvironment().check_file_pattern(file_pattern))
         throw std::invalid_argument("Filepattern provided is not valid.");
 
     std::vector<std::string> intensFiles, labelFiles;
     int errorCode = Nyxus::read_dataset(
         intensity_dir,
         labels_dir,
-        theEnvironment.get_file_pattern(), 
+        theEnvironment().get_file_pattern(), 
         "./",   // output directory
-        theEnvironment.intSegMapDir,
-        theEnvironment.intSegMapFile,
+        theEnvironment().intSegMapDir,
+        theEnvironment().intSegMapFile,
         true,
         intensFiles, labelFiles);
 
@@ -98,35 +105,37 @@ py::tuple featurize_directory_imp (
 
     init_feature_buffers();
 
-    theResultsCache.clear();
+    ctx.resultsCache.clear();
 
     // Process the image sdata
     int min_online_roi_size = 0;
     errorCode = processDataset(
         intensFiles,
         labelFiles,
-        theEnvironment.n_loader_threads,
-        theEnvironment.n_pixel_scan_threads,
-        theEnvironment.n_reduce_threads,
+        theEnvironment().n_loader_threads,
+        theEnvironment().n_pixel_scan_threads,
+        theEnvironment().n_reduce_threads,
         min_online_roi_size,
         false, // 'true' to save to csv
-        theEnvironment.output_dir);
+        theEnvironment().output_dir);
 
     if (errorCode)
         throw std::runtime_error("Error occurred during dataset processing.");
 
-    auto pyHeader = py::array(py::cast(theResultsCache.get_headerBuf()));
-    auto pyStrData = py::array(py::cast(theResultsCache.get_stringColBuf()));
-    auto pyNumData = as_pyarray(std::move(theResultsCache.get_calcResultBuf()));
-    auto nRows = theResultsCache.get_num_rows();
+    auto pyHeader = py::array(py::cast(ctx.resultsCache.get_headerBuf()));
+    auto pyStrData = py::array(py::cast(ctx.resultsCache.get_stringColBuf()));
+    auto pyNumData = as_pyarray(std::move(ctx.resultsCache.get_calcResultBuf()));
+    auto nRows = ctx.resultsCache.get_num_rows();
     pyStrData = pyStrData.reshape({nRows, pyStrData.size() / nRows});
     pyNumData = pyNumData.reshape({ nRows, pyNumData.size() / nRows });
 
     return py::make_tuple(pyHeader, pyStrData, pyNumData);
 }
 
-py::tuple featurize_fname_lists_imp (const py::list& int_fnames, const py::list & seg_fnames)
+py::tuple featurize_fname_lists_imp (NyxusContext& ctx, const py::list& int_fnames, const py::list & seg_fnames)
 {
+    ContextBinding binding (ctx);
+
     std::vector<std::string> intensFiles, labelFiles;
     for (auto it = int_fnames.begin(); it != int_fnames.end(); ++it)
     {
@@ -165,26 +174,26 @@ py::tuple featurize_fname_lists_imp (const py::list& int_fnames, const py::list
 
     init_feature_buffers();
 
-    theResultsCache.clear();
+    ctx.resultsCache.clear();
 
     // Process the image sdata
     int min_online_roi_size = 0;
     int errorCode = processDataset(
         intensFiles,
         labelFiles,
-        theEnvironment.n_loader_threads,
-        theEnvironment.n_pixel_scan_threads,
-        theEnvironment.n_reduce_threads,
+        theEnvironment().n_loader_threads,
+        theEnvironment().n_pixel_scan_threads,
+        theEnvironment().n_reduce_threads,
         min_online_roi_size,
         false, // 'true' to save to csv
-        theEnvironment.output_dir);
+        theEnvironment().output_dir);
     if (errorCode)
         throw std::runtime_error("Error occurred during dataset processing.");
 
-    auto pyHeader = py::array(py::cast(theResultsCache.get_headerBuf()));
-    auto pyStrData = py::array(py::cast(theResultsCache.get_stringColBuf()));
-    auto pyNumData = as_pyarray(std::move(theResultsCache.get_calcResultBuf()));
-    auto nRows = theResultsCache.get_num_rows();
+    auto pyHeader = py::array(py::cast(ctx.resultsCache.get_headerBuf()));
+    auto pyStrData = py::array(py::cast(ctx.resultsCache.get_stringColBuf()));
+    auto pyNumData = as_pyarray(std::move(ctx.resultsCache.get_calcResultBuf()));
+    auto nRows = ctx.resultsCache.get_num_rows();
     pyStrData = pyStrData.reshape({nRows, pyStrData.size() / nRows});
     pyNumData = pyNumData.reshape({ nRows, pyNumData.size() / nRows });
 
@@ -197,14 +206,14 @@ py::tuple findrelations_imp(
         std::string& child_file_pattern
     )
 {
-    if (! theEnvironment.check_file_pattern(parent_file_pattern) || ! theEnvironment.check_file_pattern(child_file_pattern))
+    if (! theEnvironment().check_file_pattern(parent_file_pattern) || ! theEnvironment().check_file_pattern(child_file_pattern))
         throw std::invalid_argument("Filepattern provided is not valid.");
 
     theResultsCache.clear();
 
     // Result -> headerBuf, stringColBuf, calcResultBuf
     ChildFeatureAggregation aggr;
-    bool mineOK = mine_segment_relations (true, label_dir, parent_file_pattern, child_file_pattern, ".", aggr, theEnvironment.get_verbosity_level());  // the 'outdir' parameter is not used if 'output2python' is true
+    bool mineOK = mine_segment_relations (true, label_dir, parent_file_pattern, child_file_pattern, ".", aggr, theEnvironment().get_verbosity_level());  // the 'outdir' parameter is not used if 'output2python' is true
 
     if (! mineOK)
         throw std::runtime_error("Error occurred during dataset processing: mine_segment_relations() returned false");
@@ -225,9 +234,9 @@ py::tuple findrelations_imp(
  * 
  * @param yes True to use gpu
  */
-void use_gpu(bool yes){
+void use_gpu(NyxusContext& ctx, bool yes){
     #ifdef USE_GPU
-        theEnvironment.set_use_gpu(yes);
+        ctx.environment.set_use_gpu(yes);
     #else 
         std::cout << "GPU is not available." << std::endl;
     #endif
@@ -240,7 +249,7 @@ void use_gpu(bool yes){
  */
 static std::vector<std::map<std::string, std::string>> get_gpu_properties() {
     #ifdef USE_GPU
-        return theEnvironment.get_gpu_properties();
+        return theEnvironment().get_gpu_properties();
     #else 
         std::vector<std::map<std::string, std::string>> empty;
         return empty;
@@ -252,6 +261,9 @@ PYBIND11_MODULE(backend, m)
 {
     m.doc() = "Nyxus";
 
+    py::class_<NyxusContext>(m, "Context", "State of a feature extraction: parameters, feature selection, ROI data, and results")
+        .def(py::init<>());
+
     m.def("initialize_environment", &initialize_environment, "Environment initialization");
     m.def("featurize_directory_imp", &featurize_directory_imp, "Calculate features of images defined by intensity and mask image collection directories");
     m.def("featurize_fname_lists_imp", &featurize_fname_lists_imp, "Calculate features of intensity-mask image pairs defined by lists of image file names");
@@ -1,4 +1,4 @@
-from .backend import initialize_environment, featurize_directory_imp, featurize_fname_lists_imp, findrelations_imp, use_gpu, gpu_available 
+from .backend import Context, initialize_environment, featurize_directory_imp, featurize_fname_lists_imp, findrelations_imp, use_gpu, gpu_available 
 import os
 import numpy as np
 import pandas as pd
@@ -81,7 +81,11 @@ class Nyxus:
             print("No gpu available.")
             using_gpu = -1
 
+        # State of this object's feature extraction, independent of other Nyxus objects'
+        self._ctx = Context()
+
         initialize_environment(
+            self._ctx,
             features,
             neighbor_distance,
             pixels_per_micron,
@@ -133,7 +137,7 @@ class Nyxus:
         if label_dir is None:
             label_dir = intensity_dir
 
-        header, string_data, numeric_data = featurize_directory_imp (intensity_dir, label_dir, file_pattern)
+        header, string_data, numeric_data = featurize_directory_imp (self._ctx, intensity_dir, label_dir, file_pattern)
 
         df = pd.concat(
             [
@@ -150,7 +154,7 @@ class Nyxus:
         return df
     
     def using_gpu(self, gpu_on: bool):
-        use_gpu(gpu_on)
+        use_gpu(self._ctx, gpu_on)
 
     def featurize (
         self,
@@ -180,7 +184,7 @@ class Nyxus:
         if mask_files is None:
             raise IOError ("The list of segment file paths is empty")
 
-        header, string_data, numeric_data = featurize_fname_lists_imp (intensity_files, mask_files)
+        header, string_data, numeric_data = featurize_fname_lists_imp (self._ctx, intensity_files, mask_files)
 
         df = pd.concat(
             [
@@ -12,282 +12,138 @@
 #include <sstream>
 #include "environment.h"
 #include "globals.h"
-#include "features/basic_morphology.h"
-#include "features/chords.h"
-#include "features/convex_hull.h"
-#include "features/ellipse_fitting.h"
-#include "features/euler_number.h"
-#include "features/circle.h"
-#include "features/extrema.h"
-#include "features/fractal_dim.h"
-#include "features/erosion.h"
-#include "features/radial_distribution.h"
-#include "features/gabor.h"
-#include "features/geodetic_len_thickness.h"
-#include "features/glcm.h"
-#include "features/glrlm.h"
-#include "features/glszm.h"
-#include "features/gldm.h"
-#include "features/hexagonality_polygonality.h"
-#include "features/ngtdm.h"
-#include "features/image_moments.h"
-#include "features/intensity.h"
-#include "features/moments.h"
 #include "features/neighbors.h"
-#include "features/caliper.h"
-#include "features/roi_radius.h"
-#include "features/zernike.h"
 #include "helpers/timing.h"
 #include "parallel.h"
 
 namespace Nyxus
 {
-	// Calculating features in parallel with automatic feature order
-	void reduce_trivial_rois (std::vector<int>& PendingRoisLabels)
+	// ROI-major flavor of reduce_trivial_rois(). A task takes a range of ROIs and calculates every requested feature method of a ROI, in the 
+	// order of their dependence, before proceeding to the next ROI so that the ROI's pixel cloud, image matrix, and contour are still in cache 
+	// when the next feature method reads them. Feature methods that need all the batch's ROIs at once (e.g. neighbors) break the batch into 
+	// stages: stage s consists of ROI-granular feature methods depending on non-granular ones of stages < s followed by non-granular feature 
+	// methods of stage s.
+	static void reduce_trivial_rois_roi_major (RoiTaskPlan& plan, const std::vector<FeatureMethod*>& F, const std::vector<std::vector<int>>& D)
 	{
-		int nrf = theFeatureMgr.get_num_requested_features();
-		for (int i = 0; i < nrf; i++)
-		{
-			auto feature = theFeatureMgr.get_feature_method(i);
-			feature->parallel_process (PendingRoisLabels, roiData, theEnvironment.n_reduce_threads);
+		//==== Stage of each feature method. 'F' is topologically ordered, so dependencies' stages are known by the time a feature method is visited
+		std::vector<int> stage (F.size(), 0);
+		int n_stages = 1;
+		for (size_t k = 0; k < F.size(); k++)
+		{
+			for (int d : D[k])
+				stage[k] = std::max (stage[k], F[d]->roi_granular() ? stage[d] : stage[d] + 1);
+			n_stages = std::max (n_stages, stage[k] + 1);
+		}
+
+		for (int s = 0; s < n_stages; s++)
+		{
+			// ROI-granular feature methods of the stage in the order of their dependence
+			std::vector<FeatureMethod*> fused;
+			for (size_t k = 0; k < F.size(); k++)
+				if (stage[k] == s && F[k]->roi_granular())
+					fused.push_back (F[k]);
+
+			std::vector<ThreadPool::Task> T;
+			if (! fused.empty())
+				for (auto& rng : plan.ranges)
+					T.push_back ([&fused, &plan, rng]
+						{
+							for (size_t i = rng.first; i < rng.second; i++)
+								for (auto fm : fused)
+									fm->parallel_process (i, i + 1, &plan.labels, plan.roi_data);
+						});
+			theThreadPool().run (T, plan.n_threads);
+
+			// Non-granular feature methods of the stage don't depend on each other
+			T.clear();
+			for (size_t k = 0; k < F.size(); k++)
+				if (stage[k] == s && ! F[k]->roi_granular())
+				{
+					FeatureMethod* fm = F[k];
+					T.push_back ([fm, &plan] { fm->parallel_process (0, plan.labels.size(), &plan.labels, plan.roi_data); });
+				}
+			theThreadPool().run (T, plan.n_threads);
 		}
 	}
 
-	// Calculating features in parallel with hard-coded feature order. This function should be called once after a file pair processing is finished.
-	void reduce_trivial_rois_manual (std::vector<int> & PendingRoisLabels)
+	// Calculating features of a batch of trivial ROIs in the order of their dependence. Feature methods are calculated concurrently, each in 
+	// ROI-granular tasks, and a feature method waits only for the ones providing the features it depends on. With option --reduceOrder=roi, 
+	// all the features of a ROI are calculated by one task instead. This function should be called for each batch of a file pair's trivial ROIs.
+	void reduce_trivial_rois (std::vector<int>& PendingRoisLabels)
 	{
-		//==== Parallel execution parameters 
-		int n_reduce_threads = theEnvironment.n_reduce_threads;		
-		size_t jobSize = PendingRoisLabels.size(),
-			workPerThread = jobSize / n_reduce_threads;
-
-		//==== Pixel intensity stats. Calculate these basic features unconditionally
-		{
-			STOPWATCH("Intensity/Intensity/Int/#FFFF00", "\t=");
-			runParallel(PixelIntensityFeatures::reduce, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Basic morphology
-		if (BasicMorphologyFeatures::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Basic/E/#4aaaea", "\t=");
-			runParallel(BasicMorphologyFeatures::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Fitting an ellipse
-		if (EllipseFittingFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Ellipticity/E/#4aaaea", "\t=");
-			runParallel(EllipseFittingFeature::reduce, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Contour-related ROI perimeter, equivalent circle diameter
-		if (ContourFeature::required(theFeatureSet) || NeighborsFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Contour/C/#4aaaea", "\t=");
-			runParallel(parallelReduceContour, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Neighbors
-		if (NeighborsFeature::required(theFeatureSet) || HexagonalityPolygonalityFeature::required(theFeatureSet) || EnclosingInscribingCircumscribingCircleFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Neighbors/Neighbors/N/#FF69B4", "\t=");
-			NeighborsFeature::manual_reduce();
-		}
-
-		//==== Convex hull related solidity, circularity
-		if (ConvexHullFeature::required(theFeatureSet))
-		{
-			// CONVEX_HULL_AREA, SOLIDITY, CIRCULARITY // depends on PERIMETER
-			STOPWATCH("Morphology/Hull/H/#4aaaea", "\t=");
-			runParallel(parallelReduceConvHull, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Extrema 
-		if (ExtremaFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Extrema/Ex/#4aaaea", "\t=");
-			runParallel(ExtremaFeature::reduce, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Euler 
-		if (EulerNumberFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Euler/Eu/#4aaaea", "\t=");
-			runParallel(EulerNumberFeature::reduce, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Feret diameters and angles
-		if (CaliperFeretFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Feret/F/#4aaaea", "\t=");
-			runParallel(CaliperFeretFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
+		//==== ROI-granular tasks, largest ROIs first, shared by all the feature methods
+		RoiTaskPlan plan = plan_roi_tasks (PendingRoisLabels, roiData(), theEnvironment().n_reduce_threads);
 
-		//==== Martin diameters
-		if (CaliperMartinFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Martin/M/#4aaaea", "\t=");
-			runParallel(CaliperMartinFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Nassenstein diameters
-		if (CaliperNassensteinFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Nassenstein/N/#4aaaea", "\t=");
-			runParallel(CaliperNassensteinFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Chords
-		if (ChordsFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/Chords/Ch/#4aaaea", "\t=");
-			runParallel(ChordsFeature::process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Hexagonality and polygonality
-		if (HexagonalityPolygonalityFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/HexPolygEncloInsCircleGeodetLenThickness/HP/#4aaaea", "\t=");
-			runParallel(HexagonalityPolygonalityFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Enclosing, inscribing, and circumscribing circle
-		if (EnclosingInscribingCircumscribingCircleFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/HexPolygEncloInsCircleGeodetLenThickness/HP/#4aaaea", "\t=");
-			runParallel(EnclosingInscribingCircumscribingCircleFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Geodetic length and thickness
-		if (GeodeticLengthThicknessFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/HexPolygEncloInsCircleGeodetLenThickness/HP/#4aaaea", "\t=");
-			runParallel(GeodeticLengthThicknessFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== ROI radius
-		if (RoiRadiusFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Morphology/RoiR/R/#4aaaea", "\t=");
-			runParallel(RoiRadiusFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Erosion pixels
-		if (ErosionPixelsFeature::required(theFeatureSet))
+		//==== Feature methods to calculate and indices of the ones each of them depends on
+		std::vector<FeatureMethod*> F;
+		std::vector<std::vector<int>> D;
+		int nrf = theFeatureMgr().get_num_requested_features();
+		for (int i = 0; i < nrf; i++)
 		{
-			STOPWATCH("Morphology/Erosion/Er/#4aaaea", "\t=");
-			runParallel(ErosionPixelsFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
+			F.push_back (theFeatureMgr().get_feature_method(i));
+			D.push_back (theFeatureMgr().get_requested_dependencies(i));
 		}
 
-		//==== Fractal dimension
-		if (FractalDimensionFeature::required(theFeatureSet))
+		// Pixel intensity stats. Calculate these basic features unconditionally
+		FeatureMethod* intensityFM = theFeatureMgr().get_provider (MEAN);
+		if (intensityFM && std::find(F.begin(), F.end(), intensityFM) == F.end())
 		{
-			STOPWATCH("Morphology/Fractal dimension/Fd/#4aaaea", "\t=");
-			runParallel(FractalDimensionFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
+			F.push_back (intensityFM);
+			D.push_back ({});
 		}
 
-		//==== GLCM aka Haralick 2D 
-		if (GLCMFeature::required(theFeatureSet))
+		if (theEnvironment().roi_major_reduce)
 		{
-			STOPWATCH("Texture/GLCM texture/GLCM/#bbbbbb", "\t=");
-			runParallel(GLCMFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
+			reduce_trivial_rois_roi_major (plan, F, D);
+			return;
 		}
 
-		//==== GLRLM
-		if (GLRLMFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Texture/GLRLM/RL/#bbbbbb", "\t=");
-			runParallel(GLRLMFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
+		//==== Task graph. Each feature method is a group of tasks calculating it for ROI ranges followed by an empty task joining them
+		std::vector<ThreadPool::Task> T;
+		std::vector<std::vector<size_t>> successors;
+		std::vector<size_t> n_prerequisites;
+		std::vector<size_t> firstTask (F.size()), 
+			joinTask (F.size());
 
-		//==== GLSZM
-		if (GLSZMFeature::required(theFeatureSet))
+		for (size_t k = 0; k < F.size(); k++)
 		{
-			STOPWATCH("Texture/GLSZM/SZ/#bbbbbb", "\t=");
-			runParallel(GLSZMFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
+			FeatureMethod* fm = F[k];
+			firstTask[k] = T.size();
+			if (fm->roi_granular())
+			{
+				for (auto& rng : plan.ranges)
+					T.push_back ([fm, &plan, rng] { fm->parallel_process (rng.first, rng.second, &plan.labels, plan.roi_data); });
+			}
+			else
+				T.push_back ([fm, &plan] { fm->parallel_process (0, plan.labels.size(), &plan.labels, plan.roi_data); });
+			joinTask[k] = T.size();
+			T.push_back (nullptr);
 		}
 
-		//==== GLDM
-		if (GLDMFeature::required(theFeatureSet))
+		successors.resize (T.size());
+		n_prerequisites.resize (T.size(), 0);
+		for (size_t k = 0; k < F.size(); k++)
 		{
-			STOPWATCH("Texture/GLDM/D/#bbbbbb", "\t=");
-			runParallel(GLDMFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
+			// A feature method is over when all its tasks are
+			for (size_t t = firstTask[k]; t < joinTask[k]; t++)
+				successors[t].push_back (joinTask[k]);
+			n_prerequisites[joinTask[k]] = joinTask[k] - firstTask[k];
 
-		//==== NGTDM
-		if (NGTDMFeature::required(theFeatureSet))
-		{
-			STOPWATCH("Texture/NGTDM/NG/#bbbbbb", "\t=");
-			runParallel(NGTDMFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Moments
-		if (ImageMomentsFeature::required(theFeatureSet))
-		{
-			#ifndef USE_GPU
-				STOPWATCH("Moments/Moments/2D moms/#FFFACD", "\t=");
-				runParallel(ImageMomentsFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-			#else
-				// Did the user opted out from using GPU?
-				if (theEnvironment.using_gpu() == false)
-				{				
-					// Route calculation via the regular CPU-multithreaded way
-					STOPWATCH("Moments/Moments/2D moms/#FFFACD", "\t=");
-					runParallel(ImageMomentsFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-				}
-				else
+			// Feature method's tasks start when the feature methods it depends on are over
+			for (int d : D[k])
+				for (size_t t = firstTask[k]; t < joinTask[k]; t++)
 				{
-					// Calculate the feature via GPU
-					STOPWATCH("GPU-Moments/GPU-Moments/2D moms/#FFFACD", "\t=");
-					ImageMomentsFeature::gpu_process_all_rois(PendingRoisLabels, roiData);
+					successors[joinTask[d]].push_back (t);
+					n_prerequisites[t]++;
 				}
-			#endif
 		}
 
-		//==== Gabor features
-		if (GaborFeature::required(theFeatureSet))
-		{
-			#ifndef USE_GPU
-
-				STOPWATCH("Gabor/Gabor/Gabor/#f58231", "\t=");
-				runParallel(GaborFeature::reduce, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-				
-			#else 
-				
-				if (theEnvironment.using_gpu() == false) {
-
-					STOPWATCH("Gabor/Gabor/Gabor/#f58231", "\t=");
-					runParallel(GaborFeature::reduce, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-
-				} else {
-
-					STOPWATCH("GPU-Gabor/GPU-Gabor/Gabor/#f58231", "\t=");
-					GaborFeature::gpu_process_all_rois(PendingRoisLabels, roiData);
-
-				}
-				
-			#endif
-		}
-
-		//==== Radial distribution / Zernike 2D 
-		if (ZernikeFeature::required(theFeatureSet))
-		{
-			STOPWATCH("RDistribution/Zernike/Rz/#00FFFF", "\t=");
-			runParallel(ZernikeFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
-
-		//==== Radial distribution / FracAtD, MeanFraq, and RadialCV
-		if (RadialDistributionFeature::required(theFeatureSet))
-		{
-			STOPWATCH("RDistribution/Rdist/Rd/#00FFFF", "\t=");
-			runParallel(RadialDistributionFeature::parallel_process_1_batch, n_reduce_threads, workPerThread, jobSize, &PendingRoisLabels, &roiData);
-		}
+		theThreadPool().run (T, successors, n_prerequisites, plan.n_threads);
 	}
 
 	void reduce_neighbors()
 	{
-		if (NeighborsFeature::required(theFeatureSet))
+		if (NeighborsFeature::required(theFeatureSet()))
 		{
 			STOPWATCH("Neighbors/Neighbors/N/#FF69B4", "\t=");
 			NeighborsFeature::manual_reduce();
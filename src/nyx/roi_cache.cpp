@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "globals.h"
 #include "roi_cache.h"
 
@@ -14,10 +15,10 @@ bool LR::nontrivial_roi (size_t memory_limit)
 size_t LR::get_ram_footprint_estimate()
 {
 	size_t sz =
-		Nyxus::AvailableFeatures::_COUNT_ * 10 * sizeof(double) + // feature values (approximately 10 each)
+		Nyxus::theFeatureValueLayout().row_width() * sizeof(StatsReal) + // feature values
 		aabb.get_width() * aabb.get_height() * sizeof(Pixel2) +	// image matrix
-		aux_area * sizeof(Pixel2) +	// raw pixels
-		(uniqueLabels.size() - 1) * sizeof(int);	// neighbors
+		aux_area * PixelCache::pixel_footprint(aabb) +	// raw pixels
+		(roiData().size() - 1) * sizeof(int);	// neighbors
 	return sz;
 }
 
@@ -62,18 +63,97 @@ bool LR::caching_permitted()
 void LR::clear_pixels_cache()
 {
 	recycle_aux_obj(RAW_PIXELS);
+	raw_pixels.shrink_to_fit();	// give the memory back
 }
 
 std::vector<StatsReal> LR::get_fvals(AvailableFeatures af)
 {
-	return fvals[af];
+	return fvals[af].to_vector();
 }
 
 void LR::initialize_fvals()
 {
-	fvals.resize(AvailableFeatures::_COUNT_);
-	for (auto& valVec : fvals)
-		valVec.push_back(0.0);
+	fvals.initialize();
 }
 
+LR& RoiStore::operator[] (int label)
+{
+	return *try_emplace(label).first;
+}
+
+LR* RoiStore::find (int label)
+{
+	size_t slot = slot_of (label);
+	return slot == NO_SLOT ? nullptr : &at_slot(slot);
+}
+
+const LR* RoiStore::find (int label) const
+{
+	size_t slot = slot_of (label);
+	return slot == NO_SLOT ? nullptr : &at_slot(slot);
+}
+
+std::pair<LR*, bool> RoiStore::try_emplace (int label)
+{
+	size_t slot = slot_of (label);
+	if (slot != NO_SLOT)
+		return { &at_slot(slot), false };
+	return { &at_slot(add_slot(label)), true };
+}
+
+size_t RoiStore::slot_of (int label) const
+{
+	if (sparse)
+	{
+		auto itm = sparseSlots.find (label);
+		return itm == sparseSlots.end() ? NO_SLOT : itm->second;
+	}
+	if (label < 0 || (size_t) label >= denseSlots.size())
+		return NO_SLOT;
+	return denseSlots[label];
+}
 
+size_t RoiStore::add_slot (int label)
+{
+	size_t slot = slotLabels.size();
+	if (slot % CHUNK_SIZE == 0)
+		chunks.emplace_back (new LR[CHUNK_SIZE]);
+	slotLabels.push_back (label);
+
+	// Switch to hashing if the dense table would be too big for this label
+	if (! sparse && (label < 0 || ((size_t) label >= MIN_DENSE_SPAN && (size_t) label >= DENSE_SPAN_FACTOR * slotLabels.size())))
+	{
+		sparse = true;
+		sparseSlots.reserve (slotLabels.size());
+		for (size_t s = 0; s < slot; s++)
+			sparseSlots[slotLabels[s]] = (uint32_t) s;
+		denseSlots.clear();
+		denseSlots.shrink_to_fit();
+	}
+
+	if (sparse)
+		sparseSlots[label] = (uint32_t) slot;
+	else
+	{
+		if ((size_t) label >= denseSlots.size())
+			denseSlots.resize (std::max((size_t) label + 1, denseSlots.size() * 2), NO_SLOT);
+		denseSlots[label] = (uint32_t) slot;
+	}
+
+	return slot;
+}
+
+void RoiStore::reserve (size_t n)
+{
+	chunks.reserve ((n + CHUNK_SIZE - 1) / CHUNK_SIZE);
+	slotLabels.reserve (n);
+}
+
+void RoiStore::clear()
+{
+	chunks.clear();
+	slotLabels.clear();
+	denseSlots.clear();
+	sparseSlots.clear();
+	sparse = false;
+}
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include "features/aabb.h"
 #include "features/image_matrix.h"
 #include "features/image_matrix_nontriv.h"
 #include "features/pixel.h"
+#include "features/pixel_cache.h"
+#include "feature_values.h"
 #include "featureset.h"
 #include "roi_cache_basic.h"
 
@@ -42,14 +46,14 @@ public:
 
 	bool roi_disabled = false;
 
-	std::vector <Pixel2> raw_pixels;
+	PixelCache raw_pixels;
 	OutOfRamPixelCloud osized_pixel_cloud;
 	unsigned int aux_area = 0;
 	PixIntens aux_min, aux_max;
 	std::vector<Pixel2> contour;	
 	std::vector<Pixel2> convHull_CH; 
 
-	std::vector<std::vector<StatsReal>> fvals;
+	FeatureValues fvals;
 	std::vector<StatsReal> get_fvals(AvailableFeatures af);
 	void initialize_fvals();
 
@@ -68,3 +72,69 @@ public:
 	void reduce_pixel_intensity_features();
 };
 
+/// @brief Label-indexed storage of ROI records. Records are laid out in fixed-size chunks in the order of labels' first appearance, 
+/// so references stay valid while new ROIs are added. Labels are mapped to slots via a dense label-indexed table, falling back to 
+/// a hash table if the label space is sparse (labels much greater than the number of ROIs) or negative.
+class RoiStore
+{
+public:
+	template <class Store, class Rec>
+	class Iterator
+	{
+	public:
+		Iterator (Store* s, size_t slot) : store(s), slot(slot) {}
+		Rec& operator* () const { return store->at_slot(slot); }
+		Rec* operator-> () const { return &store->at_slot(slot); }
+		Iterator& operator++ () { slot++; return *this; }
+		bool operator== (const Iterator& other) const { return slot == other.slot; }
+		bool operator!= (const Iterator& other) const { return slot != other.slot; }
+	private:
+		Store* store;
+		size_t slot;
+	};
+	using iterator = Iterator<RoiStore, LR>;
+	using const_iterator = Iterator<const RoiStore, const LR>;
+
+	/// @brief Returns label's record creating an empty one if the label is new
+	LR& operator[] (int label);
+
+	/// @brief Returns label's record or nullptr if the label is unknown
+	LR* find (int label);
+	const LR* find (int label) const;
+	bool contains (int label) const { return find(label) != nullptr; }
+
+	/// @brief Returns label's record creating an empty one if the label is new. The flag tells if the record is new
+	std::pair<LR*, bool> try_emplace (int label);
+
+	/// @brief Labels in the order of their first appearance
+	const std::vector<int>& labels() const { return slotLabels; }
+
+	size_t size() const { return slotLabels.size(); }
+	bool empty() const { return slotLabels.empty(); }
+	void reserve (size_t n);
+	void clear();
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, size()); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+
+	LR& at_slot (size_t slot) { return chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]; }
+	const LR& at_slot (size_t slot) const { return chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]; }
+
+private:
+	static constexpr size_t CHUNK_SIZE = 64;
+	static constexpr size_t MIN_DENSE_SPAN = 1 << 16;	// dense tables are always permitted for labels below this
+	static constexpr size_t DENSE_SPAN_FACTOR = 16;	// otherwise, the dense table may be this many times bigger than the number of ROIs
+	static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+	size_t slot_of (int label) const;
+	size_t add_slot (int label);
+
+	std::vector<std::unique_ptr<LR[]>> chunks;
+	std::vector<int> slotLabels;
+	std::vector<uint32_t> denseSlots;	// label -> slot, NO_SLOT if the label is unknown
+	std::unordered_map<int, uint32_t> sparseSlots;
+	bool sparse = false;
+};
+
@@ -16,11 +16,14 @@
 #include <vector>
 #include <map>
 #include <array>
+#include <future>
+#include <utility>
 #ifdef WITH_PYTHON_H
 #include <pybind11/pybind11.h>
 #endif
 #include "environment.h"
 #include "globals.h"
+#include "nyxus_context.h"
 #include "helpers/timing.h"
 
 // Sanity
@@ -30,47 +33,35 @@
 
 namespace Nyxus
 {
-	bool processIntSegImagePair (const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, int filepair_index, int tot_num_filepairs)
+	// Reports the dataset progress and the amount of free RAM before processing a file pair
+	static void reportFilePairProgress (const std::string& intens_fpath, const std::string& label_fpath, int filepair_index, int tot_num_filepairs)
+	{
+		// Report the amount of free RAM
+		unsigned long long freeRamAmt = getAvailPhysMemory();
+		static unsigned long long initial_freeRamAmt = 0;
+		if (initial_freeRamAmt == 0)
+			initial_freeRamAmt = freeRamAmt;
+		double memDiff = double(freeRamAmt) - double(initial_freeRamAmt);
+		VERBOSLVL1(std::cout << std::setw(15) << freeRamAmt << " bytes free (" << "consumed=" << memDiff << ") ";)
+
+			// Display (1) dataset progress info and (2) file pair info
+			int digits = 2, k = std::pow(10.f, digits);
+		float perCent = float(filepair_index * 100 * k / tot_num_filepairs) / float(k);
+		VERBOSLVL1(std::cout << "[ " << std::setw(digits + 2) << perCent << "% ]\t" << " INT: " << intens_fpath << " SEG: " << label_fpath << "\n";)
+	}
+
+	// Phases 2 and 3 of a file pair whose ROI metrics are gathered in 'roiData'. Trivial ROIs are processed in batches fitting in 'memory_limit'
+	static bool reduceIntSegImagePair (const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, bool pixelsCached, size_t memory_limit)
 	{
 		std::vector<int> trivRoiLabels, nontrivRoiLabels;
 
 		// Timing block (image scanning)
 		{
-			//______	STOPWATCH("Image scan/ImgScan/Scan/lightsteelblue", "\t=");
-
-			{ STOPWATCH("Image scan1/ImgScan1/Scan1/lightsteelblue", "\t=");
-
-				// Report the amount of free RAM
-				unsigned long long freeRamAmt = getAvailPhysMemory();
-				static unsigned long long initial_freeRamAmt = 0;
-				if (initial_freeRamAmt == 0)
-					initial_freeRamAmt = freeRamAmt;
-				double memDiff = double(freeRamAmt) - double(initial_freeRamAmt);
-				VERBOSLVL1(std::cout << std::setw(15) << freeRamAmt << " bytes free (" << "consumed=" << memDiff << ") ";)
-
-					// Display (1) dataset progress info and (2) file pair info
-					int digits = 2, k = std::pow(10.f, digits);
-				float perCent = float(filepair_index * 100 * k / tot_num_filepairs) / float(k);
-				VERBOSLVL1(std::cout << "[ " << std::setw(digits + 2) << perCent << "% ]\t" << " INT: " << intens_fpath << " SEG: " << label_fpath << "\n";)
-
-			}
-
-			{ STOPWATCH("Image scan2a/ImgScan2a/Scan2a/lightsteelblue", "\t=");
-
-			// Phase 1: gather ROI metrics
-			VERBOSLVL1(std::cout << "Gathering ROI metrics\n";)
-				gatherRoisMetrics(intens_fpath, label_fpath, num_FL_threads);	// Output - set of ROI labels, label-ROI cache mappings
-
-			}
-
 			{ STOPWATCH("Image scan2b/ImgScan2b/Scan2b/lightsteelblue", "\t=");
 
 					// Allocate each ROI's feature value buffer
-				for (auto lab : uniqueLabels)
-				{
-					LR& r = roiData[lab];
+				for (LR& r : roiData())
 					r.initialize_fvals();
-				}
 
 				// Dump ROI metrics
 				VERBOSLVL4(dump_roi_metrics(label_fpath))	// dumps to file in the output directory
@@ -80,11 +71,11 @@ namespace Nyxus
 			{ STOPWATCH("Image scan3/ImgScan3/Scan3/lightsteelblue", "\t=");
 
 				// Distribute ROIs among phases
-				for (auto lab : uniqueLabels)
+				for (LR& r : roiData())
 				{
-					LR& r = roiData[lab];
+					int lab = r.label;
 					size_t footprint = r.get_ram_footprint_estimate();
-					if (footprint >= theEnvironment.get_ram_limit())
+					if (footprint >= theEnvironment().get_ram_limit())
 					{
 						VERBOSLVL2(std::cout << ">>> Skipping non-trivial ROI " << lab << " (area=" << r.aux_area << " px, footprint=" << footprint << " b"
 							<< " w=" << r.aabb.get_width() << " h=" << r.aabb.get_height() << " sz_Pixel2=" << sizeof(Pixel2)
@@ -94,6 +85,21 @@ namespace Nyxus
 					else
 						trivRoiLabels.push_back(lab);
 				}
+
+				// Fused scan mode: ROI pixels cached in phase 1 spare phase 2 the image rescan if all the ROIs fit in a single batch. Otherwise release them
+				if (pixelsCached)
+				{
+					size_t totDemand = 0;
+					for (auto lab : trivRoiLabels)
+						totDemand += roiData()[lab].get_ram_footprint_estimate();
+					pixelsCached = nontrivRoiLabels.empty() && totDemand < memory_limit;
+					if (! pixelsCached)
+					{
+						VERBOSLVL1(std::cout << "ROIs exceed the RAM limit, falling back to 2-pass scan\n";)
+						for (LR& r : roiData())
+							r.clear_pixels_cache();
+					}
+				}
 			}
 		}
 
@@ -101,7 +107,7 @@ namespace Nyxus
 		if (trivRoiLabels.size())
 		{
 			VERBOSLVL1(std::cout << "Processing trivial ROIs\n";)
-			processTrivialRois (trivRoiLabels, intens_fpath, label_fpath, num_FL_threads, theEnvironment.get_ram_limit());
+			processTrivialRois (trivRoiLabels, intens_fpath, label_fpath, num_FL_threads, memory_limit, pixelsCached);
 		}
 
 		// Phase 3: process nontrivial (oversized) ROIs, if any
@@ -114,13 +120,30 @@ namespace Nyxus
 		return true;
 	}
 
-	int processDataset(
+	bool processIntSegImagePair (const std::string& intens_fpath, const std::string& label_fpath, int num_FL_threads, int filepair_index, int tot_num_filepairs)
+	{
+		bool pixelsCached = false;	// fused scan mode flag
+
+		{ STOPWATCH("Image scan1/ImgScan1/Scan1/lightsteelblue", "\t=");
+			reportFilePairProgress (intens_fpath, label_fpath, filepair_index, tot_num_filepairs);
+		}
+
+		{ STOPWATCH("Image scan2a/ImgScan2a/Scan2a/lightsteelblue", "\t=");
+
+		// Phase 1: gather ROI metrics
+		VERBOSLVL1(std::cout << "Gathering ROI metrics\n";)
+			gatherRoisMetrics(intens_fpath, label_fpath, num_FL_threads, true, pixelsCached);	// Output - set of ROI labels, label-ROI cache mappings, and optionally ROI pixels
+
+		}
+
+		return reduceIntSegImagePair (intens_fpath, label_fpath, num_FL_threads, pixelsCached, theEnvironment().get_ram_limit());
+	}
+
+	// Processes file pairs one after another
+	static int processFilePairs (
 		const std::vector<std::string>& intensFiles,
 		const std::vector<std::string>& labelFiles,
 		int numFastloaderThreads,
-		int numSensemakerThreads,
-		int numReduceThreads,
-		int min_online_roi_size,
 		bool save2csv,
 		const std::string& csvOutputDir)
 	{
@@ -137,11 +160,14 @@ namespace Nyxus
 
 			// Cache the file names to be picked up by labels to know their file origin
 			fs::path p_int(ifp), p_seg(lfp);
-			theSegFname = p_seg.string(); 
-			theIntFname = p_int.string(); 
+			theSegFname() = p_seg.string(); 
+			theIntFname() = p_int.string(); 
 
 			// Scan one label-intensity pair 
-			ok = theImLoader.open (theIntFname, theSegFname);
+			theImLoader().set_pyramid_level (theEnvironment().pyramid_level);
+			theImLoader().set_prefetch_depth (theEnvironment().n_prefetch_depth);
+			theImLoader().set_loader_threads (numFastloaderThreads);
+			ok = theImLoader().open (theIntFname(), theSegFname());
 			if (ok == false)
 			{
 				std::cout << "Terminating\n";
@@ -158,16 +184,115 @@ namespace Nyxus
 
 			// Save the result for this intensity-label file pair
 			if (save2csv)
-				ok = save_features_2_csv (ifp, lfp, csvOutputDir);
+				ok = save_features_2_csv (ifp, lfp, csvOutputDir, roiData());
 			else
-				ok = save_features_2_buffer(theResultsCache);
+				ok = save_features_2_buffer (current_context().resultsCache, roiData());
 			if (ok == false)
 			{
 				std::cout << "save_features_2_csv() returned an error code" << std::endl;
 				return 2;
 			}
 
-			theImLoader.close();
+			theImLoader().close();
+			theZarrChunkCache().clear();
+
+			#ifdef WITH_PYTHON_H
+			// Allow heyboard interrupt.
+			if (PyErr_CheckSignals() != 0)
+                throw pybind11::error_already_set();
+			#endif
+		}
+
+		return 0;
+	}
+
+	// Pipelined flavor of processFilePairs(). While a file pair is being processed, the next one's ROI metrics are gathered (phase 1) 
+	// and the previous one's results are saved by background threads. Phase 1 caching ROI pixels of the next file pair and phase 2 
+	// processing trivial ROIs of the current one split the RAM limit in halves.
+	static int processFilePairsPipelined (
+		const std::vector<std::string>& intensFiles,
+		const std::vector<std::string>& labelFiles,
+		int numFastloaderThreads,
+		bool save2csv,
+		const std::string& csvOutputDir)
+	{
+		size_t stageRamLimit = theEnvironment().get_ram_limit() / 2;
+
+		// ROI metrics of the file pair scanned ahead
+		RoiStore aheadRois;
+		bool aheadPixelsCached = false;
+		auto scanAhead = [&] (int i)
+		{
+			return std::async (std::launch::async, in_current_context ([&, i] { return gatherRoisMetrics_ahead (intensFiles[i], labelFiles[i], stageRamLimit, aheadRois, aheadPixelsCached); }));
+		};
+		std::future<bool> ahead = scanAhead (0);
+
+		// Results of the file pair being saved
+		RoiStore savedRois;
+		std::future<bool> saving;
+
+		auto nf = intensFiles.size();
+		for (int i = 0; i < nf; i++)
+		{
+			auto& ifp = intensFiles[i],
+				& lfp = labelFiles[i];
+
+			{ STOPWATCH("Image scan1/ImgScan1/Scan1/lightsteelblue", "\t=");
+				reportFilePairProgress (ifp, lfp, i, nf);
+			}
+
+			// Take over the file pair's ROI metrics and have the next file pair scanned meanwhile
+			{ STOPWATCH("Image scan2a/ImgScan2a/Scan2a/lightsteelblue", "\t=");
+				if (! ahead.get())
+				{
+					std::cout << "Terminating\n";
+					return 1;
+				}
+			}
+			clear_feature_buffers();
+			std::swap (roiData(), aheadRois);
+			bool pixelsCached = aheadPixelsCached;
+			if (i + 1 < nf)
+				ahead = scanAhead (i + 1);
+
+			// Cache the file names to be picked up by labels to know their file origin
+			fs::path p_int(ifp), p_seg(lfp);
+			theSegFname() = p_seg.string(); 
+			theIntFname() = p_int.string(); 
+
+			// Phases 2 and 3 rescan the image pair
+			theImLoader().set_pyramid_level (theEnvironment().pyramid_level);
+			theImLoader().set_prefetch_depth (theEnvironment().n_prefetch_depth);
+			theImLoader().set_loader_threads (numFastloaderThreads);
+			if (! theImLoader().open (theIntFname(), theSegFname()))
+			{
+				std::cout << "Terminating\n";
+				return 1;
+			}
+
+			if (! reduceIntSegImagePair (ifp, lfp, numFastloaderThreads, pixelsCached, stageRamLimit))
+			{
+				std::cout << "reduceIntSegImagePair() returned an error code while processing file pair " << ifp << " and " << lfp << std::endl;
+				return 1;
+			}
+
+			// OME-Zarr chunks aren't cleared as they may be the next file pair's being scanned
+			theImLoader().close();
+
+			// Save the result for this intensity-label file pair once the previous one's is saved
+			if (saving.valid() && ! saving.get())
+			{
+				std::cout << "save_features_2_csv() returned an error code" << std::endl;
+				return 2;
+			}
+			std::swap (roiData(), savedRois);
+			saving = std::async (std::launch::async, in_current_context ([&, i]
+				{
+					if (save2csv)
+						return save_features_2_csv (intensFiles[i], labelFiles[i], csvOutputDir, savedRois);
+					else
+						return save_features_2_buffer (current_context().resultsCache, savedRois);
+				}));
 
 			#ifdef WITH_PYTHON_H
 			// Allow heyboard interrupt.
@@ -176,10 +301,48 @@ namespace Nyxus
 			#endif
 		}
 
+		if (saving.valid() && ! saving.get())
+		{
+			std::cout << "save_features_2_csv() returned an error code" << std::endl;
+			return 2;
+		}
+
+		return 0;
+	}
+
+	int processDataset(
+		const std::vector<std::string>& intensFiles,
+		const std::vector<std::string>& labelFiles,
+		int numFastloaderThreads,
+		int numSensemakerThreads,
+		int numReduceThreads,
+		int min_online_roi_size,
+		bool save2csv,
+		const std::string& csvOutputDir)
+	{
+		// Lay out ROI feature value rows: user-selected features in the output order followed by the other features calculated along with them
+		std::vector<AvailableFeatures> F;
+		for (auto& enabdF : theFeatureSet().getEnabledFeatures())
+			F.push_back (std::get<1>(enabdF));
+		F.push_back (MEAN);	// pixel intensity features are calculated unconditionally
+		theFeatureValueLayout().build (theFeatureMgr().get_calculated_features(F));
+
+		// OME-Zarr chunks are cached across phases within a quarter of the RAM limit
+		theZarrChunkCache().set_capacity (theEnvironment().get_ram_limit() / 4);
+
+		int errorCode = theEnvironment().pipelined && intensFiles.size() > 1 ?
+			processFilePairsPipelined (intensFiles, labelFiles, numFastloaderThreads, save2csv, csvOutputDir) :
+			processFilePairs (intensFiles, labelFiles, numFastloaderThreads, save2csv, csvOutputDir);
+		if (errorCode)
+			return errorCode;
+
+		// Give back the memory of trivial ROI batches
+		trivialRoisArena().release();
+
 #ifdef CHECKTIMING
 		// Detailed timing
 		VERBOSLVL1(Stopwatch::print_stats();)
-		VERBOSLVL1(Stopwatch::save_stats(theEnvironment.output_dir + "/nyxus_timing.csv");)
+		VERBOSLVL1(Stopwatch::save_stats(theEnvironment().output_dir + "/nyxus_timing.csv");)
 #endif
 
 		return 0; // success
@@ -188,7 +351,7 @@ namespace Nyxus
 	void dump_roi_metrics(const std::string & label_fpath)
 	{
 		fs::path pseg (label_fpath);
-		std::string fpath = theEnvironment.output_dir + "/roi_metrics_" + pseg.stem().string() + ".csv";
+		std::string fpath = theEnvironment().output_dir + "/roi_metrics_" + pseg.stem().string() + ".csv";
 		std::cout << "Dumping ROI metrics to " << fpath << " ...\n";
 
 		std::ofstream f (fpath);
@@ -197,14 +360,14 @@ namespace Nyxus
 		f << "label, area, minx, miny, maxx, maxy, width, height, min_intens, max_intens, size_bytes, size_class, host_tiles \n";
 
 		// sort labels
-		std::vector<int>  sortedLabs { uniqueLabels.begin(), uniqueLabels.end() };
+		std::vector<int> sortedLabs = roiData().labels();
 		std::sort(sortedLabs.begin(), sortedLabs.end());
 		// body
 		for (auto lab : sortedLabs)
 		{
-			LR& r = roiData[lab];
+			LR& r = roiData()[lab];
 			auto szb = r.get_ram_footprint_estimate();
-			std::string ovsz = szb < theEnvironment.get_ram_limit() ? "T" : "OVERSIZE";
+			std::string ovsz = szb < theEnvironment().get_ram_limit() ? "T" : "OVERSIZE";
 			f << lab << ", "
 				<< r.aux_area << ", "
 				<< r.aabb.get_xmin() << ", "
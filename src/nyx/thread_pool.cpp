@@ -0,0 +1,253 @@
+#include <algorithm>
+#include "thread_pool.h"
+
+namespace Nyxus
+{
+	// Set in threads executing tasks of a batch
+	static thread_local bool inPoolTask = false;
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lk (mux);
+			stopping = true;
+		}
+		startCond.notify_all();
+		for (auto& w : workers)
+			w.join();
+	}
+
+	void ThreadPool::grow (size_t n_workers)
+	{
+		while (queues.size() < n_workers + 1)
+			queues.push_back (std::make_unique<TaskQueue>());
+		while (workers.size() < n_workers)
+			workers.emplace_back (&ThreadPool::worker_loop, this, workers.size());
+	}
+
+	void ThreadPool::run (std::vector<Task>& tasks, int n_threads)
+	{
+		run (tasks, {}, {}, n_threads);
+	}
+
+	void ThreadPool::run (std::vector<Task>& tasks, const std::vector<std::vector<size_t>>& succ, const std::vector<size_t>& n_prerequisites, int n_threads)
+	{
+		if (tasks.empty())
+			return;
+
+		size_t n = std::min ((size_t) std::max (n_threads, 1), tasks.size());
+
+		// Nested batches and batches not worth a thread hand-off are executed right here
+		if (n == 1 || inPoolTask)
+		{
+			run_serially (tasks, succ, n_prerequisites);
+			return;
+		}
+
+		std::lock_guard<std::mutex> runLock (runMux);
+		grow (n - 1);
+
+		// Deal the tasks that are ready
+		n_waiting.reset (new std::atomic<size_t> [tasks.size()]);
+		size_t n_ready = 0;
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			n_waiting[i] = n_prerequisites.empty() ? 0 : n_prerequisites[i];
+			if (n_waiting[i] == 0)
+				queues[n_ready++ % n]->items.push_back (i);
+		}
+		n_queued = n_ready;
+		n_unfinished = tasks.size();
+
+		{
+			std::lock_guard<std::mutex> lk (mux);
+			batch = &tasks;
+			successors = succ.empty() ? nullptr : &succ;
+			n_participants = n;
+			n_busy_workers = n - 1;
+			error = nullptr;
+			generation++;
+		}
+		startCond.notify_all();
+
+		participate (n - 1);
+
+		// Barrier
+		{
+			std::unique_lock<std::mutex> lk (mux);
+			doneCond.wait (lk, [this] { return n_busy_workers == 0; });
+			batch = nullptr;
+			successors = nullptr;
+		}
+
+		if (error)
+			std::rethrow_exception (error);
+	}
+
+	void ThreadPool::run_serially (std::vector<Task>& tasks, const std::vector<std::vector<size_t>>& succ, const std::vector<size_t>& n_prerequisites)
+	{
+		std::vector<size_t> waiting (tasks.size(), 0);
+		std::deque<size_t> ready;
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			if (! n_prerequisites.empty())
+				waiting[i] = n_prerequisites[i];
+			if (waiting[i] == 0)
+				ready.push_back (i);
+		}
+
+		while (! ready.empty())
+		{
+			size_t t = ready.front();
+			ready.pop_front();
+			if (tasks[t])
+				tasks[t]();
+			if (! succ.empty())
+				for (auto s : succ[t])
+					if (--waiting[s] == 0)
+						ready.push_back (s);
+		}
+	}
+
+	void ThreadPool::worker_loop (size_t idx)
+	{
+		if (workerInit)
+			workerInit();
+
+		size_t seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lk (mux);
+				startCond.wait (lk, [&] { return stopping || (generation != seen && idx + 1 < n_participants); });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+
+			participate (idx);
+
+			{
+				std::lock_guard<std::mutex> lk (mux);
+				if (--n_busy_workers == 0)
+					doneCond.notify_all();
+			}
+		}
+	}
+
+	void ThreadPool::participate (size_t idx)
+	{
+		inPoolTask = true;
+		for (;;)
+		{
+			size_t t;
+			if (next_task (idx, t))
+			{
+				try
+				{
+					if ((*batch)[t])
+						(*batch)[t]();
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lk (errorMux);
+					if (! error)
+						error = std::current_exception();
+				}
+				finish_task (idx, t);
+				continue;
+			}
+
+			// Nothing to take: either the batch is over or the remaining tasks wait for the ones being executed by other threads
+			std::unique_lock<std::mutex> lk (mux);
+			readyCond.wait (lk, [this] { return n_unfinished == 0 || n_queued > 0; });
+			if (n_unfinished == 0)
+				break;
+		}
+		inPoolTask = false;
+	}
+
+	void ThreadPool::finish_task (size_t idx, size_t task)
+	{
+		bool released = false;
+		if (successors)
+			for (auto s : (*successors)[task])
+				if (--n_waiting[s] == 0)
+				{
+					n_queued++;	// before the task is visible to the others
+					TaskQueue& q = *queues[idx];
+					std::lock_guard<std::mutex> lk (q.mux);
+					q.items.push_back (s);
+					released = true;
+				}
+
+		if (--n_unfinished == 0 || released)
+		{
+			// Synchronize with threads about to wait for ready tasks so that they don't miss the notification
+			{
+				std::lock_guard<std::mutex> lk (mux);
+			}
+			readyCond.notify_all();
+		}
+	}
+
+	bool ThreadPool::next_task (size_t idx, size_t& task)
+	{
+		// Own tasks first, in the dealt order
+		{
+			TaskQueue& q = *queues[idx];
+			std::lock_guard<std::mutex> lk (q.mux);
+			if (! q.items.empty())
+			{
+				task = q.items.front();
+				q.items.pop_front();
+				n_queued--;
+				return true;
+			}
+		}
+
+		// Steal the cheapest task of another participant
+		for (size_t k = 1; k < n_participants; k++)
+		{
+			TaskQueue& q = *queues[(idx + k) % n_participants];
+			std::lock_guard<std::mutex> lk (q.mux);
+			if (! q.items.empty())
+			{
+				task = q.items.back();
+				q.items.pop_back();
+				n_queued--;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	std::vector<std::pair<size_t, size_t>> split_by_cost (const std::vector<size_t>& costs, int n_threads)
+	{
+		const size_t tasksPerThread = 8;
+
+		size_t total = 0;
+		for (auto c : costs)
+			total += c;
+		size_t grain = std::max (total / (std::max(n_threads, 1) * tasksPerThread), size_t(1));
+
+		std::vector<std::pair<size_t, size_t>> ranges;
+		size_t start = 0,
+			acc = 0;
+		for (size_t i = 0; i < costs.size(); i++)
+		{
+			acc += costs[i];
+			if (acc >= grain)
+			{
+				ranges.push_back ({ start, i + 1 });
+				start = i + 1;
+				acc = 0;
+			}
+		}
+		if (start < costs.size())
+			ranges.push_back ({ start, costs.size() });
+
+		return ranges;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Nyxus
+{
+	/// @brief Persistent pool of worker threads executing batches of tasks. Each thread taking part in a batch owns a deque of tasks
+	/// and, having exhausted it, steals tasks from the back of other threads' deques. The thread submitting a batch takes part in
+	/// executing it too, so a batch run on 1 thread is executed serially by the caller.
+	class ThreadPool
+	{
+	public:
+		using Task = std::function<void()>;
+
+		ThreadPool() = default;
+
+		/// @brief Makes worker threads call 'worker_init' before taking part in batches
+		explicit ThreadPool (std::function<void()> worker_init) : workerInit (std::move(worker_init)) {}
+		ThreadPool (const ThreadPool&) = delete;
+		ThreadPool& operator= (const ThreadPool&) = delete;
+		~ThreadPool();
+
+		/// @brief Executes 'tasks' on 'n_threads' threads (the calling one included) and returns when all of them are finished, i.e. acts as a
+		/// barrier. Tasks are dealt to threads' deques round-robin, so tasks listed in the order of decreasing cost are spread evenly. The
+		/// first exception thrown by a task is rethrown after the barrier. Tasks submitting batches of their own are executed serially.
+		void run (std::vector<Task>& tasks, int n_threads);
+
+		/// @brief Executes 'tasks' like run() respecting dependencies between them: task i is started after 'n_prerequisites[i]' tasks
+		/// listing it among their 'successors' have finished. A task made ready by a finished one is queued to the thread that finished
+		/// it. Empty tasks can be used to join and fork dependencies of groups of tasks.
+		void run (std::vector<Task>& tasks, const std::vector<std::vector<size_t>>& successors, const std::vector<size_t>& n_prerequisites, int n_threads);
+
+		/// @brief Number of worker threads started so far
+		size_t num_workers() const { return workers.size(); }
+
+	private:
+		struct TaskQueue
+		{
+			std::mutex mux;
+			std::deque<size_t> items;
+		};
+
+		void grow (size_t n_workers);
+		void worker_loop (size_t idx);
+		void participate (size_t idx);
+		bool next_task (size_t idx, size_t& task);
+		void finish_task (size_t idx, size_t task);
+		static void run_serially (std::vector<Task>& tasks, const std::vector<std::vector<size_t>>& successors, const std::vector<size_t>& n_prerequisites);
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<TaskQueue>> queues;	// [i] is worker i's, [n_threads-1] is the submitting thread's
+
+		std::mutex runMux,	// serializes batches
+			mux,	// guards the batch state below
+			errorMux;
+		std::condition_variable startCond,
+			readyCond,	// a task got queued or the batch is over
+			doneCond;
+		std::vector<Task>* batch = nullptr;
+		const std::vector<std::vector<size_t>>* successors = nullptr;
+		std::unique_ptr<std::atomic<size_t>[]> n_waiting;	// per task, number of unfinished prerequisites
+		std::atomic<size_t> n_queued {0},
+			n_unfinished {0};
+		size_t generation = 0,
+			n_participants = 0,
+			n_busy_workers = 0;
+		bool stopping = false;
+		std::function<void()> workerInit;
+		std::exception_ptr error;
+	};
+
+	/// @brief Splits items listed in the order of decreasing cost into consecutive ranges [first, second) of comparable total cost making
+	/// a few tasks per thread. Items costlier than a task's share get ranges of their own.
+	std::vector<std::pair<size_t, size_t>> split_by_cost (const std::vector<size_t>& costs, int n_threads);
+
+	/// @brief Worker pool of the current context
+	ThreadPool& theThreadPool();
+}
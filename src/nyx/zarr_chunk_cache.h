@@ -0,0 +1,119 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// @brief LRU cache of decoded OME-Zarr chunks shared by the loaders of a feature extraction context (see Nyxus::NyxusContext). 
+/// Chunks outlive loaders, so chunks revisited by later phases (e.g. host tiles of oversized ROIs) aren't decompressed again. 
+/// A chunk being decoded by a loader is waited for by other loaders rather than decoded twice
+/// @tparam DataType Type of decoded samples
+template<class DataType>
+class ZarrChunkCache
+{
+public:
+    using Chunk = std::shared_ptr<const std::vector<DataType>>;
+
+    /// @brief Sets the limit of the decoded data size, evicting least recently used chunks if necessary. 0 disables caching
+    void set_capacity(size_t capacity_bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity_bytes;
+        evict();
+    }
+
+    size_t capacity()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_;
+    }
+
+    /// @brief Drops all the chunks
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lru_.clear();
+        index_.clear();
+        size_ = 0;
+    }
+
+    /// @brief Returns the chunk of 'key' if it's cached. Otherwise, unless another loader is decoding the chunk, 
+    /// returns nullptr and reserves the key for the caller who must then call publish() or abandon()
+    Chunk acquire(const std::string& key)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            auto it = index_.find(key);
+            if (it != index_.end())
+            {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                return it->second->second;
+            }
+            if (inflight_.count(key) == 0)
+                break;
+            cv_.wait(lock);
+        }
+        inflight_.insert(key);
+        return nullptr;
+    }
+
+    /// @brief Caches a chunk decoded under a key reserved by acquire()
+    void publish(const std::string& key, Chunk chunk)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inflight_.erase(key);
+            size_t szb = chunk->size() * sizeof(DataType);
+            if (szb <= capacity_ && index_.find(key) == index_.end())
+            {
+                lru_.emplace_front(key, std::move(chunk));
+                index_[key] = lru_.begin();
+                size_ += szb;
+                evict();
+            }
+        }
+        cv_.notify_all();
+    }
+
+    /// @brief Releases a key reserved by acquire() when the chunk couldn't be decoded
+    void abandon(const std::string& key)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inflight_.erase(key);
+        }
+        cv_.notify_all();
+    }
+
+private:
+    void evict()
+    {
+        while (size_ > capacity_ && ! lru_.empty())
+        {
+            size_ -= lru_.back().second->size() * sizeof(DataType);
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::list<std::pair<std::string, Chunk>> lru_;      ///< Most recently used chunks first
+    std::unordered_map<std::string, typename std::list<std::pair<std::string, Chunk>>::iterator> index_;
+    std::unordered_set<std::string> inflight_;         ///< Keys of chunks being decoded
+    size_t capacity_ = 256L * 1024L * 1024L,            ///< [bytes]
+        size_ = 0;
+};
+
+namespace Nyxus
+{
+	/// @brief Chunk cache of the current context. OME-Zarr files are always read in 32-bit tiles
+	ZarrChunkCache<uint32_t>& theZarrChunkCache();
+}
@@ -0,0 +1,167 @@
+#define _USE_MATH_DEFINES	// For M_PI, etc.
+// Compares the feature-major (default) and the ROI-major (--reduceOrder=roi) ways of reducing trivial ROIs on a synthetic
+// small-cell image: a grid of elliptic cells a few pixels in radius, all the features enabled.
+//
+// Usage: benchReduceOrder [<number of cells> [<number of reduction threads> [<number of repetitions>]]]
+//
+// Built only when configured with -DBUILD_BENCHMARKS=ON
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../src/nyx/environment.h"
+#include "../src/nyx/feature_values.h"
+#include "../src/nyx/globals.h"
+
+using namespace Nyxus;
+
+// Scans a grid of synthetic cells into 'roiData' the way phases 1 and 2 do and returns their labels
+static std::vector<int> make_cells (int n_cells)
+{
+	const int spacing = 24;
+	int n_cols = (int) std::ceil (std::sqrt (n_cells));
+
+	std::mt19937 rng (12345);	// same cells in every repetition
+	std::uniform_real_distribution<double> radius (4.0, 10.0),
+		angle (0.0, M_PI);
+	std::normal_distribution<double> noise (0.0, 40.0);
+
+	std::vector<int> labels;
+	for (int c = 0; c < n_cells; c++)
+	{
+		int label = c + 1,
+			cx = (c % n_cols) * spacing + spacing / 2,
+			cy = (c / n_cols) * spacing + spacing / 2;
+		double a = radius (rng),
+			b = radius (rng),
+			phi = angle (rng),
+			peak = 1000 + 50 * (c % 20);
+
+		LR& r = roiData()[label];
+		for (int y = cy - spacing / 2; y < cy + spacing / 2; y++)
+			for (int x = cx - spacing / 2; x < cx + spacing / 2; x++)
+			{
+				double u = (x - cx) * std::cos(phi) + (y - cy) * std::sin(phi),
+					v = -(x - cx) * std::sin(phi) + (y - cy) * std::cos(phi),
+					d2 = u * u / (a * a) + v * v / (b * b);
+				if (d2 > 1.0)
+					continue;
+
+				PixIntens intensity = (PixIntens) std::max (1.0, peak * (1.0 - 0.5 * d2) + noise (rng));
+				if (r.aux_area == 0)
+					init_label_record_2 (r, "synthetic", "synthetic", x, y, label, intensity, 0);
+				else
+					update_label_record_2 (r, x, y, label, intensity, 0);
+				r.raw_pixels.push_back (Pixel2 (x, y, intensity));
+			}
+		r.initialize_fvals();
+		labels.push_back (label);
+	}
+
+	return labels;
+}
+
+// Returns the time in seconds of reducing the cells in the specified order. Keeps the feature values of the first 'n_kept' cells in 'kept'
+static double reduce_cells (int n_cells, bool roi_major, size_t n_kept, std::vector<std::vector<StatsReal>>& kept)
+{
+	clear_feature_buffers();
+	std::vector<int> Pending = make_cells (n_cells);
+	reserveTrivialRoisArena (Pending, true);
+	allocateTrivialRoisBuffers (Pending);
+
+	theEnvironment().roi_major_reduce = roi_major;
+	auto start = std::chrono::steady_clock::now();
+	reduce_trivial_rois (Pending);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	kept.clear();
+	for (size_t i = 0; i < std::min (n_kept, Pending.size()); i++)
+	{
+		std::vector<StatsReal> row;
+		for (auto& enabdF : theFeatureSet().getEnabledFeatures())
+			for (auto x : roiData()[Pending[i]].fvals[std::get<1>(enabdF)])
+				row.push_back (x);
+		kept.push_back (row);
+	}
+
+	freeTrivialRoisBuffers (Pending);
+	return elapsed.count();
+}
+
+static bool same_values (const std::vector<std::vector<StatsReal>>& A, const std::vector<std::vector<StatsReal>>& B)
+{
+	if (A.size() != B.size())
+		return false;
+	for (size_t i = 0; i < A.size(); i++)
+	{
+		if (A[i].size() != B[i].size())
+			return false;
+		for (size_t k = 0; k < A[i].size(); k++)
+		{
+			double a = A[i][k],
+				b = B[i][k];
+			if (std::isnan(a) && std::isnan(b))
+				continue;
+			if (std::abs(a - b) > 1e-9 * std::max (1.0, std::abs(a)))
+				return false;
+		}
+	}
+	return true;
+}
+
+int main (int argc, char** argv)
+{
+	int n_cells = argc > 1 ? std::atoi(argv[1]) : 2000,
+		n_threads = argc > 2 ? std::atoi(argv[2]) : 1,
+		n_reps = argc > 3 ? std::atoi(argv[3]) : 3;
+	if (n_cells <= 0 || n_threads <= 0 || n_reps <= 0)
+	{
+		std::cout << "Usage: " << argv[0] << " [<number of cells> [<number of reduction threads> [<number of repetitions>]]]\n";
+		return 1;
+	}
+
+	theEnvironment().n_reduce_threads = n_threads;
+	theFeatureSet().enableAll();
+	if (! theFeatureMgr().compile())
+	{
+		std::cout << "Error: compiling feature methods failed\n";
+		return 1;
+	}
+	theFeatureMgr().apply_user_selection();
+
+	// Lay out feature value rows like processDataset() does
+	std::vector<AvailableFeatures> F;
+	for (auto& enabdF : theFeatureSet().getEnabledFeatures())
+		F.push_back (std::get<1>(enabdF));
+	F.push_back (MEAN);
+	theFeatureValueLayout().build (theFeatureMgr().get_calculated_features(F));
+	init_feature_buffers();
+
+	std::cout << n_cells << " cells, " << n_threads << " reduction thread(s), best of " << n_reps << " repetition(s)\n";
+
+	// Alternate the orders so that both see the same machine state
+	const size_t n_kept = 100;
+	double bestFeatureMajor = 1e30,
+		bestRoiMajor = 1e30;
+	std::vector<std::vector<StatsReal>> featureMajorVals, roiMajorVals;
+	for (int i = 0; i < n_reps; i++)
+	{
+		bestFeatureMajor = std::min (bestFeatureMajor, reduce_cells (n_cells, false, n_kept, featureMajorVals));
+		bestRoiMajor = std::min (bestRoiMajor, reduce_cells (n_cells, true, n_kept, roiMajorVals));
+	}
+
+	std::cout << "\tfeature-major\t" << bestFeatureMajor << " s\n"
+		<< "\tROI-major\t" << bestRoiMajor << " s\n"
+		<< "\tspeedup\t" << bestFeatureMajor / bestRoiMajor << "\n";
+
+	if (! same_values (featureMajorVals, roiMajorVals))
+	{
+		std::cout << "Error: feature values calculated in the two orders differ\n";
+		return 1;
+	}
+	return 0;
+}
@@ -4,6 +4,12 @@
 #include "../src/nyx/globals.h"
 #include "test_pixel_intensity_features.h"
 #include "test_initialization.h"
+#include "test_roi_store.h"
+#include "test_thread_pool.h"
+#include "test_context.h"
+#include "test_pixel_cloud.h"
+#include "test_paged_matrix.h"
+#include "test_roi_masking.h"
 
 TEST(TEST_NYXUS, TEST_GABOR){
     test_gabor();
@@ -103,6 +109,46 @@ TEST(TEST_NYXUS, TEST_PIXEL_INTENSITY_UNIFORMITY_PIU)
 	ASSERT_NO_THROW(test_pixel_intensity_uniformity_piu());
 }
 
+TEST(TEST_NYXUS, TEST_ROI_STORE) 
+{
+	ASSERT_NO_THROW(test_roi_store());
+}
+
+TEST(TEST_NYXUS, TEST_THREAD_POOL) 
+{
+	ASSERT_NO_THROW(test_thread_pool());
+}
+
+TEST(TEST_NYXUS, TEST_PIXEL_INTENSITY_ONLINE) 
+{
+	ASSERT_NO_THROW(test_pixel_intensity_online());
+}
+
+TEST(TEST_NYXUS, TEST_CONCURRENT_CONTEXTS) 
+{
+	ASSERT_NO_THROW(test_concurrent_contexts());
+}
+
+TEST(TEST_NYXUS, TEST_CONTEXT_TEMP_DIRS) 
+{
+	ASSERT_NO_THROW(test_context_temp_dirs());
+}
+
+TEST(TEST_NYXUS, TEST_OUT_OF_RAM_PIXEL_CLOUD) 
+{
+	ASSERT_NO_THROW(test_out_of_ram_pixel_cloud());
+}
+
+TEST(TEST_NYXUS, TEST_PAGED_IMAGE_MATRIX) 
+{
+	ASSERT_NO_THROW(test_paged_image_matrix());
+}
+
+TEST(TEST_NYXUS, TEST_OVERSIZED_ROI_MASKING) 
+{
+	ASSERT_NO_THROW(test_oversized_roi_masking());
+}
+
 int main(int argc, char **argv) 
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,127 @@
+#pragma once
+
+#if __has_include(<filesystem>)
+  #include <filesystem>
+  namespace fs = std::filesystem;
+#elif __has_include(<experimental/filesystem>)
+  #include <experimental/filesystem> 
+  namespace fs = std::experimental::filesystem;
+#else
+  error "Missing the <filesystem> header."
+#endif
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../src/nyx/environment.h"
+#include "../src/nyx/globals.h"
+#include "../src/nyx/nyxus_context.h"
+#include "../src/nyx/features/image_matrix_nontriv.h"
+#include "test_data.h"
+#include "test_main_nyxus.h"
+
+// Extracts features of the test ROI in the context bound to the calling thread and returns their values in the order of 'features'
+static std::vector<std::vector<StatsReal>> extract_in_context (const std::vector<AvailableFeatures>& features, const std::vector<int>& glcm_angles)
+{
+    theEnvironment().n_reduce_threads = 2;
+    theEnvironment().glcmAngles = glcm_angles;
+    theFeatureSet().enableAll (false);
+    for (auto f : features)
+        theFeatureSet().enableFeature (f);
+    if (! theFeatureMgr().compile())
+        return {};
+    theFeatureMgr().apply_user_selection();
+    theFeatureValueLayout().build (theFeatureMgr().get_calculated_features (features));
+
+    int label = 1;
+    LR& r = roiData()[label];
+    load_test_roi_data (r);
+    r.initialize_fvals();
+
+    std::vector<int> pending { label };
+    reserveTrivialRoisArena (pending, true);
+    allocateTrivialRoisBuffers (pending);
+    reduce_trivial_rois (pending);
+    freeTrivialRoisBuffers (pending);
+
+    std::vector<std::vector<StatsReal>> vals;
+    for (auto f : features)
+        vals.push_back (r.fvals[f].to_vector());
+    return vals;
+}
+
+void test_concurrent_contexts()
+{
+    // Two extractions with different parameters and feature selections running at the same time
+    NyxusContext ctxA, ctxB;
+    std::vector<std::vector<StatsReal>> valsA, valsB;
+    std::thread tA ([&] { ContextBinding b (ctxA); valsA = extract_in_context ({ MEAN }, { 0, 45, 90, 135 }); }),
+        tB ([&] { ContextBinding b (ctxB); valsB = extract_in_context ({ MEAN, GLCM_CONTRAST }, { 0, 90 }); });
+    tA.join();
+    tB.join();
+
+    // Same results as lone extractions
+    NyxusContext ctxLone;
+    std::vector<std::vector<StatsReal>> valsLone;
+    {
+        ContextBinding b (ctxLone);
+        valsLone = extract_in_context ({ MEAN, GLCM_CONTRAST }, { 0, 90 });
+    }
+    ASSERT_EQ(valsA.size(), 1);
+    ASSERT_EQ(valsB.size(), 2);
+    ASSERT_EQ(valsLone.size(), 2);
+    ASSERT_TRUE(agrees_gt(valsA[0][0], 3.256638961038961e+04));
+    ASSERT_TRUE(agrees_gt(valsB[0][0], 3.256638961038961e+04));
+    ASSERT_EQ(valsB[1].size(), 2);
+    ASSERT_EQ(valsB[1], valsLone[1]);
+    ASSERT_NE(valsB[1][0], 0);
+
+    // ... of the features laid out by each context's own selection and parameters
+    ASSERT_EQ(ctxA.featureValueLayout.offset(GLCM_CONTRAST), FeatureValueLayout::ABSENT);
+    ASSERT_NE(ctxB.featureValueLayout.offset(GLCM_CONTRAST), FeatureValueLayout::ABSENT);
+    ASSERT_EQ(ctxB.featureValueLayout.width(GLCM_CONTRAST), 2);
+    ASSERT_EQ(ctxA.roiData.size(), 1);
+    ASSERT_EQ(ctxB.roiData.size(), 1);
+}
+
+// Temporary files of contexts processing ROIs of the same labels
+void test_context_temp_dirs()
+{
+    std::string dirA, dirB;
+    {
+        NyxusContext ctxA, ctxB;
+        {
+            ContextBinding b (ctxA);
+            dirA = theTempDirPath();
+        }
+        {
+            ContextBinding b (ctxB);
+            dirB = theTempDirPath();
+        }
+        ASSERT_NE(dirA, dirB);
+        ASSERT_TRUE(fs::is_directory (dirA));
+        ASSERT_TRUE(fs::is_directory (dirB));
+        ASSERT_EQ(dirA, ctxA.tempDir.get (""));
+
+        // ... and files of the same names don't clash
+        OutOfRamPixelCloud cloudA, cloudB;
+        {
+            ContextBinding b (ctxA);
+            cloudA.init (1, "test_context_temp_dirs");
+        }
+        {
+            ContextBinding b (ctxB);
+            cloudB.init (1, "test_context_temp_dirs");
+        }
+        cloudA.add_pixel (Pixel2 (1, 2, PixIntens(3)));
+        cloudB.add_pixel (Pixel2 (4, 5, PixIntens(6)));
+        ASSERT_EQ(cloudA.get_at(0).inten, 3);
+        ASSERT_EQ(cloudB.get_at(0).inten, 6);
+        cloudA.clear();
+        cloudB.clear();
+    }
+
+    // Gone along with the contexts
+    ASSERT_FALSE(fs::exists (dirA));
+    ASSERT_FALSE(fs::exists (dirB));
+}
@@ -31,13 +31,13 @@ void test_initialization() {
         
         load_test_roi_data(roi, i, false);
 
-        roiData[i] = roi;
+        roiData()[i] = std::move(roi);
     }
 
     allocateTrivialRoisBuffers(pending);
 
     for(int i = 0; i < pending.size(); ++i){
-        LR& r = roiData[i];
+        LR& r = roiData()[i];
 
         const ImageMatrix& im = r.aux_image_matrix;
 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdexcept>
+#include <gtest/gtest.h>
+
+#include "../src/nyx/environment.h"
+#include "../src/nyx/features/image_matrix_nontriv.h"
+
+// Out of RAM image matrix of more pages than the RAM limit lets it keep resident
+void test_paged_image_matrix()
+{
+    // Restores the RAM limit however the test ends
+    struct RamLimitGuard
+    {
+        size_t saved = Nyxus::theEnvironment().get_ram_limit();
+        ~RamLimitGuard() { Nyxus::theEnvironment().set_ram_limit (saved); }
+    } guard;
+    Nyxus::theEnvironment().set_ram_limit (0);	// the minimum number of resident pages
+
+    int w = 300, h = 200;
+    WriteImageMatrix_nontriv A ("test_paged_matrix_A", 1), B ("test_paged_matrix_B", 1);
+    A.allocate (w, h);
+    ASSERT_EQ(A.size(), w * h);
+
+    // Column-major writes sweeping all the pages for every column, then row-major reads
+    for (int col = 0; col < w; col++)
+        for (int row = 0; row < h; row++)
+            A.set_at (row, col, PixIntens(row * w + col));
+    for (size_t i = 0; i < A.size(); i++)
+        ASSERT_EQ(A.get_at(i), PixIntens(i));
+    ASSERT_EQ(A.get_max(), PixIntens(w * h - 1));
+
+    // Copies are deep
+    B.copy (A);
+    A.set_at (5, 7, 0);
+    ASSERT_EQ(B.get_at(5, 7), PixIntens(5 * w + 7));
+    ASSERT_EQ(A.get_at(5, 7), 0);
+
+    // Reallocation forgets the content
+    A.allocate (w, h, 3);
+    ASSERT_EQ(A.get_at(h - 1, w - 1), 3);
+    ASSERT_EQ(A.get_max(), 3);
+    A.set_at (h - 1, 0, 0);
+    ASSERT_EQ(A.get_chlen(0), h - 1);
+    ASSERT_FALSE(A.safe(h, 0));
+    ASSERT_TRUE(A.safe(h - 1, w - 1));
+
+    // A matrix whose file can't be created
+    ASSERT_THROW(WriteImageMatrix_nontriv ("no_such_dir/test_paged_matrix", 1), std::runtime_error);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../src/nyx/features/image_matrix_nontriv.h"
+
+// Out of RAM pixel cloud spanning several chunks
+void test_out_of_ram_pixel_cloud()
+{
+    OutOfRamPixelCloud cloud;
+    cloud.init (1, "test_pixel_cloud");
+
+    // Blocks of pixels appended one at a time and at once in turn
+    size_t n = 2 * OutOfRamPixelCloud::CHUNK_LEN + 123;
+    std::vector<Pixel2> block;
+    for (size_t i = 0; i < n; i++)
+    {
+        block.push_back (Pixel2 (int(i % 1000), int(i / 1000), PixIntens(i * 7)));
+        if (block.size() < 1000 && i < n - 1)
+            continue;
+
+        if (i / 1000 % 2)
+            cloud.add_pixels (block.data(), block.size());
+        else
+            for (auto& p : block)
+                cloud.add_pixel (p);
+        block.clear();
+    }
+    ASSERT_EQ(cloud.get_size(), n);
+
+    // Sequential access
+    size_t i = 0;
+    for (const Pixel2& p : cloud)
+    {
+        ASSERT_EQ(p.inten, PixIntens(i * 7));
+        i++;
+    }
+    ASSERT_EQ(i, n);
+
+    // Random access
+    for (size_t k : { n - 1, size_t(0), OutOfRamPixelCloud::CHUNK_LEN, size_t(12345) })
+    {
+        Pixel2 p = cloud.get_at (k);
+        ASSERT_EQ(p.x, StatsInt(k % 1000));
+        ASSERT_EQ(p.y, StatsInt(k / 1000));
+    }
+
+    // Appending after reading
+    cloud.add_pixel (Pixel2 (1, 2, PixIntens(3)));
+    ASSERT_EQ(cloud.get_at(n).inten, 3);
+
+    // Moves take the file and its mapping over, the moved-from cloud is empty
+    OutOfRamPixelCloud moved (std::move (cloud));
+    ASSERT_EQ(cloud.get_size(), 0);
+    ASSERT_TRUE(cloud.begin() == cloud.end());
+    ASSERT_EQ(moved.get_size(), n + 1);
+    ASSERT_EQ(moved.get_at(n).inten, 3);
+    ASSERT_EQ(moved.get_at(12345).inten, PixIntens(12345 * 7));
+
+    cloud = std::move (moved);
+    ASSERT_EQ(moved.get_size(), 0);
+    ASSERT_EQ(cloud.get_size(), n + 1);
+    ASSERT_EQ(cloud.get_at(1).inten, 7);
+
+    cloud.reset();
+    ASSERT_EQ(cloud.get_size(), 0);
+    ASSERT_TRUE(cloud.begin() == cloud.end());
+
+    cloud.clear();
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include "../src/nyx/roi_cache.h"
@@ -361,3 +363,56 @@ void test_pixel_intensity_percentiles_iqr()
     ASSERT_TRUE(agrees_gt(roidata.fvals[INTERQUARTILE_RANGE][0], 26171));
 }
 
+
+void test_pixel_intensity_online()
+{
+    // Features calculated from cached pixels
+    LR roidata;
+    load_test_roi_data(roidata);
+    PixelIntensityFeatures f;
+    ASSERT_NO_THROW(f.calculate(roidata));
+    roidata.initialize_fvals();
+    f.save_value(roidata.fvals);
+
+    // ... and from pixels fed online to two instances in turn, then merged
+    PixelIntensityFeatures fa, fb;
+    size_t i = 0;
+    for (auto& px : testData)
+        (i++ % 2 ? fa : fb).osized_add_online_pixel(px.x, px.y, px.intensity);
+    fa.osized_merge_online(fb);
+    LR osized;
+    ASSERT_NO_THROW(fa.osized_calculate(osized, theImLoader()));
+    osized.initialize_fvals();
+    fa.save_value(osized.fvals);
+
+    // Same values as the intensities' range is counted exactly
+    for (auto fcode : { INTEGRATED_INTENSITY, MEAN, MEDIAN, MIN, MAX, RANGE, STANDARD_DEVIATION, STANDARD_ERROR, SKEWNESS, KURTOSIS, 
+        HYPERSKEWNESS, HYPERFLATNESS, MEAN_ABSOLUTE_DEVIATION, ENERGY, ROOT_MEAN_SQUARED, ENTROPY, MODE, UNIFORMITY, UNIFORMITY_PIU, 
+        P01, P10, P25, P75, P90, P99, INTERQUARTILE_RANGE, ROBUST_MEAN_ABSOLUTE_DEVIATION })
+        ASSERT_TRUE(agrees_gt(osized.fvals[fcode][0], roidata.fvals[fcode][0], 1e9));
+
+    // A range too wide to be counted exactly: exact moments, quantiles within the sketch's accuracy
+    OnlineIntensityStats sketchA (1000), sketchB (1000);
+    std::vector<PixIntens> I;
+    for (auto& px : testData)
+        for (PixIntens scale : { 1, 7, 1000 })
+            I.push_back(px.intensity * scale);
+    for (size_t k = 0; k < I.size(); k++)
+        (k < I.size() / 3 ? sketchA : sketchB).add(I[k]);
+    sketchA.merge(sketchB);
+    ASSERT_FALSE(sketchA.exact());
+    ASSERT_EQ(sketchA.count(), I.size());
+    ASSERT_EQ(sketchA.min(), *std::min_element(I.begin(), I.end()));
+    ASSERT_EQ(sketchA.max(), *std::max_element(I.begin(), I.end()));
+
+    MergeableMoments me = MergeableMoments::of_counts(std::vector<double>(I.begin(), I.end()), std::vector<size_t>(I.size(), 1)), 
+        ms = sketchA.moments();
+    ASSERT_TRUE(agrees_gt(ms.mean(), me.mean(), 1e9));
+    for (int p = 2; p <= MergeableMoments::MAX_ORDER; p++)
+        ASSERT_TRUE(agrees_gt(ms.central_sum(p), me.central_sum(p), 1e6));
+
+    std::sort(I.begin(), I.end());
+    size_t n = I.size();
+    double median = n % 2 ? I[n / 2] : (I[n / 2 - 1] + I[n / 2]) / 2.0;
+    ASSERT_TRUE(agrees_gt(std::get<0>(sketchA.get_stats()), median, 1. / OnlineIntensityStats::SKETCH_ACCURACY));
+}
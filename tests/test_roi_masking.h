@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../src/nyx/environment.h"
+#include "../src/nyx/image_loader.h"
+#include "../src/nyx/features/image_matrix_nontriv.h"
+
+// Image held in memory served in tiles. Files named "mask" hold labels, others hold intensities
+class FakeTileLoader : public AbstractTileLoader<uint32_t>
+{
+public:
+    static constexpr size_t W = 11, H = 7, TW = 4, TH = 3;
+
+    FakeTileLoader (const std::string& fpath) : AbstractTileLoader<uint32_t> ("FakeTileLoader", fpath), labels (fpath == "mask") {}
+
+    // Intensities 0-9 with zeros scattered, labels 1 on the left, 2 on the right, and 0 in the middle column
+    static uint32_t intensity (size_t x, size_t y) { return (uint32_t) ((x * 3 + y * 5) % 10); }
+    static uint32_t label (size_t x, size_t y) { return x < W / 2 ? 1 : (x > W / 2 ? 2 : 0); }
+
+    void loadTileFromFile (std::shared_ptr<std::vector<uint32_t>> tile, size_t row, size_t col, size_t layer, size_t level) override
+    {
+        for (size_t i = 0; i < TH; i++)
+            for (size_t k = 0; k < TW; k++)
+            {
+                size_t y = row * TH + i,
+                    x = col * TW + k;
+                (*tile)[i * TW + k] = x >= W || y >= H ? 0 : (labels ? label (x, y) : intensity (x, y));
+            }
+    }
+
+    size_t fullHeight (size_t level) const override { return H; }
+    size_t fullWidth (size_t level) const override { return W; }
+    size_t tileWidth (size_t level) const override { return TW; }
+    size_t tileHeight (size_t level) const override { return TH; }
+    short bitsPerSample() const override { return 32; }
+    size_t numberPyramidLevels() const override { return 1; }
+
+private:
+    bool labels;
+};
+
+// Checks the pixels of a whole-image ROI both streamed and read at random against 'expected (x, y)'
+template <class F>
+static void check_roi_pixels (ImageLoader& imlo, int label, F expected)
+{
+    AABB aabb;
+    aabb.init_x (0);
+    aabb.init_y (0);
+    aabb.update_x (FakeTileLoader::W - 1);
+    aabb.update_y (FakeTileLoader::H - 1);
+
+    OOR_ReadMatrix M (imlo, aabb, label);
+    size_t n_streamed = 0;
+    M.for_each_segment ([&] (size_t row, size_t col, const PixIntens* I, size_t n)
+        {
+            for (size_t k = 0; k < n; k++)
+                ASSERT_EQ(I[k], expected (col + k, row));
+            n_streamed += n;
+        });
+    ASSERT_EQ(n_streamed, FakeTileLoader::W * FakeTileLoader::H);
+
+    for (size_t y = 0; y < FakeTileLoader::H; y++)
+        for (size_t x = 0; x < FakeTileLoader::W; x++)
+            ASSERT_EQ(M.get_at (y, x), expected (x, y));
+}
+
+// Pixels of oversized ROIs kept by their mask, with a labeled mask and in the single-ROI mode where the mask is the intensity image
+void test_oversized_roi_masking()
+{
+    // Restores the mode however the test ends
+    struct SingleRoiGuard
+    {
+        bool saved = Nyxus::theEnvironment().singleROI;
+        ~SingleRoiGuard() { Nyxus::theEnvironment().singleROI = saved; }
+    } guard;
+
+    ImageLoader imlo;
+    imlo.set_tile_loader_factory ([] (const std::string& fpath) { return new FakeTileLoader (fpath); });
+
+    // Pixels of other ROIs and of the background are zeroed
+    Nyxus::theEnvironment().singleROI = false;
+    ASSERT_TRUE(imlo.open ("intensity", "mask"));
+    check_roi_pixels (imlo, 2, [] (size_t x, size_t y) { return FakeTileLoader::label (x, y) == 2 ? FakeTileLoader::intensity (x, y) : 0; });
+
+    // Tiles beyond the image can't be fetched
+    AABB beyond;
+    beyond.init_x (0);
+    beyond.init_y (0);
+    beyond.update_x (FakeTileLoader::W - 1);
+    beyond.update_y (FakeTileLoader::H + FakeTileLoader::TH - 1);
+    OOR_ReadMatrix B (imlo, beyond, 2);
+    ASSERT_THROW(B.get_at (FakeTileLoader::H + FakeTileLoader::TH - 1, 0), std::runtime_error);
+    ASSERT_EQ(B.get_at (0, FakeTileLoader::W - 1), FakeTileLoader::intensity (FakeTileLoader::W - 1, 0));
+
+    // All the pixels belong to the only ROI, whose label is collapsed to 1
+    Nyxus::theEnvironment().singleROI = true;
+    ASSERT_TRUE(imlo.open ("intensity", "intensity"));
+    check_roi_pixels (imlo, 1, [] (size_t x, size_t y) { return FakeTileLoader::intensity (x, y); });
+
+    imlo.close();
+}
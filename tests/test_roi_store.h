@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../src/nyx/roi_cache.h"
+
+// Label-indexed ROI store growing densely, then switching to hashing for a far label
+void test_roi_store()
+{
+    RoiStore store;
+
+    // Dense growth over several chunks of records
+    std::vector<LR*> records;
+    for (int label = 1; label <= 200; label++)
+    {
+        auto [r, isNew] = store.try_emplace (label);
+        ASSERT_TRUE(isNew);
+        r->label = label;
+        records.push_back (r);
+    }
+    ASSERT_EQ(store.size(), 200);
+    ASSERT_FALSE(store.try_emplace(5).second);
+
+    // Missing labels: within the dense table, beyond it, and negative
+    store[300].label = 300;
+    ASSERT_EQ(store.find (250), nullptr);
+    ASSERT_EQ(store.find (301), nullptr);
+    ASSERT_EQ(store.find (100000), nullptr);
+    ASSERT_EQ(store.find (-1), nullptr);
+    ASSERT_FALSE(store.contains (0));
+
+    // A label too far for a dense table switches to hashing. Existing records stay where they are
+    int farLabel = 100000000;
+    store[farLabel].label = farLabel;
+    ASSERT_EQ(store.size(), 202);
+    for (int label = 1; label <= 200; label++)
+    {
+        ASSERT_EQ(store.find (label), records[label - 1]);
+        ASSERT_EQ(store.find (label)->label, label);
+    }
+    ASSERT_EQ(store[300].label, 300);
+    ASSERT_EQ(store.find (farLabel)->label, farLabel);
+    ASSERT_EQ(store.find (250), nullptr);
+    ASSERT_EQ(store.find (-1), nullptr);
+
+    // ... and keep their order of appearance
+    ASSERT_EQ(store.labels().size(), 202);
+    ASSERT_EQ(store.labels()[0], 1);
+    ASSERT_EQ(store.labels()[200], 300);
+    ASSERT_EQ(store.labels()[201], farLabel);
+    int slot = 0;
+    for (LR& r : store)
+        ASSERT_EQ(r.label, store.labels()[slot++]);
+
+    // New labels of both kinds after the switch
+    store[7].label = 7;
+    store[201].label = 201;
+    ASSERT_EQ(store.find (201)->label, 201);
+    ASSERT_EQ(store.size(), 203);
+
+    // Clearing forgets everything and brings dense indexing back
+    store.clear();
+    ASSERT_TRUE(store.empty());
+    ASSERT_EQ(store.find (1), nullptr);
+    ASSERT_EQ(store.find (farLabel), nullptr);
+    ASSERT_TRUE(store.begin() == store.end());
+    store[3].label = 3;
+    ASSERT_EQ(store.size(), 1);
+    ASSERT_EQ(store.find (3)->label, 3);
+
+    // Negative labels go straight to hashing
+    RoiStore negStore;
+    negStore[-5].label = -5;
+    negStore[2].label = 2;
+    ASSERT_EQ(negStore.find (-5)->label, -5);
+    ASSERT_EQ(negStore.find (2)->label, 2);
+    ASSERT_EQ(negStore.find (-4), nullptr);
+    ASSERT_EQ(negStore.find (3), nullptr);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../src/nyx/thread_pool.h"
+
+// Dependent tasks, exceptions thrown by tasks, and batches submitted by tasks
+void test_thread_pool()
+{
+    Nyxus::ThreadPool pool;
+
+    // Layers of tasks, each task of a layer depending on all of the previous layer's via an empty joining task
+    const size_t n_layers = 4, width = 8;
+    std::vector<Nyxus::ThreadPool::Task> tasks;
+    std::vector<std::vector<size_t>> successors;
+    std::vector<size_t> n_prerequisites;
+    std::atomic<int> clock {0};
+    std::vector<int> started (n_layers * width), finished (n_layers * width);
+    for (size_t layer = 0; layer < n_layers; layer++)
+    {
+        size_t join = tasks.size() + width;
+        for (size_t k = 0; k < width; k++)
+        {
+            size_t i = layer * width + k;
+            tasks.push_back ([&, i] { started[i] = clock++; std::this_thread::yield(); finished[i] = clock++; });
+            successors.push_back (layer + 1 < n_layers ? std::vector<size_t> { join } : std::vector<size_t> {});
+            n_prerequisites.push_back (layer > 0 ? 1 : 0);
+        }
+        if (layer + 1 < n_layers)
+        {
+            tasks.push_back (nullptr);
+            std::vector<size_t> next;
+            for (size_t k = 0; k < width; k++)
+                next.push_back (join + 1 + k);
+            successors.push_back (next);
+            n_prerequisites.push_back (width);
+        }
+    }
+
+    // Every task starts after all of the previous layer's have finished
+    for (int n_threads : { 1, 4 })
+        for (int rep = 0; rep < 20; rep++)
+        {
+            clock = 0;
+            pool.run (tasks, successors, n_prerequisites, n_threads);
+            for (size_t layer = 1; layer < n_layers; layer++)
+                for (size_t k = 0; k < width; k++)
+                    for (size_t p = 0; p < width; p++)
+                        ASSERT_GT(started[layer * width + k], finished[(layer - 1) * width + p]);
+        }
+
+    // The first exception is rethrown after all the tasks have finished, and the pool stays usable
+    std::atomic<int> n_done {0};
+    std::vector<Nyxus::ThreadPool::Task> throwing;
+    for (int i = 0; i < 16; i++)
+        throwing.push_back ([&, i]
+            {
+                n_done++;
+                if (i == 5)
+                    throw std::runtime_error ("task failure");
+            });
+    ASSERT_THROW(pool.run (throwing, 4), std::runtime_error);
+    ASSERT_EQ(n_done, 16);
+
+    n_done = 0;
+    throwing.resize (5);
+    ASSERT_NO_THROW(pool.run (throwing, 4));
+    ASSERT_EQ(n_done, 5);
+
+    // Batches submitted by tasks are executed serially by the submitting thread
+    std::atomic<int> n_inner {0}, n_foreign {0};
+    std::vector<Nyxus::ThreadPool::Task> outer;
+    for (int i = 0; i < 8; i++)
+        outer.push_back ([&]
+            {
+                auto self = std::this_thread::get_id();
+                std::vector<Nyxus::ThreadPool::Task> inner;
+                for (int k = 0; k < 4; k++)
+                    inner.push_back ([&, self]
+                        {
+                            n_inner++;
+                            if (std::this_thread::get_id() != self)
+                                n_foreign++;
+                        });
+                pool.run (inner, 4);
+            });
+    pool.run (outer, 4);
+    ASSERT_EQ(n_inner, 32);
+    ASSERT_EQ(n_foreign, 0);
+}